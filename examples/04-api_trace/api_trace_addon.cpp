@@ -3,10 +3,19 @@
  * SPDX-License-Identifier: BSD-3-Clause OR MIT
  */
 
+#include "api_trace_format.hpp"
 #include <reshade.hpp>
 #include <cassert>
-#include <sstream>
+#include <ctime> // std::time, std::strftime
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm> // std::min, std::max
 #include <shared_mutex>
+#include <unordered_map>
 #include <unordered_set>
 
 using namespace reshade::api;
@@ -14,6 +23,10 @@ using namespace reshade::api;
 namespace
 {
 	bool s_do_capture = false;
+	// Write events into a binary capture file instead of the log (see 'api_trace_format.hpp' for the file format)
+	bool s_binary_capture = false;
+	// Number of frames left to capture
+	uint32_t s_capture_frames_remaining = 0;
 	std::shared_mutex s_mutex;
 	std::unordered_set<uint64_t> s_samplers;
 	std::unordered_set<uint64_t> s_resources;
@@ -339,6 +352,254 @@ namespace
 	}
 }
 
+/// <summary>
+/// Single-producer single-consumer ring of 64-bit words, which the thread recording events writes records into and the writer thread reads them back out of.
+/// </summary>
+struct trace_ring
+{
+	static constexpr size_t capacity = 1 << 16; // 512 KiB per thread
+	static constexpr size_t mask = capacity - 1;
+
+	uint32_t thread_id = 0;
+	// Only accessed by the writer thread
+	uint64_t last_timestamp = 0;
+
+	std::atomic<size_t> head = 0;
+	std::atomic<size_t> tail = 0;
+	std::atomic<uint64_t> dropped_records = 0;
+
+	uint64_t words[capacity];
+};
+
+static std::mutex s_ring_mutex;
+static std::vector<std::unique_ptr<trace_ring>> s_rings;
+static thread_local trace_ring *t_ring = nullptr;
+
+static std::thread s_writer_thread;
+static std::atomic<bool> s_writer_running = false;
+
+static inline uint64_t to_arg(uint32_t value) { return value; }
+static inline uint64_t to_arg(uint64_t value) { return value; }
+static inline uint64_t to_arg(int32_t value) { return api_trace::zigzag_encode(value); }
+static inline uint64_t to_arg(float value) { return api_trace::float_to_bits(value); }
+// String arguments are pointers to string literals (as returned by 'to_string'), which stay valid until the add-on is unloaded
+static inline uint64_t to_arg(const char *value) { return reinterpret_cast<uintptr_t>(value); }
+template <typename T>
+static inline uint64_t to_arg(T value, decltype(T::handle) * = nullptr) { return value.handle; }
+
+static void trace_record(command_list *cmd_list, api_trace::trace_event ev, const uint64_t *args, uint32_t arg_count)
+{
+	assert(arg_count <= api_trace::max_args);
+
+	if (!s_binary_capture)
+	{
+		const std::string text = api_trace::format_event(ev, args, arg_count, [](uint64_t value) { return reinterpret_cast<const char *>(static_cast<uintptr_t>(value)); });
+		reshade::log::message(reshade::log::level::info, text.c_str());
+		return;
+	}
+
+	trace_ring *ring = t_ring;
+	if (ring == nullptr)
+	{
+		// First event on this thread, so allocate a ring for it (this is the only time the thread has to lock)
+		const std::unique_lock<std::mutex> lock(s_ring_mutex);
+		ring = s_rings.emplace_back(std::make_unique<trace_ring>()).get();
+		ring->thread_id = GetCurrentThreadId();
+		t_ring = ring;
+	}
+
+	const size_t record_size = 3 + arg_count;
+	const size_t head = ring->head.load(std::memory_order_relaxed);
+	if (head - ring->tail.load(std::memory_order_acquire) + record_size > trace_ring::capacity)
+	{
+		// Never block the application when the writer thread cannot keep up, drop the record instead
+		ring->dropped_records.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	LARGE_INTEGER timestamp;
+	QueryPerformanceCounter(&timestamp);
+
+	ring->words[(head + 0) & trace_ring::mask] = static_cast<uint64_t>(ev) | (static_cast<uint64_t>(arg_count) << 8);
+	ring->words[(head + 1) & trace_ring::mask] = static_cast<uint64_t>(timestamp.QuadPart);
+	ring->words[(head + 2) & trace_ring::mask] = reinterpret_cast<uintptr_t>(cmd_list);
+	for (uint32_t i = 0; i < arg_count; ++i)
+		ring->words[(head + 3 + i) & trace_ring::mask] = args[i];
+
+	ring->head.store(head + record_size, std::memory_order_release);
+}
+template <typename... Args>
+static inline void trace(command_list *cmd_list, api_trace::trace_event ev, Args... args)
+{
+	const uint64_t values[] = { to_arg(args)..., 0 };
+	trace_record(cmd_list, ev, values, static_cast<uint32_t>(sizeof...(Args)));
+}
+
+static void write_trace_file(FILE *file)
+{
+	std::string buffer;
+	buffer.reserve(2 * 1024 * 1024);
+
+	// Map of string literal addresses to the ids they were written to the file with
+	std::unordered_map<uint64_t, uint64_t> string_ids;
+	std::vector<trace_ring *> rings;
+	uint64_t args[api_trace::max_args];
+
+	bool running;
+	do
+	{
+		// Read this before draining, so that all records that were pushed before the capture was stopped are written
+		running = s_writer_running.load(std::memory_order_acquire);
+
+		{	const std::unique_lock<std::mutex> lock(s_ring_mutex);
+			rings.clear();
+			for (const std::unique_ptr<trace_ring> &ring : s_rings)
+				rings.push_back(ring.get());
+		}
+
+		bool processed_any = false;
+
+		for (trace_ring *const ring : rings)
+		{
+			const size_t head = ring->head.load(std::memory_order_acquire);
+			size_t tail = ring->tail.load(std::memory_order_relaxed);
+
+			while (tail != head)
+			{
+				const uint64_t header = ring->words[(tail + 0) & trace_ring::mask];
+				const uint64_t timestamp = ring->words[(tail + 1) & trace_ring::mask];
+				const uint64_t cmd_list = ring->words[(tail + 2) & trace_ring::mask];
+
+				const auto ev = static_cast<api_trace::trace_event>(header & 0xFF);
+				const uint32_t arg_count = static_cast<uint32_t>((header >> 8) & 0xFF);
+				for (uint32_t i = 0; i < arg_count; ++i)
+					args[i] = ring->words[(tail + 3 + i) & trace_ring::mask];
+
+				tail += 3 + arg_count;
+
+				// Replace string literal addresses with ids, defining new strings before the record that references them
+				api_trace::enumerate_event_args(ev, args, arg_count, [&](char kind, const char *, size_t, uint32_t index, uint32_t count, bool) {
+					if (kind != 's')
+						return;
+					for (uint32_t i = index; i < index + count; ++i)
+					{
+						const auto insert = string_ids.emplace(args[i], string_ids.size());
+						if (insert.second)
+						{
+							const char *const string = reinterpret_cast<const char *>(static_cast<uintptr_t>(args[i]));
+							const size_t length = std::strlen(string);
+							buffer.push_back(static_cast<char>(api_trace::chunk_type::string));
+							api_trace::write_varint(buffer, insert.first->second);
+							api_trace::write_varint(buffer, length);
+							buffer.append(string, length);
+						}
+						args[i] = insert.first->second;
+					}
+				});
+
+				buffer.push_back(static_cast<char>(api_trace::chunk_type::record));
+				api_trace::write_varint(buffer, ring->thread_id);
+				buffer.push_back(static_cast<char>(ev));
+				api_trace::write_varint(buffer, timestamp - ring->last_timestamp);
+				api_trace::write_varint(buffer, cmd_list);
+				buffer.push_back(static_cast<char>(arg_count));
+				for (uint32_t i = 0; i < arg_count; ++i)
+					api_trace::write_varint(buffer, args[i]);
+
+				ring->last_timestamp = timestamp;
+			}
+
+			if (tail != ring->tail.load(std::memory_order_relaxed))
+			{
+				ring->tail.store(tail, std::memory_order_release);
+				processed_any = true;
+			}
+		}
+
+		if (buffer.size() >= 1024 * 1024 || !running)
+		{
+			fwrite(buffer.data(), 1, buffer.size(), file);
+			buffer.clear();
+		}
+
+		if (!processed_any && running)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	} while (running);
+
+	for (trace_ring *const ring : rings)
+	{
+		if (const uint64_t dropped_records = ring->dropped_records.exchange(0, std::memory_order_relaxed))
+		{
+			buffer.push_back(static_cast<char>(api_trace::chunk_type::dropped));
+			api_trace::write_varint(buffer, ring->thread_id);
+			api_trace::write_varint(buffer, dropped_records);
+		}
+	}
+
+	fwrite(buffer.data(), 1, buffer.size(), file);
+	fclose(file);
+}
+
+static bool begin_binary_capture()
+{
+	char base_path[260] = "";
+	size_t base_path_size = sizeof(base_path);
+	reshade::get_reshade_base_path(base_path, &base_path_size);
+
+	char time_string[32] = "";
+	const std::time_t t = std::time(nullptr);
+	std::tm tm;
+	localtime_s(&tm, &t);
+	std::strftime(time_string, sizeof(time_string), "%Y-%m-%d_%H-%M-%S", &tm);
+
+	char file_path[320];
+	std::snprintf(file_path, sizeof(file_path), "%s\\api_trace_%s.rstrace", base_path, time_string);
+
+	FILE *file = nullptr;
+	if (fopen_s(&file, file_path, "wb") != 0 || file == nullptr)
+	{
+		reshade::log::message(reshade::log::level::error, "Failed to open API trace capture file for writing!");
+		return false;
+	}
+
+	LARGE_INTEGER frequency, timestamp;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&timestamp);
+
+	const uint64_t header_values[2] = { static_cast<uint64_t>(frequency.QuadPart), static_cast<uint64_t>(timestamp.QuadPart) };
+	fwrite(api_trace::file_magic, 1, sizeof(api_trace::file_magic), file);
+	fwrite(&api_trace::file_version, sizeof(api_trace::file_version), 1, file);
+	fwrite(header_values, sizeof(header_values), 1, file);
+
+	// Discard anything that was left over from threads that were still recording when the last capture finished
+	{	const std::unique_lock<std::mutex> lock(s_ring_mutex);
+		for (const std::unique_ptr<trace_ring> &ring : s_rings)
+		{
+			ring->tail.store(ring->head.load(std::memory_order_acquire), std::memory_order_release);
+			ring->last_timestamp = header_values[1];
+			ring->dropped_records.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	s_writer_running.store(true, std::memory_order_release);
+	s_writer_thread = std::thread(write_trace_file, file);
+
+	std::string message = "Writing API trace to \"";
+	message += file_path;
+	message += "\" ...";
+	reshade::log::message(reshade::log::level::info, message.c_str());
+
+	return true;
+}
+static void end_binary_capture()
+{
+	s_writer_running.store(false, std::memory_order_release);
+	if (s_writer_thread.joinable())
+		s_writer_thread.join();
+
+	reshade::log::message(reshade::log::level::info, "Finished writing API trace.");
+}
+
 static void on_init_swapchain(swapchain *swapchain, bool)
 {
 	const std::unique_lock<std::shared_mutex> lock(s_mutex);
@@ -415,7 +676,7 @@ static void on_destroy_pipeline(device *device, pipeline handle)
 	s_pipelines.erase(handle.handle);
 }
 
-static void on_barrier(command_list *, uint32_t num_resources, const resource *resources, const resource_usage *old_states, const resource_usage *new_states)
+static void on_barrier(command_list *cmd_list, uint32_t num_resources, const resource *resources, const resource_usage *old_states, const resource_usage *new_states)
 {
 	if (!s_do_capture)
 		return;
@@ -429,37 +690,31 @@ static void on_barrier(command_list *, uint32_t num_resources, const resource *r
 #endif
 
 	for (uint32_t i = 0; i < num_resources; ++i)
-	{
-		std::stringstream s;
-		s << "barrier(" << (void *)resources[i].handle << ", " << to_string(old_states[i]) << ", " << to_string(new_states[i]) << ")";
-		reshade::log::message(reshade::log::level::info, s.str().c_str());
-	}
+		trace(cmd_list, api_trace::trace_event::barrier, resources[i], to_string(old_states[i]), to_string(new_states[i]));
 }
 
-static void on_begin_render_pass(command_list *, uint32_t count, const render_pass_render_target_desc *rts, const render_pass_depth_stencil_desc *ds)
+static void on_begin_render_pass(command_list *cmd_list, uint32_t count, const render_pass_render_target_desc *rts, const render_pass_depth_stencil_desc *ds)
 {
 	if (!s_do_capture)
 		return;
 
-	std::stringstream s;
-	s << "begin_render_pass(" << count << ", { ";
+	count = std::min(count, 8u);
+
+	uint64_t args[2 + 8] = { count };
 	for (uint32_t i = 0; i < count; ++i)
-		s << (void *)rts[i].view.handle << ", ";
-	s << " }, " << (ds != nullptr ? (void *)ds->view.handle : 0) << ")";
+		args[1 + i] = rts[i].view.handle;
+	args[1 + count] = (ds != nullptr ? ds->view.handle : 0);
 
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_record(cmd_list, api_trace::trace_event::begin_render_pass, args, 2 + count);
 }
-static void on_end_render_pass(command_list *)
+static void on_end_render_pass(command_list *cmd_list)
 {
 	if (!s_do_capture)
 		return;
 
-	std::stringstream s;
-	s << "end_render_pass()";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::end_render_pass);
 }
-static void on_bind_render_targets_and_depth_stencil(command_list *, uint32_t count, const resource_view *rtvs, resource_view dsv)
+static void on_bind_render_targets_and_depth_stencil(command_list *cmd_list, uint32_t count, const resource_view *rtvs, resource_view dsv)
 {
 	if (!s_do_capture)
 		return;
@@ -473,16 +728,17 @@ static void on_bind_render_targets_and_depth_stencil(command_list *, uint32_t co
 	}
 #endif
 
-	std::stringstream s;
-	s << "bind_render_targets_and_depth_stencil(" << count << ", { ";
+	count = std::min(count, 8u);
+
+	uint64_t args[2 + 8] = { count };
 	for (uint32_t i = 0; i < count; ++i)
-		s << (void *)rtvs[i].handle << ", ";
-	s << " }, " << (void *)dsv.handle << ")";
+		args[1 + i] = rtvs[i].handle;
+	args[1 + count] = dsv.handle;
 
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_record(cmd_list, api_trace::trace_event::bind_render_targets_and_depth_stencil, args, 2 + count);
 }
 
-static void on_bind_pipeline(command_list *, pipeline_stage type, pipeline pipeline)
+static void on_bind_pipeline(command_list *cmd_list, pipeline_stage type, pipeline pipeline)
 {
 	if (!s_do_capture)
 		return;
@@ -494,57 +750,45 @@ static void on_bind_pipeline(command_list *, pipeline_stage type, pipeline pipel
 	}
 #endif
 
-	std::stringstream s;
-	s << "bind_pipeline(" << to_string(type) << ", " << (void *)pipeline.handle << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::bind_pipeline, to_string(type), pipeline);
 }
-static void on_bind_pipeline_states(command_list *, uint32_t count, const dynamic_state *states, const uint32_t *values)
+static void on_bind_pipeline_states(command_list *cmd_list, uint32_t count, const dynamic_state *states, const uint32_t *values)
 {
 	if (!s_do_capture)
 		return;
 
 	for (uint32_t i = 0; i < count; ++i)
-	{
-		std::stringstream s;
-		s << "bind_pipeline_state(" << to_string(states[i]) << ", " << values[i] << ")";
-		reshade::log::message(reshade::log::level::info, s.str().c_str());
-	}
+		trace(cmd_list, api_trace::trace_event::bind_pipeline_state, to_string(states[i]), values[i]);
 }
-static void on_bind_viewports(command_list *, uint32_t first, uint32_t count, const viewport *viewports)
+static void on_bind_viewports(command_list *cmd_list, uint32_t first, uint32_t count, const viewport *viewports)
 {
 	if (!s_do_capture)
 		return;
 
-	std::stringstream s;
-	s << "bind_viewports(" << first << ", " << count << ", { ... })";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::bind_viewports, first, count);
 }
-static void on_bind_scissor_rects(command_list *, uint32_t first, uint32_t count, const rect *rects)
+static void on_bind_scissor_rects(command_list *cmd_list, uint32_t first, uint32_t count, const rect *rects)
 {
 	if (!s_do_capture)
 		return;
 
-	std::stringstream s;
-	s << "bind_scissor_rects(" << first << ", " << count << ", { ... })";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::bind_scissor_rects, first, count);
 }
-static void on_push_constants(command_list *, shader_stage stages, pipeline_layout layout, uint32_t param_index, uint32_t first, uint32_t count, const void *values)
+static void on_push_constants(command_list *cmd_list, shader_stage stages, pipeline_layout layout, uint32_t param_index, uint32_t first, uint32_t count, const void *values)
 {
 	if (!s_do_capture)
 		return;
 
-	std::stringstream s;
-	s << "push_constants(" << to_string(stages) << ", " << (void *)layout.handle << ", " << param_index << ", " << first << ", " << count << ", { ";
-	for (uint32_t i = 0; i < count; ++i)
-		s << std::hex << static_cast<const uint32_t *>(values)[i] << std::dec << ", ";
-	s << " })";
+	// Only keep the first couple of values, so that the record fits into the argument limit
+	const uint32_t value_count = std::min(count, api_trace::max_args - 5);
 
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	uint64_t args[api_trace::max_args] = { to_arg(to_string(stages)), layout.handle, param_index, first, value_count };
+	for (uint32_t i = 0; i < value_count; ++i)
+		args[5 + i] = static_cast<const uint32_t *>(values)[i];
+
+	trace_record(cmd_list, api_trace::trace_event::push_constants, args, 5 + value_count);
 }
-static void on_push_descriptors(command_list *, shader_stage stages, pipeline_layout layout, uint32_t param_index, const descriptor_table_update &update)
+static void on_push_descriptors(command_list *cmd_list, shader_stage stages, pipeline_layout layout, uint32_t param_index, const descriptor_table_update &update)
 {
 	if (!s_do_capture)
 		return;
@@ -578,24 +822,17 @@ static void on_push_descriptors(command_list *, shader_stage stages, pipeline_la
 	}
 #endif
 
-	std::stringstream s;
-	s << "push_descriptors(" << to_string(stages) << ", " << (void *)layout.handle << ", " << param_index << ", { " << to_string(update.type) << ", " << update.binding << ", " << update.count << " })";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::push_descriptors, to_string(stages), layout, param_index, to_string(update.type), update.binding, update.count);
 }
-static void on_bind_descriptor_tables(command_list *, shader_stage stages, pipeline_layout layout, uint32_t first, uint32_t count, const descriptor_table *tables)
+static void on_bind_descriptor_tables(command_list *cmd_list, shader_stage stages, pipeline_layout layout, uint32_t first, uint32_t count, const descriptor_table *tables)
 {
 	if (!s_do_capture)
 		return;
 
 	for (uint32_t i = 0; i < count; ++i)
-	{
-		std::stringstream s;
-		s << "bind_descriptor_table(" << to_string(stages) << ", " << (void *)layout.handle << ", " << (first + i) << ", " << (void *)tables[i].handle << ")";
-		reshade::log::message(reshade::log::level::info, s.str().c_str());
-	}
+		trace(cmd_list, api_trace::trace_event::bind_descriptor_table, to_string(stages), layout, first + i, tables[i]);
 }
-static void on_bind_index_buffer(command_list *, resource buffer, uint64_t offset, uint32_t index_size)
+static void on_bind_index_buffer(command_list *cmd_list, resource buffer, uint64_t offset, uint32_t index_size)
 {
 	if (!s_do_capture)
 		return;
@@ -607,12 +844,9 @@ static void on_bind_index_buffer(command_list *, resource buffer, uint64_t offse
 	}
 #endif
 
-	std::stringstream s;
-	s << "bind_index_buffer(" << (void *)buffer.handle << ", " << offset << ", " << index_size << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::bind_index_buffer, buffer, offset, index_size);
 }
-static void on_bind_vertex_buffers(command_list *, uint32_t first, uint32_t count, const resource *buffers, const uint64_t *offsets, const uint32_t *strides)
+static void on_bind_vertex_buffers(command_list *cmd_list, uint32_t first, uint32_t count, const resource *buffers, const uint64_t *offsets, const uint32_t *strides)
 {
 	if (!s_do_capture)
 		return;
@@ -626,107 +860,85 @@ static void on_bind_vertex_buffers(command_list *, uint32_t first, uint32_t coun
 #endif
 
 	for (uint32_t i = 0; i < count; ++i)
-	{
-		std::stringstream s;
-		s << "bind_vertex_buffer(" << (first + i) << ", " << (void *)buffers[i].handle << ", " << (offsets != nullptr ? offsets[i] : 0) << ", " << (strides != nullptr ? strides[i] : 0) << ")";
-		reshade::log::message(reshade::log::level::info, s.str().c_str());
-	}
+		trace(cmd_list, api_trace::trace_event::bind_vertex_buffer, first + i, buffers[i], offsets != nullptr ? offsets[i] : static_cast<uint64_t>(0), strides != nullptr ? strides[i] : 0u);
 }
 
-static bool on_draw(command_list *, uint32_t vertices, uint32_t instances, uint32_t first_vertex, uint32_t first_instance)
+static bool on_draw(command_list *cmd_list, uint32_t vertices, uint32_t instances, uint32_t first_vertex, uint32_t first_instance)
 {
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "draw(" << vertices << ", " << instances << ", " << first_vertex << ", " << first_instance << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::draw, vertices, instances, first_vertex, first_instance);
 
 	return false;
 }
-static bool on_draw_indexed(command_list *, uint32_t indices, uint32_t instances, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance)
+static bool on_draw_indexed(command_list *cmd_list, uint32_t indices, uint32_t instances, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance)
 {
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "draw_indexed(" << indices << ", " << instances << ", " << first_index << ", " << vertex_offset << ", " << first_instance << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::draw_indexed, indices, instances, first_index, vertex_offset, first_instance);
 
 	return false;
 }
-static bool on_dispatch(command_list *, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
+static bool on_dispatch(command_list *cmd_list, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
 {
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "dispatch(" << group_count_x << ", " << group_count_y << ", " << group_count_z << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::dispatch, group_count_x, group_count_y, group_count_z);
 
 	return false;
 }
-static bool on_dispatch_mesh(command_list *, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
+static bool on_dispatch_mesh(command_list *cmd_list, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
 {
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "dispatch_mesh(" << group_count_x << ", " << group_count_y << ", " << group_count_z << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::dispatch_mesh, group_count_x, group_count_y, group_count_z);
 
 	return false;
 }
-static bool on_dispatch_rays(command_list *, resource raygen, uint64_t raygen_offset, uint64_t raygen_size, resource miss, uint64_t miss_offset, uint64_t miss_size, uint64_t miss_stride, resource hit_group, uint64_t hit_group_offset, uint64_t hit_group_size, uint64_t hit_group_stride, resource callable, uint64_t callable_offset, uint64_t callable_size, uint64_t callable_stride, uint32_t width, uint32_t height, uint32_t depth)
+static bool on_dispatch_rays(command_list *cmd_list, resource raygen, uint64_t raygen_offset, uint64_t raygen_size, resource miss, uint64_t miss_offset, uint64_t miss_size, uint64_t miss_stride, resource hit_group, uint64_t hit_group_offset, uint64_t hit_group_size, uint64_t hit_group_stride, resource callable, uint64_t callable_offset, uint64_t callable_size, uint64_t callable_stride, uint32_t width, uint32_t height, uint32_t depth)
 {
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "dispatch_rays(" << (void *)raygen.handle << ", " << raygen_offset << ", " << raygen_size << ", " << (void *)miss.handle << ", " << miss_offset << ", " << miss_size << ", " << miss_stride << (void *)hit_group.handle << ", " << hit_group_offset << ", " << hit_group_size << ", " << hit_group_stride << ", " << (void *)callable.handle << ", " << callable_offset << ", " << callable_size << ", " << callable_stride << ", " << width << ", " << height << ", " << depth << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::dispatch_rays, raygen, raygen_offset, raygen_size, miss, miss_offset, miss_size, miss_stride, hit_group, hit_group_offset, hit_group_size, hit_group_stride, callable, callable_offset, callable_size, callable_stride, width, height, depth);
 
 	return false;
 }
-static bool on_draw_or_dispatch_indirect(command_list *, indirect_command type, resource buffer, uint64_t offset, uint32_t draw_count, uint32_t stride)
+static bool on_draw_or_dispatch_indirect(command_list *cmd_list, indirect_command type, resource buffer, uint64_t offset, uint32_t draw_count, uint32_t stride)
 {
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
+	api_trace::trace_event ev = api_trace::trace_event::draw_or_dispatch_indirect;
 	switch (type)
 	{
-	case indirect_command::unknown:
-		s << "draw_or_dispatch_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
-		break;
 	case indirect_command::draw:
-		s << "draw_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
+		ev = api_trace::trace_event::draw_indirect;
 		break;
 	case indirect_command::draw_indexed:
-		s << "draw_indexed_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
+		ev = api_trace::trace_event::draw_indexed_indirect;
 		break;
 	case indirect_command::dispatch:
-		s << "dispatch_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
+		ev = api_trace::trace_event::dispatch_indirect;
 		break;
 	case indirect_command::dispatch_mesh:
-		s << "dispatch_mesh_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
+		ev = api_trace::trace_event::dispatch_mesh_indirect;
 		break;
 	case indirect_command::dispatch_rays:
-		s << "dispatch_rays_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
+		ev = api_trace::trace_event::dispatch_rays_indirect;
 		break;
 	}
 
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, ev, buffer, offset, draw_count, stride);
 
 	return false;
 }
 
-static bool on_copy_resource(command_list *, resource src, resource dst)
+static bool on_copy_resource(command_list *cmd_list, resource src, resource dst)
 {
 	if (!s_do_capture)
 		return false;
@@ -739,14 +951,11 @@ static bool on_copy_resource(command_list *, resource src, resource dst)
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_resource(" << (void *)src.handle << ", " << (void *)dst.handle << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::copy_resource, src, dst);
 
 	return false;
 }
-static bool on_copy_buffer_region(command_list *, resource src, uint64_t src_offset, resource dst, uint64_t dst_offset, uint64_t size)
+static bool on_copy_buffer_region(command_list *cmd_list, resource src, uint64_t src_offset, resource dst, uint64_t dst_offset, uint64_t size)
 {
 	if (!s_do_capture)
 		return false;
@@ -759,14 +968,11 @@ static bool on_copy_buffer_region(command_list *, resource src, uint64_t src_off
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_buffer_region(" << (void *)src.handle << ", " << src_offset << ", " << (void *)dst.handle << ", " << dst_offset << ", " << size << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::copy_buffer_region, src, src_offset, dst, dst_offset, size);
 
 	return false;
 }
-static bool on_copy_buffer_to_texture(command_list *, resource src, uint64_t src_offset, uint32_t row_length, uint32_t slice_height, resource dst, uint32_t dst_subresource, const subresource_box *)
+static bool on_copy_buffer_to_texture(command_list *cmd_list, resource src, uint64_t src_offset, uint32_t row_length, uint32_t slice_height, resource dst, uint32_t dst_subresource, const subresource_box *)
 {
 	if (!s_do_capture)
 		return false;
@@ -779,14 +985,11 @@ static bool on_copy_buffer_to_texture(command_list *, resource src, uint64_t src
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_buffer_to_texture(" << (void *)src.handle << ", " << src_offset << ", " << row_length << ", " << slice_height << ", " << (void *)dst.handle << ", " << dst_subresource << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::copy_buffer_to_texture, src, src_offset, row_length, slice_height, dst, dst_subresource);
 
 	return false;
 }
-static bool on_copy_texture_region(command_list *, resource src, uint32_t src_subresource, const subresource_box *, resource dst, uint32_t dst_subresource, const subresource_box *, filter_mode filter)
+static bool on_copy_texture_region(command_list *cmd_list, resource src, uint32_t src_subresource, const subresource_box *, resource dst, uint32_t dst_subresource, const subresource_box *, filter_mode filter)
 {
 	if (!s_do_capture)
 		return false;
@@ -799,14 +1002,11 @@ static bool on_copy_texture_region(command_list *, resource src, uint32_t src_su
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_texture_region(" << (void *)src.handle << ", " << src_subresource << ", " << (void *)dst.handle << ", " << dst_subresource << ", " << (uint32_t)filter << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::copy_texture_region, src, src_subresource, dst, dst_subresource, static_cast<uint32_t>(filter));
 
 	return false;
 }
-static bool on_copy_texture_to_buffer(command_list *, resource src, uint32_t src_subresource, const subresource_box *, resource dst, uint64_t dst_offset, uint32_t row_length, uint32_t slice_height)
+static bool on_copy_texture_to_buffer(command_list *cmd_list, resource src, uint32_t src_subresource, const subresource_box *, resource dst, uint64_t dst_offset, uint32_t row_length, uint32_t slice_height)
 {
 	if (!s_do_capture)
 		return false;
@@ -819,14 +1019,11 @@ static bool on_copy_texture_to_buffer(command_list *, resource src, uint32_t src
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_texture_to_buffer(" << (void *)src.handle << ", " << src_subresource << ", " << (void *)dst.handle << ", " << dst_offset << ", " << row_length << ", " << slice_height << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::copy_texture_to_buffer, src, src_subresource, dst, dst_offset, row_length, slice_height);
 
 	return false;
 }
-static bool on_resolve_texture_region(command_list *, resource src, uint32_t src_subresource, const subresource_box *, resource dst, uint32_t dst_subresource, uint32_t dst_x, uint32_t dst_y, uint32_t dst_z, format format)
+static bool on_resolve_texture_region(command_list *cmd_list, resource src, uint32_t src_subresource, const subresource_box *, resource dst, uint32_t dst_subresource, uint32_t dst_x, uint32_t dst_y, uint32_t dst_z, format format)
 {
 	if (!s_do_capture)
 		return false;
@@ -839,15 +1036,12 @@ static bool on_resolve_texture_region(command_list *, resource src, uint32_t src
 	}
 #endif
 
-	std::stringstream s;
-	s << "resolve_texture_region(" << (void *)src.handle << ", " << src_subresource << ", { ... }, " << (void *)dst.handle << ", " << dst_subresource << ", " << dst_x << ", " << dst_y << ", " << dst_z << ", " << (uint32_t)format << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::resolve_texture_region, src, src_subresource, dst, dst_subresource, dst_x, dst_y, dst_z, static_cast<uint32_t>(format));
 
 	return false;
 }
 
-static bool on_clear_depth_stencil_view(command_list *, resource_view dsv, const float *depth, const uint8_t *stencil, uint32_t, const rect *)
+static bool on_clear_depth_stencil_view(command_list *cmd_list, resource_view dsv, const float *depth, const uint8_t *stencil, uint32_t, const rect *)
 {
 	if (!s_do_capture)
 		return false;
@@ -859,14 +1053,11 @@ static bool on_clear_depth_stencil_view(command_list *, resource_view dsv, const
 	}
 #endif
 
-	std::stringstream s;
-	s << "clear_depth_stencil_view(" << (void *)dsv.handle << ", " << (depth != nullptr ? *depth : 0.0f) << ", " << (stencil != nullptr ? *stencil : 0) << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::clear_depth_stencil_view, dsv, depth != nullptr ? *depth : 0.0f, stencil != nullptr ? static_cast<uint32_t>(*stencil) : 0u);
 
 	return false;
 }
-static bool on_clear_render_target_view(command_list *, resource_view rtv, const float color[4], uint32_t, const rect *)
+static bool on_clear_render_target_view(command_list *cmd_list, resource_view rtv, const float color[4], uint32_t, const rect *)
 {
 	if (!s_do_capture)
 		return false;
@@ -878,14 +1069,11 @@ static bool on_clear_render_target_view(command_list *, resource_view rtv, const
 	}
 #endif
 
-	std::stringstream s;
-	s << "clear_render_target_view(" << (void *)rtv.handle << ", { " << color[0] << ", " << color[1] << ", " << color[2] << ", " << color[3] << " })";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::clear_render_target_view, rtv, 4u, color[0], color[1], color[2], color[3]);
 
 	return false;
 }
-static bool on_clear_unordered_access_view_uint(command_list *, resource_view uav, const uint32_t values[4], uint32_t, const rect *)
+static bool on_clear_unordered_access_view_uint(command_list *cmd_list, resource_view uav, const uint32_t values[4], uint32_t, const rect *)
 {
 	if (!s_do_capture)
 		return false;
@@ -897,14 +1085,11 @@ static bool on_clear_unordered_access_view_uint(command_list *, resource_view ua
 	}
 #endif
 
-	std::stringstream s;
-	s << "clear_unordered_access_view_uint(" << (void *)uav.handle << ", { " << values[0] << ", " << values[1] << ", " << values[2] << ", " << values[3] << " })";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::clear_unordered_access_view_uint, uav, 4u, values[0], values[1], values[2], values[3]);
 
 	return false;
 }
-static bool on_clear_unordered_access_view_float(command_list *, resource_view uav, const float values[4], uint32_t, const rect *)
+static bool on_clear_unordered_access_view_float(command_list *cmd_list, resource_view uav, const float values[4], uint32_t, const rect *)
 {
 	if (!s_do_capture)
 		return false;
@@ -916,15 +1101,12 @@ static bool on_clear_unordered_access_view_float(command_list *, resource_view u
 	}
 #endif
 
-	std::stringstream s;
-	s << "clear_unordered_access_view_float(" << (void *)uav.handle << ", { " << values[0] << ", " << values[1] << ", " << values[2] << ", " << values[3] << " })";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::clear_unordered_access_view_float, uav, 4u, values[0], values[1], values[2], values[3]);
 
 	return false;
 }
 
-static bool on_generate_mipmaps(command_list *, resource_view srv)
+static bool on_generate_mipmaps(command_list *cmd_list, resource_view srv)
 {
 	if (!s_do_capture)
 		return false;
@@ -936,10 +1118,7 @@ static bool on_generate_mipmaps(command_list *, resource_view srv)
 	}
 #endif
 
-	std::stringstream s;
-	s << "generate_mipmaps(" << (void *)srv.handle << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::generate_mipmaps, srv);
 
 	return false;
 }
@@ -949,10 +1128,7 @@ static bool on_begin_query(command_list *cmd_list, query_heap heap, query_type t
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "begin_query(" << (void *)heap.handle << ", " << to_string(type) << ", " << index << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::begin_query, heap, to_string(type), index);
 
 	return false;
 }
@@ -961,10 +1137,7 @@ static bool on_end_query(command_list *cmd_list, query_heap heap, query_type typ
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "end_query(" << (void *)heap.handle << ", " << to_string(type) << ", " << index << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::end_query, heap, to_string(type), index);
 
 	return false;
 }
@@ -980,15 +1153,12 @@ static bool on_copy_query_heap_results(command_list *cmd_list, query_heap heap,
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_query_heap_results(" << (void *)heap.handle << ", " << to_string(type) << ", " << first << ", " << count << (void *)dest.handle << ", " << dest_offset << ", " << stride << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::copy_query_heap_results, heap, to_string(type), first, count, dest, dest_offset, stride);
 
 	return false;
 }
 
-static bool on_copy_acceleration_structure(command_list *, resource_view source, resource_view dest, acceleration_structure_copy_mode mode)
+static bool on_copy_acceleration_structure(command_list *cmd_list, resource_view source, resource_view dest, acceleration_structure_copy_mode mode)
 {
 	if (!s_do_capture)
 		return false;
@@ -1000,14 +1170,11 @@ static bool on_copy_acceleration_structure(command_list *, resource_view source,
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_acceleration_structure(" << (void *)source.handle << ", " << (void *)dest.handle << ", " << to_string(mode) << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::copy_acceleration_structure, source, dest, to_string(mode));
 
 	return false;
 }
-static bool on_build_acceleration_structure(command_list *, acceleration_structure_type type, acceleration_structure_build_flags flags, uint32_t input_count, const acceleration_structure_build_input *inputs, resource scratch, uint64_t scratch_offset, resource_view source, resource_view dest, acceleration_structure_build_mode mode)
+static bool on_build_acceleration_structure(command_list *cmd_list, acceleration_structure_type type, acceleration_structure_build_flags flags, uint32_t input_count, const acceleration_structure_build_input *inputs, resource scratch, uint64_t scratch_offset, resource_view source, resource_view dest, acceleration_structure_build_mode mode)
 {
 	if (!s_do_capture)
 		return false;
@@ -1019,14 +1186,11 @@ static bool on_build_acceleration_structure(command_list *, acceleration_structu
 	}
 #endif
 
-	std::stringstream s;
-	s << "build_acceleration_structure(" << to_string(type) << ", " << std::hex << static_cast<uint32_t>(flags) << std::dec << ", " << input_count << ", { ... }, " << (void *)scratch.handle << ", " << scratch_offset << ", " << (void *)source.handle << ", " << (void *)dest.handle << ", " << to_string(mode) << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace(cmd_list, api_trace::trace_event::build_acceleration_structure, to_string(type), static_cast<uint32_t>(flags), input_count, scratch, scratch_offset, source, dest, to_string(mode));
 
 	return false;
 }
-static bool on_query_acceleration_structures(command_list *, uint32_t count, const resource_view *acceleration_structures, query_heap heap, query_type type, uint32_t first)
+static bool on_query_acceleration_structures(command_list *cmd_list, uint32_t count, const resource_view *acceleration_structures, query_heap heap, query_type type, uint32_t first)
 {
 	if (!s_do_capture)
 		return false;
@@ -1040,10 +1204,16 @@ static bool on_query_acceleration_structures(command_list *, uint32_t count, con
 	}
 #endif
 
-	std::stringstream s;
-	s << "query_acceleration_structures(" << count << ", " << count << ", { ... }, " << (void *)heap.handle << ", " << to_string(type) << ", " << first << ")";
+	const uint32_t list_count = std::min(count, api_trace::max_args - 4);
+
+	uint64_t args[api_trace::max_args] = { list_count };
+	for (uint32_t i = 0; i < list_count; ++i)
+		args[1 + i] = acceleration_structures[i].handle;
+	args[1 + list_count] = heap.handle;
+	args[2 + list_count] = to_arg(to_string(type));
+	args[3 + list_count] = first;
 
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_record(cmd_list, api_trace::trace_event::query_acceleration_structures, args, 4 + list_count);
 
 	return false;
 }
@@ -1052,23 +1222,67 @@ static void on_present(effect_runtime *runtime)
 {
 	if (s_do_capture)
 	{
-		reshade::log::message(reshade::log::level::info, "present()");
-		reshade::log::message(reshade::log::level::info, "--- End Frame ---");
-		s_do_capture = false;
+		if (s_binary_capture)
+		{
+			trace(nullptr, api_trace::trace_event::present);
+
+			if (--s_capture_frames_remaining != 0)
+				return;
+
+			s_do_capture = false;
+			end_binary_capture();
+		}
+		else
+		{
+			reshade::log::message(reshade::log::level::info, "present()");
+			reshade::log::message(reshade::log::level::info, "--- End Frame ---");
+
+			if (--s_capture_frames_remaining != 0)
+			{
+				reshade::log::message(reshade::log::level::info, "--- Frame ---");
+				return;
+			}
+
+			s_do_capture = false;
+		}
 	}
 	else
 	{
 		// The keyboard shortcut to trigger logging
 		if (runtime->is_key_pressed(VK_F10))
 		{
+			s_binary_capture = false;
+			reshade::get_config_value(nullptr, "API_TRACE", "BinaryCapture", s_binary_capture);
+			s_capture_frames_remaining = 1;
+			reshade::get_config_value(nullptr, "API_TRACE", "CaptureFrameCount", s_capture_frames_remaining);
+			s_capture_frames_remaining = std::max(s_capture_frames_remaining, 1u);
+
+			if (s_binary_capture)
+			{
+				if (!begin_binary_capture())
+					return;
+			}
+			else
+			{
+				reshade::log::message(reshade::log::level::info, "--- Frame ---");
+			}
+
 			s_do_capture = true;
-			reshade::log::message(reshade::log::level::info, "--- Frame ---");
 		}
 	}
 }
+static void on_destroy_effect_runtime(effect_runtime *)
+{
+	// Make sure the writer thread is finished before the add-on may be unloaded
+	if (s_do_capture && s_binary_capture)
+	{
+		s_do_capture = false;
+		end_binary_capture();
+	}
+}
 
 extern "C" __declspec(dllexport) const char *NAME = "API Trace";
-extern "C" __declspec(dllexport) const char *DESCRIPTION = "Example add-on that logs the graphics API calls done by the application of the next frame after pressing a keyboard shortcut.";
+extern "C" __declspec(dllexport) const char *DESCRIPTION = "Example add-on that logs the graphics API calls done by the application of the next frame after pressing a keyboard shortcut (optionally into a compact binary capture file).";
 
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 {
@@ -1127,6 +1341,7 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 		reshade::register_event<reshade::addon_event::query_acceleration_structures>(on_query_acceleration_structures);
 
 		reshade::register_event<reshade::addon_event::reshade_present>(on_present);
+		reshade::register_event<reshade::addon_event::destroy_effect_runtime>(on_destroy_effect_runtime);
 		break;
 	case DLL_PROCESS_DETACH:
 		reshade::unregister_addon(hModule);
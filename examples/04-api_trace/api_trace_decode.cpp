@@ -0,0 +1,408 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+// Standalone decoder for the binary capture files written by the API Trace add-on
+// It only depends on the C++17 standard library, so can be built on any platform, e.g. with "c++ -std=c++17 -O2 -o api_trace_decode api_trace_decode.cpp"
+
+#include "api_trace_format.hpp"
+#include <cmath> // std::isfinite
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm> // std::stable_sort
+#include <unordered_map>
+#include <vector>
+
+enum class output_format
+{
+	text,
+	json,
+	perfetto
+};
+
+struct trace_record
+{
+	uint32_t thread_id;
+	api_trace::trace_event ev;
+	uint64_t timestamp;
+	uint64_t cmd_list;
+	size_t first_arg;
+	uint32_t arg_count;
+};
+
+struct trace_capture
+{
+	uint64_t frequency = 1;
+	uint64_t start_timestamp = 0;
+	std::vector<trace_record> records;
+	std::vector<uint64_t> args;
+	std::unordered_map<uint64_t, std::string> strings;
+	std::vector<std::pair<uint32_t, uint64_t>> dropped_records;
+
+	double to_microseconds(uint64_t timestamp) const
+	{
+		return static_cast<double>(timestamp - start_timestamp) * 1000000.0 / static_cast<double>(frequency);
+	}
+	const std::string &resolve_string(uint64_t id) const
+	{
+		static const std::string unknown = "unknown";
+		const auto it = strings.find(id);
+		return it != strings.end() ? it->second : unknown;
+	}
+};
+
+static void print_usage(const char *path)
+{
+	printf(R"(usage: %s [options] <filename>
+
+Options:
+  -h, --help                Print this help.
+
+  --text                    Output one line of text per event (default).
+  --json                    Output a JSON document with all events and their named arguments.
+  --perfetto                Output a JSON trace in the Chrome trace event format, which can be opened in Perfetto (https://ui.perfetto.dev) or chrome://tracing.
+
+  -o <file>                 Write output to the given file instead of standard output.
+	)", path);
+}
+
+static bool read_capture(const std::vector<uint8_t> &data, trace_capture &capture)
+{
+	constexpr size_t header_size = sizeof(api_trace::file_magic) + sizeof(uint32_t) + 2 * sizeof(uint64_t);
+	if (data.size() < header_size || std::memcmp(data.data(), api_trace::file_magic, sizeof(api_trace::file_magic)) != 0)
+	{
+		std::cerr << "error: not an API trace capture file" << std::endl;
+		return false;
+	}
+
+	uint32_t version;
+	std::memcpy(&version, data.data() + 8, sizeof(version));
+	if (version != api_trace::file_version)
+	{
+		std::cerr << "error: unsupported capture file version " << version << std::endl;
+		return false;
+	}
+
+	std::memcpy(&capture.frequency, data.data() + 12, sizeof(uint64_t));
+	std::memcpy(&capture.start_timestamp, data.data() + 20, sizeof(uint64_t));
+	if (capture.frequency == 0)
+		capture.frequency = 1;
+
+	// Timestamps of records are stored as deltas to the previous record of the same thread
+	std::unordered_map<uint32_t, uint64_t> last_timestamps;
+
+	const uint8_t *it = data.data() + header_size;
+	const uint8_t *const end = data.data() + data.size();
+
+	while (it < end)
+	{
+		const auto type = static_cast<api_trace::chunk_type>(*it++);
+
+		uint64_t values[3] = {};
+		switch (type)
+		{
+		case api_trace::chunk_type::string:
+			if (!api_trace::read_varint(it, end, values[0]) || !api_trace::read_varint(it, end, values[1]) || values[1] > static_cast<uint64_t>(end - it))
+				break;
+			capture.strings[values[0]].assign(reinterpret_cast<const char *>(it), static_cast<size_t>(values[1]));
+			it += values[1];
+			continue;
+		case api_trace::chunk_type::record:
+		{
+			trace_record record;
+			if (!api_trace::read_varint(it, end, values[0]) || it >= end)
+				break;
+			record.thread_id = static_cast<uint32_t>(values[0]);
+			record.ev = static_cast<api_trace::trace_event>(*it++);
+			if (!api_trace::read_varint(it, end, values[1]) || !api_trace::read_varint(it, end, values[2]) || it >= end)
+				break;
+
+			const auto insert = last_timestamps.emplace(record.thread_id, capture.start_timestamp);
+			record.timestamp = insert.first->second += values[1];
+			record.cmd_list = values[2];
+			record.arg_count = *it++;
+			record.first_arg = capture.args.size();
+
+			bool valid = true;
+			for (uint32_t i = 0; i < record.arg_count && valid; ++i)
+				valid = api_trace::read_varint(it, end, capture.args.emplace_back());
+			if (!valid)
+				break;
+
+			capture.records.push_back(record);
+			continue;
+		}
+		case api_trace::chunk_type::dropped:
+			if (!api_trace::read_varint(it, end, values[0]) || !api_trace::read_varint(it, end, values[1]))
+				break;
+			capture.dropped_records.emplace_back(static_cast<uint32_t>(values[0]), values[1]);
+			continue;
+		}
+
+		// Capture files may be cut short if the application exited during a capture, so keep what was read so far
+		std::cerr << "warning: capture file is truncated or corrupt, ignoring data after offset " << (it - data.data()) << std::endl;
+		break;
+	}
+
+	// Records are written grouped by thread, so sort them back into a single timeline
+	std::stable_sort(capture.records.begin(), capture.records.end(),
+		[](const trace_record &a, const trace_record &b) { return a.timestamp < b.timestamp; });
+
+	return true;
+}
+
+static void write_json_string(std::ostream &out, const std::string &value)
+{
+	out << '\"';
+	for (const char c : value)
+	{
+		if (c == '\"' || c == '\\')
+			out << '\\' << c;
+		else if (static_cast<unsigned char>(c) < 0x20)
+			out << ' ';
+		else
+			out << c;
+	}
+	out << '\"';
+}
+static void write_json_value(std::ostream &out, const trace_capture &capture, char kind, uint64_t value)
+{
+	switch (kind)
+	{
+	case 'u':
+		out << value;
+		break;
+	case 'i':
+		out << api_trace::zigzag_decode(value);
+		break;
+	case 'f':
+		if (const float float_value = api_trace::bits_to_float(value); std::isfinite(float_value))
+			out << float_value;
+		else
+			out << "null";
+		break;
+	case 's':
+		write_json_string(out, capture.resolve_string(value));
+		break;
+	default:
+	{
+		std::string text;
+		api_trace::format_arg(text, kind, value, [](uint64_t) { return std::string(); });
+		write_json_string(out, text);
+		break;
+	}
+	}
+}
+static void write_json_args(std::ostream &out, const trace_capture &capture, const trace_record &record)
+{
+	const uint64_t *const args = capture.args.data() + record.first_arg;
+
+	out << '{';
+	bool first = true;
+	api_trace::enumerate_event_args(record.ev, args, record.arg_count, [&](char kind, const char *name, size_t name_length, uint32_t index, uint32_t count, bool is_list) {
+		if (!first)
+			out << ", ";
+		first = false;
+
+		write_json_string(out, std::string(name, name_length));
+		out << ": ";
+
+		if (is_list)
+		{
+			out << '[';
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				if (i != 0)
+					out << ", ";
+				write_json_value(out, capture, kind, args[index + i]);
+			}
+			out << ']';
+		}
+		else
+		{
+			write_json_value(out, capture, kind, args[index]);
+		}
+	});
+	out << '}';
+}
+
+static const char *event_name(api_trace::trace_event ev)
+{
+	return ev < api_trace::trace_event::count ? api_trace::trace_event_infos[static_cast<size_t>(ev)].name : "unknown";
+}
+
+static void write_text(std::ostream &out, const trace_capture &capture)
+{
+	char prefix[64];
+
+	for (const trace_record &record : capture.records)
+	{
+		std::snprintf(prefix, sizeof(prefix), "%12.3f us | %5u | ", capture.to_microseconds(record.timestamp), record.thread_id);
+
+		out << prefix << api_trace::format_event(record.ev, capture.args.data() + record.first_arg, record.arg_count,
+			[&capture](uint64_t value) -> const std::string & { return capture.resolve_string(value); }) << '\n';
+
+		if (record.ev == api_trace::trace_event::present)
+			out << "--- End Frame ---\n";
+	}
+
+	for (const auto &[thread_id, count] : capture.dropped_records)
+		out << "Dropped " << count << " records on thread " << thread_id << " because the ring buffer was full.\n";
+}
+
+static void write_json(std::ostream &out, const trace_capture &capture)
+{
+	out << "{\n\"frequency\": " << capture.frequency << ",\n\"events\": [\n";
+
+	for (size_t i = 0; i < capture.records.size(); ++i)
+	{
+		const trace_record &record = capture.records[i];
+
+		char cmd_list[32];
+		std::snprintf(cmd_list, sizeof(cmd_list), "0x%016llx", static_cast<unsigned long long>(record.cmd_list));
+
+		out << "{\"time_us\": " << capture.to_microseconds(record.timestamp) << ", \"thread\": " << record.thread_id << ", \"command_list\": \"" << cmd_list << "\", \"event\": ";
+		write_json_string(out, event_name(record.ev));
+		out << ", \"args\": ";
+		write_json_args(out, capture, record);
+		out << (i + 1 < capture.records.size() ? "},\n" : "}\n");
+	}
+
+	out << "],\n\"dropped\": [";
+	for (size_t i = 0; i < capture.dropped_records.size(); ++i)
+		out << (i != 0 ? ", " : "") << "{\"thread\": " << capture.dropped_records[i].first << ", \"count\": " << capture.dropped_records[i].second << '}';
+	out << "]\n}\n";
+}
+
+static void write_perfetto(std::ostream &out, const trace_capture &capture)
+{
+	out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+
+	bool first = true;
+	for (const trace_record &record : capture.records)
+	{
+		// Render passes become slices, frames are separated by instant events with global scope, everything else is a thread-scoped instant event
+		const char *phase = "i";
+		if (record.ev == api_trace::trace_event::begin_render_pass)
+			phase = "B";
+		else if (record.ev == api_trace::trace_event::end_render_pass)
+			phase = "E";
+
+		out << (first ? "" : ",\n") << "{\"name\": ";
+		write_json_string(out, record.ev == api_trace::trace_event::end_render_pass ? event_name(api_trace::trace_event::begin_render_pass) : event_name(record.ev));
+		out << ", \"cat\": \"api\", \"ph\": \"" << phase << "\", \"ts\": " << capture.to_microseconds(record.timestamp) << ", \"pid\": 1, \"tid\": " << record.thread_id;
+		if (phase[0] == 'i')
+			out << ", \"s\": \"" << (record.ev == api_trace::trace_event::present ? 'g' : 't') << '\"';
+		out << ", \"args\": ";
+		write_json_args(out, capture, record);
+		out << '}';
+
+		first = false;
+	}
+
+	out << "\n]}\n";
+}
+
+int main(int argc, char *argv[])
+{
+	const char *input_file = nullptr;
+	const char *output_file = nullptr;
+	output_format format = output_format::text;
+
+	// Parse command-line arguments
+	for (int i = 1; i < argc; ++i)
+	{
+		if (const char *arg = argv[i]; arg[0] == '-')
+		{
+			if (0 == std::strcmp(arg, "-h") || 0 == std::strcmp(arg, "--help"))
+			{
+				print_usage(argv[0]);
+				return 0;
+			}
+
+			if (0 == std::strcmp(arg, "--text"))
+			{
+				format = output_format::text;
+				continue;
+			}
+			if (0 == std::strcmp(arg, "--json"))
+			{
+				format = output_format::json;
+				continue;
+			}
+			if (0 == std::strcmp(arg, "--perfetto"))
+			{
+				format = output_format::perfetto;
+				continue;
+			}
+
+			if (0 == std::strcmp(arg, "-o") && i + 1 < argc)
+			{
+				output_file = argv[++i];
+				continue;
+			}
+
+			print_usage(argv[0]);
+			return 1;
+		}
+		else
+		{
+			if (input_file != nullptr)
+			{
+				print_usage(argv[0]);
+				return 1;
+			}
+
+			input_file = arg;
+		}
+	}
+
+	if (input_file == nullptr)
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	std::ifstream file(input_file, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "error: could not open " << input_file << std::endl;
+		return 1;
+	}
+
+	const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	trace_capture capture;
+	if (!read_capture(data, capture))
+		return 1;
+
+	std::ofstream output_stream;
+	if (output_file != nullptr)
+	{
+		output_stream.open(output_file, std::ios::binary);
+		if (!output_stream)
+		{
+			std::cerr << "error: could not open " << output_file << " for writing" << std::endl;
+			return 1;
+		}
+	}
+
+	std::ostream &out = output_file != nullptr ? output_stream : std::cout;
+
+	switch (format)
+	{
+	case output_format::text:
+		write_text(out, capture);
+		break;
+	case output_format::json:
+		write_json(out, capture);
+		break;
+	case output_format::perfetto:
+		write_perfetto(out, capture);
+		break;
+	}
+
+	return 0;
+}
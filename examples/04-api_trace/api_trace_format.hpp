@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#pragma once
+
+#include <cstdio> // std::snprintf
+#include <cstdint>
+#include <cstring> // std::memcpy, std::strchr
+#include <string>
+
+// Binary API trace format, shared between the add-on writing it and the decoder reading it (so this has to stay free of any Windows or ReShade API dependencies)
+//
+// A capture file starts with a header:
+//   char[8]  magic ("RSAPITRC")
+//   uint32_t version
+//   uint64_t timestamp frequency (ticks per second)
+//   uint64_t timestamp of the start of the capture
+// followed by a sequence of chunks, each starting with a chunk type byte:
+//   'S': varint string id, varint length, string characters (defines a string referenced by string arguments of records that follow)
+//   'R': varint thread id, uint8_t event, varint timestamp delta to the previous record of the same thread (or the start of the capture), varint command list, uint8_t argument count, varint arguments
+//   'D': varint thread id, varint number of records that were dropped on that thread because its ring buffer was full
+
+namespace api_trace
+{
+	constexpr char file_magic[8] = { 'R', 'S', 'A', 'P', 'I', 'T', 'R', 'C' };
+	constexpr uint32_t file_version = 1;
+
+	enum class chunk_type : uint8_t
+	{
+		string = 'S',
+		record = 'R',
+		dropped = 'D',
+	};
+
+	enum class trace_event : uint8_t
+	{
+		present,
+		barrier,
+		begin_render_pass,
+		end_render_pass,
+		bind_render_targets_and_depth_stencil,
+		bind_pipeline,
+		bind_pipeline_state,
+		bind_viewports,
+		bind_scissor_rects,
+		push_constants,
+		push_descriptors,
+		bind_descriptor_table,
+		bind_index_buffer,
+		bind_vertex_buffer,
+		draw,
+		draw_indexed,
+		dispatch,
+		dispatch_mesh,
+		dispatch_rays,
+		draw_or_dispatch_indirect,
+		draw_indirect,
+		draw_indexed_indirect,
+		dispatch_indirect,
+		dispatch_mesh_indirect,
+		dispatch_rays_indirect,
+		copy_resource,
+		copy_buffer_region,
+		copy_buffer_to_texture,
+		copy_texture_region,
+		copy_texture_to_buffer,
+		resolve_texture_region,
+		clear_depth_stencil_view,
+		clear_render_target_view,
+		clear_unordered_access_view_uint,
+		clear_unordered_access_view_float,
+		generate_mipmaps,
+		begin_query,
+		end_query,
+		copy_query_heap_results,
+		copy_acceleration_structure,
+		build_acceleration_structure,
+		query_acceleration_structures,
+
+		count
+	};
+
+	/// <summary>
+	/// Maximum number of arguments a single record can have.
+	/// </summary>
+	constexpr uint32_t max_args = 255;
+
+	struct trace_event_info
+	{
+		const char *name;
+		/// <summary>
+		/// Space-separated list of arguments in the form "kind:name", where kind is one of:
+		///   'u' unsigned integer, 'i' signed integer (zigzag encoded), 'h' handle, 'x' hexadecimal integer, 'f' 32-bit float (bit pattern), 's' string (pointer to a string literal in the add-on, string id in a capture file).
+		/// A kind prefixed with '[' is a list, which is stored as the number of elements followed by the elements.
+		/// </summary>
+		const char *args;
+	};
+
+	constexpr trace_event_info trace_event_infos[] = {
+		{ "present", "" },
+		{ "barrier", "h:resource s:old_state s:new_state" },
+		{ "begin_render_pass", "[h:render_targets h:depth_stencil" },
+		{ "end_render_pass", "" },
+		{ "bind_render_targets_and_depth_stencil", "[h:rtvs h:dsv" },
+		{ "bind_pipeline", "s:stages h:pipeline" },
+		{ "bind_pipeline_state", "s:state u:value" },
+		{ "bind_viewports", "u:first u:count" },
+		{ "bind_scissor_rects", "u:first u:count" },
+		{ "push_constants", "s:stages h:layout u:param_index u:first [x:values" },
+		{ "push_descriptors", "s:stages h:layout u:param_index s:type u:binding u:count" },
+		{ "bind_descriptor_table", "s:stages h:layout u:param_index h:table" },
+		{ "bind_index_buffer", "h:buffer u:offset u:index_size" },
+		{ "bind_vertex_buffer", "u:index h:buffer u:offset u:stride" },
+		{ "draw", "u:vertex_count u:instance_count u:first_vertex u:first_instance" },
+		{ "draw_indexed", "u:index_count u:instance_count u:first_index i:vertex_offset u:first_instance" },
+		{ "dispatch", "u:group_count_x u:group_count_y u:group_count_z" },
+		{ "dispatch_mesh", "u:group_count_x u:group_count_y u:group_count_z" },
+		{ "dispatch_rays", "h:raygen u:raygen_offset u:raygen_size h:miss u:miss_offset u:miss_size u:miss_stride h:hit_group u:hit_group_offset u:hit_group_size u:hit_group_stride h:callable u:callable_offset u:callable_size u:callable_stride u:width u:height u:depth" },
+		{ "draw_or_dispatch_indirect", "h:buffer u:offset u:draw_count u:stride" },
+		{ "draw_indirect", "h:buffer u:offset u:draw_count u:stride" },
+		{ "draw_indexed_indirect", "h:buffer u:offset u:draw_count u:stride" },
+		{ "dispatch_indirect", "h:buffer u:offset u:draw_count u:stride" },
+		{ "dispatch_mesh_indirect", "h:buffer u:offset u:draw_count u:stride" },
+		{ "dispatch_rays_indirect", "h:buffer u:offset u:draw_count u:stride" },
+		{ "copy_resource", "h:source h:dest" },
+		{ "copy_buffer_region", "h:source u:source_offset h:dest u:dest_offset u:size" },
+		{ "copy_buffer_to_texture", "h:source u:source_offset u:row_length u:slice_height h:dest u:dest_subresource" },
+		{ "copy_texture_region", "h:source u:source_subresource h:dest u:dest_subresource u:filter" },
+		{ "copy_texture_to_buffer", "h:source u:source_subresource h:dest u:dest_offset u:row_length u:slice_height" },
+		{ "resolve_texture_region", "h:source u:source_subresource h:dest u:dest_subresource u:dest_x u:dest_y u:dest_z u:format" },
+		{ "clear_depth_stencil_view", "h:dsv f:depth u:stencil" },
+		{ "clear_render_target_view", "h:rtv [f:color" },
+		{ "clear_unordered_access_view_uint", "h:uav [u:values" },
+		{ "clear_unordered_access_view_float", "h:uav [f:values" },
+		{ "generate_mipmaps", "h:srv" },
+		{ "begin_query", "h:heap s:type u:index" },
+		{ "end_query", "h:heap s:type u:index" },
+		{ "copy_query_heap_results", "h:heap s:type u:first u:count h:dest u:dest_offset u:stride" },
+		{ "copy_acceleration_structure", "h:source h:dest s:mode" },
+		{ "build_acceleration_structure", "s:type x:flags u:input_count h:scratch u:scratch_offset h:source h:dest s:mode" },
+		{ "query_acceleration_structures", "[h:acceleration_structures h:heap s:type u:first" },
+	};
+	static_assert(sizeof(trace_event_infos) / sizeof(trace_event_infos[0]) == static_cast<size_t>(trace_event::count));
+
+	inline uint64_t zigzag_encode(int64_t value)
+	{
+		return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+	}
+	inline int64_t zigzag_decode(uint64_t value)
+	{
+		return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+	}
+
+	inline uint64_t float_to_bits(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+	inline float bits_to_float(uint64_t value)
+	{
+		const uint32_t bits = static_cast<uint32_t>(value);
+		float result;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	inline void write_varint(std::string &out, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<char>(value));
+	}
+	inline bool read_varint(const uint8_t *&data, const uint8_t *end, uint64_t &value)
+	{
+		value = 0;
+		for (uint32_t shift = 0; data < end && shift < 64; shift += 7)
+		{
+			const uint8_t byte = *data++;
+			value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	/// <summary>
+	/// Walks the arguments of a record according to the argument list of its event.
+	/// Calls <paramref name="callback"/> with the argument kind, the argument name (not null-terminated), its length, the index of the first value in <paramref name="args"/> and the number of values (which is always one for arguments that are not lists).
+	/// </summary>
+	/// <returns><see langword="true"/> if the record contained all arguments the event describes, <see langword="false"/> otherwise.</returns>
+	template <typename F>
+	inline bool enumerate_event_args(trace_event ev, const uint64_t *args, uint32_t arg_count, F callback)
+	{
+		if (ev >= trace_event::count)
+			return false;
+
+		uint32_t index = 0;
+
+		for (const char *spec = trace_event_infos[static_cast<size_t>(ev)].args; *spec != '\0';)
+		{
+			const bool is_list = *spec == '[';
+			if (is_list)
+				++spec;
+
+			const char kind = spec[0];
+			const char *const name = spec + 2;
+			const char *name_end = std::strchr(name, ' ');
+			if (name_end == nullptr)
+				name_end = name + std::strlen(name);
+
+			spec = (*name_end == ' ') ? name_end + 1 : name_end;
+
+			uint32_t count = 1;
+			if (is_list)
+			{
+				if (index >= arg_count)
+					return false;
+				count = static_cast<uint32_t>(args[index++]);
+			}
+
+			if (count > arg_count - index)
+				return false;
+
+			callback(kind, name, static_cast<size_t>(name_end - name), index, count, is_list);
+
+			index += count;
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// Formats a single argument value as text.
+	/// </summary>
+	/// <param name="resolve_string">Function that returns the text of a string argument.</param>
+	template <typename F>
+	inline void format_arg(std::string &out, char kind, uint64_t value, F resolve_string)
+	{
+		char buf[32];
+		switch (kind)
+		{
+		case 'u':
+			std::snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(value));
+			break;
+		case 'i':
+			std::snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(zigzag_decode(value)));
+			break;
+		case 'h':
+			std::snprintf(buf, sizeof(buf), "0x%016llx", static_cast<unsigned long long>(value));
+			break;
+		case 'x':
+			std::snprintf(buf, sizeof(buf), "%llx", static_cast<unsigned long long>(value));
+			break;
+		case 'f':
+			std::snprintf(buf, sizeof(buf), "%g", bits_to_float(value));
+			break;
+		case 's':
+			out += resolve_string(value);
+			return;
+		default:
+			buf[0] = '?';
+			buf[1] = '\0';
+			break;
+		}
+		out += buf;
+	}
+
+	/// <summary>
+	/// Formats a record as text in the form "name(arg0, arg1, { list0, list1 }, ...)".
+	/// </summary>
+	/// <param name="resolve_string">Function that returns the text of a string argument.</param>
+	template <typename F>
+	inline std::string format_event(trace_event ev, const uint64_t *args, uint32_t arg_count, F resolve_string)
+	{
+		if (ev >= trace_event::count)
+			return "unknown()";
+
+		std::string out = trace_event_infos[static_cast<size_t>(ev)].name;
+		out += '(';
+
+		bool first = true;
+		enumerate_event_args(ev, args, arg_count, [&](char kind, const char *, size_t, uint32_t index, uint32_t count, bool is_list) {
+			if (!first)
+				out += ", ";
+			first = false;
+
+			if (is_list)
+			{
+				out += "{ ";
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					format_arg(out, kind, args[index + i], resolve_string);
+					out += ", ";
+				}
+				out += '}';
+			}
+			else
+			{
+				format_arg(out, kind, args[index], resolve_string);
+			}
+		});
+
+		out += ')';
+		return out;
+	}
+}
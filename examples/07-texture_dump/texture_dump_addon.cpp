@@ -9,7 +9,9 @@
 using namespace reshade::api;
 
 // See implementation in 'utils\save_texture_image.cpp'
-extern bool save_texture_image(const resource_desc &desc, const subresource_data &data);
+extern bool save_texture_image(const resource_desc &desc, const subresource_data &data, bool force = false);
+extern void init_texture_image_writer();
+extern void destroy_texture_image_writer();
 
 // There are multiple different ways textures can be initialized, so try and intercept them all:
 // - via initial data provided during texture creation (e.g. for immutable textures, common in D3D11 and OpenGL): See 'on_init_texture' implementation below
@@ -43,6 +45,17 @@ static inline bool filter_texture(device *device, const resource_desc &desc, con
 	return true;
 }
 
+static void on_init_device(device *)
+{
+	// Start the threads that write dumped textures in the background
+	init_texture_image_writer();
+}
+static void on_destroy_device(device *)
+{
+	// Waits for all queued textures to be written
+	destroy_texture_image_writer();
+}
+
 static void on_init_texture(device *device, const resource_desc &desc, const subresource_data *initial_data, resource_usage, resource)
 {
 	if (initial_data == nullptr || !filter_texture(device, desc, nullptr))
@@ -138,6 +151,8 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 	case DLL_PROCESS_ATTACH:
 		if (!reshade::register_addon(hModule))
 			return FALSE;
+		reshade::register_event<reshade::addon_event::init_device>(on_init_device);
+		reshade::register_event<reshade::addon_event::destroy_device>(on_destroy_device);
 		reshade::register_event<reshade::addon_event::init_resource>(on_init_texture);
 		reshade::register_event<reshade::addon_event::update_texture_region>(on_update_texture);
 		reshade::register_event<reshade::addon_event::copy_buffer_to_texture>(on_copy_buffer_to_texture);
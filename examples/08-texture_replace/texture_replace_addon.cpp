@@ -18,6 +18,8 @@ static thread_local std::vector<std::vector<uint8_t>> s_data_to_delete;
 
 // See implementation in 'utils\load_texture_image.cpp'
 extern bool load_texture_image(const resource_desc &desc, subresource_data &data, std::vector<std::vector<uint8_t>> &data_to_delete);
+extern void init_texture_replacements();
+extern void destroy_texture_replacements();
 
 static inline bool filter_texture(device *device, const resource_desc &desc, const subresource_box *box)
 {
@@ -39,6 +41,16 @@ static inline bool filter_texture(device *device, const resource_desc &desc, con
 	return true;
 }
 
+static void on_init_device(device *)
+{
+	// Start indexing the replacement directory and decoding replacement images in the background
+	init_texture_replacements();
+}
+static void on_destroy_device(device *)
+{
+	destroy_texture_replacements();
+}
+
 static bool on_create_texture(device *device, resource_desc &desc, subresource_data *initial_data, resource_usage)
 {
 	if (!filter_texture(device, desc, nullptr))
@@ -163,6 +175,8 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 	case DLL_PROCESS_ATTACH:
 		if (!reshade::register_addon(hModule))
 			return FALSE;
+		reshade::register_event<reshade::addon_event::init_device>(on_init_device);
+		reshade::register_event<reshade::addon_event::destroy_device>(on_destroy_device);
 		reshade::register_event<reshade::addon_event::create_resource>(on_create_texture);
 		reshade::register_event<reshade::addon_event::init_resource>(on_after_create_texture);
 		reshade::register_event<reshade::addon_event::copy_texture_region>(on_copy_texture);
@@ -6,7 +6,7 @@
 #include <imgui.h>
 #include <reshade.hpp>
 #include <vector>
-#include <shared_mutex>
+#include <mutex>
 #include <unordered_map>
 #include <cmath> // std::abs, std::modf
 #include <cstring> // std::strcmp
@@ -15,7 +15,8 @@
 
 using namespace reshade::api;
 
-static std::shared_mutex s_mutex;
+// Protects the per-frame depth-stencil results and the list of destroyed depth-stencils of all devices
+static std::mutex s_mutex;
 
 enum class draw_stats_heuristic : unsigned int
 {
@@ -86,6 +87,14 @@ struct depth_stencil_frame_stats
 	bool reversed_clear_value = false;
 };
 
+// Copy of the counters of a depth-stencil that are needed to select the best match, which can be taken cheaply while the lock is held
+struct depth_stencil_candidate
+{
+	resource resource;
+	draw_stats total_stats;
+	bool copied_during_frame;
+};
+
 struct resource_hash
 {
 	size_t operator()(resource value) const
@@ -98,29 +107,49 @@ struct resource_hash
 struct __declspec(uuid("43319e83-387c-448e-881c-7e68fc2e52c4")) state_tracking
 {
 	const bool is_queue;
+	// Protects the counters of queue state (happens if this is a immediate command list), since another thread may take them in a present call or merge into them in an execute call
+	// Command list state on the other hand is only ever accessed by the thread recording it, so is never locked
+	std::mutex queue_mutex;
 	viewport current_viewport = {};
 	resource current_depth_stencil = { 0 };
 	std::unordered_map<resource, depth_stencil_frame_stats, resource_hash> counters_per_used_depth_stencil;
 	bool first_draw_since_bind = true;
 	draw_stats best_copy_stats;
 
+	// Counters of the depth-stencil that was last accessed, to avoid a hash map lookup for every draw call (references to elements of an unordered map stay valid until they are erased)
+	resource cached_counters_resource = { 0 };
+	depth_stencil_frame_stats *cached_counters = nullptr;
+
 	state_tracking(bool is_queue) : is_queue(is_queue)
 	{
 		// Reserve some space upfront to avoid rehashing during command recording
 		counters_per_used_depth_stencil.reserve(32);
 	}
 
+	depth_stencil_frame_stats &counters_for(resource depth_stencil)
+	{
+		if (cached_counters == nullptr || cached_counters_resource != depth_stencil)
+		{
+			cached_counters = &counters_per_used_depth_stencil[depth_stencil];
+			cached_counters_resource = depth_stencil;
+		}
+		return *cached_counters;
+	}
+
 	void reset()
 	{
 		best_copy_stats = { 0, 0 };
 		counters_per_used_depth_stencil.clear();
+		cached_counters = nullptr;
 		current_depth_stencil = { 0 };
 	}
-	void reset_on_present()
+	void reset_on_present(std::unordered_map<resource, depth_stencil_frame_stats, resource_hash> &frame_counters)
 	{
-		assert(is_queue);
+		assert(is_queue && frame_counters.empty());
 		best_copy_stats = { 0, 0 };
-		counters_per_used_depth_stencil.clear();
+		// Hand the counters of this frame over to the caller in exchange for its empty map, so that the lock only has to be held for the swap (and the storage of both maps is reused)
+		counters_per_used_depth_stencil.swap(frame_counters);
+		cached_counters = nullptr;
 	}
 
 	void merge(const state_tracking &source)
@@ -131,13 +160,17 @@ struct __declspec(uuid("43319e83-387c-448e-881c-7e68fc2e52c4")) state_tracking
 		if (source.best_copy_stats.vertices >= best_copy_stats.vertices)
 			best_copy_stats = source.best_copy_stats;
 
-		if (source.counters_per_used_depth_stencil.empty())
+		merge_counters(source.counters_per_used_depth_stencil);
+	}
+	void merge_counters(const std::unordered_map<resource, depth_stencil_frame_stats, resource_hash> &source_counters_per_used_depth_stencil)
+	{
+		if (source_counters_per_used_depth_stencil.empty())
 			return;
 
-		counters_per_used_depth_stencil.reserve(source.counters_per_used_depth_stencil.size());
-		for (const auto &[depth_stencil_handle, source_counters] : source.counters_per_used_depth_stencil)
+		counters_per_used_depth_stencil.reserve(source_counters_per_used_depth_stencil.size());
+		for (const auto &[depth_stencil_handle, source_counters] : source_counters_per_used_depth_stencil)
 		{
-			depth_stencil_frame_stats &counters = counters_per_used_depth_stencil[depth_stencil_handle];
+			depth_stencil_frame_stats &counters = counters_for(depth_stencil_handle);
 			counters.total_stats.vertices += source_counters.total_stats.vertices;
 			counters.total_stats.drawcalls += source_counters.total_stats.drawcalls;
 			counters.total_stats.drawcalls_indirect += source_counters.total_stats.drawcalls_indirect;
@@ -167,6 +200,9 @@ struct __declspec(uuid("7c6363c7-f94e-437a-9160-141782c44a98")) generic_depth_da
 
 	// True when the shader resource view was created from the backup resource, false when it was created from the original depth-stencil
 	bool using_backup_texture = false;
+
+	// Counters of the depth-stencils of the last frame that are considered for automatic selection (kept around to reuse the storage between frames)
+	std::vector<depth_stencil_candidate> candidates;
 };
 
 struct depth_stencil_backup
@@ -208,9 +244,12 @@ struct __declspec(uuid("e006e162-33ac-4b9f-b10f-0e15335c7bdb")) generic_depth_de
 	// List of queues created for this device
 	std::vector<command_queue *> queues;
 
-	// List of all encountered depth-stencils of the last frame
+	// List of all encountered depth-stencils of the last frame (updated in place in every present call)
 	std::unordered_map<resource, depth_stencil_resource, resource_hash> depth_stencil_resources;
 
+	// Storage the counters of each queue are moved into during a present call (reused across frames)
+	std::unordered_map<resource, depth_stencil_frame_stats, resource_hash> queue_counters;
+
 	// List of depth-stencils that should be tracked throughout each frame and potentially be backed up during clear operations
 	std::vector<depth_stencil_backup> depth_stencil_backups;
 
@@ -239,7 +278,7 @@ struct __declspec(uuid("e006e162-33ac-4b9f-b10f-0e15335c7bdb")) generic_depth_de
 		const device_api api = device->get_api();
 		if (api <= device_api::d3d12)
 		{
-			std::shared_lock<std::shared_mutex> lock(s_mutex);
+			const std::unique_lock<std::mutex> lock(s_mutex);
 			if (depth_stencil_resources.find(resource) == depth_stencil_resources.end())
 				return nullptr;
 
@@ -381,13 +420,13 @@ static void on_clear_depth_impl(command_list *cmd_list, state_tracking &state, r
 	if (depth_stencil_backup == nullptr || depth_stencil_backup->backup_texture == 0)
 		return;
 
-	// If this is queue state (happens if this is a immediate command list), need to protect access to it, since another thread may be in a present call, which can reset it
-	std::shared_lock<std::shared_mutex> lock(s_mutex, std::defer_lock);
+	// If this is queue state (happens if this is a immediate command list), need to protect access to it, since another thread may be in a present call, which can take its counters
+	std::unique_lock<std::mutex> lock(state.queue_mutex, std::defer_lock);
 	if (state.is_queue)
 		lock.lock();
 
 	bool do_copy = true;
-	depth_stencil_frame_stats &counters = state.counters_per_used_depth_stencil[depth_stencil];
+	depth_stencil_frame_stats &counters = state.counters_for(depth_stencil);
 
 	// Ignore clears when there was no meaningful workload (e.g. at the start of a frame)
 	// Don't do this in Vulkan, to handle common case of DXVK flushing its immediate command buffer and thus resetting its stats during the frame
@@ -445,7 +484,7 @@ static void on_clear_depth_impl(command_list *cmd_list, state_tracking &state, r
 
 			counters.copied_during_frame = true;
 
-			// Unlock before calling into the device, since e.g. in D3D11 this can cause delayed destruction of resources (calls 'CDevice::FlushDeletionPool'), which calls 'on_destroy_resource' below, which tries to lock the same mutex
+			// Unlock before calling into the device, since e.g. in D3D11 this can cause delayed destruction of resources (calls 'CDevice::FlushDeletionPool'), which calls 'on_destroy_resource' below, which may wait on a present call that in turn waits on this lock
 			if (state.is_queue)
 				lock.unlock();
 
@@ -648,7 +687,7 @@ static void on_destroy_resource(device *device, resource resource)
 	if (device_data == nullptr)
 		return;
 
-	std::unique_lock<std::shared_mutex> lock(s_mutex);
+	std::unique_lock<std::mutex> lock(s_mutex);
 
 	// Remove this destroyed resource from the list of tracked depth-stencil resources
 	if (const auto it = device_data->depth_stencil_resources.find(resource);
@@ -685,14 +724,15 @@ static bool on_draw(command_list *cmd_list, uint32_t vertices, uint32_t instance
 		cmd_list->get_device()->get_api() != device_api::vulkan)
 		on_clear_depth_impl(cmd_list, state, state.current_depth_stencil, clear_op::fullscreen_draw);
 
-	// If this is queue state (happens if this is a immediate command list), need to protect access to it, since another thread may be in a present call, which can reset it
-	std::shared_lock<std::shared_mutex> lock(s_mutex, std::defer_lock);
+	// If this is queue state (happens if this is a immediate command list), need to protect access to it, since another thread may be in a present call, which can take its counters
+	// Command list state is only accessed by the recording thread, so draw calls recorded into command lists never lock
+	std::unique_lock<std::mutex> lock(state.queue_mutex, std::defer_lock);
 	if (state.is_queue)
 		lock.lock();
 
 	state.first_draw_since_bind = false;
 
-	depth_stencil_frame_stats &counters = state.counters_per_used_depth_stencil[state.current_depth_stencil];
+	depth_stencil_frame_stats &counters = state.counters_for(state.current_depth_stencil);
 	counters.total_stats.vertices += vertices * instances;
 	counters.total_stats.drawcalls += 1;
 	counters.current_stats.vertices += vertices * instances;
@@ -719,12 +759,12 @@ static bool on_draw_indirect(command_list *cmd_list, indirect_command type, reso
 	if (state.current_depth_stencil == 0)
 		return false; // This is a draw call with no depth-stencil bound
 
-	// If this is queue state (happens if this is a immediate command list), need to protect access to it, since another thread may be in a present call, which can reset it
-	std::shared_lock<std::shared_mutex> lock(s_mutex, std::defer_lock);
+	// If this is queue state (happens if this is a immediate command list), need to protect access to it, since another thread may be in a present call, which can take its counters
+	std::unique_lock<std::mutex> lock(state.queue_mutex, std::defer_lock);
 	if (state.is_queue)
 		lock.lock();
 
-	depth_stencil_frame_stats &counters = state.counters_per_used_depth_stencil[state.current_depth_stencil];
+	depth_stencil_frame_stats &counters = state.counters_for(state.current_depth_stencil);
 	counters.total_stats.drawcalls += draw_count;
 	counters.total_stats.drawcalls_indirect += draw_count;
 	counters.current_stats.drawcalls += draw_count;
@@ -777,11 +817,11 @@ static bool on_clear_depth_stencil(command_list *cmd_list, resource_view dsv, co
 
 		if (*depth != 1.0f)
 		{
-			std::shared_lock<std::shared_mutex> lock(s_mutex, std::defer_lock);
+			std::unique_lock<std::mutex> lock(state.queue_mutex, std::defer_lock);
 			if (state.is_queue)
 				lock.lock();
 
-			state.counters_per_used_depth_stencil[depth_stencil].reversed_clear_value = true;
+			state.counters_for(depth_stencil).reversed_clear_value = true;
 		}
 	}
 
@@ -806,6 +846,11 @@ static void on_begin_render_pass_with_depth_stencil(command_list *cmd_list, uint
 static void on_reset(command_list *cmd_list)
 {
 	auto &target_state = *cmd_list->get_private_data<state_tracking>();
+
+	std::unique_lock<std::mutex> lock(target_state.queue_mutex, std::defer_lock);
+	if (target_state.is_queue)
+		lock.lock();
+
 	target_state.reset();
 }
 static void on_execute_primary(command_queue *queue, command_list *cmd_list)
@@ -818,8 +863,9 @@ static void on_execute_primary(command_queue *queue, command_list *cmd_list)
 	const auto &source_state = *cmd_list->get_private_data<state_tracking>();
 	assert(target_state.is_queue && !source_state.is_queue);
 
-	// Need to protect access to the queue state, since another thread may be in a present call, which can reset this state
-	const std::unique_lock<std::shared_mutex> lock(s_mutex);
+	// Need to protect access to the queue state, since another thread may be in a present call, which can take its counters
+	// This only locks the target queue, so command lists executed on different queues do not contend with each other
+	const std::unique_lock<std::mutex> lock(target_state.queue_mutex);
 
 	target_state.merge(source_state);
 }
@@ -837,8 +883,8 @@ static void on_execute_secondary(command_list *cmd_list, command_list *secondary
 	}
 	else
 	{
-		// If this is queue state (happens if this is a immediate command list), need to protect access to it, since another thread may be in a present call, which can reset it
-		std::shared_lock<std::shared_mutex> lock(s_mutex, std::defer_lock);
+		// If this is queue state (happens if this is a immediate command list), need to protect access to it, since another thread may be in a present call, which can take its counters
+		std::unique_lock<std::mutex> lock(target_state.queue_mutex, std::defer_lock);
 		if (target_state.is_queue)
 			lock.lock();
 
@@ -851,16 +897,23 @@ static void on_present(command_queue *, swapchain *swapchain, const rect *, cons
 	device *const device = swapchain->get_device();
 	generic_depth_device_data *const device_data = device->get_private_data<generic_depth_device_data>();
 
-	const std::unique_lock<std::shared_mutex> lock(s_mutex);
+	// Hold the lock for the whole update, including the backup list below, so that effect runtimes never observe partially updated state
+	const std::unique_lock<std::mutex> lock(s_mutex);
 
 	state_tracking queue_state(true);
 	// Merge state from all graphics queues
 	for (command_queue *const queue : device_data->queues)
 	{
 		auto &state = *queue->get_private_data<state_tracking>();
-		queue_state.merge(state);
 
-		state.reset_on_present();
+		// Only hold the queue lock while taking the counters, so that recording on the queue is not blocked by the merge below
+		{
+			const std::unique_lock<std::mutex> queue_lock(state.queue_mutex);
+			state.reset_on_present(device_data->queue_counters);
+		}
+
+		queue_state.merge_counters(device_data->queue_counters);
+		device_data->queue_counters.clear();
 	}
 
 	// Only update device list if there are any depth-stencils, otherwise this may be a second present call (at which point 'reset_on_present' already cleared out the queue list in the first present call)
@@ -931,17 +984,16 @@ static void on_begin_render_effects(effect_runtime *runtime, command_list *cmd_l
 
 	resource best_match = { 0 };
 	resource_desc best_match_desc;
-	const depth_stencil_frame_stats *best_snapshot = nullptr;
+	const depth_stencil_candidate *best_snapshot = nullptr;
 
 	uint32_t frame_width, frame_height;
 	runtime->get_screenshot_width_and_height(&frame_width, &frame_height);
 
-	std::shared_lock<std::shared_mutex> lock(s_mutex);
-	const std::unordered_map<resource, depth_stencil_resource, resource_hash> current_depth_stencil_resources = device_data->depth_stencil_resources;
-	// Unlock while calling into device below, since device may hold a lock itself and that then can deadlock another thread that calls into 'on_destroy_resource' from the device holding that lock
-	lock.unlock();
+	std::unique_lock<std::mutex> lock(s_mutex);
 
-	for (auto &[resource, info] : current_depth_stencil_resources)
+	// Only copy the counters of depth-stencils that are candidates for selection, since the list may be modified by a present call on another thread as soon as the lock is released
+	data.candidates.clear();
+	for (const auto &[resource, info] : device_data->depth_stencil_resources)
 	{
 		if (info.last_counters.total_stats.drawcalls == 0 || (info.last_counters.total_stats.vertices <= 3 && info.last_counters.total_stats.drawcalls_indirect == 0))
 			continue; // Skip unused
@@ -949,7 +1001,23 @@ static void on_begin_render_effects(effect_runtime *runtime, command_list *cmd_l
 		if (info.last_used_in_frame < device_data->frame_index || device_data->frame_index <= (info.first_used_in_frame + 1))
 			continue; // Skip resources not used this frame or those that only just appeared for the first time
 
-		const resource_desc desc = device->get_resource_desc(resource);
+		data.candidates.push_back({ resource, info.last_counters.total_stats, info.last_counters.copied_during_frame });
+	}
+
+	depth_stencil_candidate override_snapshot = {};
+	if (data.override_depth_stencil != 0)
+	{
+		if (const auto it = device_data->depth_stencil_resources.find(data.override_depth_stencil);
+			it != device_data->depth_stencil_resources.end())
+			override_snapshot = { it->first, it->second.last_counters.total_stats, it->second.last_counters.copied_during_frame };
+	}
+
+	// Unlock while calling into device below, since device may hold a lock itself and that then can deadlock another thread that calls into 'on_destroy_resource' from the device holding that lock
+	lock.unlock();
+
+	for (const depth_stencil_candidate &snapshot : data.candidates)
+	{
+		const resource_desc desc = device->get_resource_desc(snapshot.resource);
 		if (desc.texture.samples > 1 && !device->check_capability(device_caps::resolve_depth_stencil))
 			continue; // Ignore multisampled textures, since they would need to be resolved first
 
@@ -958,25 +1026,20 @@ static void on_begin_render_effects(effect_runtime *runtime, command_list *cmd_l
 		if (s_aspect_ratio_heuristic != aspect_ratio_heuristic::none && !check_aspect_ratio(static_cast<float>(desc.texture.width), static_cast<float>(desc.texture.height), static_cast<float>(frame_width), static_cast<float>(frame_height)))
 			continue; // Not a good fit
 
-		const depth_stencil_frame_stats &snapshot = info.last_counters;
 		if (best_snapshot == nullptr ||
 			snapshot.total_stats > best_snapshot->total_stats)
 		{
-			best_match = resource;
+			best_match = snapshot.resource;
 			best_match_desc = desc;
 			best_snapshot = &snapshot;
 		}
 	}
 
-	if (data.override_depth_stencil != 0)
+	if (override_snapshot.resource != 0)
 	{
-		const auto it = current_depth_stencil_resources.find(data.override_depth_stencil);
-		if (it != current_depth_stencil_resources.end())
-		{
-			best_match = it->first;
-			best_match_desc = device->get_resource_desc(it->first);
-			best_snapshot = &it->second.last_counters;
-		}
+		best_match = data.override_depth_stencil;
+		best_match_desc = device->get_resource_desc(data.override_depth_stencil);
+		best_snapshot = &override_snapshot;
 	}
 
 	const resource_view prev_shader_resource = data.selected_shader_resource;
@@ -1249,7 +1312,7 @@ static void draw_settings_overlay(effect_runtime *runtime)
 	auto &data = *runtime->get_private_data<generic_depth_data>();
 	generic_depth_device_data *const device_data = device->get_private_data<generic_depth_device_data>();
 
-	std::shared_lock<std::shared_mutex> lock(s_mutex);
+	std::unique_lock<std::mutex> lock(s_mutex);
 
 	if (device_data == nullptr || device_data->depth_stencil_resources.empty())
 	{
@@ -284,7 +284,7 @@ static void on_present(command_queue *, swapchain *swapchain, const rect *, cons
 }
 
 // See implementation in 'utils\save_texture_image.cpp'
-extern bool save_texture_image(const resource_desc &desc, const subresource_data &data);
+extern bool save_texture_image(const resource_desc &desc, const subresource_data &data, bool force = false);
 
 static bool save_texture_image(command_queue *queue, resource tex, const resource_desc &desc)
 {
@@ -321,7 +321,8 @@ static bool save_texture_image(command_queue *queue, resource tex, const resourc
 	subresource_data mapped_data = {};
 	if (device->map_texture_region(intermediate, 0, nullptr, map_access::read_only, &mapped_data))
 	{
-		save_texture_image(desc, mapped_data);
+		// Always save when explicitly requested, even if the texture was already dumped before
+		save_texture_image(desc, mapped_data, true);
 
 		device->unmap_texture_region(intermediate, 0);
 	}
@@ -0,0 +1,913 @@
+/*
+ * Copyright (C) 2024 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring> // std::memcpy, std::memset
+#include <algorithm> // std::min
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#include <tmmintrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <tmmintrin.h>
+#elif defined(_M_ARM64)
+#include <arm64_neon.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__) || defined(_M_ARM64) || defined(__aarch64__)
+#define BC_DECODE_SIMD 1
+#else
+#define BC_DECODE_SIMD 0
+#endif
+// GCC and Clang only allow SSSE3 intrinsics in functions that are compiled for it, which must not include the scalar fallbacks (so they still run on processors without it)
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BC_DECODE_SIMD_TARGET __attribute__((target("ssse3")))
+#else
+#define BC_DECODE_SIMD_TARGET
+#endif
+
+// Decoders for block compressed texture formats (BC1 to BC7) to 8-bit RGBA, independent of the ReShade API
+// See https://learn.microsoft.com/windows/win32/direct3d11/texture-block-compression-in-direct3d-11
+//
+// BC1 to BC5 blocks are expanded with byte shuffles (SSSE3 on x86 if supported by the processor, NEON on ARM64), with a scalar fallback producing identical results.
+// BC6H and BC7 select a different bit layout for every block, so are decoded with scalar code.
+
+namespace bc_decode
+{
+	enum class block_format
+	{
+		bc1,
+		bc2,
+		bc3,
+		bc4,
+		bc5,
+		bc6h_uf16,
+		bc6h_sf16,
+		bc7,
+	};
+
+	/// <summary>
+	/// Gets the size of a 4x4 block of the specified format in bytes.
+	/// </summary>
+	constexpr uint32_t block_size(block_format format)
+	{
+		return format == block_format::bc1 || format == block_format::bc4 ? 8 : 16;
+	}
+
+	namespace detail
+	{
+		struct shuffle_tables
+		{
+			// Shuffle masks selecting the 4-byte palette entries for a row of BC1 color indices (indexed by the byte holding the four 2-bit indices of the row)
+			uint8_t color_row[256][16];
+			// Shuffle masks moving the 16 per-texel values of a row into the alpha channel, all color channels or the red or green channel of four RGBA texels
+			uint8_t alpha_row[4][16];
+			uint8_t gray_row[4][16];
+			uint8_t red_row[4][16];
+			uint8_t green_row[4][16];
+
+			constexpr shuffle_tables() : color_row(), alpha_row(), gray_row(), red_row(), green_row()
+			{
+				for (uint32_t row_bits = 0; row_bits < 256; ++row_bits)
+					for (uint32_t x = 0; x < 4; ++x)
+						for (uint32_t c = 0; c < 4; ++c)
+							color_row[row_bits][x * 4 + c] = static_cast<uint8_t>(((row_bits >> (2 * x)) & 0x3) * 4 + c);
+
+				for (uint32_t y = 0; y < 4; ++y)
+				{
+					for (uint32_t x = 0; x < 4; ++x)
+					{
+						for (uint32_t c = 0; c < 4; ++c)
+						{
+							const uint8_t texel = static_cast<uint8_t>(y * 4 + x);
+							// Indices with the high bit set produce zero
+							alpha_row[y][x * 4 + c] = c == 3 ? texel : 0x80;
+							gray_row[y][x * 4 + c] = c != 3 ? texel : 0x80;
+							red_row[y][x * 4 + c] = c == 0 ? texel : 0x80;
+							green_row[y][x * 4 + c] = c == 1 ? texel : 0x80;
+						}
+					}
+				}
+			}
+		};
+
+		inline constexpr shuffle_tables tables;
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+		inline bool has_simd()
+		{
+			static const bool has_ssse3 = []() {
+#if defined(_MSC_VER)
+				int cpu_info[4];
+				__cpuid(cpu_info, 1);
+				return (cpu_info[2] & (1 << 9)) != 0;
+#else
+				unsigned int eax, ebx, ecx, edx;
+				return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSSE3) != 0;
+#endif
+			}();
+			return has_ssse3;
+		}
+
+		using vec = __m128i;
+
+		BC_DECODE_SIMD_TARGET inline vec load(const void *p) { return _mm_loadu_si128(static_cast<const __m128i *>(p)); }
+		BC_DECODE_SIMD_TARGET inline void store(void *p, vec v) { _mm_storeu_si128(static_cast<__m128i *>(p), v); }
+		BC_DECODE_SIMD_TARGET inline vec shuffle(vec table, vec indices) { return _mm_shuffle_epi8(table, indices); }
+		BC_DECODE_SIMD_TARGET inline vec bitwise_or(vec a, vec b) { return _mm_or_si128(a, b); }
+		BC_DECODE_SIMD_TARGET inline vec splat_u32(uint32_t value) { return _mm_set1_epi32(static_cast<int>(value)); }
+#elif defined(_M_ARM64) || defined(__aarch64__)
+		constexpr bool has_simd() { return true; }
+
+		using vec = uint8x16_t;
+
+		inline vec load(const void *p) { return vld1q_u8(static_cast<const uint8_t *>(p)); }
+		inline void store(void *p, vec v) { vst1q_u8(static_cast<uint8_t *>(p), v); }
+		inline vec shuffle(vec table, vec indices) { return vqtbl1q_u8(table, indices); }
+		inline vec bitwise_or(vec a, vec b) { return vorrq_u8(a, b); }
+		inline vec splat_u32(uint32_t value) { return vreinterpretq_u8_u32(vdupq_n_u32(value)); }
+#else
+		constexpr bool has_simd() { return false; }
+#endif
+
+#if BC_DECODE_SIMD
+		BC_DECODE_SIMD_TARGET inline void decode_channel_simd(const uint8_t palette[16], const uint8_t indices[16], uint8_t values[16])
+		{
+			store(values, shuffle(load(palette), load(indices)));
+		}
+
+		BC_DECODE_SIMD_TARGET inline void write_color_block_simd(const uint8_t *color_src, const uint32_t palette[4], const uint8_t *alpha_values, uint8_t *dst, size_t dst_pitch)
+		{
+			const vec palette_vec = load(palette);
+			vec alpha_vec = vec();
+			if (alpha_values != nullptr)
+				alpha_vec = load(alpha_values);
+
+			for (uint32_t y = 0; y < 4; ++y, dst += dst_pitch)
+			{
+				vec row = shuffle(palette_vec, load(tables.color_row[color_src[4 + y]]));
+				if (alpha_values != nullptr)
+					row = bitwise_or(row, shuffle(alpha_vec, load(tables.alpha_row[y])));
+				store(dst, row);
+			}
+		}
+
+		BC_DECODE_SIMD_TARGET inline void write_gray_block_simd(const uint8_t values[16], uint8_t *dst, size_t dst_pitch)
+		{
+			const vec values_vec = load(values);
+			const vec alpha_vec = splat_u32(0xFF000000);
+
+			for (uint32_t y = 0; y < 4; ++y, dst += dst_pitch)
+				store(dst, bitwise_or(shuffle(values_vec, load(tables.gray_row[y])), alpha_vec));
+		}
+
+		BC_DECODE_SIMD_TARGET inline void write_red_green_block_simd(const uint8_t red_values[16], const uint8_t green_values[16], uint8_t *dst, size_t dst_pitch)
+		{
+			const vec red_vec = load(red_values);
+			const vec green_vec = load(green_values);
+			const vec alpha_vec = splat_u32(0xFF000000);
+
+			for (uint32_t y = 0; y < 4; ++y, dst += dst_pitch)
+				store(dst, bitwise_or(
+					bitwise_or(shuffle(red_vec, load(tables.red_row[y])), shuffle(green_vec, load(tables.green_row[y]))),
+					alpha_vec));
+		}
+#endif
+
+		inline uint16_t read16(const uint8_t *p)
+		{
+			return static_cast<uint16_t>(p[0] | (p[1] << 8));
+		}
+		inline uint64_t read48(const uint8_t *p)
+		{
+			return
+				(static_cast<uint64_t>(p[0])      ) |
+				(static_cast<uint64_t>(p[1]) <<  8) |
+				(static_cast<uint64_t>(p[2]) << 16) |
+				(static_cast<uint64_t>(p[3]) << 24) |
+				(static_cast<uint64_t>(p[4]) << 32) |
+				(static_cast<uint64_t>(p[5]) << 40);
+		}
+
+		inline uint32_t unpack_r5g6b5(uint16_t data)
+		{
+			uint32_t temp;
+			temp =  (data           >> 11) * 255 + 16;
+			const uint32_t r = (temp / 32 + temp) / 32;
+			temp = ((data & 0x07E0) >>  5) * 255 + 32;
+			const uint32_t g = (temp / 64 + temp) / 64;
+			temp =  (data & 0x001F)        * 255 + 16;
+			const uint32_t b = (temp / 32 + temp) / 32;
+			return r | (g << 8) | (b << 16);
+		}
+
+		/// <summary>
+		/// Computes the four RGBA colors of a BC1 color block.
+		/// </summary>
+		/// <param name="alpha">Alpha value of the opaque colors (zero when the alpha channel is filled in separately).</param>
+		/// <param name="allow_three_color_mode">Whether the ordering of the endpoints selects between the four and three color modes (only the case for BC1).</param>
+		inline void make_color_palette(const uint8_t *src, uint32_t palette[4], uint32_t alpha, bool allow_three_color_mode)
+		{
+			const uint16_t color_0 = read16(src);
+			const uint16_t color_1 = read16(src + 2);
+
+			const uint32_t c0 = unpack_r5g6b5(color_0);
+			const uint32_t c1 = unpack_r5g6b5(color_1);
+
+			palette[0] = c0 | (alpha << 24);
+			palette[1] = c1 | (alpha << 24);
+
+			uint32_t c2 = 0, c3 = 0;
+			for (uint32_t shift = 0; shift < 24; shift += 8)
+			{
+				const uint32_t v0 = (c0 >> shift) & 0xFF;
+				const uint32_t v1 = (c1 >> shift) & 0xFF;
+
+				if (color_0 > color_1 || !allow_three_color_mode)
+				{
+					c2 |= ((2 * v0 + v1) / 3) << shift;
+					c3 |= ((v0 + 2 * v1) / 3) << shift;
+				}
+				else
+				{
+					c2 |= ((v0 + v1) / 2) << shift;
+				}
+			}
+
+			palette[2] = c2 | (alpha << 24);
+			palette[3] = (color_0 > color_1 || !allow_three_color_mode) ? c3 | (alpha << 24) : 0; // Transparent black in three color mode
+		}
+
+		/// <summary>
+		/// Computes the eight values of a BC4 channel block.
+		/// </summary>
+		inline void make_channel_palette(const uint8_t *src, uint8_t palette[16])
+		{
+			const uint32_t v0 = src[0];
+			const uint32_t v1 = src[1];
+
+			palette[0] = static_cast<uint8_t>(v0);
+			palette[1] = static_cast<uint8_t>(v1);
+
+			if (v0 > v1)
+			{
+				for (uint32_t i = 1; i < 7; ++i)
+					palette[1 + i] = static_cast<uint8_t>(((7 - i) * v0 + i * v1) / 7);
+			}
+			else
+			{
+				for (uint32_t i = 1; i < 5; ++i)
+					palette[1 + i] = static_cast<uint8_t>(((5 - i) * v0 + i * v1) / 5);
+				palette[6] = 0;
+				palette[7] = 255;
+			}
+
+			std::memset(palette + 8, 0, 8);
+		}
+
+		/// <summary>
+		/// Extracts the 16 3-bit indices of a BC4 channel block into one byte each.
+		/// </summary>
+		inline void unpack_channel_indices(const uint8_t *src, uint8_t indices[16])
+		{
+			const uint64_t bits = read48(src + 2);
+			for (uint32_t i = 0; i < 16; ++i)
+				indices[i] = static_cast<uint8_t>((bits >> (3 * i)) & 0x7);
+		}
+
+		/// <summary>
+		/// Decodes a BC4 channel block into 16 values.
+		/// </summary>
+		inline void decode_channel(const uint8_t *src, uint8_t values[16])
+		{
+			alignas(16) uint8_t palette[16];
+			make_channel_palette(src, palette);
+			alignas(16) uint8_t indices[16];
+			unpack_channel_indices(src, indices);
+
+#if BC_DECODE_SIMD
+			if (has_simd())
+			{
+				decode_channel_simd(palette, indices, values);
+				return;
+			}
+#endif
+			for (uint32_t i = 0; i < 16; ++i)
+				values[i] = palette[indices[i]];
+		}
+
+		/// <summary>
+		/// Writes the 4x4 texels of a block with BC1 colors, optionally combined with separately decoded alpha values.
+		/// </summary>
+		inline void write_color_block(const uint8_t *color_src, const uint32_t palette[4], const uint8_t *alpha_values, uint8_t *dst, size_t dst_pitch)
+		{
+#if BC_DECODE_SIMD
+			if (has_simd())
+			{
+				write_color_block_simd(color_src, palette, alpha_values, dst, dst_pitch);
+				return;
+			}
+#endif
+			for (uint32_t y = 0; y < 4; ++y, dst += dst_pitch)
+			{
+				for (uint32_t x = 0; x < 4; ++x)
+				{
+					uint32_t color = palette[(color_src[4 + y] >> (2 * x)) & 0x3];
+					if (alpha_values != nullptr)
+						color |= static_cast<uint32_t>(alpha_values[y * 4 + x]) << 24;
+					std::memcpy(dst + x * 4, &color, 4);
+				}
+			}
+		}
+	}
+
+	inline void decode_bc1_block(const uint8_t *src, uint8_t *dst, size_t dst_pitch)
+	{
+		alignas(16) uint32_t palette[4];
+		detail::make_color_palette(src, palette, 255, true);
+
+		detail::write_color_block(src, palette, nullptr, dst, dst_pitch);
+	}
+
+	inline void decode_bc2_block(const uint8_t *src, uint8_t *dst, size_t dst_pitch)
+	{
+		alignas(16) uint8_t alpha_values[16];
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			alpha_values[i * 2 + 0] = static_cast<uint8_t>((src[i] & 0xF) * 17);
+			alpha_values[i * 2 + 1] = static_cast<uint8_t>((src[i] >> 4) * 17);
+		}
+
+		alignas(16) uint32_t palette[4];
+		detail::make_color_palette(src + 8, palette, 0, false);
+
+		detail::write_color_block(src + 8, palette, alpha_values, dst, dst_pitch);
+	}
+
+	inline void decode_bc3_block(const uint8_t *src, uint8_t *dst, size_t dst_pitch)
+	{
+		alignas(16) uint8_t alpha_values[16];
+		detail::decode_channel(src, alpha_values);
+
+		alignas(16) uint32_t palette[4];
+		detail::make_color_palette(src + 8, palette, 0, false);
+
+		detail::write_color_block(src + 8, palette, alpha_values, dst, dst_pitch);
+	}
+
+	/// <summary>
+	/// Decodes a BC4 block into gray RGBA texels.
+	/// </summary>
+	inline void decode_bc4_block(const uint8_t *src, uint8_t *dst, size_t dst_pitch)
+	{
+		alignas(16) uint8_t values[16];
+		detail::decode_channel(src, values);
+
+#if BC_DECODE_SIMD
+		if (detail::has_simd())
+		{
+			detail::write_gray_block_simd(values, dst, dst_pitch);
+			return;
+		}
+#endif
+		for (uint32_t y = 0; y < 4; ++y, dst += dst_pitch)
+		{
+			for (uint32_t x = 0; x < 4; ++x)
+			{
+				dst[x * 4 + 0] = values[y * 4 + x];
+				dst[x * 4 + 1] = values[y * 4 + x];
+				dst[x * 4 + 2] = values[y * 4 + x];
+				dst[x * 4 + 3] = 255;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Decodes a BC5 block into RGBA texels with the two channels in red and green.
+	/// </summary>
+	inline void decode_bc5_block(const uint8_t *src, uint8_t *dst, size_t dst_pitch)
+	{
+		alignas(16) uint8_t red_values[16];
+		detail::decode_channel(src, red_values);
+		alignas(16) uint8_t green_values[16];
+		detail::decode_channel(src + 8, green_values);
+
+#if BC_DECODE_SIMD
+		if (detail::has_simd())
+		{
+			detail::write_red_green_block_simd(red_values, green_values, dst, dst_pitch);
+			return;
+		}
+#endif
+		for (uint32_t y = 0; y < 4; ++y, dst += dst_pitch)
+		{
+			for (uint32_t x = 0; x < 4; ++x)
+			{
+				dst[x * 4 + 0] = red_values[y * 4 + x];
+				dst[x * 4 + 1] = green_values[y * 4 + x];
+				dst[x * 4 + 2] = 0;
+				dst[x * 4 + 3] = 255;
+			}
+		}
+	}
+
+	namespace detail
+	{
+		/// <summary>
+		/// Reads bit fields from a 128-bit block, starting at the least significant bit of the first byte.
+		/// </summary>
+		class bit_reader
+		{
+		public:
+			explicit bit_reader(const uint8_t *src)
+			{
+				std::memcpy(_bits, src, 16); // Assumes little-endian byte order
+			}
+
+			uint32_t read(uint32_t count)
+			{
+				const uint32_t value = peek(_pos, count);
+				_pos += count;
+				return value;
+			}
+			uint32_t peek(uint32_t pos, uint32_t count) const
+			{
+				if (count == 0)
+					return 0;
+
+				uint64_t value;
+				if (pos >= 64)
+					value = _bits[1] >> (pos - 64);
+				else if (pos + count <= 64)
+					value = _bits[0] >> pos;
+				else
+					value = (_bits[0] >> pos) | (_bits[1] << (64 - pos));
+
+				return static_cast<uint32_t>(value & ((1ull << count) - 1));
+			}
+
+			uint32_t position() const { return _pos; }
+			void skip(uint32_t count) { _pos += count; }
+
+		private:
+			uint64_t _bits[2];
+			uint32_t _pos = 0;
+		};
+
+		constexpr uint8_t weights2[4] = { 0, 21, 43, 64 };
+		constexpr uint8_t weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+		constexpr uint8_t weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		inline const uint8_t *weights_for_bits(uint32_t index_bits)
+		{
+			return index_bits == 2 ? weights2 : index_bits == 3 ? weights3 : weights4;
+		}
+
+		// Partition of each texel into subsets, one bit per texel for two subsets
+		constexpr uint16_t partitions2[64] = {
+			0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+			0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+			0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+			0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+		};
+		// Two bits per texel for three subsets
+		constexpr uint32_t partitions3[64] = {
+			0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+			0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+			0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+			0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+			0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+			0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+			0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+			0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254,
+		};
+
+		// Texel index of the anchor of the second subset for two subsets, and of the second and third subset for three subsets (the first subset is always anchored at texel 0)
+		constexpr uint8_t anchors2[64] = {
+			15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+			15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,  6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+		};
+		constexpr uint8_t anchors3_second[64] = {
+			 3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,  3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+			 8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,  3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3,
+		};
+		constexpr uint8_t anchors3_third[64] = {
+			15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8, 15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+			15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8, 15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8,
+		};
+
+		inline uint32_t subset_of(uint32_t num_subsets, uint32_t partition, uint32_t texel)
+		{
+			if (num_subsets == 2)
+				return (partitions2[partition] >> texel) & 0x1;
+			if (num_subsets == 3)
+				return (partitions3[partition] >> (2 * texel)) & 0x3;
+			return 0;
+		}
+		inline bool is_anchor(uint32_t num_subsets, uint32_t partition, uint32_t texel)
+		{
+			return texel == 0 ||
+				(num_subsets == 2 && texel == anchors2[partition]) ||
+				(num_subsets == 3 && (texel == anchors3_second[partition] || texel == anchors3_third[partition]));
+		}
+
+		inline uint32_t interpolate(uint32_t e0, uint32_t e1, uint32_t weight)
+		{
+			return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+		}
+	}
+
+	inline void decode_bc7_block(const uint8_t *src, uint8_t *dst, size_t dst_pitch)
+	{
+		struct mode_info
+		{
+			uint8_t num_subsets;
+			uint8_t partition_bits;
+			uint8_t rotation_bits;
+			uint8_t index_selection_bits;
+			uint8_t color_bits;
+			uint8_t alpha_bits;
+			uint8_t endpoint_pbits;
+			uint8_t shared_pbits;
+			uint8_t index_bits;
+			uint8_t index_bits2;
+		};
+		static constexpr mode_info modes[8] = {
+			{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+			{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+			{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+			{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+			{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+			{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+			{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+			{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+		};
+
+		uint32_t mode = 0;
+		while (mode < 8 && (src[0] & (1 << mode)) == 0)
+			++mode;
+
+		if (mode == 8)
+		{
+			// Reserved mode, which decodes to transparent black
+			for (uint32_t y = 0; y < 4; ++y, dst += dst_pitch)
+				std::memset(dst, 0, 16);
+			return;
+		}
+
+		const mode_info &info = modes[mode];
+
+		detail::bit_reader bits(src);
+		bits.skip(mode + 1);
+
+		const uint32_t partition = bits.read(info.partition_bits);
+		const uint32_t rotation = bits.read(info.rotation_bits);
+		const uint32_t index_selection = bits.read(info.index_selection_bits);
+
+		const uint32_t num_endpoints = info.num_subsets * 2;
+
+		uint32_t endpoints[6][4] = {};
+		for (uint32_t c = 0; c < 3; ++c)
+			for (uint32_t e = 0; e < num_endpoints; ++e)
+				endpoints[e][c] = bits.read(info.color_bits);
+		if (info.alpha_bits != 0)
+			for (uint32_t e = 0; e < num_endpoints; ++e)
+				endpoints[e][3] = bits.read(info.alpha_bits);
+
+		uint32_t color_bits = info.color_bits;
+		uint32_t alpha_bits = info.alpha_bits;
+
+		if (info.endpoint_pbits != 0 || info.shared_pbits != 0)
+		{
+			for (uint32_t e = 0; e < num_endpoints; ++e)
+			{
+				const uint32_t pbit = info.endpoint_pbits != 0 ? bits.read(1) : (e % 2 == 0 ? bits.read(1) : bits.peek(bits.position() - 1, 1));
+				for (uint32_t c = 0; c < 4; ++c)
+					endpoints[e][c] = (endpoints[e][c] << 1) | pbit;
+			}
+
+			color_bits += 1;
+			if (alpha_bits != 0)
+				alpha_bits += 1;
+		}
+
+		// Expand endpoints to 8 bits by replicating the most significant bits into the low bits
+		for (uint32_t e = 0; e < num_endpoints; ++e)
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+				endpoints[e][c] = ((endpoints[e][c] << (8 - color_bits)) | (endpoints[e][c] >> (2 * color_bits - 8))) & 0xFF;
+
+			if (alpha_bits != 0)
+				endpoints[e][3] = ((endpoints[e][3] << (8 - alpha_bits)) | (endpoints[e][3] >> (2 * alpha_bits - 8))) & 0xFF;
+			else
+				endpoints[e][3] = 255;
+		}
+
+		uint32_t indices[16];
+		for (uint32_t texel = 0; texel < 16; ++texel)
+			indices[texel] = bits.read(info.index_bits - (detail::is_anchor(info.num_subsets, partition, texel) ? 1 : 0));
+
+		uint32_t indices2[16] = {};
+		if (info.index_bits2 != 0)
+			for (uint32_t texel = 0; texel < 16; ++texel)
+				indices2[texel] = bits.read(info.index_bits2 - (texel == 0 ? 1 : 0));
+
+		const uint8_t *const color_weights = detail::weights_for_bits(info.index_bits2 != 0 && index_selection != 0 ? info.index_bits2 : info.index_bits);
+		const uint8_t *const alpha_weights = detail::weights_for_bits(info.index_bits2 != 0 && index_selection == 0 ? info.index_bits2 : info.index_bits);
+
+		for (uint32_t texel = 0; texel < 16; ++texel)
+		{
+			const uint32_t subset = detail::subset_of(info.num_subsets, partition, texel);
+			const uint32_t *const e0 = endpoints[subset * 2 + 0];
+			const uint32_t *const e1 = endpoints[subset * 2 + 1];
+
+			uint32_t color_index = indices[texel];
+			uint32_t alpha_index = indices[texel];
+			if (info.index_bits2 != 0)
+				(index_selection != 0 ? color_index : alpha_index) = indices2[texel];
+
+			uint8_t rgba[4];
+			for (uint32_t c = 0; c < 3; ++c)
+				rgba[c] = static_cast<uint8_t>(detail::interpolate(e0[c], e1[c], color_weights[color_index]));
+			rgba[3] = static_cast<uint8_t>(detail::interpolate(e0[3], e1[3], alpha_weights[alpha_index]));
+
+			if (rotation != 0)
+				std::swap(rgba[3], rgba[rotation - 1]);
+
+			std::memcpy(dst + (texel / 4) * dst_pitch + (texel % 4) * 4, rgba, 4);
+		}
+	}
+
+	namespace detail
+	{
+		inline int32_t sign_extend(uint32_t value, uint32_t bits)
+		{
+			return static_cast<int32_t>(value << (32 - bits)) >> (32 - bits);
+		}
+
+		inline int32_t bc6h_unquantize(int32_t value, uint32_t bits, bool is_signed)
+		{
+			if (!is_signed)
+			{
+				if (bits >= 15 || value == 0)
+					return value;
+				if (value == (1 << bits) - 1)
+					return 0xFFFF;
+				return ((value << 16) + 0x8000) >> bits;
+			}
+			else
+			{
+				if (bits >= 16)
+					return value;
+
+				const bool negative = value < 0;
+				if (negative)
+					value = -value;
+
+				int32_t result;
+				if (value == 0)
+					result = 0;
+				else if (value >= (1 << (bits - 1)) - 1)
+					result = 0x7FFF;
+				else
+					result = ((value << 15) + 0x4000) >> (bits - 1);
+
+				return negative ? -result : result;
+			}
+		}
+
+		inline uint8_t bc6h_finish(int32_t value, bool is_signed)
+		{
+			// Scale interpolated value to a half-precision float
+			uint32_t half_bits;
+			if (!is_signed)
+				half_bits = static_cast<uint32_t>((value * 31) >> 6);
+			else
+				half_bits = value < 0 ? 0x8000 | static_cast<uint32_t>(((-value) * 31) >> 5) : static_cast<uint32_t>((value * 31) >> 5);
+
+			// Negative values and values above one are clamped, so can skip converting those to float
+			if ((half_bits & 0x8000) != 0)
+				return 0;
+			if (half_bits >= 0x3C00)
+				return 255;
+
+			const uint32_t exponent = (half_bits >> 10) & 0x1F;
+			const uint32_t mantissa = half_bits & 0x3FF;
+			const float result = exponent == 0 ?
+				mantissa * (1.0f / (1 << 24)) :
+				(1.0f + mantissa * (1.0f / 1024)) * (1.0f / (1 << 15)) * static_cast<float>(1 << exponent);
+
+			return static_cast<uint8_t>(result * 255.0f + 0.5f);
+		}
+	}
+
+	/// <summary>
+	/// Decodes a BC6H block into RGBA texels, clamping the HDR colors to the [0, 1] range.
+	/// </summary>
+	inline void decode_bc6h_block(const uint8_t *src, uint8_t *dst, size_t dst_pitch, bool is_signed)
+	{
+		struct mode_info
+		{
+			uint8_t num_subsets;
+			uint8_t transformed;
+			uint8_t endpoint_bits;
+			uint8_t delta_bits[3];
+		};
+		static constexpr mode_info modes[14] = {
+			{ 2, 1, 10, { 5, 5, 5 } },
+			{ 2, 1,  7, { 6, 6, 6 } },
+			{ 2, 1, 11, { 5, 4, 4 } },
+			{ 2, 1, 11, { 4, 5, 4 } },
+			{ 2, 1, 11, { 4, 4, 5 } },
+			{ 2, 1,  9, { 5, 5, 5 } },
+			{ 2, 1,  8, { 6, 5, 5 } },
+			{ 2, 1,  8, { 5, 6, 5 } },
+			{ 2, 1,  8, { 5, 5, 6 } },
+			{ 2, 0,  6, { 6, 6, 6 } },
+			{ 1, 0, 10, { 10, 10, 10 } },
+			{ 1, 1, 11, { 9, 9, 9 } },
+			{ 1, 1, 12, { 8, 8, 8 } },
+			{ 1, 1, 16, { 4, 4, 4 } },
+		};
+		// Location of each endpoint bit in the block, in the order they are stored after the mode bits
+		// Each entry is the endpoint component (four endpoints with red, green and blue each) times 16 plus the bit index in that component
+		static constexpr uint8_t bit_layouts[14][75] = {
+			{ 116, 132, 180, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 48, 49, 50, 51, 52, 164, 112, 113, 114, 115, 64, 65, 66, 67, 68, 176, 160, 161, 162, 163, 80, 81, 82, 83, 84, 177, 128, 129, 130, 131, 96, 97, 98, 99, 100, 178, 144, 145, 146, 147, 148, 179 },
+			{ 117, 164, 165, 0, 1, 2, 3, 4, 5, 6, 176, 177, 132, 16, 17, 18, 19, 20, 21, 22, 133, 178, 116, 32, 33, 34, 35, 36, 37, 38, 179, 181, 180, 48, 49, 50, 51, 52, 53, 112, 113, 114, 115, 64, 65, 66, 67, 68, 69, 160, 161, 162, 163, 80, 81, 82, 83, 84, 85, 128, 129, 130, 131, 96, 97, 98, 99, 100, 101, 144, 145, 146, 147, 148, 149 },
+			{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 48, 49, 50, 51, 52, 10, 112, 113, 114, 115, 64, 65, 66, 67, 26, 176, 160, 161, 162, 163, 80, 81, 82, 83, 42, 177, 128, 129, 130, 131, 96, 97, 98, 99, 100, 178, 144, 145, 146, 147, 148, 179 },
+			{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 48, 49, 50, 51, 10, 164, 112, 113, 114, 115, 64, 65, 66, 67, 68, 26, 160, 161, 162, 163, 80, 81, 82, 83, 42, 177, 128, 129, 130, 131, 96, 97, 98, 99, 176, 178, 144, 145, 146, 147, 116, 179 },
+			{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 48, 49, 50, 51, 10, 132, 112, 113, 114, 115, 64, 65, 66, 67, 26, 176, 160, 161, 162, 163, 80, 81, 82, 83, 84, 42, 128, 129, 130, 131, 96, 97, 98, 99, 177, 178, 144, 145, 146, 147, 180, 179 },
+			{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 132, 16, 17, 18, 19, 20, 21, 22, 23, 24, 116, 32, 33, 34, 35, 36, 37, 38, 39, 40, 180, 48, 49, 50, 51, 52, 164, 112, 113, 114, 115, 64, 65, 66, 67, 68, 176, 160, 161, 162, 163, 80, 81, 82, 83, 84, 177, 128, 129, 130, 131, 96, 97, 98, 99, 100, 178, 144, 145, 146, 147, 148, 179 },
+			{ 0, 1, 2, 3, 4, 5, 6, 7, 164, 132, 16, 17, 18, 19, 20, 21, 22, 23, 178, 116, 32, 33, 34, 35, 36, 37, 38, 39, 179, 180, 48, 49, 50, 51, 52, 53, 112, 113, 114, 115, 64, 65, 66, 67, 68, 176, 160, 161, 162, 163, 80, 81, 82, 83, 84, 177, 128, 129, 130, 131, 96, 97, 98, 99, 100, 101, 144, 145, 146, 147, 148, 149 },
+			{ 0, 1, 2, 3, 4, 5, 6, 7, 176, 132, 16, 17, 18, 19, 20, 21, 22, 23, 117, 116, 32, 33, 34, 35, 36, 37, 38, 39, 165, 180, 48, 49, 50, 51, 52, 164, 112, 113, 114, 115, 64, 65, 66, 67, 68, 69, 160, 161, 162, 163, 80, 81, 82, 83, 84, 177, 128, 129, 130, 131, 96, 97, 98, 99, 100, 178, 144, 145, 146, 147, 148, 179 },
+			{ 0, 1, 2, 3, 4, 5, 6, 7, 177, 132, 16, 17, 18, 19, 20, 21, 22, 23, 133, 116, 32, 33, 34, 35, 36, 37, 38, 39, 181, 180, 48, 49, 50, 51, 52, 164, 112, 113, 114, 115, 64, 65, 66, 67, 68, 176, 160, 161, 162, 163, 80, 81, 82, 83, 84, 85, 128, 129, 130, 131, 96, 97, 98, 99, 100, 178, 144, 145, 146, 147, 148, 179 },
+			{ 0, 1, 2, 3, 4, 5, 164, 176, 177, 132, 16, 17, 18, 19, 20, 21, 117, 133, 178, 116, 32, 33, 34, 35, 36, 37, 165, 179, 181, 180, 48, 49, 50, 51, 52, 53, 112, 113, 114, 115, 64, 65, 66, 67, 68, 69, 160, 161, 162, 163, 80, 81, 82, 83, 84, 85, 128, 129, 130, 131, 96, 97, 98, 99, 100, 101, 144, 145, 146, 147, 148, 149 },
+			{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 64, 65, 66, 67, 68, 69, 70, 71, 72, 73, 80, 81, 82, 83, 84, 85, 86, 87, 88, 89 },
+			{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 48, 49, 50, 51, 52, 53, 54, 55, 56, 10, 64, 65, 66, 67, 68, 69, 70, 71, 72, 26, 80, 81, 82, 83, 84, 85, 86, 87, 88, 42 },
+			{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 48, 49, 50, 51, 52, 53, 54, 55, 11, 10, 64, 65, 66, 67, 68, 69, 70, 71, 27, 26, 80, 81, 82, 83, 84, 85, 86, 87, 43, 42 },
+			{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 48, 49, 50, 51, 15, 14, 13, 12, 11, 10, 64, 65, 66, 67, 31, 30, 29, 28, 27, 26, 80, 81, 82, 83, 47, 46, 45, 44, 43, 42 },
+		};
+
+		detail::bit_reader bits(src);
+
+		uint32_t mode = bits.read(2);
+		if (mode >= 2)
+		{
+			// Modes with five mode bits
+			mode |= bits.read(3) << 2;
+
+			switch (mode)
+			{
+			case 0x02: mode = 2; break;
+			case 0x06: mode = 3; break;
+			case 0x0A: mode = 4; break;
+			case 0x0E: mode = 5; break;
+			case 0x12: mode = 6; break;
+			case 0x16: mode = 7; break;
+			case 0x1A: mode = 8; break;
+			case 0x1E: mode = 9; break;
+			case 0x03: mode = 10; break;
+			case 0x07: mode = 11; break;
+			case 0x0B: mode = 12; break;
+			case 0x0F: mode = 13; break;
+			default:
+				// Reserved mode, which decodes to black
+				for (uint32_t y = 0; y < 4; ++y, dst += dst_pitch)
+					for (uint32_t x = 0; x < 4; ++x)
+						std::memcpy(dst + x * 4, "\0\0\0\xFF", 4);
+				return;
+			}
+		}
+
+		const mode_info &info = modes[mode];
+
+		const uint32_t num_layout_bits = mode < 2 ? 75 : info.num_subsets == 2 ? 72 : 60;
+
+		// Four endpoints, each with red, green and blue components
+		uint32_t raw[12] = {};
+		for (uint32_t i = 0; i < num_layout_bits; ++i)
+			raw[bit_layouts[mode][i] >> 4] |= bits.read(1) << (bit_layouts[mode][i] & 0xF);
+
+		const uint32_t partition = info.num_subsets == 2 ? bits.read(5) : 0;
+
+		const uint32_t num_endpoints = info.num_subsets * 2;
+
+		int32_t endpoints[4][3];
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			endpoints[0][c] = is_signed ? detail::sign_extend(raw[c], info.endpoint_bits) : static_cast<int32_t>(raw[c]);
+
+			for (uint32_t e = 1; e < num_endpoints; ++e)
+			{
+				const uint32_t value = raw[e * 3 + c];
+
+				if (info.transformed)
+				{
+					// Other endpoints are stored as deltas to the first one
+					const uint32_t endpoint = (static_cast<uint32_t>(endpoints[0][c]) + static_cast<uint32_t>(detail::sign_extend(value, info.delta_bits[c]))) & ((1u << info.endpoint_bits) - 1);
+					endpoints[e][c] = is_signed ? detail::sign_extend(endpoint, info.endpoint_bits) : static_cast<int32_t>(endpoint);
+				}
+				else
+				{
+					endpoints[e][c] = is_signed ? detail::sign_extend(value, info.endpoint_bits) : static_cast<int32_t>(value);
+				}
+			}
+		}
+
+		for (uint32_t e = 0; e < num_endpoints; ++e)
+			for (uint32_t c = 0; c < 3; ++c)
+				endpoints[e][c] = detail::bc6h_unquantize(endpoints[e][c], info.endpoint_bits, is_signed);
+
+		const uint32_t index_bits = info.num_subsets == 2 ? 3 : 4;
+		const uint8_t *const weights = detail::weights_for_bits(index_bits);
+
+		for (uint32_t texel = 0; texel < 16; ++texel)
+		{
+			const uint32_t index = bits.read(index_bits - (detail::is_anchor(info.num_subsets, partition, texel) ? 1 : 0));
+
+			const uint32_t subset = detail::subset_of(info.num_subsets, partition, texel);
+			const int32_t *const e0 = endpoints[subset * 2 + 0];
+			const int32_t *const e1 = endpoints[subset * 2 + 1];
+
+			uint8_t rgba[4];
+			for (uint32_t c = 0; c < 3; ++c)
+				rgba[c] = detail::bc6h_finish(((64 - weights[index]) * e0[c] + weights[index] * e1[c] + 32) >> 6, is_signed);
+			rgba[3] = 255;
+
+			std::memcpy(dst + (texel / 4) * dst_pitch + (texel % 4) * 4, rgba, 4);
+		}
+	}
+
+	/// <summary>
+	/// Decodes a block compressed image into 8-bit RGBA texels.
+	/// </summary>
+	/// <param name="width">Width of the image in texels.</param>
+	/// <param name="height">Height of the image in texels.</param>
+	/// <param name="src">Pointer to the first block of the image.</param>
+	/// <param name="src_row_pitch">Number of bytes between the start of one row of blocks and the next.</param>
+	/// <param name="dst">Pointer to the output image, which has to have room for <paramref name="height"/> rows of <paramref name="dst_row_pitch"/> bytes.</param>
+	/// <param name="dst_row_pitch">Number of bytes between the start of one row of texels and the next in the output image (at least <paramref name="width"/> * 4).</param>
+	inline void decode_image(block_format format, uint32_t width, uint32_t height, const uint8_t *src, size_t src_row_pitch, uint8_t *dst, size_t dst_row_pitch)
+	{
+		const uint32_t bytes_per_block = block_size(format);
+
+		const auto decode_block = [format](const uint8_t *block_src, uint8_t *block_dst, size_t block_dst_pitch) {
+			switch (format)
+			{
+			case block_format::bc1:
+				decode_bc1_block(block_src, block_dst, block_dst_pitch);
+				break;
+			case block_format::bc2:
+				decode_bc2_block(block_src, block_dst, block_dst_pitch);
+				break;
+			case block_format::bc3:
+				decode_bc3_block(block_src, block_dst, block_dst_pitch);
+				break;
+			case block_format::bc4:
+				decode_bc4_block(block_src, block_dst, block_dst_pitch);
+				break;
+			case block_format::bc5:
+				decode_bc5_block(block_src, block_dst, block_dst_pitch);
+				break;
+			case block_format::bc6h_uf16:
+			case block_format::bc6h_sf16:
+				decode_bc6h_block(block_src, block_dst, block_dst_pitch, format == block_format::bc6h_sf16);
+				break;
+			case block_format::bc7:
+				decode_bc7_block(block_src, block_dst, block_dst_pitch);
+				break;
+			}
+		};
+
+		for (uint32_t block_y = 0; block_y < height; block_y += 4, src += src_row_pitch)
+		{
+			for (uint32_t block_x = 0; block_x < width; block_x += 4)
+			{
+				const uint8_t *const block_src = src + (block_x / 4) * bytes_per_block;
+				uint8_t *const block_dst = dst + block_y * dst_row_pitch + block_x * 4;
+
+				if (block_x + 4 <= width && block_y + 4 <= height)
+				{
+					decode_block(block_src, block_dst, dst_row_pitch);
+				}
+				else
+				{
+					// Blocks on the right and bottom edge of images with dimensions that are not a multiple of four are partially outside the image
+					uint8_t block[4 * 4 * 4];
+					decode_block(block_src, block, 4 * 4);
+
+					const uint32_t block_width = std::min(width - block_x, 4u);
+					const uint32_t block_height = std::min(height - block_y, 4u);
+					for (uint32_t y = 0; y < block_height; ++y)
+						std::memcpy(block_dst + y * dst_row_pitch, block + y * 4 * 4, block_width * 4);
+				}
+			}
+		}
+	}
+}
@@ -9,14 +9,30 @@
 // The subdirectory to load shader binaries from
 #define RESHADE_ADDON_SHADER_LOAD_DIR ".\\shaderreplace"
 
+// The algorithm used to hash texture data for dumped and replaced file names
+//   0: CRC32 (compatible with existing texture packs and TexMod)
+//   1: CRC32C (uses the SSE4.2 or ARMv8 CRC instructions, several times faster, but produces different file names)
+//   2: xxHash3 (fastest on large textures, but produces different file names)
+#define RESHADE_ADDON_TEXTURE_HASH_ALGORITHM 0
+
 // The subdirectory to save textures to
 #define RESHADE_ADDON_TEXTURE_SAVE_DIR ".\\texdump"
 #define RESHADE_ADDON_TEXTURE_SAVE_FORMAT ".png"
 #define RESHADE_ADDON_TEXTURE_SAVE_HASH_TEXMOD 1
 // Skip any textures that were already dumped this session, to reduce lag at the cost of increased memory usage
 #define RESHADE_ADDON_TEXTURE_SAVE_ENABLE_HASH_SET 1
+// Keep an index of the hashes of all dumped textures in the dump directory, so that textures dumped in an earlier session are skipped too (requires the hash set above)
+#define RESHADE_ADDON_TEXTURE_SAVE_HASH_INDEX 1
+// Number of threads decoding and writing textures in the background (0 to write them synchronously in the event that loaded them)
+#define RESHADE_ADDON_TEXTURE_SAVE_THREADS 2
+// Maximum amount of texture data (in MiB) waiting to be written, before dumping blocks until the background threads caught up
+#define RESHADE_ADDON_TEXTURE_SAVE_QUEUE_SIZE 256
 
 // The subdirectory to load textures from
 #define RESHADE_ADDON_TEXTURE_LOAD_DIR ".\\texreplace"
 #define RESHADE_ADDON_TEXTURE_LOAD_FORMAT ".png"
 #define RESHADE_ADDON_TEXTURE_LOAD_HASH_TEXMOD 1
+// Memory budget (in MiB) for decoded replacement images kept in memory, so that they do not have to be decoded again when a texture is loaded
+#define RESHADE_ADDON_TEXTURE_LOAD_CACHE_SIZE 512
+// Number of threads decoding replacement images in the background (0 to use half the number of processor cores)
+#define RESHADE_ADDON_TEXTURE_LOAD_THREADS 0
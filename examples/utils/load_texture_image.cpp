@@ -7,14 +7,21 @@
 
 #include <reshade.hpp>
 #include "config.hpp"
-#include "crc32_hash.hpp"
+#include "texture_hash.hpp"
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
+#include <algorithm> // std::max
 #include <filesystem>
+#include <unordered_map>
+#include <condition_variable>
 #include <stb_image.h>
 
 using namespace reshade::api;
 
-static std::filesystem::path make_texture_file_path(uint32_t texture_hash)
+static std::filesystem::path get_texture_load_dir()
 {
 	// Prepend executable directory to image files
 	wchar_t file_prefix[MAX_PATH] = L"";
@@ -24,20 +31,384 @@ static std::filesystem::path make_texture_file_path(uint32_t texture_hash)
 	path = path.parent_path();
 	path /= RESHADE_ADDON_TEXTURE_LOAD_DIR;
 
+	return path;
+}
+
+struct texture_replacement
+{
+	std::filesystem::path path;
+	std::filesystem::file_time_type last_write_time;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t channels = 0;
+	// Decoded RGBA pixel data, or null if it was not loaded yet or evicted from the cache again
+	std::shared_ptr<const std::vector<uint8_t>> pixels;
+	uint64_t last_used = 0;
+	bool decoding = false;
+	bool failed = false;
+};
+
+// Index of all replacement images in the replacement directory, so that looking up a texture hash does not have to go to the file system
+// Images are decoded ahead of time on a set of worker threads (as long as they fit into the cache), so that the resource creation and update events usually only have to copy the pixel data
+static struct replacement_catalog
+{
+	~replacement_catalog()
+	{
+		// The threads are normally joined in 'destroy_texture_replacements', but if a device is leaked that never happens and the threads are still joinable when this static is destroyed during 'DLL_PROCESS_DETACH'.
+		// They cannot be joined at that point (on process exit the system already terminated them, possibly while holding the mutex, and a thread that is still running cannot exit while the loader lock is held), so detach them instead of having 'std::thread' call 'std::terminate'.
+		if (watcher.joinable())
+			watcher.detach();
+		for (std::thread &worker : workers)
+			if (worker.joinable())
+				worker.detach();
+	}
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::unordered_map<uint32_t, texture_replacement> entries;
+	std::deque<uint32_t> prefetch_queue;
+	size_t cache_size = 0;
+	uint64_t use_counter = 0;
+	uint32_t ref_count = 0;
+	bool running = false;
+	bool index_ready = false;
+	std::vector<std::thread> workers;
+	std::thread watcher;
+	HANDLE stop_event = nullptr;
+} s_catalog;
+
+static constexpr size_t s_cache_limit = static_cast<size_t>(RESHADE_ADDON_TEXTURE_LOAD_CACHE_SIZE) * 1024 * 1024;
+
+static std::unordered_map<uint32_t, texture_replacement> scan_replacement_directory(const std::filesystem::path &dir)
+{
+	std::unordered_map<uint32_t, texture_replacement> entries;
+
+	const std::filesystem::path extension = RESHADE_ADDON_TEXTURE_LOAD_FORMAT;
+
+	std::error_code ec;
+	for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(dir, std::filesystem::directory_options::skip_permission_denied, ec))
+	{
+		if (!entry.is_regular_file(ec) || _wcsicmp(entry.path().extension().c_str(), extension.c_str()) != 0)
+			continue;
+
+		// File names have the form "0x%08X", see 'make_texture_file_path' in 'utils\save_texture_image.cpp'
+		const std::wstring stem = entry.path().stem().wstring();
+		if (stem.size() != 10 || stem[0] != L'0' || (stem[1] != L'x' && stem[1] != L'X'))
+			continue;
+		wchar_t *stem_end = nullptr;
+		const uint32_t hash = std::wcstoul(stem.c_str() + 2, &stem_end, 16);
+		if (*stem_end != L'\0')
+			continue;
+
+		texture_replacement &replacement = entries[hash];
+		replacement.path = entry.path();
+		replacement.last_write_time = entry.last_write_time(ec);
+
+		// Only read the image header here, the pixel data is decoded later
+		int width = 0, height = 0, channels = 0;
+		if (!stbi_info(replacement.path.u8string().c_str(), &width, &height, &channels))
+		{
+			reshade::log::message(reshade::log::level::warning, ("Failed to read replacement image \"" + replacement.path.u8string() + "\"!").c_str());
+			entries.erase(hash);
+			continue;
+		}
+
+		replacement.width = static_cast<uint32_t>(width);
+		replacement.height = static_cast<uint32_t>(height);
+		replacement.channels = static_cast<uint32_t>(channels);
+	}
+
+	return entries;
+}
+
+static void update_replacement_catalog(std::unordered_map<uint32_t, texture_replacement> &&entries)
+{
+	const std::lock_guard<std::mutex> lock(s_catalog.mutex);
+
+	s_catalog.cache_size = 0;
+	s_catalog.prefetch_queue.clear();
+
+	for (auto &[hash, replacement] : entries)
+	{
+		// Keep decoded pixel data of images that did not change since the last scan
+		if (const auto it = s_catalog.entries.find(hash);
+			it != s_catalog.entries.end() && it->second.path == replacement.path && it->second.last_write_time == replacement.last_write_time)
+		{
+			replacement = std::move(it->second);
+
+			if (replacement.pixels != nullptr)
+			{
+				s_catalog.cache_size += replacement.pixels->size();
+				continue;
+			}
+		}
+
+		if (!replacement.failed)
+			s_catalog.prefetch_queue.push_back(hash);
+	}
+
+	s_catalog.entries = std::move(entries);
+	s_catalog.index_ready = true;
+
+	s_catalog.cv.notify_all();
+}
+
+static void evict_replacements(uint32_t keep_hash)
+{
+	while (s_catalog.cache_size > s_cache_limit)
+	{
+		// Evict the least recently used image (images that were prefetched but never used go first)
+		texture_replacement *oldest = nullptr;
+		for (auto &[hash, replacement] : s_catalog.entries)
+			if (replacement.pixels != nullptr && hash != keep_hash && (oldest == nullptr || replacement.last_used < oldest->last_used))
+				oldest = &replacement;
+
+		if (oldest == nullptr)
+			break;
+
+		s_catalog.cache_size -= oldest->pixels->size();
+		oldest->pixels.reset();
+	}
+}
+
+static std::shared_ptr<const std::vector<uint8_t>> decode_replacement(std::unique_lock<std::mutex> &lock, uint32_t hash, texture_replacement &replacement)
+{
+	replacement.decoding = true;
+
+	const std::filesystem::path path = replacement.path;
+	const std::filesystem::file_time_type last_write_time = replacement.last_write_time;
+
+	// Decode without holding the lock, so that other threads can continue to look up and decode other images in the meantime
+	lock.unlock();
+
+	std::shared_ptr<std::vector<uint8_t>> pixels;
+
+	int width = 0, height = 0, channels = 0;
+	if (stbi_uc *const rgba_pixel_data_p = stbi_load(path.u8string().c_str(), &width, &height, &channels, STBI_rgb_alpha))
+	{
+		pixels = std::make_shared<std::vector<uint8_t>>(rgba_pixel_data_p, rgba_pixel_data_p + static_cast<size_t>(width) * static_cast<size_t>(height) * 4);
+
+		stbi_image_free(rgba_pixel_data_p);
+	}
+
+	lock.lock();
+
+	// The catalog may have been updated while decoding, so look the entry up again
+	const auto it = s_catalog.entries.find(hash);
+	if (it != s_catalog.entries.end() && it->second.path == path && it->second.last_write_time == last_write_time)
+	{
+		texture_replacement &current = it->second;
+		current.decoding = false;
+
+		if (pixels != nullptr && current.width == static_cast<uint32_t>(width) && current.height == static_cast<uint32_t>(height))
+		{
+			current.pixels = pixels;
+			s_catalog.cache_size += pixels->size();
+			evict_replacements(hash);
+		}
+		else
+		{
+			current.failed = true;
+			pixels.reset();
+
+			reshade::log::message(reshade::log::level::error, ("Failed to load replacement image \"" + path.u8string() + "\"!").c_str());
+		}
+	}
+
+	s_catalog.cv.notify_all();
+
+	return pixels;
+}
+
+static void prefetch_replacements()
+{
+	std::unique_lock<std::mutex> lock(s_catalog.mutex);
+
+	while (true)
+	{
+		s_catalog.cv.wait(lock, []() { return !s_catalog.running || !s_catalog.prefetch_queue.empty(); });
+		if (!s_catalog.running)
+			break;
+
+		const uint32_t hash = s_catalog.prefetch_queue.front();
+		s_catalog.prefetch_queue.pop_front();
+
+		const auto it = s_catalog.entries.find(hash);
+		if (it == s_catalog.entries.end())
+			continue;
+		texture_replacement &replacement = it->second;
+		if (replacement.pixels != nullptr || replacement.decoding || replacement.failed)
+			continue;
+
+		// Only prefetch while there is room left in the cache, everything else is decoded on demand
+		if (s_catalog.cache_size + static_cast<size_t>(replacement.width) * static_cast<size_t>(replacement.height) * 4 > s_cache_limit)
+			continue;
+
+		decode_replacement(lock, hash, replacement);
+	}
+}
+
+static void watch_replacement_directory()
+{
+	const std::filesystem::path dir = get_texture_load_dir();
+
+	update_replacement_catalog(scan_replacement_directory(dir));
+
+	const HANDLE change_handle = FindFirstChangeNotificationW(dir.c_str(), FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+	if (change_handle == INVALID_HANDLE_VALUE)
+	{
+		reshade::log::message(reshade::log::level::warning, "Failed to watch texture replacement directory for changes.");
+		return;
+	}
+
+	const HANDLE wait_handles[2] = { s_catalog.stop_event, change_handle };
+	while (WaitForMultipleObjects(2, wait_handles, FALSE, INFINITE) == WAIT_OBJECT_0 + 1)
+	{
+		// Give a batch of changes (e.g. a texture pack being copied into the directory) some time to settle before scanning again
+		if (WaitForSingleObject(s_catalog.stop_event, 500) == WAIT_OBJECT_0)
+			break;
+
+		FindNextChangeNotification(change_handle);
+
+		update_replacement_catalog(scan_replacement_directory(dir));
+	}
+
+	FindCloseChangeNotification(change_handle);
+}
+
+void init_texture_replacements()
+{
+	const std::lock_guard<std::mutex> lock(s_catalog.mutex);
+
+	if (s_catalog.ref_count++ != 0)
+		return;
+
+	s_catalog.running = true;
+	s_catalog.stop_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	s_catalog.watcher = std::thread(watch_replacement_directory);
+
+	uint32_t num_workers = RESHADE_ADDON_TEXTURE_LOAD_THREADS;
+	if (num_workers == 0)
+		num_workers = std::max(1u, std::thread::hardware_concurrency() / 2);
+	for (uint32_t i = 0; i < num_workers; ++i)
+		s_catalog.workers.emplace_back(prefetch_replacements);
+}
+void destroy_texture_replacements()
+{
+	{
+		const std::lock_guard<std::mutex> lock(s_catalog.mutex);
+
+		if (s_catalog.ref_count == 0 || --s_catalog.ref_count != 0)
+			return;
+
+		s_catalog.running = false;
+	}
+
+	s_catalog.cv.notify_all();
+	SetEvent(s_catalog.stop_event);
+
+	s_catalog.watcher.join();
+	for (std::thread &worker : s_catalog.workers)
+		worker.join();
+	s_catalog.workers.clear();
+
+	CloseHandle(s_catalog.stop_event);
+	s_catalog.stop_event = nullptr;
+
+	const std::lock_guard<std::mutex> lock(s_catalog.mutex);
+
+	s_catalog.entries.clear();
+	s_catalog.prefetch_queue.clear();
+	s_catalog.cache_size = 0;
+	s_catalog.index_ready = false;
+}
+
+static std::shared_ptr<const std::vector<uint8_t>> load_replacement_uncached(uint32_t hash, uint32_t width, uint32_t height)
+{
 	wchar_t hash_string[11];
-	swprintf_s(hash_string, L"0x%08X", texture_hash);
+	swprintf_s(hash_string, L"0x%08X", hash);
 
+	std::filesystem::path path = get_texture_load_dir();
 	path /= hash_string;
 	path += RESHADE_ADDON_TEXTURE_LOAD_FORMAT;
 
-	return path;
+	std::error_code ec;
+	if (!std::filesystem::is_regular_file(path, ec))
+		return nullptr;
+
+	int image_width = 0, image_height = 0, channels = 0;
+	stbi_uc *const rgba_pixel_data_p = stbi_load(path.u8string().c_str(), &image_width, &image_height, &channels, STBI_rgb_alpha);
+	if (rgba_pixel_data_p == nullptr)
+	{
+		reshade::log::message(reshade::log::level::error, ("Failed to load replacement image \"" + path.u8string() + "\"!").c_str());
+		return nullptr;
+	}
+
+	std::shared_ptr<std::vector<uint8_t>> pixels = std::make_shared<std::vector<uint8_t>>(rgba_pixel_data_p, rgba_pixel_data_p + static_cast<size_t>(image_width) * static_cast<size_t>(image_height) * 4);
+
+	stbi_image_free(rgba_pixel_data_p);
+
+	// Only support changing pixel data, but not texture dimensions
+	if (width != static_cast<uint32_t>(image_width) || height != static_cast<uint32_t>(image_height))
+	{
+		reshade::log::message(reshade::log::level::error, "Failed to replace texture data because dimensions do not match!");
+		return nullptr;
+	}
+
+	return pixels;
+}
+
+static std::shared_ptr<const std::vector<uint8_t>> find_replacement(uint32_t hash, uint32_t width, uint32_t height)
+{
+	std::unique_lock<std::mutex> lock(s_catalog.mutex);
+
+	// Whether a replacement exists is not yet known while the initial scan of the replacement directory is still running (which reads the header of every image and can take a while for large texture packs)
+	// Rather than stalling resource creation until it completes, look for the single file this hash maps to directly, without adding it to the catalog (the scan will pick it up)
+	if (!s_catalog.index_ready)
+	{
+		lock.unlock();
+
+		return load_replacement_uncached(hash, width, height);
+	}
+
+	while (true)
+	{
+		const auto it = s_catalog.entries.find(hash);
+		if (it == s_catalog.entries.end())
+			return nullptr;
+		texture_replacement &replacement = it->second;
+
+		// Only support changing pixel data, but not texture dimensions
+		if (replacement.width != width || replacement.height != height)
+		{
+			reshade::log::message(reshade::log::level::error, "Failed to replace texture data because dimensions do not match!");
+			return nullptr;
+		}
+
+		if (replacement.failed)
+			return nullptr;
+
+		// Wait for a worker thread that is already decoding this image to finish, rather than decoding it a second time
+		if (replacement.decoding)
+		{
+			s_catalog.cv.wait(lock);
+			continue;
+		}
+
+		replacement.last_used = ++s_catalog.use_counter;
+
+		if (replacement.pixels != nullptr)
+			return replacement.pixels;
+
+		return decode_replacement(lock, hash, replacement);
+	}
 }
 
 bool load_texture_image(const resource_desc &desc, subresource_data &data, std::vector<std::vector<uint8_t>> &data_to_delete)
 {
 #if RESHADE_ADDON_TEXTURE_LOAD_HASH_TEXMOD
 	// Behavior of the original TexMod (see https://github.com/codemasher/texmod/blob/master/uMod_DX9/uMod_TextureFunction.cpp#L41)
-	const uint32_t hash = ~compute_crc32(
+	const uint32_t hash = ~compute_texture_hash(
 		static_cast<const uint8_t *>(data.data),
 		desc.texture.height * static_cast<size_t>(
 			(desc.texture.format >= format::bc1_typeless && desc.texture.format <= format::bc1_unorm_srgb) || (desc.texture.format >= format::bc4_typeless && desc.texture.format <= format::bc4_snorm) ? (desc.texture.width * 4) / 8 :
@@ -45,33 +416,20 @@ bool load_texture_image(const resource_desc &desc, subresource_data &data, std::
 			format_row_pitch(desc.texture.format, desc.texture.width)));
 #else
 	// Correct hash calculation using entire resource data
-	const uint32_t hash = compute_crc32(
+	const uint32_t hash = compute_texture_hash(
 		static_cast<const uint8_t *>(data.data),
 		format_slice_pitch(desc.texture.format, data.row_pitch, desc.texture.height));
 #endif
 
-	const std::filesystem::path file_path = make_texture_file_path(hash);
-
-	// Check if a replacement file for this texture hash exists and if so, overwrite the texture data with its contents
-	if (!std::filesystem::exists(file_path))
+	const std::shared_ptr<const std::vector<uint8_t>> replacement = find_replacement(hash, desc.texture.width, desc.texture.height);
+	if (replacement == nullptr)
 		return false;
 
-	int width = 0, height = 0, channels = 0;
-	stbi_uc *const rgba_pixel_data_p = stbi_load(file_path.u8string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
-	if (rgba_pixel_data_p == nullptr)
-		return false;
-
-	std::vector<uint8_t> pixel_data(rgba_pixel_data_p, rgba_pixel_data_p + static_cast<size_t>(width) * static_cast<size_t>(height) * 4);
+	const int width = static_cast<int>(desc.texture.width);
+	const int height = static_cast<int>(desc.texture.height);
 
-	stbi_image_free(rgba_pixel_data_p);
-
-	// Only support changing pixel data, but not texture dimensions
-	if (desc.texture.width != static_cast<uint32_t>(width) ||
-		desc.texture.height != static_cast<uint32_t>(height))
-	{
-		reshade::log::message(reshade::log::level::error, "Failed to replace texture data because dimensions do not match!");
-		return false;
-	}
+	// Copy the cached pixel data, since it is converted in place below and the cache entry may be used again later
+	std::vector<uint8_t> pixel_data(*replacement);
 
 	switch (desc.texture.format)
 	{
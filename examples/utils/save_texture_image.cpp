@@ -7,18 +7,24 @@
 
 #include <reshade.hpp>
 #include "config.hpp"
-#include "crc32_hash.hpp"
+#include "texture_hash.hpp"
+#include "bc_decode.hpp"
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <vector>
+#include <fstream>
 #include <filesystem>
+#include <condition_variable>
 #include <stb_image_write.h>
 
 #if RESHADE_ADDON_TEXTURE_SAVE_ENABLE_HASH_SET
-#include <set>
+#include <unordered_set>
 #endif
 
 using namespace reshade::api;
 
-static std::filesystem::path make_texture_file_path(uint32_t texture_hash)
+static std::filesystem::path get_texture_save_dir()
 {
 	// Prepend executable directory to image files
 	wchar_t file_prefix[MAX_PATH] = L"";
@@ -28,6 +34,13 @@ static std::filesystem::path make_texture_file_path(uint32_t texture_hash)
 	path = path.parent_path();
 	path /= RESHADE_ADDON_TEXTURE_SAVE_DIR;
 
+	return path;
+}
+
+static std::filesystem::path make_texture_file_path(uint32_t texture_hash)
+{
+	std::filesystem::path path = get_texture_save_dir();
+
 	// Ensure target directory exists
 	if (!std::filesystem::exists(path))
 		std::filesystem::create_directory(path);
@@ -41,111 +54,63 @@ static std::filesystem::path make_texture_file_path(uint32_t texture_hash)
 	return path;
 }
 
-static void unpack_r5g6b5(uint16_t data, uint8_t rgb[3])
+static bool is_texture_format_supported(format format)
 {
-	uint32_t temp;
-	temp =  (data           >> 11) * 255 + 16;
-	rgb[0] = static_cast<uint8_t>((temp / 32 + temp) / 32);
-	temp = ((data & 0x07E0) >>  5) * 255 + 32;
-	rgb[1] = static_cast<uint8_t>((temp / 64 + temp) / 64);
-	temp =  (data & 0x001F)        * 255 + 16;
-	rgb[2] = static_cast<uint8_t>((temp / 32 + temp) / 32);
-}
-static void unpack_bc1_value(const uint8_t color_0[3], const uint8_t color_1[3], uint32_t color_index, uint8_t result[4], bool not_degenerate = true)
-{
-	switch (color_index)
+	// Keep in sync with the formats handled in 'decode_texture_image' below
+	switch (format)
 	{
-	case 0:
-		for (int c = 0; c < 3; ++c)
-			result[c] = color_0[c];
-		result[3] = 255;
-		break;
-	case 1:
-		for (int c = 0; c < 3; ++c)
-			result[c] = color_1[c];
-		result[3] = 255;
-		break;
-	case 2:
-		for (int c = 0; c < 3; ++c)
-			result[c] = not_degenerate ? (2 * color_0[c] + color_1[c]) / 3 : (color_0[c] + color_1[c]) / 2;
-		result[3] = 255;
-		break;
-	case 3:
-		for (int c = 0; c < 3; ++c)
-			result[c] = not_degenerate ? (color_0[c] + 2 * color_1[c]) / 3 : 0;
-		result[3] = not_degenerate ? 255 : 0;
-		break;
-	}
-}
-static void unpack_bc4_value(uint8_t alpha_0, uint8_t alpha_1, uint32_t alpha_index, uint8_t *result)
-{
-	const bool interpolation_type = alpha_0 > alpha_1;
-
-	switch (alpha_index)
-	{
-	case 0:
-		*result = alpha_0;
-		break;
-	case 1:
-		*result = alpha_1;
-		break;
-	case 2:
-		*result = interpolation_type ? (6 * alpha_0 + 1 * alpha_1) / 7 : (4 * alpha_0 + 1 * alpha_1) / 5;
-		break;
-	case 3:
-		*result = interpolation_type ? (5 * alpha_0 + 2 * alpha_1) / 7 : (3 * alpha_0 + 2 * alpha_1) / 5;
-		break;
-	case 4:
-		*result = interpolation_type ? (4 * alpha_0 + 3 * alpha_1) / 7 : (2 * alpha_0 + 3 * alpha_1) / 5;
-		break;
-	case 5:
-		*result = interpolation_type ? (3 * alpha_0 + 4 * alpha_1) / 7 : (1 * alpha_0 + 4 * alpha_1) / 5;
-		break;
-	case 6:
-		*result = interpolation_type ? (2 * alpha_0 + 5 * alpha_1) / 7 : 0;
-		break;
-	case 7:
-		*result = interpolation_type ? (1 * alpha_0 + 6 * alpha_1) / 7 : 255;
-		break;
+	case format::l8_unorm:
+	case format::a8_unorm:
+	case format::r8_typeless:
+	case format::r8_unorm:
+	case format::r8_snorm:
+	case format::l8a8_unorm:
+	case format::r8g8_typeless:
+	case format::r8g8_unorm:
+	case format::r8g8_snorm:
+	case format::r8g8b8a8_typeless:
+	case format::r8g8b8a8_unorm:
+	case format::r8g8b8a8_unorm_srgb:
+	case format::r8g8b8x8_unorm:
+	case format::r8g8b8x8_unorm_srgb:
+	case format::b8g8r8a8_typeless:
+	case format::b8g8r8a8_unorm:
+	case format::b8g8r8a8_unorm_srgb:
+	case format::b8g8r8x8_typeless:
+	case format::b8g8r8x8_unorm:
+	case format::b8g8r8x8_unorm_srgb:
+	case format::bc1_typeless:
+	case format::bc1_unorm:
+	case format::bc1_unorm_srgb:
+	case format::bc2_typeless:
+	case format::bc2_unorm:
+	case format::bc2_unorm_srgb:
+	case format::bc3_typeless:
+	case format::bc3_unorm:
+	case format::bc3_unorm_srgb:
+	case format::bc4_typeless:
+	case format::bc4_unorm:
+	case format::bc4_snorm:
+	case format::bc5_typeless:
+	case format::bc5_unorm:
+	case format::bc5_snorm:
+	case format::bc6h_typeless:
+	case format::bc6h_ufloat:
+	case format::bc6h_sfloat:
+	case format::bc7_typeless:
+	case format::bc7_unorm:
+	case format::bc7_unorm_srgb:
+		return true;
+	default:
+		return false;
 	}
 }
 
-bool save_texture_image(const resource_desc &desc, const subresource_data &data)
+static bool decode_texture_image(const resource_desc &desc, const subresource_data &data, std::vector<uint8_t> &rgba_pixel_data)
 {
-#if RESHADE_ADDON_TEXTURE_SAVE_HASH_TEXMOD
-	// Behavior of the original TexMod (see https://github.com/codemasher/texmod/blob/master/uMod_DX9/uMod_TextureFunction.cpp#L41)
-	const uint32_t hash = ~compute_crc32(
-		static_cast<const uint8_t *>(data.data),
-		desc.texture.height * static_cast<size_t>(
-			(desc.texture.format >= format::bc1_typeless && desc.texture.format <= format::bc1_unorm_srgb) || (desc.texture.format >= format::bc4_typeless && desc.texture.format <= format::bc4_snorm) ? (desc.texture.width * 4) / 8 :
-			(desc.texture.format >= format::bc2_typeless && desc.texture.format <= format::bc2_unorm_srgb) || (desc.texture.format >= format::bc3_typeless && desc.texture.format <= format::bc3_unorm_srgb) || (desc.texture.format >= format::bc5_typeless && desc.texture.format <= format::bc7_unorm_srgb) ? desc.texture.width :
-			format_row_pitch(desc.texture.format, desc.texture.width)));
-#else
-	// Correct hash calculation using entire resource data
-	const uint32_t hash = compute_crc32(
-		static_cast<const uint8_t *>(data.data),
-		format_slice_pitch(desc.texture.format, data.row_pitch, desc.texture.height));
-#endif
-
-#if RESHADE_ADDON_TEXTURE_SAVE_ENABLE_HASH_SET
-	static std::set<uint32_t> hash_set;
-	if (hash_set.find(hash) != hash_set.end())
-	{
-		reshade::log::message(reshade::log::level::error, "Skipped texture that was already dumped.");
-		return true;
-	}
-	else
-	{
-		hash_set.insert(hash);
-	}
-#endif
-
-	const uint32_t block_count_x = (desc.texture.width + 3) / 4;
-	const uint32_t block_count_y = (desc.texture.height + 3) / 4;
-
 	uint8_t *data_p = static_cast<uint8_t *>(data.data);
-	// Add sufficient padding for block compressed textures that are not a multiple of 4 in all dimensions
-	std::vector<uint8_t> rgba_pixel_data((block_count_x * 4) * (block_count_y * 4) * 4);
+	// Block compressed formats clip blocks that are partially outside the texture, so this does not need any padding
+	rgba_pixel_data.resize(static_cast<size_t>(desc.texture.width) * desc.texture.height * 4);
 
 	switch (desc.texture.format)
 	{
@@ -272,161 +237,59 @@ bool save_texture_image(const resource_desc &desc, const subresource_data &data)
 	case format::bc1_unorm:
 	case format::bc1_unorm_srgb:
 		// See https://docs.microsoft.com/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression#bc1
-		for (size_t block_y = 0; block_y < block_count_y; ++block_y, data_p += data.row_pitch)
-		{
-			for (size_t block_x = 0; block_x < block_count_x; ++block_x)
-			{
-				const uint8_t *const src = data_p + block_x * 8;
-
-				const uint16_t color_0 = *reinterpret_cast<const uint16_t *>(src);
-				const uint16_t color_1 = *reinterpret_cast<const uint16_t *>(src + 2);
-				const uint32_t color_i = *reinterpret_cast<const uint32_t *>(src + 4);
-
-				uint8_t color_0_rgb[3];
-				unpack_r5g6b5(color_0, color_0_rgb);
-				uint8_t color_1_rgb[3];
-				unpack_r5g6b5(color_1, color_1_rgb);
-				const bool degenerate = color_0 > color_1;
-
-				for (int y = 0; y < 4; ++y)
-				{
-					for (int x = 0; x < 4; ++x)
-					{
-						uint8_t *const dst = rgba_pixel_data.data() + ((block_y * 4 + y) * desc.texture.width + (block_x * 4 + x)) * 4;
-
-						unpack_bc1_value(color_0_rgb, color_1_rgb, (color_i >> (2 * (y * 4 + x))) & 0x3, dst, degenerate);
-					}
-				}
-			}
-		}
+		bc_decode::decode_image(bc_decode::block_format::bc1, desc.texture.width, desc.texture.height, data_p, data.row_pitch, rgba_pixel_data.data(), desc.texture.width * 4);
+		break;
+	case format::bc2_typeless:
+	case format::bc2_unorm:
+	case format::bc2_unorm_srgb:
+		// See https://docs.microsoft.com/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression#bc2
+		bc_decode::decode_image(bc_decode::block_format::bc2, desc.texture.width, desc.texture.height, data_p, data.row_pitch, rgba_pixel_data.data(), desc.texture.width * 4);
 		break;
 	case format::bc3_typeless:
 	case format::bc3_unorm:
 	case format::bc3_unorm_srgb:
 		// See https://docs.microsoft.com/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression#bc3
-		for (size_t block_y = 0; block_y < block_count_y; ++block_y, data_p += data.row_pitch)
-		{
-			for (size_t block_x = 0; block_x < block_count_x; ++block_x)
-			{
-				const uint8_t *const src = data_p + block_x * 16;
-
-				const uint8_t  alpha_0 = src[0];
-				const uint8_t  alpha_1 = src[1];
-				const uint64_t alpha_i =
-					(static_cast<uint64_t>(src[2])      ) |
-					(static_cast<uint64_t>(src[3]) <<  8) |
-					(static_cast<uint64_t>(src[4]) << 16) |
-					(static_cast<uint64_t>(src[5]) << 24) |
-					(static_cast<uint64_t>(src[6]) << 32) |
-					(static_cast<uint64_t>(src[7]) << 40);
-
-				const uint16_t color_0 = *reinterpret_cast<const uint16_t *>(src + 8);
-				const uint16_t color_1 = *reinterpret_cast<const uint16_t *>(src + 10);
-				const uint32_t color_i = *reinterpret_cast<const uint32_t *>(src + 12);
-
-				uint8_t color_0_rgb[3];
-				unpack_r5g6b5(color_0, color_0_rgb);
-				uint8_t color_1_rgb[3];
-				unpack_r5g6b5(color_1, color_1_rgb);
-
-				for (int y = 0; y < 4; ++y)
-				{
-					for (int x = 0; x < 4; ++x)
-					{
-						uint8_t *const dst = rgba_pixel_data.data() + ((block_y * 4 + y) * desc.texture.width + (block_x * 4 + x)) * 4;
-
-						unpack_bc1_value(color_0_rgb, color_1_rgb, (color_i >> (2 * (y * 4 + x))) & 0x3, dst);
-						unpack_bc4_value(alpha_0, alpha_1, (alpha_i >> (3 * (y * 4 + x))) & 0x7, dst + 3);
-					}
-				}
-			}
-		}
+		bc_decode::decode_image(bc_decode::block_format::bc3, desc.texture.width, desc.texture.height, data_p, data.row_pitch, rgba_pixel_data.data(), desc.texture.width * 4);
 		break;
 	case format::bc4_typeless:
 	case format::bc4_unorm:
 	case format::bc4_snorm:
 		// See https://docs.microsoft.com/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression#bc4
-		for (size_t block_y = 0; block_y < block_count_y; ++block_y, data_p += data.row_pitch)
-		{
-			for (size_t block_x = 0; block_x < block_count_x; ++block_x)
-			{
-				const uint8_t *const src = data_p + block_x * 8;
-
-				const uint8_t  red_0 = src[0];
-				const uint8_t  red_1 = src[1];
-				const uint64_t red_i =
-					(static_cast<uint64_t>(src[2])      ) |
-					(static_cast<uint64_t>(src[3]) <<  8) |
-					(static_cast<uint64_t>(src[4]) << 16) |
-					(static_cast<uint64_t>(src[5]) << 24) |
-					(static_cast<uint64_t>(src[6]) << 32) |
-					(static_cast<uint64_t>(src[7]) << 40);
-
-				for (int y = 0; y < 4; ++y)
-				{
-					for (int x = 0; x < 4; ++x)
-					{
-						uint8_t *const dst = rgba_pixel_data.data() + ((block_y * 4 + y) * desc.texture.width + (block_x * 4 + x)) * 4;
-
-						unpack_bc4_value(red_0, red_1, (red_i >> (3 * (y * 4 + x))) & 0x7, dst);
-						dst[1] = dst[0];
-						dst[2] = dst[0];
-						dst[3] = 255;
-					}
-				}
-			}
-		}
+		bc_decode::decode_image(bc_decode::block_format::bc4, desc.texture.width, desc.texture.height, data_p, data.row_pitch, rgba_pixel_data.data(), desc.texture.width * 4);
 		break;
 	case format::bc5_typeless:
 	case format::bc5_unorm:
 	case format::bc5_snorm:
 		// See https://docs.microsoft.com/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression#bc5
-		for (size_t block_y = 0; block_y < block_count_y; ++block_y, data_p += data.row_pitch)
-		{
-			for (size_t block_x = 0; block_x < block_count_x; ++block_x)
-			{
-				const uint8_t *const src = data_p + block_x * 16;
-
-				const uint8_t  red_0 = src[0];
-				const uint8_t  red_1 = src[1];
-				const uint64_t red_i =
-					(static_cast<uint64_t>(src[2])      ) |
-					(static_cast<uint64_t>(src[3]) <<  8) |
-					(static_cast<uint64_t>(src[4]) << 16) |
-					(static_cast<uint64_t>(src[5]) << 24) |
-					(static_cast<uint64_t>(src[6]) << 32) |
-					(static_cast<uint64_t>(src[7]) << 40);
-
-				const uint8_t  green_0 = src[8];
-				const uint8_t  green_1 = src[9];
-				const uint64_t green_i =
-					(static_cast<uint64_t>(src[10])      ) |
-					(static_cast<uint64_t>(src[11]) <<  8) |
-					(static_cast<uint64_t>(src[12]) << 16) |
-					(static_cast<uint64_t>(src[13]) << 24) |
-					(static_cast<uint64_t>(src[14]) << 32) |
-					(static_cast<uint64_t>(src[15]) << 40);
-
-				for (int y = 0; y < 4; ++y)
-				{
-					for (int x = 0; x < 4; ++x)
-					{
-						uint8_t *const dst = rgba_pixel_data.data() + ((block_y * 4 + y) * desc.texture.width + (block_x * 4 + x)) * 4;
-
-						unpack_bc4_value(red_0, red_1, (red_i >> (3 * (y * 4 + x))) & 0x7, dst);
-						unpack_bc4_value(green_0, green_1, (green_i >> (3 * (y * 4 + x))) & 0x7, dst + 1);
-						dst[2] = 0;
-						dst[3] = 255;
-					}
-				}
-			}
-		}
+		bc_decode::decode_image(bc_decode::block_format::bc5, desc.texture.width, desc.texture.height, data_p, data.row_pitch, rgba_pixel_data.data(), desc.texture.width * 4);
+		break;
+	case format::bc6h_typeless:
+	case format::bc6h_ufloat:
+	case format::bc6h_sfloat:
+		// See https://learn.microsoft.com/windows/win32/direct3d11/bc6h-format
+		// HDR colors are clamped to the [0, 1] range, since they are written to an 8-bit image
+		bc_decode::decode_image(desc.texture.format == format::bc6h_sfloat ? bc_decode::block_format::bc6h_sf16 : bc_decode::block_format::bc6h_uf16, desc.texture.width, desc.texture.height, data_p, data.row_pitch, rgba_pixel_data.data(), desc.texture.width * 4);
+		break;
+	case format::bc7_typeless:
+	case format::bc7_unorm:
+	case format::bc7_unorm_srgb:
+		// See https://learn.microsoft.com/windows/win32/direct3d11/bc7-format
+		bc_decode::decode_image(bc_decode::block_format::bc7, desc.texture.width, desc.texture.height, data_p, data.row_pitch, rgba_pixel_data.data(), desc.texture.width * 4);
 		break;
 	default:
 		// Unsupported format
 		return false;
 	}
 
+	return true;
+}
+
+static bool write_texture_image(uint32_t hash, const resource_desc &desc, const subresource_data &data)
+{
+	std::vector<uint8_t> rgba_pixel_data;
+	if (!decode_texture_image(desc, data, rgba_pixel_data))
+		return false;
+
 	const std::filesystem::path file_path = make_texture_file_path(hash);
 
 	if (file_path.extension() == L".bmp")
@@ -436,3 +299,301 @@ bool save_texture_image(const resource_desc &desc, const subresource_data &data)
 	else
 		return false;
 }
+
+#if RESHADE_ADDON_TEXTURE_SAVE_ENABLE_HASH_SET
+static std::mutex s_hash_set_mutex;
+static std::unordered_set<uint32_t> s_hash_set;
+#if RESHADE_ADDON_TEXTURE_SAVE_HASH_INDEX
+static bool s_hash_index_loaded = false;
+static std::ofstream s_hash_index_file;
+
+static void load_hash_index()
+{
+	const std::filesystem::path dump_dir = get_texture_save_dir();
+	const std::filesystem::path index_path = dump_dir / L"index.txt";
+
+	// Hashes are only comparable if they were computed the same way, so the settings are part of the header
+	char header[64];
+	sprintf_s(header, "# Texture hash index v1 %d %d", RESHADE_ADDON_TEXTURE_HASH_ALGORITHM, RESHADE_ADDON_TEXTURE_SAVE_HASH_TEXMOD);
+
+	std::error_code ec;
+	const bool index_exists = std::filesystem::exists(index_path, ec);
+
+	bool index_valid = false;
+	if (std::ifstream index_file(index_path); index_file)
+	{
+		std::string line;
+		if (std::getline(index_file, line) && line == header)
+		{
+			index_valid = true;
+
+			while (std::getline(index_file, line))
+			{
+				char *line_end = nullptr;
+				const uint32_t hash = std::strtoul(line.c_str(), &line_end, 16);
+				if (line_end != line.c_str())
+					s_hash_set.insert(hash);
+			}
+		}
+	}
+
+	if (!index_valid)
+	{
+		// Seed a new index with the textures that were dumped before there was one
+		if (!index_exists)
+		{
+			const std::filesystem::path extension = RESHADE_ADDON_TEXTURE_SAVE_FORMAT;
+
+			for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(dump_dir, std::filesystem::directory_options::skip_permission_denied, ec))
+			{
+				if (entry.path().extension() != extension)
+					continue;
+
+				const std::string stem = entry.path().stem().u8string();
+				char *stem_end = nullptr;
+				const uint32_t hash = std::strtoul(stem.c_str(), &stem_end, 16);
+				if (stem.size() == 10 && *stem_end == '\0')
+					s_hash_set.insert(hash);
+			}
+		}
+
+		std::filesystem::create_directory(dump_dir, ec);
+
+		s_hash_index_file.open(index_path, std::ios::trunc);
+		s_hash_index_file << header << '\n';
+		for (const uint32_t hash : s_hash_set)
+			s_hash_index_file << "0x" << std::hex << std::uppercase << hash << '\n';
+		s_hash_index_file.flush();
+	}
+	else
+	{
+		s_hash_index_file.open(index_path, std::ios::app);
+	}
+
+	if (!s_hash_index_file)
+		reshade::log::message(reshade::log::level::warning, "Failed to open texture hash index for writing.");
+}
+#endif
+
+/// <summary>
+/// Marks the texture with the specified hash as dumped.
+/// </summary>
+/// <returns><see langword="true"/> if the texture was not dumped before, <see langword="false"/> otherwise.</returns>
+static bool mark_texture_dumped(uint32_t hash)
+{
+	const std::lock_guard<std::mutex> lock(s_hash_set_mutex);
+
+#if RESHADE_ADDON_TEXTURE_SAVE_HASH_INDEX
+	if (!s_hash_index_loaded)
+	{
+		s_hash_index_loaded = true;
+		load_hash_index();
+	}
+#endif
+
+	return s_hash_set.insert(hash).second;
+}
+#endif
+
+static void on_texture_image_written(uint32_t hash, bool add_to_index, bool written)
+{
+#if RESHADE_ADDON_TEXTURE_SAVE_ENABLE_HASH_SET
+	if (!add_to_index)
+		return;
+
+	const std::lock_guard<std::mutex> lock(s_hash_set_mutex);
+
+	// The hash was already added to the set by 'mark_texture_dumped' before the texture was queued, so remove it again if writing failed, to try again the next time the texture is loaded
+	if (!written)
+	{
+		s_hash_set.erase(hash);
+		return;
+	}
+
+#if RESHADE_ADDON_TEXTURE_SAVE_HASH_INDEX
+	// Only add textures to the persistent index once they were actually written, so that a crash in between does not cause them to be skipped forever
+	if (s_hash_index_file)
+		s_hash_index_file << "0x" << std::hex << std::uppercase << hash << std::endl;
+#endif
+#else
+	(void)hash;
+	(void)add_to_index;
+	(void)written;
+#endif
+}
+
+struct texture_save_job
+{
+	uint32_t hash;
+	bool add_to_index;
+	resource_desc desc;
+	subresource_data data;
+	std::vector<uint8_t> data_copy;
+};
+
+// Decoding and encoding images is slow, so is done on a set of worker threads, to avoid blocking the application thread that is loading textures
+static struct texture_image_writer
+{
+	~texture_image_writer()
+	{
+		// The worker threads are normally joined in 'destroy_texture_image_writer', but if a device is leaked that never happens and they are still joinable when this static is destroyed during 'DLL_PROCESS_DETACH'.
+		// They cannot be joined at that point (on process exit the system already terminated them, and a thread that is still running cannot exit while the loader lock is held), so detach them instead of having 'std::thread' call 'std::terminate'.
+		for (std::thread &worker : workers)
+			if (worker.joinable())
+				worker.detach();
+
+		// Write what is left in the queue on this thread, unless a terminated worker thread still owned the lock
+		if (!mutex.try_lock())
+			return;
+
+		for (texture_save_job &job : queue)
+			on_texture_image_written(job.hash, job.add_to_index, write_texture_image(job.hash, job.desc, job.data));
+		queue.clear();
+
+		mutex.unlock();
+	}
+
+	std::mutex mutex;
+	std::condition_variable job_cv;
+	std::condition_variable space_cv;
+	std::deque<texture_save_job> queue;
+	size_t queue_size = 0;
+	uint32_t ref_count = 0;
+	bool running = false;
+	std::vector<std::thread> workers;
+} s_writer;
+
+static constexpr size_t s_queue_limit = static_cast<size_t>(RESHADE_ADDON_TEXTURE_SAVE_QUEUE_SIZE) * 1024 * 1024;
+
+static void write_queued_texture_images()
+{
+	std::unique_lock<std::mutex> lock(s_writer.mutex);
+
+	while (true)
+	{
+		s_writer.job_cv.wait(lock, []() { return !s_writer.running || !s_writer.queue.empty(); });
+		// Finish writing all queued textures before stopping
+		if (s_writer.queue.empty())
+			break;
+
+		texture_save_job job = std::move(s_writer.queue.front());
+		s_writer.queue.pop_front();
+		s_writer.queue_size -= job.data_copy.size();
+
+		s_writer.space_cv.notify_all();
+
+		lock.unlock();
+
+		on_texture_image_written(job.hash, job.add_to_index, write_texture_image(job.hash, job.desc, job.data));
+
+		lock.lock();
+	}
+}
+
+void init_texture_image_writer()
+{
+	const std::lock_guard<std::mutex> lock(s_writer.mutex);
+
+	if (s_writer.ref_count++ != 0 || RESHADE_ADDON_TEXTURE_SAVE_THREADS == 0)
+		return;
+
+	s_writer.running = true;
+	for (uint32_t i = 0; i < RESHADE_ADDON_TEXTURE_SAVE_THREADS; ++i)
+		s_writer.workers.emplace_back(write_queued_texture_images);
+}
+void destroy_texture_image_writer()
+{
+	{
+		const std::lock_guard<std::mutex> lock(s_writer.mutex);
+
+		if (s_writer.ref_count == 0 || --s_writer.ref_count != 0)
+			return;
+
+		s_writer.running = false;
+	}
+
+	s_writer.job_cv.notify_all();
+	s_writer.space_cv.notify_all();
+
+	for (std::thread &worker : s_writer.workers)
+		worker.join();
+	s_writer.workers.clear();
+}
+
+bool save_texture_image(const resource_desc &desc, const subresource_data &data, bool force)
+{
+	// Check this before hashing or copying any data, so that unsupported textures are cheap to skip (and are not marked as dumped)
+	if (!is_texture_format_supported(desc.texture.format))
+		return false;
+
+#if RESHADE_ADDON_TEXTURE_SAVE_HASH_TEXMOD
+	// Behavior of the original TexMod (see https://github.com/codemasher/texmod/blob/master/uMod_DX9/uMod_TextureFunction.cpp#L41)
+	const uint32_t hash = ~compute_texture_hash(
+		static_cast<const uint8_t *>(data.data),
+		desc.texture.height * static_cast<size_t>(
+			(desc.texture.format >= format::bc1_typeless && desc.texture.format <= format::bc1_unorm_srgb) || (desc.texture.format >= format::bc4_typeless && desc.texture.format <= format::bc4_snorm) ? (desc.texture.width * 4) / 8 :
+			(desc.texture.format >= format::bc2_typeless && desc.texture.format <= format::bc2_unorm_srgb) || (desc.texture.format >= format::bc3_typeless && desc.texture.format <= format::bc3_unorm_srgb) || (desc.texture.format >= format::bc5_typeless && desc.texture.format <= format::bc7_unorm_srgb) ? desc.texture.width :
+			format_row_pitch(desc.texture.format, desc.texture.width)));
+#else
+	// Correct hash calculation using entire resource data
+	const uint32_t hash = compute_texture_hash(
+		static_cast<const uint8_t *>(data.data),
+		format_slice_pitch(desc.texture.format, data.row_pitch, desc.texture.height));
+#endif
+
+	bool add_to_index = true;
+#if RESHADE_ADDON_TEXTURE_SAVE_ENABLE_HASH_SET
+	// Check this before copying any data, so that textures that were already dumped (in this or an earlier session) are cheap to skip
+	// Explicit saves (e.g. requested by the user) are always written, even if the texture was dumped before
+	if (!mark_texture_dumped(hash))
+	{
+		if (!force)
+		{
+			reshade::log::message(reshade::log::level::debug, "Skipped texture that was already dumped.");
+			return true;
+		}
+
+		add_to_index = false;
+	}
+#endif
+
+	{
+		std::unique_lock<std::mutex> lock(s_writer.mutex);
+
+		if (s_writer.running)
+		{
+			lock.unlock();
+
+			// Copy the data, since the application is free to modify or release it as soon as the event returns
+			texture_save_job job;
+			job.hash = hash;
+			job.add_to_index = add_to_index;
+			job.desc = desc;
+			job.data_copy.assign(
+				static_cast<const uint8_t *>(data.data),
+				static_cast<const uint8_t *>(data.data) + format_slice_pitch(desc.texture.format, data.row_pitch, desc.texture.height));
+			job.data.data = job.data_copy.data();
+			job.data.row_pitch = data.row_pitch;
+			job.data.slice_pitch = static_cast<uint32_t>(job.data_copy.size());
+
+			lock.lock();
+
+			// Block when the worker threads fall too far behind, to limit the amount of memory used by queued textures
+			s_writer.space_cv.wait(lock, [&job]() { return !s_writer.running || s_writer.queue.empty() || s_writer.queue_size + job.data_copy.size() <= s_queue_limit; });
+
+			if (s_writer.running)
+			{
+				s_writer.queue_size += job.data_copy.size();
+				s_writer.queue.push_back(std::move(job));
+
+				s_writer.job_cv.notify_one();
+				return true;
+			}
+		}
+	}
+
+	// Write synchronously if there are no worker threads
+	const bool written = write_texture_image(hash, desc, data);
+	on_texture_image_written(hash, add_to_index, written);
+	return written;
+}
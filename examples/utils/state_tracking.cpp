@@ -5,50 +5,190 @@
 
 #include "reshade.hpp"
 #include "state_tracking.hpp"
+#include <atomic>
+#include <algorithm> // std::copy_n, std::equal, std::fill, std::min, std::max, std::remove_if, std::rotate
+#include <cstring> // std::memcmp
 
 using namespace reshade::api;
 
-void state_block::apply(command_list *cmd_list) const
+static void bind_descriptor_table_ranges(command_list *cmd_list, const state_block::descriptor_table_binding &binding, uint64_t tables_to_bind)
 {
-	if (!render_targets.empty() || depth_stencil != 0)
-		cmd_list->bind_render_targets_and_depth_stencil(static_cast<uint32_t>(render_targets.size()), render_targets.data(), depth_stencil);
+	// Bind each consecutive range of tables with a single call
+	for (uint32_t first = 0; first < state_block::max_descriptor_tables; ++first)
+	{
+		if ((tables_to_bind & (1ull << first)) == 0)
+			continue;
 
-	for (const auto &[stages, pipeline] : pipelines)
-		cmd_list->bind_pipeline(stages, pipeline);
+		uint32_t count = 1;
+		while (first + count < state_block::max_descriptor_tables && (tables_to_bind & (1ull << (first + count))) != 0)
+			++count;
 
-	if (primitive_topology != primitive_topology::undefined)
-		cmd_list->bind_pipeline_state(dynamic_state::primitive_topology, static_cast<uint32_t>(primitive_topology));
-	if (blend_constant != 0)
-		cmd_list->bind_pipeline_state(dynamic_state::blend_constant, blend_constant);
-	if (sample_mask != 0xFFFFFFFF)
-		cmd_list->bind_pipeline_state(dynamic_state::sample_mask, sample_mask);
-	if (front_stencil_reference_value != 0)
-		cmd_list->bind_pipeline_state(dynamic_state::front_stencil_reference_value, front_stencil_reference_value);
-	if (back_stencil_reference_value != 0)
-		cmd_list->bind_pipeline_state(dynamic_state::back_stencil_reference_value, back_stencil_reference_value);
+		cmd_list->bind_descriptor_tables(binding.stages, binding.layout, first, count, binding.tables + first);
+		first += count;
+	}
+}
 
-	if (!viewports.empty())
-		cmd_list->bind_viewports(0, static_cast<uint32_t>(viewports.size()), viewports.data());
-	if (!scissor_rects.empty())
-		cmd_list->bind_scissor_rects(0, static_cast<uint32_t>(scissor_rects.size()), scissor_rects.data());
+static bool is_pipeline_bound(const state_block &state, pipeline_stage stages, pipeline pipeline)
+{
+	// Bindings are stored in the order they were bound, so the last one that includes a stage is what is in effect for that stage
+	for (uint32_t stage_bit = 1; stage_bit != 0; stage_bit <<= 1)
+	{
+		if ((static_cast<uint32_t>(stages) & stage_bit) == 0)
+			continue;
+
+		const state_block::pipeline_binding *effective_binding = nullptr;
+		for (uint32_t i = state.pipeline_count; i-- != 0 && effective_binding == nullptr;)
+			if ((static_cast<uint32_t>(state.pipelines[i].stages) & stage_bit) != 0)
+				effective_binding = &state.pipelines[i];
+
+		if (effective_binding == nullptr || effective_binding->pipeline != pipeline)
+			return false;
+	}
+
+	return true;
+}
 
-	for (const auto &[stages, descriptor_state] : descriptor_tables)
-		cmd_list->bind_descriptor_tables(stages, descriptor_state.first, 0, static_cast<uint32_t>(descriptor_state.second.size()), descriptor_state.second.data());
+static void apply_state(command_list *cmd_list, const state_block &state, const state_block *current_state)
+{
+	// Only state that was bound in this state block is applied, and of that only what is not already bound identically when the current state is known
+	const uint32_t current_bound_state = current_state != nullptr ? current_state->bound_state : 0;
+	const auto is_bound_in_current_state = [current_bound_state](uint32_t bit) { return (current_bound_state & bit) != 0; };
+
+	if ((state.bound_state & state_block::render_targets_bit) != 0 && !(
+			is_bound_in_current_state(state_block::render_targets_bit) &&
+			current_state->render_target_count == state.render_target_count &&
+			current_state->depth_stencil == state.depth_stencil &&
+			std::equal(state.render_targets, state.render_targets + state.render_target_count, current_state->render_targets)))
+		cmd_list->bind_render_targets_and_depth_stencil(state.render_target_count, state.render_targets, state.depth_stencil);
+
+	if ((state.bound_state & state_block::pipelines_bit) != 0)
+	{
+		// Stages that were bound again by this call, which may differ from the current state now
+		pipeline_stage rebound_stages = static_cast<pipeline_stage>(0);
+
+		for (uint32_t i = 0; i < state.pipeline_count; ++i)
+		{
+			const state_block::pipeline_binding &binding = state.pipelines[i];
+
+			// Compare what is in effect for each stage, since the current state may have bound other pipelines to some of these stages with a different stage mask
+			if (is_bound_in_current_state(state_block::pipelines_bit) && (binding.stages & rebound_stages) == 0 && is_pipeline_bound(*current_state, binding.stages, binding.pipeline))
+				continue;
+
+			cmd_list->bind_pipeline(binding.stages, binding.pipeline);
+			rebound_stages |= binding.stages;
+		}
+	}
+
+	// Batch all dynamic states into a single call
+	uint32_t dynamic_state_count = 0;
+	dynamic_state dynamic_states[5];
+	uint32_t dynamic_state_values[5];
+	const auto add_dynamic_state = [&](uint32_t bit, dynamic_state type, uint32_t value, uint32_t current_value) {
+		if ((state.bound_state & bit) == 0 || (is_bound_in_current_state(bit) && current_value == value))
+			return;
+		dynamic_states[dynamic_state_count] = type;
+		dynamic_state_values[dynamic_state_count] = value;
+		dynamic_state_count++;
+	};
+
+	add_dynamic_state(state_block::primitive_topology_bit, dynamic_state::primitive_topology, static_cast<uint32_t>(state.primitive_topology), current_state != nullptr ? static_cast<uint32_t>(current_state->primitive_topology) : 0);
+	add_dynamic_state(state_block::blend_constant_bit, dynamic_state::blend_constant, state.blend_constant, current_state != nullptr ? current_state->blend_constant : 0);
+	add_dynamic_state(state_block::sample_mask_bit, dynamic_state::sample_mask, state.sample_mask, current_state != nullptr ? current_state->sample_mask : 0);
+	add_dynamic_state(state_block::front_stencil_reference_value_bit, dynamic_state::front_stencil_reference_value, state.front_stencil_reference_value, current_state != nullptr ? current_state->front_stencil_reference_value : 0);
+	add_dynamic_state(state_block::back_stencil_reference_value_bit, dynamic_state::back_stencil_reference_value, state.back_stencil_reference_value, current_state != nullptr ? current_state->back_stencil_reference_value : 0);
+
+	if (dynamic_state_count != 0)
+		cmd_list->bind_pipeline_states(dynamic_state_count, dynamic_states, dynamic_state_values);
+
+	if ((state.bound_state & state_block::viewports_bit) != 0 && !(
+			is_bound_in_current_state(state_block::viewports_bit) &&
+			current_state->viewport_count == state.viewport_count &&
+			std::memcmp(current_state->viewports, state.viewports, state.viewport_count * sizeof(viewport)) == 0))
+		cmd_list->bind_viewports(0, state.viewport_count, state.viewports);
+	if ((state.bound_state & state_block::scissor_rects_bit) != 0 && !(
+			is_bound_in_current_state(state_block::scissor_rects_bit) &&
+			current_state->scissor_rect_count == state.scissor_rect_count &&
+			std::memcmp(current_state->scissor_rects, state.scissor_rects, state.scissor_rect_count * sizeof(rect)) == 0))
+		cmd_list->bind_scissor_rects(0, state.scissor_rect_count, state.scissor_rects);
+
+	if ((state.bound_state & state_block::descriptor_tables_bit) != 0)
+	{
+		// Stages that were bound again by this call, which may differ from the current state now
+		shader_stage rebound_stages = static_cast<shader_stage>(0);
+
+		for (uint32_t i = 0; i < state.descriptor_table_count; ++i)
+		{
+			const state_block::descriptor_table_binding &binding = state.descriptor_tables[i];
+
+			uint64_t tables_to_bind = binding.bound_tables;
+
+			if (is_bound_in_current_state(state_block::descriptor_tables_bit) && (binding.stages & rebound_stages) == 0)
+			{
+				// Only skip tables when the current state has no other binding for any of these stages, since that may have replaced tables or changed the layout for some of them
+				bool overlapping_binding = false;
+				for (uint32_t k = 0; k < current_state->descriptor_table_count; ++k)
+					if (current_state->descriptor_tables[k].stages != binding.stages && (current_state->descriptor_tables[k].stages & binding.stages) != 0)
+						overlapping_binding = true;
+
+				// Tables bound with a different layout are invalidated, so can only skip those that were bound with the same layout
+				if (const state_block::descriptor_table_binding *const current_binding = current_state->find_descriptor_tables(binding.stages);
+					current_binding != nullptr && current_binding->layout == binding.layout && !overlapping_binding)
+				{
+					const uint64_t bound_in_both = binding.bound_tables & current_binding->bound_tables;
+					for (uint32_t index = 0; index < state_block::max_descriptor_tables; ++index)
+						if ((bound_in_both & (1ull << index)) != 0 && current_binding->tables[index] == binding.tables[index])
+							tables_to_bind &= ~(1ull << index);
+				}
+			}
+
+			if (tables_to_bind == 0)
+				continue;
+
+			bind_descriptor_table_ranges(cmd_list, binding, tables_to_bind);
+			rebound_stages |= binding.stages;
+		}
+	}
+}
+
+void state_block::apply(command_list *cmd_list) const
+{
+	apply_state(cmd_list, *this, nullptr);
+}
+void state_block::apply(command_list *cmd_list, const state_block &current_state) const
+{
+	apply_state(cmd_list, *this, &current_state);
 }
 
 void state_block::clear()
 {
-	render_targets.clear();
+	// Only reset the counts, since entries beyond those are never read
+	bound_state = 0;
+	render_target_count = 0;
 	depth_stencil = { 0 };
-	pipelines.clear();
+	pipeline_count = 0;
 	primitive_topology = primitive_topology::undefined;
 	blend_constant = 0;
 	sample_mask = 0xFFFFFFFF;
 	front_stencil_reference_value = 0;
 	back_stencil_reference_value = 0;
-	viewports.clear();
-	scissor_rects.clear();
-	descriptor_tables.clear();
+	viewport_count = 0;
+	scissor_rect_count = 0;
+	descriptor_table_count = 0;
+}
+
+auto state_block::find_pipeline(pipeline_stage stages) const -> const pipeline_binding *
+{
+	for (uint32_t i = 0; i < pipeline_count; ++i)
+		if (pipelines[i].stages == stages)
+			return &pipelines[i];
+	return nullptr;
+}
+auto state_block::find_descriptor_tables(shader_stage stages) const -> const descriptor_table_binding *
+{
+	for (uint32_t i = 0; i < descriptor_table_count; ++i)
+		if (descriptor_tables[i].stages == stages)
+			return &descriptor_tables[i];
+	return nullptr;
 }
 
 static void on_init_command_list(command_list *cmd_list)
@@ -63,14 +203,31 @@ static void on_destroy_command_list(command_list *cmd_list)
 static void on_bind_render_targets_and_depth_stencil(command_list *cmd_list, uint32_t count, const resource_view *rtvs, resource_view dsv)
 {
 	auto &state = *cmd_list->get_private_data<state_tracking>();
-	state.render_targets.assign(rtvs, rtvs + count);
+
+	state.render_target_count = std::min(count, state_block::max_render_targets);
+	std::copy_n(rtvs, state.render_target_count, state.render_targets);
 	state.depth_stencil = dsv;
+	state.bound_state |= state_block::render_targets_bit;
 }
 
 static void on_bind_pipeline(command_list *cmd_list, pipeline_stage stages, pipeline pipeline)
 {
 	auto &state = *cmd_list->get_private_data<state_tracking>();
-	state.pipelines[stages] = pipeline;
+
+	// Remove bindings for which all stages are replaced by this one (including one for the exact same stages), and keep the rest in the order they were bound, so that applying them in order gives the same result for stages that were bound with different masks
+	state.pipeline_count = static_cast<uint32_t>(std::remove_if(state.pipelines, state.pipelines + state.pipeline_count,
+		[stages](const state_block::pipeline_binding &binding) { return (binding.stages & ~stages) == 0; }) - state.pipelines);
+
+	if (state.pipeline_count == state_block::max_pipeline_bindings)
+	{
+		static std::atomic<bool> s_overflow_logged = false;
+		if (!s_overflow_logged.exchange(true))
+			reshade::log::message(reshade::log::level::warning, "Too many pipelines bound with different pipeline stages in a command list, some of them will not be restored by state tracking.");
+		return; // Out of space, so this pipeline will not be restored
+	}
+
+	state.pipelines[state.pipeline_count++] = { stages, pipeline };
+	state.bound_state |= state_block::pipelines_bit;
 }
 
 static void on_bind_pipeline_states(command_list *cmd_list, uint32_t count, const dynamic_state *states, const uint32_t *values)
@@ -83,61 +240,124 @@ static void on_bind_pipeline_states(command_list *cmd_list, uint32_t count, cons
 		{
 		case dynamic_state::primitive_topology:
 			state.primitive_topology = static_cast<primitive_topology>(values[i]);
+			state.bound_state |= state_block::primitive_topology_bit;
 			break;
 		case dynamic_state::blend_constant:
 			state.blend_constant = values[i];
+			state.bound_state |= state_block::blend_constant_bit;
 			break;
 		case dynamic_state::sample_mask:
 			state.sample_mask = values[i];
+			state.bound_state |= state_block::sample_mask_bit;
 			break;
 		case dynamic_state::front_stencil_reference_value:
 			state.front_stencil_reference_value = values[i];
+			state.bound_state |= state_block::front_stencil_reference_value_bit;
 			break;
 		case dynamic_state::back_stencil_reference_value:
 			state.back_stencil_reference_value = values[i];
+			state.bound_state |= state_block::back_stencil_reference_value_bit;
 			break;
 		}
 	}
 }
 
+template <typename T, uint32_t capacity>
+static void update_array(T (&array)[capacity], uint32_t &array_count, uint32_t first, uint32_t count, const T *values)
+{
+	if (first >= capacity)
+		return;
+	count = std::min(count, capacity - first);
+
+	// Entries between the previous end and the first updated one were never bound, so reset them
+	if (first > array_count)
+		std::fill(array + array_count, array + first, T {});
+
+	std::copy_n(values, count, array + first);
+	array_count = std::max(array_count, first + count);
+}
+
 static void on_bind_viewports(command_list *cmd_list, uint32_t first, uint32_t count, const viewport *viewports)
 {
 	auto &state = *cmd_list->get_private_data<state_tracking>();
 
-	const uint32_t total_count = first + count;
-	if (state.viewports.size() < total_count)
-		state.viewports.resize(total_count);
-
-	for (uint32_t i = 0; i < count; ++i)
-		state.viewports[i + first] = viewports[i];
+	update_array(state.viewports, state.viewport_count, first, count, viewports);
+	state.bound_state |= state_block::viewports_bit;
 }
 
 static void on_bind_scissor_rects(command_list *cmd_list, uint32_t first, uint32_t count, const rect *rects)
 {
 	auto &state = *cmd_list->get_private_data<state_tracking>();
 
-	const uint32_t total_count = first + count;
-	if (state.scissor_rects.size() < total_count)
-		state.scissor_rects.resize(total_count);
-
-	for (uint32_t i = 0; i < count; ++i)
-		state.scissor_rects[i + first] = rects[i];
+	update_array(state.scissor_rects, state.scissor_rect_count, first, count, rects);
+	state.bound_state |= state_block::scissor_rects_bit;
 }
 
 static void on_bind_descriptor_tables(command_list *cmd_list, shader_stage stages, pipeline_layout layout, uint32_t first, uint32_t count, const descriptor_table *tables)
 {
-	auto &state = cmd_list->get_private_data<state_tracking>()->descriptor_tables[stages];
+	auto &state = *cmd_list->get_private_data<state_tracking>();
 
-	if (layout != state.first)
-		state.second.clear(); // Layout changed, which resets all descriptor table bindings
-	state.first = layout;
+	uint64_t updated_tables = 0;
+	for (uint32_t k = 0; k < count && first + k < state_block::max_descriptor_tables; ++k)
+		updated_tables |= 1ull << (first + k);
 
-	const uint32_t total_count = first + count;
-	if (state.second.size() < total_count)
-		state.second.resize(total_count);
+	// Tables of bindings for a subset of these stages are replaced by this one (or all of them are reset if the layout changed)
+	// Those bindings are kept even if they have no tables left, so that 'apply' with a current state knows that these stages were bound separately and does not assume tables of this binding are still bound for all of them
+	for (uint32_t i = 0; i < state.descriptor_table_count; ++i)
+	{
+		state_block::descriptor_table_binding &binding = state.descriptor_tables[i];
 
-	for (uint32_t i = 0; i < count; ++i)
-		state.second[i + first] = tables[i];
+		if (binding.stages != stages && (binding.stages & ~stages) == 0)
+			binding.bound_tables &= binding.layout == layout ? ~updated_tables : 0;
+	}
+
+	uint32_t i = 0;
+	while (i < state.descriptor_table_count && state.descriptor_tables[i].stages != stages)
+		++i;
+
+	if (i != state.descriptor_table_count)
+	{
+		// Move the binding behind later bindings that include more stages than it, so that it is applied after them and its tables take precedence for the shared stages
+		// Tables they bound after this binding bound the same index were already removed from this binding, so what is left is newer than theirs
+		// Later bindings for a subset of these stages stay behind it, since any of their tables that are older than one this binding bound were removed when it was bound
+		bool overlapped_by_later_binding = false;
+		for (uint32_t k = i + 1; k < state.descriptor_table_count; ++k)
+			if ((state.descriptor_tables[k].stages & stages) != 0 && (state.descriptor_tables[k].stages & ~stages) != 0)
+				overlapped_by_later_binding = true;
+
+		if (overlapped_by_later_binding)
+		{
+			std::rotate(state.descriptor_tables + i, state.descriptor_tables + i + 1, state.descriptor_tables + state.descriptor_table_count);
+			i = state.descriptor_table_count - 1;
+		}
+	}
+	else
+	{
+		if (i == state_block::max_descriptor_table_bindings)
+		{
+			static std::atomic<bool> s_overflow_logged = false;
+			if (!s_overflow_logged.exchange(true))
+				reshade::log::message(reshade::log::level::warning, "Too many descriptor tables bound with different shader stages in a command list, some of them will not be restored by state tracking.");
+			return; // Out of space, so these descriptor tables will not be restored
+		}
+		state.descriptor_table_count++;
+
+		state.descriptor_tables[i].stages = stages;
+		state.descriptor_tables[i].layout = { 0 };
+		state.descriptor_tables[i].bound_tables = 0;
+	}
+
+	state_block::descriptor_table_binding &binding = state.descriptor_tables[i];
+
+	if (layout != binding.layout)
+		binding.bound_tables = 0; // Layout changed, which resets all descriptor table bindings
+	binding.layout = layout;
+
+	for (uint32_t k = 0; k < count && first + k < state_block::max_descriptor_tables; ++k)
+		binding.tables[first + k] = tables[k];
+	binding.bound_tables |= updated_tables;
+
+	state.bound_state |= state_block::descriptor_tables_bit;
 }
 
 static void on_reset_command_list(command_list *cmd_list)
@@ -5,36 +5,103 @@
 
 #pragma once
 
-#include <vector>
-#include <unordered_map>
+#include <cstdint>
 
 /// <summary>
 /// A state block capturing current state of a command list.
+/// All state is stored inline with fixed capacity, so that state blocks can be copied and compared without any heap allocations.
 /// </summary>
 struct state_block
 {
+	static constexpr uint32_t max_render_targets = 8;
+	static constexpr uint32_t max_pipeline_bindings = 16;
+	static constexpr uint32_t max_viewports = 16;
+	static constexpr uint32_t max_descriptor_table_bindings = 8;
+	static constexpr uint32_t max_descriptor_tables = 64;
+
+	/// <summary>
+	/// Groups of state that can be bound. A group is only applied when its bit is set in <see cref="bound_state"/>.
+	/// </summary>
+	enum state_bits : uint32_t
+	{
+		render_targets_bit = 1 << 0,
+		pipelines_bit = 1 << 1,
+		primitive_topology_bit = 1 << 2,
+		blend_constant_bit = 1 << 3,
+		sample_mask_bit = 1 << 4,
+		front_stencil_reference_value_bit = 1 << 5,
+		back_stencil_reference_value_bit = 1 << 6,
+		viewports_bit = 1 << 7,
+		scissor_rects_bit = 1 << 8,
+		descriptor_tables_bit = 1 << 9,
+	};
+
+	/// <summary>
+	/// Pipelines are stored in the order they were bound. Bindings for stages that were all bound again later are removed.
+	/// </summary>
+	struct pipeline_binding
+	{
+		reshade::api::pipeline_stage stages;
+		reshade::api::pipeline pipeline;
+	};
+
+	struct descriptor_table_binding
+	{
+		reshade::api::shader_stage stages;
+		reshade::api::pipeline_layout layout;
+		/// <summary>
+		/// Bit mask of the entries in <see cref="tables"/> that were bound since the layout last changed.
+		/// </summary>
+		uint64_t bound_tables;
+		reshade::api::descriptor_table tables[max_descriptor_tables];
+	};
+
 	/// <summary>
 	/// Binds all state captured by this state block on the specified command list.
 	/// </summary>
 	/// <param name="cmd_list">Target command list to bind the state on.</param>
 	void apply(reshade::api::command_list *cmd_list) const;
+	/// <summary>
+	/// Binds the state captured by this state block that differs from the state that is currently bound on the specified command list.
+	/// </summary>
+	/// <param name="cmd_list">Target command list to bind the state on.</param>
+	/// <param name="current_state">State that is currently bound on the command list (e.g. the state an add-on bound itself after this state block was captured).</param>
+	void apply(reshade::api::command_list *cmd_list, const state_block &current_state) const;
 
 	/// <summary>
 	/// Removes all state in this state block.
 	/// </summary>
 	void clear();
 
-	std::vector<reshade::api::resource_view> render_targets;
+	/// <summary>
+	/// Finds the pipeline bound to exactly the specified pipeline stages.
+	/// </summary>
+	/// <returns>Pointer to the binding, or <see langword="nullptr"/> if no pipeline is bound to these stages.</returns>
+	const pipeline_binding *find_pipeline(reshade::api::pipeline_stage stages) const;
+	/// <summary>
+	/// Finds the descriptor tables bound to exactly the specified shader stages.
+	/// </summary>
+	/// <returns>Pointer to the binding, or <see langword="nullptr"/> if no descriptor tables are bound to these stages.</returns>
+	const descriptor_table_binding *find_descriptor_tables(reshade::api::shader_stage stages) const;
+
+	uint32_t bound_state = 0;
+
+	uint32_t render_target_count = 0;
+	reshade::api::resource_view render_targets[max_render_targets] = {};
 	reshade::api::resource_view depth_stencil = { 0 };
-	std::unordered_map<reshade::api::pipeline_stage, reshade::api::pipeline> pipelines;
+	uint32_t pipeline_count = 0;
+	pipeline_binding pipelines[max_pipeline_bindings] = {};
 	reshade::api::primitive_topology primitive_topology = reshade::api::primitive_topology::undefined;
 	uint32_t blend_constant = 0;
 	uint32_t sample_mask = 0xFFFFFFFF;
 	uint32_t front_stencil_reference_value = 0;
 	uint32_t back_stencil_reference_value = 0;
-	std::vector<reshade::api::viewport> viewports;
-	std::vector<reshade::api::rect> scissor_rects;
-	std::unordered_map<reshade::api::shader_stage, std::pair<reshade::api::pipeline_layout, std::vector<reshade::api::descriptor_table>>> descriptor_tables;
+	uint32_t viewport_count = 0;
+	reshade::api::viewport viewports[max_viewports] = {};
+	uint32_t scissor_rect_count = 0;
+	reshade::api::rect scissor_rects[max_viewports] = {};
+	uint32_t descriptor_table_count = 0;
+	descriptor_table_binding descriptor_tables[max_descriptor_table_bindings] = {};
 };
 
 /// <summary>
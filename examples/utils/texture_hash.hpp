@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2024 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#pragma once
+
+#include "config.hpp"
+#include "crc32_hash.hpp"
+#if RESHADE_ADDON_TEXTURE_HASH_ALGORITHM == 2
+#include "xxh3_hash.hpp"
+#endif
+
+/// <summary>
+/// Computes the hash used to identify texture data in file names, using the algorithm selected with <c>RESHADE_ADDON_TEXTURE_HASH_ALGORITHM</c>.
+/// </summary>
+inline uint32_t compute_texture_hash(const uint8_t *data, size_t size)
+{
+#if RESHADE_ADDON_TEXTURE_HASH_ALGORITHM == 0
+	return compute_crc32(data, size);
+#elif RESHADE_ADDON_TEXTURE_HASH_ALGORITHM == 1
+	return compute_crc32c(data, size);
+#elif RESHADE_ADDON_TEXTURE_HASH_ALGORITHM == 2
+	// Fold to 32 bits, so that file names keep their length
+	const uint64_t hash = compute_xxh3_64(data, size);
+	return static_cast<uint32_t>(hash ^ (hash >> 32));
+#else
+	#error "Unknown texture hash algorithm"
+#endif
+}
@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2012-2021 Yann Collet
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring> // std::memcpy
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+
+// Compact implementation of the 64-bit variant of XXH3 (https://github.com/Cyan4973/xxHash), using the default secret and a seed of zero.
+// Produces the same results as 'XXH3_64bits' from the reference implementation.
+
+namespace xxh3
+{
+	constexpr uint32_t prime32_1 = 0x9E3779B1U;
+	constexpr uint32_t prime32_2 = 0x85EBCA77U;
+	constexpr uint32_t prime32_3 = 0xC2B2AE3DU;
+	constexpr uint64_t prime64_1 = 0x9E3779B185EBCA87ULL;
+	constexpr uint64_t prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+	constexpr uint64_t prime64_3 = 0x165667B19E3779F9ULL;
+	constexpr uint64_t prime64_4 = 0x85EBCA77C2B2AE63ULL;
+	constexpr uint64_t prime64_5 = 0x27D4EB2F165667C5ULL;
+	constexpr uint64_t prime_mx1 = 0x165667919E3779F9ULL;
+	constexpr uint64_t prime_mx2 = 0x9FB21C651E98DF25ULL;
+
+	constexpr size_t stripe_len = 64;
+	constexpr size_t secret_consume_rate = 8;
+	constexpr size_t secret_size = 192;
+	constexpr size_t secret_size_min = 136;
+
+	alignas(64) constexpr uint8_t default_secret[secret_size] = {
+		0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+		0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+		0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+		0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+		0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+		0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+		0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+		0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+		0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+		0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+		0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+		0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+	};
+
+	// All loads assume little-endian byte order
+	inline uint32_t read32(const uint8_t *p)
+	{
+		uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+	inline uint64_t read64(const uint8_t *p)
+	{
+		uint64_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline uint64_t rotl64(uint64_t value, int amount)
+	{
+		return (value << amount) | (value >> (64 - amount));
+	}
+	inline uint64_t swap64(uint64_t value)
+	{
+		return
+			((value << 56) & 0xFF00000000000000ULL) | ((value << 40) & 0x00FF000000000000ULL) |
+			((value << 24) & 0x0000FF0000000000ULL) | ((value <<  8) & 0x000000FF00000000ULL) |
+			((value >>  8) & 0x00000000FF000000ULL) | ((value >> 24) & 0x0000000000FF0000ULL) |
+			((value >> 40) & 0x000000000000FF00ULL) | ((value >> 56) & 0x00000000000000FFULL);
+	}
+
+	/// <summary>
+	/// Computes the full 128-bit product of two 64-bit values and folds it back into 64 bits by xor-ing the halves.
+	/// </summary>
+	inline uint64_t mul128_fold64(uint64_t lhs, uint64_t rhs)
+	{
+#if defined(_M_X64)
+		uint64_t product_hi;
+		const uint64_t product_lo = _umul128(lhs, rhs, &product_hi);
+		return product_lo ^ product_hi;
+#elif defined(__SIZEOF_INT128__)
+		const unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+		return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+		const uint64_t lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+		const uint64_t hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+		const uint64_t lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+		const uint64_t hi_hi = (lhs >> 32) * (rhs >> 32);
+		const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+		const uint64_t product_hi = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+		const uint64_t product_lo = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+		return product_lo ^ product_hi;
+#endif
+	}
+
+	inline uint64_t xxh64_avalanche(uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= prime64_2;
+		h ^= h >> 29;
+		h *= prime64_3;
+		h ^= h >> 32;
+		return h;
+	}
+	inline uint64_t avalanche(uint64_t h)
+	{
+		h ^= h >> 37;
+		h *= prime_mx1;
+		h ^= h >> 32;
+		return h;
+	}
+	inline uint64_t rrmxmx(uint64_t h, uint64_t len)
+	{
+		h ^= rotl64(h, 49) ^ rotl64(h, 24);
+		h *= prime_mx2;
+		h ^= (h >> 35) + len;
+		h *= prime_mx2;
+		h ^= h >> 28;
+		return h;
+	}
+
+	inline uint64_t mix16(const uint8_t *input, const uint8_t *secret)
+	{
+		return mul128_fold64(read64(input) ^ read64(secret), read64(input + 8) ^ read64(secret + 8));
+	}
+
+	inline uint64_t hash_0to16(const uint8_t *input, size_t len)
+	{
+		const uint8_t *const secret = default_secret;
+
+		if (len > 8)
+		{
+			const uint64_t input_lo = read64(input) ^ (read64(secret + 24) ^ read64(secret + 32));
+			const uint64_t input_hi = read64(input + len - 8) ^ (read64(secret + 40) ^ read64(secret + 48));
+			return avalanche(len + swap64(input_lo) + input_hi + mul128_fold64(input_lo, input_hi));
+		}
+		if (len >= 4)
+		{
+			const uint64_t input64 = read32(input + len - 4) + (static_cast<uint64_t>(read32(input)) << 32);
+			return rrmxmx(input64 ^ (read64(secret + 8) ^ read64(secret + 16)), len);
+		}
+		if (len != 0)
+		{
+			const uint32_t combined =
+				(static_cast<uint32_t>(input[0]) << 16) | (static_cast<uint32_t>(input[len >> 1]) << 24) | input[len - 1] | (static_cast<uint32_t>(len) << 8);
+			return xxh64_avalanche(combined ^ static_cast<uint64_t>(read32(secret) ^ read32(secret + 4)));
+		}
+
+		return xxh64_avalanche(read64(secret + 56) ^ read64(secret + 64));
+	}
+
+	inline uint64_t hash_17to128(const uint8_t *input, size_t len)
+	{
+		const uint8_t *const secret = default_secret;
+
+		uint64_t acc = len * prime64_1;
+		if (len > 32)
+		{
+			if (len > 64)
+			{
+				if (len > 96)
+				{
+					acc += mix16(input + 48, secret + 96);
+					acc += mix16(input + len - 64, secret + 112);
+				}
+				acc += mix16(input + 32, secret + 64);
+				acc += mix16(input + len - 48, secret + 80);
+			}
+			acc += mix16(input + 16, secret + 32);
+			acc += mix16(input + len - 32, secret + 48);
+		}
+		acc += mix16(input + 0, secret + 0);
+		acc += mix16(input + len - 16, secret + 16);
+		return avalanche(acc);
+	}
+
+	inline uint64_t hash_129to240(const uint8_t *input, size_t len)
+	{
+		const uint8_t *const secret = default_secret;
+
+		uint64_t acc = len * prime64_1;
+		for (size_t i = 0; i < 8; ++i)
+			acc += mix16(input + 16 * i, secret + 16 * i);
+		acc = avalanche(acc);
+
+		uint64_t acc_end = mix16(input + len - 16, secret + secret_size_min - 17);
+		for (size_t i = 8; i < len / 16; ++i)
+			acc_end += mix16(input + 16 * i, secret + 16 * (i - 8) + 3);
+		return avalanche(acc + acc_end);
+	}
+
+	/// <summary>
+	/// Mixes one 64-byte stripe of input into the eight accumulator lanes.
+	/// </summary>
+	inline void accumulate_512(uint64_t acc[8], const uint8_t *input, const uint8_t *secret)
+	{
+#if defined(_M_X64) || defined(__x86_64__)
+		// SSE2 is always available on x64, so process two lanes per instruction
+		__m128i *const xacc = reinterpret_cast<__m128i *>(acc);
+		for (size_t i = 0; i < 4; ++i)
+		{
+			const __m128i data_vec = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input) + i);
+			const __m128i key_vec = _mm_loadu_si128(reinterpret_cast<const __m128i *>(secret) + i);
+			const __m128i data_key = _mm_xor_si128(data_vec, key_vec);
+			const __m128i data_key_lo = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+			const __m128i product = _mm_mul_epu32(data_key, data_key_lo);
+			const __m128i data_swap = _mm_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+			xacc[i] = _mm_add_epi64(product, _mm_add_epi64(xacc[i], data_swap));
+		}
+#else
+		for (size_t i = 0; i < 8; ++i)
+		{
+			const uint64_t data_val = read64(input + i * 8);
+			const uint64_t data_key = data_val ^ read64(secret + i * 8);
+			acc[i ^ 1] += data_val; // Swap adjacent lanes
+			acc[i] += (data_key & 0xFFFFFFFF) * (data_key >> 32);
+		}
+#endif
+	}
+
+	inline void scramble(uint64_t acc[8], const uint8_t *secret)
+	{
+#if defined(_M_X64) || defined(__x86_64__)
+		__m128i *const xacc = reinterpret_cast<__m128i *>(acc);
+		const __m128i prime32 = _mm_set1_epi32(static_cast<int>(prime32_1));
+		for (size_t i = 0; i < 4; ++i)
+		{
+			const __m128i acc_vec = xacc[i];
+			const __m128i data_vec = _mm_xor_si128(acc_vec, _mm_srli_epi64(acc_vec, 47));
+			const __m128i key_vec = _mm_loadu_si128(reinterpret_cast<const __m128i *>(secret) + i);
+			const __m128i data_key = _mm_xor_si128(data_vec, key_vec);
+			const __m128i data_key_hi = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+			const __m128i product_lo = _mm_mul_epu32(data_key, prime32);
+			const __m128i product_hi = _mm_mul_epu32(data_key_hi, prime32);
+			xacc[i] = _mm_add_epi64(product_lo, _mm_slli_epi64(product_hi, 32));
+		}
+#else
+		for (size_t i = 0; i < 8; ++i)
+		{
+			uint64_t acc64 = acc[i];
+			acc64 ^= acc64 >> 47;
+			acc64 ^= read64(secret + i * 8);
+			acc64 *= prime32_1;
+			acc[i] = acc64;
+		}
+#endif
+	}
+
+	inline uint64_t hash_long(const uint8_t *input, size_t len)
+	{
+		const uint8_t *const secret = default_secret;
+
+		alignas(16) uint64_t acc[8] = { prime32_3, prime64_1, prime64_2, prime64_3, prime64_4, prime32_2, prime64_5, prime32_1 };
+
+		constexpr size_t stripes_per_block = (secret_size - stripe_len) / secret_consume_rate;
+		constexpr size_t block_len = stripe_len * stripes_per_block;
+		const size_t num_blocks = (len - 1) / block_len;
+
+		for (size_t n = 0; n < num_blocks; ++n)
+		{
+			for (size_t s = 0; s < stripes_per_block; ++s)
+				accumulate_512(acc, input + n * block_len + s * stripe_len, secret + s * secret_consume_rate);
+			scramble(acc, secret + secret_size - stripe_len);
+		}
+
+		const size_t num_stripes = ((len - 1) - (block_len * num_blocks)) / stripe_len;
+		for (size_t s = 0; s < num_stripes; ++s)
+			accumulate_512(acc, input + num_blocks * block_len + s * stripe_len, secret + s * secret_consume_rate);
+
+		// Last stripe always covers the final 64 bytes of input (overlapping the previous stripe if necessary)
+		accumulate_512(acc, input + len - stripe_len, secret + secret_size - stripe_len - 7);
+
+		uint64_t result = len * prime64_1;
+		for (size_t i = 0; i < 4; ++i)
+			result += mul128_fold64(acc[2 * i] ^ read64(secret + 11 + 16 * i), acc[2 * i + 1] ^ read64(secret + 11 + 16 * i + 8));
+		return avalanche(result);
+	}
+}
+
+/// <summary>
+/// Computes the 64-bit XXH3 hash of the specified data.
+/// </summary>
+inline uint64_t compute_xxh3_64(const uint8_t *data, size_t size)
+{
+	if (size <= 16)
+		return xxh3::hash_0to16(data, size);
+	if (size <= 128)
+		return xxh3::hash_17to128(data, size);
+	if (size <= 240)
+		return xxh3::hash_129to240(data, size);
+	return xxh3::hash_long(data, size);
+}
@@ -505,6 +505,7 @@ namespace reshade { namespace api
 
 		/// <summary>
 		/// Gets the shader resource view that is bound to the specified texture <paramref name="variable"/>.
+		/// Render targets whose contents are completely overwritten by every technique using them may share memory with render targets of other effects, so their contents are only meaningful while a technique of their effect is rendering.
 		/// </summary>
 		/// <param name="variable">Opaque handle to the texture variable.</param>
 		/// <param name="out_srv">Pointer to a variable that is set to the shader resource view.</param>
@@ -842,5 +843,17 @@ namespace reshade { namespace api
 		/// </summary>
 		/// <param name="postfix">Optional string to append to the screenshot filename, or <see langword="nullptr"/> for no postfix.</param>
 		virtual void save_screenshot(const char *postfix = nullptr) = 0;
+
+		/// <summary>
+		/// Captures a screenshot of the current back buffer resource without waiting for the GPU and returns its image data through a callback a few frames later.
+		/// </summary>
+		/// <remarks>
+		/// The callback is invoked on a worker thread, with the image data in the same layout as returned by <see cref="capture_screenshot"/>.
+		/// The image data is only valid for the duration of the callback.
+		/// </remarks>
+		/// <param name="callback">Function to call with the image data once it is available.</param>
+		/// <param name="user_data">Pointer passed on to the callback.</param>
+		/// <returns><see langword="true"/> if the capture was queued, <see langword="false"/> if it failed or too many captures are already in flight (in which case the callback is not invoked).</returns>
+		virtual bool capture_screenshot_async(void(*callback)(effect_runtime *runtime, const void *pixels, uint32_t width, uint32_t height, void *user_data), void *user_data) = 0;
 	};
 } }
@@ -666,6 +666,38 @@ namespace reshade { namespace api
 		dispatch_rays
 	};
 
+	/// <summary>
+	/// Describes a draw call that was recorded into a command list, together with the state it was recorded with.
+	/// </summary>
+	/// <seealso cref="addon_event::draw_batch"/>
+	struct draw_record
+	{
+		/// <summary>
+		/// Type of the draw call (either <see cref="indirect_command::draw"/> or <see cref="indirect_command::draw_indexed"/>, or <see cref="indirect_command::unknown"/> for indirect draw calls where the type is not known).
+		/// </summary>
+		indirect_command type = indirect_command::unknown;
+		/// <summary>
+		/// Number of vertices (or indices for indexed draw calls) that were drawn, or zero for indirect draw calls.
+		/// </summary>
+		uint32_t vertex_count = 0;
+		/// <summary>
+		/// Number of instances that were drawn, or zero for indirect draw calls.
+		/// </summary>
+		uint32_t instance_count = 0;
+		/// <summary>
+		/// Number of draws issued by an indirect draw call, or zero for direct draw calls.
+		/// </summary>
+		uint32_t indirect_draw_count = 0;
+		/// <summary>
+		/// Depth-stencil view that was bound when the draw call was recorded.
+		/// </summary>
+		resource_view dsv = { 0 };
+		/// <summary>
+		/// First viewport that was set when the draw call was recorded.
+		/// </summary>
+		viewport viewport;
+	};
+
 	/// <summary>
 	/// A command list, used to enqueue render commands on the CPU, before later executing them in a command queue.
 	/// <para>Functionally equivalent to a 'ID3D11CommandList', 'ID3D12CommandList' or 'VkCommandBuffer'.</para>
@@ -1787,8 +1787,20 @@ namespace reshade
 		/// </remarks>
 		reshade_overlay_technique,
 
+		/// <summary>
+		/// Called with all draw calls that were recorded into a command list since the last time this event was called for it, when the command list is closed or, for immediate command lists, executed.
+		/// This is an alternative to the <see cref="draw"/>, <see cref="draw_indexed"/> and <see cref="draw_or_dispatch_indirect"/> events for add-ons that only need to observe draw calls, without being called for every single one of them.
+		/// Draw calls are only collected while at least one callback is registered for this event.
+		/// <para>Callback function signature: <c>void (api::command_list *cmd_list, uint32_t count, const api::draw_record *records)</c></para>
+		/// </summary>
+		/// <remarks>
+		/// The records are only valid during the callback.
+		/// Draw calls are recorded before any callbacks for the <see cref="draw"/>, <see cref="draw_indexed"/> and <see cref="draw_or_dispatch_indirect"/> events are invoked, so they include draw calls that are skipped by those.
+		/// </remarks>
+		draw_batch = 101,
+
 #if RESHADE_ADDON
-		max = 101 // Last value used internally by ReShade to determine number of events in this enum
+		max = 102 // Last value used internally by ReShade to determine number of events in this enum
 #endif
 	};
 
@@ -1936,4 +1948,6 @@ namespace reshade
 
 	RESHADE_DEFINE_ADDON_EVENT_TRAITS(addon_event::reshade_overlay_uniform_variable, bool, api::effect_runtime *runtime, api::effect_uniform_variable variable);
 	RESHADE_DEFINE_ADDON_EVENT_TRAITS(addon_event::reshade_overlay_technique, bool, api::effect_runtime *runtime, api::effect_technique technique);
+
+	RESHADE_DEFINE_ADDON_EVENT_TRAITS(addon_event::draw_batch, void, api::command_list *cmd_list, uint32_t count, const api::draw_record *records);
 }
@@ -9,7 +9,11 @@
 #include "addon_manager.hpp"
 #include "dll_log.hpp"
 #include "ini_file.hpp"
-#include <algorithm> // std::find, std::find_if, std::remove, std::remove_if
+#include <mutex>
+#include <atomic>
+#include <memory> // std::make_unique, std::unique_ptr
+#include <limits>
+#include <algorithm> // std::find, std::find_if, std::max, std::remove, std::remove_if
 
 extern void register_addon_depth();
 extern void register_addon_effect_runtime_sync();
@@ -20,10 +24,8 @@ extern HMODULE g_module_handle;
 
 extern std::filesystem::path get_module_path(HMODULE module);
 
-#if RESHADE_VERBOSE_LOG
-static const char *addon_event_to_string(reshade::addon_event ev)
+const char *reshade::addon_event_to_string(addon_event ev)
 {
-	using reshade::addon_event;
 	switch (ev)
 	{
 	case addon_event::init_device: return "init_device";
@@ -126,19 +128,276 @@ static const char *addon_event_to_string(reshade::addon_event ev)
 	case addon_event::reshade_open_overlay: return "reshade_open_overlay";
 	case addon_event::reshade_overlay_uniform_variable: return "reshade_overlay_uniform_variable";
 	case addon_event::reshade_overlay_technique: return "reshade_overlay_technique";
+	case addon_event::draw_batch: return "draw_batch";
 	}
 	return "unknown";
 }
-#endif
 
 #if RESHADE_ADDON == 1
 bool reshade::addon_enabled = true;
 #endif
 bool reshade::addon_all_loaded = true;
-std::vector<void *> reshade::addon_event_list[static_cast<uint32_t>(reshade::addon_event::max)];
+std::atomic<const reshade::addon_event_callback_list *> reshade::addon_event_list[static_cast<uint32_t>(reshade::addon_event::max)];
 std::vector<reshade::addon_info> reshade::addon_loaded_info;
 static unsigned long s_reference_count = 0;
 
+std::atomic<uint64_t> reshade::addon_event_epoch = 1;
+
+// Serializes modifications of the add-on event callback lists (readers do not lock)
+static std::mutex s_event_list_mutex;
+
+struct retired_event_list
+{
+	std::unique_ptr<const reshade::addon_event_callback_list> list;
+	// Epoch that was current when the list was replaced, threads that announced a later epoch cannot see it anymore
+	uint64_t epoch;
+};
+
+// Callback lists that were replaced by a newer version, but may still be iterated by other threads (these are deleted in 'reclaim_retired_event_lists' once no thread can still be iterating them)
+static std::vector<retired_event_list> s_retired_event_lists;
+
+static std::mutex s_event_reader_mutex;
+// Epoch records of all threads that invoked an add-on event with callbacks, which are reused once the thread that owned them ended
+static std::vector<std::unique_ptr<reshade::addon_event_reader>> s_event_readers;
+
+reshade::addon_event_reader &reshade::get_addon_event_reader()
+{
+	struct thread_reader
+	{
+		addon_event_reader *reader = nullptr;
+
+		~thread_reader()
+		{
+			if (reader == nullptr)
+				return;
+
+			const std::unique_lock<std::mutex> lock(s_event_reader_mutex);
+			reader->in_use = false;
+		}
+	};
+
+	static thread_local thread_reader t_reader;
+
+	if (t_reader.reader == nullptr)
+	{
+		const std::unique_lock<std::mutex> lock(s_event_reader_mutex);
+
+		const auto it = std::find_if(s_event_readers.begin(), s_event_readers.end(),
+			[](const std::unique_ptr<addon_event_reader> &reader) { return !reader->in_use; });
+		t_reader.reader = it != s_event_readers.end() ? it->get() : s_event_readers.emplace_back(std::make_unique<addon_event_reader>()).get();
+		t_reader.reader->in_use = true;
+	}
+
+	return *t_reader.reader;
+}
+
+static void reclaim_retired_event_lists()
+{
+	if (s_retired_event_lists.empty())
+		return;
+
+	// Start a new epoch, so that threads that begin iterating after this cannot see any of the lists retired so far
+	reshade::addon_event_epoch.fetch_add(1, std::memory_order_seq_cst);
+
+	uint64_t oldest_epoch = std::numeric_limits<uint64_t>::max();
+	{
+		const std::unique_lock<std::mutex> lock(s_event_reader_mutex);
+
+		for (const std::unique_ptr<reshade::addon_event_reader> &reader : s_event_readers)
+			if (const uint64_t epoch = reader->epoch.load(std::memory_order_seq_cst); epoch != 0 && epoch < oldest_epoch)
+				oldest_epoch = epoch;
+	}
+
+	// A thread that is still iterating may only see lists that were retired in or after the epoch it announced
+	s_retired_event_lists.erase(
+		std::remove_if(s_retired_event_lists.begin(), s_retired_event_lists.end(),
+			[oldest_epoch](const retired_event_list &retired) { return retired.epoch < oldest_epoch; }),
+		s_retired_event_lists.end());
+}
+
+void reshade::reclaim_addon_event_lists()
+{
+	// Do not wait while callbacks are being registered, this is tried again on the next present anyway
+	const std::unique_lock<std::mutex> lock(s_event_list_mutex, std::try_to_lock);
+	if (!lock.owns_lock())
+		return;
+
+	reclaim_retired_event_lists();
+}
+
+template <typename F>
+static void update_event_list(reshade::addon_event ev, F &&modify)
+{
+	std::atomic<const reshade::addon_event_callback_list *> &event_list = reshade::addon_event_list[static_cast<uint32_t>(ev)];
+
+	const reshade::addon_event_callback_list *const old_list = event_list.load(std::memory_order_relaxed);
+
+	// Never modify the published list in place, but instead modify a copy and then replace the published list with that
+	std::unique_ptr<reshade::addon_event_callback_list> new_list = old_list != nullptr ?
+		std::make_unique<reshade::addon_event_callback_list>(*old_list) :
+		std::make_unique<reshade::addon_event_callback_list>();
+	modify(*new_list);
+
+	// Sequentially consistent, so that the replacement is ordered before the epoch records are read in 'reclaim_retired_event_lists'
+	if (new_list->callbacks.empty())
+		event_list.store(nullptr, std::memory_order_seq_cst);
+	else
+		event_list.store(new_list.release(), std::memory_order_seq_cst);
+
+	if (old_list != nullptr)
+		s_retired_event_lists.push_back({ std::unique_ptr<const reshade::addon_event_callback_list>(old_list), reshade::addon_event_epoch.load(std::memory_order_seq_cst) });
+
+	reclaim_retired_event_lists();
+}
+
+struct __declspec(uuid("5A7D8F4E-3C21-4B6E-9F0A-8D2C61E4B937")) draw_batch_data
+{
+	reshade::api::resource_view current_dsv = { 0 };
+	reshade::api::viewport current_viewport = {};
+	std::vector<reshade::api::draw_record> records;
+};
+
+static draw_batch_data &get_draw_batch_data(reshade::api::command_list *cmd_list)
+{
+	draw_batch_data *data = cmd_list->get_private_data<draw_batch_data>();
+	if (data == nullptr)
+		data = cmd_list->create_private_data<draw_batch_data>();
+	return *data;
+}
+
+void reshade::record_draw_batch_draw(api::command_list *cmd_list, api::indirect_command type, uint32_t vertex_count, uint32_t instance_count, uint32_t indirect_draw_count)
+{
+	draw_batch_data &data = get_draw_batch_data(cmd_list);
+
+	api::draw_record &record = data.records.emplace_back();
+	record.type = type;
+	record.vertex_count = vertex_count;
+	record.instance_count = instance_count;
+	record.indirect_draw_count = indirect_draw_count;
+	record.dsv = data.current_dsv;
+	record.viewport = data.current_viewport;
+}
+void reshade::record_draw_batch_depth_stencil(api::command_list *cmd_list, api::resource_view dsv)
+{
+	get_draw_batch_data(cmd_list).current_dsv = dsv;
+}
+void reshade::record_draw_batch_viewport(api::command_list *cmd_list, const api::viewport &viewport)
+{
+	get_draw_batch_data(cmd_list).current_viewport = viewport;
+}
+void reshade::flush_draw_batch(api::command_list *cmd_list, bool discard)
+{
+	draw_batch_data *const data = cmd_list->get_private_data<draw_batch_data>();
+	if (data == nullptr || data->records.empty())
+		return;
+
+	if (!discard)
+		invoke_addon_event<addon_event::draw_batch>(cmd_list, static_cast<uint32_t>(data->records.size()), data->records.data());
+
+	// Keep the allocated memory around for the next batch
+	data->records.clear();
+}
+void reshade::destroy_draw_batch(api::command_list *cmd_list)
+{
+	if (cmd_list->get_private_data<draw_batch_data>() != nullptr)
+		cmd_list->destroy_private_data<draw_batch_data>();
+}
+
+std::atomic<bool> reshade::addon_event_profiling = false;
+
+static constexpr uint32_t s_max_event_cost_slots = 1024;
+
+struct thread_event_costs
+{
+	// Only the owning thread writes to these, other threads only read them, so they do not need atomic read-modify-write operations
+	std::atomic<uint64_t> count[s_max_event_cost_slots];
+	std::atomic<uint64_t> total_ticks[s_max_event_cost_slots];
+	std::atomic<uint64_t> max_ticks[s_max_event_cost_slots];
+};
+
+static std::mutex s_event_cost_mutex;
+// Add-on name and event each slot belongs to
+static std::vector<std::pair<std::string, reshade::addon_event>> s_event_cost_slot_owners;
+// Accumulators of all threads that ever invoked an add-on event while profiling was enabled (these are kept alive until the process exits, since threads do not notify when they end)
+static std::vector<std::unique_ptr<thread_event_costs>> s_thread_event_costs;
+static thread_local thread_event_costs *t_event_costs = nullptr;
+// Reference points to convert time stamp counter ticks to nanoseconds
+static uint64_t s_event_cost_reference_ticks = 0;
+static LARGE_INTEGER s_event_cost_reference_time = {};
+
+static uint32_t find_or_add_event_cost_slot(const std::string &addon_name, reshade::addon_event ev)
+{
+	const std::unique_lock<std::mutex> lock(s_event_cost_mutex);
+
+	const auto it = std::find(s_event_cost_slot_owners.cbegin(), s_event_cost_slot_owners.cend(), std::make_pair(addon_name, ev));
+	if (it != s_event_cost_slot_owners.cend())
+		return static_cast<uint32_t>(it - s_event_cost_slot_owners.cbegin());
+
+	if (s_event_cost_slot_owners.size() >= s_max_event_cost_slots)
+		return std::numeric_limits<uint32_t>::max();
+
+	s_event_cost_slot_owners.emplace_back(addon_name, ev);
+	return static_cast<uint32_t>(s_event_cost_slot_owners.size() - 1);
+}
+
+void reshade::record_addon_event_cost(uint32_t slot, uint64_t ticks)
+{
+	if (slot >= s_max_event_cost_slots)
+		return;
+
+	thread_event_costs *costs = t_event_costs;
+	if (costs == nullptr)
+	{
+		const std::unique_lock<std::mutex> lock(s_event_cost_mutex);
+
+		costs = t_event_costs = s_thread_event_costs.emplace_back(std::make_unique<thread_event_costs>()).get();
+	}
+
+	costs->count[slot].store(costs->count[slot].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	costs->total_ticks[slot].store(costs->total_ticks[slot].load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+	if (ticks > costs->max_ticks[slot].load(std::memory_order_relaxed))
+		costs->max_ticks[slot].store(ticks, std::memory_order_relaxed);
+}
+
+std::vector<reshade::addon_event_cost> reshade::get_addon_event_costs()
+{
+	LARGE_INTEGER frequency, current_time;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&current_time);
+	const uint64_t current_ticks = __rdtsc();
+
+	// Calibrate the time stamp counter against the performance counter over the time since add-ons were loaded
+	const double elapsed_ns = (current_time.QuadPart - s_event_cost_reference_time.QuadPart) * 1000000000.0 / frequency.QuadPart;
+	const double ns_per_tick = (current_ticks > s_event_cost_reference_ticks && elapsed_ns > 0.0) ? elapsed_ns / (current_ticks - s_event_cost_reference_ticks) : 1.0;
+
+	const std::unique_lock<std::mutex> lock(s_event_cost_mutex);
+
+	std::vector<addon_event_cost> result;
+
+	for (uint32_t slot = 0; slot < s_event_cost_slot_owners.size(); ++slot)
+	{
+		uint64_t count = 0, total_ticks = 0, max_ticks = 0;
+		for (const std::unique_ptr<thread_event_costs> &costs : s_thread_event_costs)
+		{
+			count += costs->count[slot].load(std::memory_order_relaxed);
+			total_ticks += costs->total_ticks[slot].load(std::memory_order_relaxed);
+			max_ticks = std::max(max_ticks, costs->max_ticks[slot].load(std::memory_order_relaxed));
+		}
+
+		if (count == 0)
+			continue;
+
+		result.push_back({
+			s_event_cost_slot_owners[slot].first,
+			s_event_cost_slot_owners[slot].second,
+			count,
+			static_cast<uint64_t>(total_ticks * ns_per_tick),
+			static_cast<uint64_t>(max_ticks * ns_per_tick) });
+	}
+
+	return result;
+}
+
 void reshade::load_addons()
 {
 	// Only load add-ons the first time a reference is added
@@ -149,6 +408,13 @@ void reshade::load_addons()
 
 	addon_all_loaded = true;
 
+	bool profile_event_callbacks = false;
+	config.get("ADDON", "ProfileEventCallbacks", profile_event_callbacks);
+	addon_event_profiling.store(profile_event_callbacks, std::memory_order_relaxed);
+
+	QueryPerformanceCounter(&s_event_cost_reference_time);
+	s_event_cost_reference_ticks = __rdtsc();
+
 	std::vector<std::string> disabled_addons;
 	config.get("ADDON", "DisabledAddons", disabled_addons);
 
@@ -326,6 +592,15 @@ void reshade::unload_addons()
 	if (InterlockedDecrement(&s_reference_count) != 0)
 		return;
 
+	if (const std::vector<addon_event_cost> event_costs = get_addon_event_costs();
+		!event_costs.empty())
+	{
+		log::message(log::level::info, "Time spent in add-on event callbacks:");
+
+		for (const addon_event_cost &cost : event_costs)
+			log::message(log::level::info, "> %s (%s): %llu calls, %.3f ms total, %.3f us average, %.3f us max", cost.addon_name.c_str(), addon_event_to_string(cost.ev), cost.count, cost.total_ns / 1000000.0, cost.total_ns / 1000.0 / cost.count, cost.max_ns / 1000.0);
+	}
+
 #if RESHADE_ADDON == 1
 	// There are no add-ons to unload ...
 #else
@@ -379,6 +654,10 @@ void reshade::unload_addons()
 				return !info.external;
 			}),
 		addon_loaded_info.end());
+
+	// No more events are invoked at this point, so nothing can still be iterating replaced callback lists
+	const std::unique_lock<std::mutex> lock(s_event_list_mutex);
+	s_retired_event_lists.clear();
 }
 
 bool reshade::has_loaded_addons()
@@ -558,20 +837,26 @@ void ReShadeRegisterEventForAddon(HMODULE module, reshade::addon_event ev, void
 
 #if RESHADE_ADDON == 1
 	// Block all application events when building without add-on loading support
-	if (info->handle != g_module_handle && (ev > reshade::addon_event::destroy_effect_runtime && ev < reshade::addon_event::present))
+	if (info->handle != g_module_handle && ((ev > reshade::addon_event::destroy_effect_runtime && ev < reshade::addon_event::present) || ev == reshade::addon_event::draw_batch))
 	{
 		reshade::log::message(reshade::log::level::error, "Failed to register an event because only limited add-on functionality is available!");
 		return;
 	}
 #endif
 
-	std::vector<void *> &event_list = reshade::addon_event_list[static_cast<uint32_t>(ev)];
-	event_list.push_back(callback);
+	const uint32_t cost_slot = find_or_add_event_cost_slot(info->name, ev);
+
+	const std::unique_lock<std::mutex> lock(s_event_list_mutex);
+
+	update_event_list(ev, [callback, cost_slot](reshade::addon_event_callback_list &event_list) {
+		event_list.callbacks.push_back(callback);
+		event_list.cost_slots.push_back(cost_slot);
+	});
 
 	info->event_callbacks.emplace_back(static_cast<uint32_t>(ev), callback);
 
 #if RESHADE_VERBOSE_LOG
-	reshade::log::message(reshade::log::level::debug, "Registered event callback %p for event %s.", callback, addon_event_to_string(ev));
+	reshade::log::message(reshade::log::level::debug, "Registered event callback %p for event %s.", callback, reshade::addon_event_to_string(ev));
 #endif
 }
 void ReShadeUnregisterEvent(reshade::addon_event ev, void *callback)
@@ -590,17 +875,31 @@ void ReShadeUnregisterEventForAddon(HMODULE module, reshade::addon_event ev, voi
 	assert(info->handle == module || module == nullptr);
 
 #if RESHADE_ADDON == 1
-	if (info->handle != g_module_handle && (ev > reshade::addon_event::destroy_effect_runtime && ev < reshade::addon_event::present))
+	if (info->handle != g_module_handle && ((ev > reshade::addon_event::destroy_effect_runtime && ev < reshade::addon_event::present) || ev == reshade::addon_event::draw_batch))
 		return;
 #endif
 
-	std::vector<void *> &event_list = reshade::addon_event_list[static_cast<uint32_t>(ev)];
-	event_list.erase(std::remove(event_list.begin(), event_list.end(), callback), event_list.end());
+	const std::unique_lock<std::mutex> lock(s_event_list_mutex);
+
+	update_event_list(ev, [callback](reshade::addon_event_callback_list &event_list) {
+		for (size_t cb = 0; cb < event_list.callbacks.size();)
+		{
+			if (event_list.callbacks[cb] == callback)
+			{
+				event_list.callbacks.erase(event_list.callbacks.begin() + cb);
+				event_list.cost_slots.erase(event_list.cost_slots.begin() + cb);
+			}
+			else
+			{
+				++cb;
+			}
+		}
+	});
 
 	info->event_callbacks.erase(std::remove(info->event_callbacks.begin(), info->event_callbacks.end(), std::make_pair(static_cast<uint32_t>(ev), callback)), info->event_callbacks.end());
 
 #if RESHADE_VERBOSE_LOG
-	reshade::log::message(reshade::log::level::debug, "Unregistered event callback %p for event %s.", callback, addon_event_to_string(ev));
+	reshade::log::message(reshade::log::level::debug, "Unregistered event callback %p for event %s.", callback, reshade::addon_event_to_string(ev));
 #endif
 }
 
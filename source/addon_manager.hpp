@@ -7,6 +7,8 @@
 
 #include "addon.hpp"
 #include "reshade_events.hpp"
+#include <atomic>
+#include <intrin.h> // __rdtsc
 
 #if RESHADE_ADDON
 
@@ -21,9 +23,115 @@ namespace reshade
 	extern bool addon_all_loaded;
 
 	/// <summary>
-	/// List of add-on event callbacks.
+	/// Immutable snapshot of the callbacks registered for an add-on event.
+	/// Registration publishes a new snapshot instead of modifying the current one, and keeps replaced snapshots alive until no thread can still be iterating them (see <see cref="addon_event_read_scope"/>), so that they can be iterated without locking while callbacks are registered or unregistered on other threads (or from within a callback).
 	/// </summary>
-	extern std::vector<void *> addon_event_list[];
+	struct addon_event_callback_list
+	{
+		std::vector<void *> callbacks;
+		/// <summary>
+		/// Slots the time spent in each callback is accumulated into (in the same order as <see cref="callbacks"/>).
+		/// </summary>
+		std::vector<uint32_t> cost_slots;
+	};
+
+	/// <summary>
+	/// List of add-on event callbacks (or <see langword="nullptr"/> if there are none for an event).
+	/// </summary>
+	extern std::atomic<const addon_event_callback_list *> addon_event_list[];
+
+	/// <summary>
+	/// Current epoch of the add-on event callback lists, which is advanced whenever replaced lists are reclaimed (starts at one, since zero marks a thread that is not iterating any list).
+	/// </summary>
+	extern std::atomic<uint64_t> addon_event_epoch;
+
+	/// <summary>
+	/// Per-thread record of the epoch in which the thread started iterating add-on event callback lists.
+	/// </summary>
+	struct addon_event_reader
+	{
+		/// <summary>
+		/// Value of <see cref="addon_event_epoch"/> when the thread started iterating, or zero while it is not iterating any list.
+		/// </summary>
+		std::atomic<uint64_t> epoch = 0;
+		/// <summary>
+		/// Number of nested event invocations on the owning thread (e.g. when a callback invokes another event), only accessed by that thread.
+		/// </summary>
+		uint32_t depth = 0;
+		/// <summary>
+		/// Whether a thread currently owns this record (records of threads that ended are reused).
+		/// </summary>
+		bool in_use = false;
+	};
+
+	/// <summary>
+	/// Gets the epoch record of the calling thread, creating it on first use.
+	/// </summary>
+	addon_event_reader &get_addon_event_reader();
+
+	/// <summary>
+	/// Deletes replaced add-on event callback lists that no thread can still be iterating.
+	/// This is called once per present, and does nothing if callbacks are currently being registered or unregistered on another thread.
+	/// </summary>
+	void reclaim_addon_event_lists();
+
+	/// <summary>
+	/// Announces that the calling thread may be iterating add-on event callback lists for the lifetime of this object, so that lists replaced in the meantime are not deleted yet.
+	/// </summary>
+	class addon_event_read_scope
+	{
+	public:
+		addon_event_read_scope() : _reader(get_addon_event_reader())
+		{
+			// Only the outermost scope announces an epoch, since the older epoch of an outer scope protects everything a nested scope could see as well
+			if (_reader.depth++ == 0)
+				_reader.epoch.store(addon_event_epoch.load(std::memory_order_acquire), std::memory_order_seq_cst);
+		}
+		~addon_event_read_scope()
+		{
+			if (--_reader.depth == 0)
+				_reader.epoch.store(0, std::memory_order_release);
+		}
+
+		addon_event_read_scope(const addon_event_read_scope &) = delete;
+		addon_event_read_scope &operator=(const addon_event_read_scope &) = delete;
+
+	private:
+		addon_event_reader &_reader;
+	};
+
+	/// <summary>
+	/// Global switch to measure the time spent in add-on event callbacks.
+	/// Read with relaxed loads on any thread that invokes events, while the GUI may change it at any time.
+	/// </summary>
+	extern std::atomic<bool> addon_event_profiling;
+
+	/// <summary>
+	/// Accumulated cost of all callbacks an add-on registered for a specific event.
+	/// </summary>
+	struct addon_event_cost
+	{
+		std::string addon_name;
+		addon_event ev;
+		uint64_t count;
+		uint64_t total_ns;
+		uint64_t max_ns;
+	};
+
+	/// <summary>
+	/// Adds the duration of a single callback invocation (in time stamp counter ticks) to the accumulators of the calling thread.
+	/// </summary>
+	void record_addon_event_cost(uint32_t slot, uint64_t ticks);
+
+	/// <summary>
+	/// Gets the cost of add-on event callbacks accumulated over all threads so far.
+	/// </summary>
+	std::vector<addon_event_cost> get_addon_event_costs();
+
+	/// <summary>
+	/// Gets the name of the specified <paramref name="ev"/>ent.
+	/// </summary>
+	const char *addon_event_to_string(addon_event ev);
 
 	/// <summary>
 	/// List of currently loaded add-ons.
@@ -56,7 +164,91 @@ namespace reshade
 	template <addon_event ev>
 	__forceinline bool has_addon_event()
 	{
-		return !addon_event_list[static_cast<uint32_t>(ev)].empty();
+		return addon_event_list[static_cast<uint32_t>(ev)].load(std::memory_order_acquire) != nullptr;
+	}
+
+	/// <summary>
+	/// Appends a draw call to the list of draw calls collected for the <see cref="addon_event::draw_batch"/> event of the specified command list.
+	/// </summary>
+	void record_draw_batch_draw(api::command_list *cmd_list, api::indirect_command type, uint32_t vertex_count, uint32_t instance_count, uint32_t indirect_draw_count);
+	/// <summary>
+	/// Updates the depth-stencil view that is stored with subsequent draw calls collected for the specified command list.
+	/// </summary>
+	void record_draw_batch_depth_stencil(api::command_list *cmd_list, api::resource_view dsv);
+	/// <summary>
+	/// Updates the viewport that is stored with subsequent draw calls collected for the specified command list.
+	/// </summary>
+	void record_draw_batch_viewport(api::command_list *cmd_list, const api::viewport &viewport);
+	/// <summary>
+	/// Invokes the <see cref="addon_event::draw_batch"/> event with all draw calls collected for the specified command list so far.
+	/// </summary>
+	void flush_draw_batch(api::command_list *cmd_list, bool discard = false);
+	/// <summary>
+	/// Frees the draw calls collected for the specified command list.
+	/// </summary>
+	void destroy_draw_batch(api::command_list *cmd_list);
+
+	/// <summary>
+	/// Collects the draw calls and related state reported by the specified <typeparamref name="ev"/>ent for the <see cref="addon_event::draw_batch"/> event.
+	/// </summary>
+	template <addon_event ev, typename... Args>
+	__forceinline void update_draw_batch([[maybe_unused]] Args &... args)
+	{
+		if constexpr (ev == addon_event::destroy_command_list)
+		{
+			// Always clean up, since callbacks for the batch event may have been unregistered since draw calls were collected
+			destroy_draw_batch(args...);
+			return;
+		}
+		else if constexpr (
+			ev == addon_event::draw ||
+			ev == addon_event::draw_indexed ||
+			ev == addon_event::draw_or_dispatch_indirect ||
+			ev == addon_event::bind_render_targets_and_depth_stencil ||
+			ev == addon_event::begin_render_pass ||
+			ev == addon_event::bind_viewports ||
+			ev == addon_event::reset_command_list ||
+			ev == addon_event::close_command_list ||
+			ev == addon_event::execute_command_list)
+		{
+			if (!has_addon_event<addon_event::draw_batch>())
+				return;
+
+			if constexpr (ev == addon_event::draw)
+				[](api::command_list *cmd_list, uint32_t vertex_count, uint32_t instance_count, uint32_t, uint32_t) {
+					record_draw_batch_draw(cmd_list, api::indirect_command::draw, vertex_count, instance_count, 0);
+				}(args...);
+			if constexpr (ev == addon_event::draw_indexed)
+				[](api::command_list *cmd_list, uint32_t index_count, uint32_t instance_count, uint32_t, int32_t, uint32_t) {
+					record_draw_batch_draw(cmd_list, api::indirect_command::draw_indexed, index_count, instance_count, 0);
+				}(args...);
+			if constexpr (ev == addon_event::draw_or_dispatch_indirect)
+				[](api::command_list *cmd_list, api::indirect_command type, api::resource, uint64_t, uint32_t draw_count, uint32_t) {
+					if (type == api::indirect_command::unknown || type == api::indirect_command::draw || type == api::indirect_command::draw_indexed)
+						record_draw_batch_draw(cmd_list, type, 0, 0, draw_count);
+				}(args...);
+			if constexpr (ev == addon_event::bind_render_targets_and_depth_stencil)
+				[](api::command_list *cmd_list, uint32_t, const api::resource_view *, api::resource_view dsv) {
+					record_draw_batch_depth_stencil(cmd_list, dsv);
+				}(args...);
+			if constexpr (ev == addon_event::begin_render_pass)
+				[](api::command_list *cmd_list, uint32_t, const api::render_pass_render_target_desc *, const api::render_pass_depth_stencil_desc *ds) {
+					record_draw_batch_depth_stencil(cmd_list, ds != nullptr ? ds->view : api::resource_view { 0 });
+				}(args...);
+			if constexpr (ev == addon_event::bind_viewports)
+				[](api::command_list *cmd_list, uint32_t first, uint32_t count, const api::viewport *viewports) {
+					if (first == 0 && count != 0)
+						record_draw_batch_viewport(cmd_list, viewports[0]);
+				}(args...);
+			if constexpr (ev == addon_event::reset_command_list)
+				flush_draw_batch(args..., true);
+			if constexpr (ev == addon_event::close_command_list)
+				flush_draw_batch(args...);
+			if constexpr (ev == addon_event::execute_command_list)
+				[](api::command_queue *, api::command_list *cmd_list) {
+					flush_draw_batch(cmd_list); // Deferred command lists were already flushed when closed, so this only affects immediate command lists
+				}(args...);
+		}
 	}
 
 	/// <summary>
@@ -110,9 +302,28 @@ namespace reshade
 		if (!addon_enabled)
 			return;
 #endif
-		std::vector<void *> &event_list = addon_event_list[static_cast<uint32_t>(ev)];
-		for (size_t cb = 0, count = event_list.size(); cb < count; ++cb) // Generates better code than ranged-based for loop
-			reinterpret_cast<typename addon_event_traits<ev>::decl>(event_list[cb])(std::forward<Args>(args)...);
+		update_draw_batch<ev>(args...);
+
+		// Check before announcing an epoch, so that events without any callbacks stay cheap
+		if (addon_event_list[static_cast<uint32_t>(ev)].load(std::memory_order_relaxed) == nullptr)
+			return;
+		const addon_event_read_scope read_scope;
+		// Has to be ordered after the epoch announcement, which is what allows 'reclaim_addon_event_lists' to delete lists this thread can no longer see
+		const addon_event_callback_list *const event_list = addon_event_list[static_cast<uint32_t>(ev)].load(std::memory_order_seq_cst);
+		if (event_list == nullptr)
+			return;
+		if (addon_event_profiling.load(std::memory_order_relaxed))
+		{
+			for (size_t cb = 0, count = event_list->callbacks.size(); cb < count; ++cb)
+			{
+				const uint64_t start = __rdtsc();
+				reinterpret_cast<typename addon_event_traits<ev>::decl>(event_list->callbacks[cb])(std::forward<Args>(args)...);
+				record_addon_event_cost(event_list->cost_slots[cb], __rdtsc() - start);
+			}
+			return;
+		}
+		for (size_t cb = 0, count = event_list->callbacks.size(); cb < count; ++cb) // Generates better code than ranged-based for loop
+			reinterpret_cast<typename addon_event_traits<ev>::decl>(event_list->callbacks[cb])(std::forward<Args>(args)...);
 	}
 	/// <summary>
 	/// Invokes registered callbacks for the specified <typeparamref name="ev"/>ent until a callback reports back as having handled this event by returning <see langword="true"/>.
@@ -146,10 +357,28 @@ namespace reshade
 		if (!addon_enabled)
 			return false;
 #endif
+		update_draw_batch<ev>(args...);
+
 		bool skip = false;
-		std::vector<void *> &event_list = addon_event_list[static_cast<uint32_t>(ev)];
-		for (size_t cb = 0, count = event_list.size(); cb < count; ++cb)
-			if (reinterpret_cast<typename addon_event_traits<ev>::decl>(event_list[cb])(std::forward<Args>(args)...))
+		if (addon_event_list[static_cast<uint32_t>(ev)].load(std::memory_order_relaxed) == nullptr)
+			return false;
+		const addon_event_read_scope read_scope;
+		const addon_event_callback_list *const event_list = addon_event_list[static_cast<uint32_t>(ev)].load(std::memory_order_seq_cst);
+		if (event_list == nullptr)
+			return false;
+		if (addon_event_profiling.load(std::memory_order_relaxed))
+		{
+			for (size_t cb = 0, count = event_list->callbacks.size(); cb < count; ++cb)
+			{
+				const uint64_t start = __rdtsc();
+				if (reinterpret_cast<typename addon_event_traits<ev>::decl>(event_list->callbacks[cb])(std::forward<Args>(args)...))
+					skip = true;
+				record_addon_event_cost(event_list->cost_slots[cb], __rdtsc() - start);
+			}
+			return skip;
+		}
+		for (size_t cb = 0, count = event_list->callbacks.size(); cb < count; ++cb)
+			if (reinterpret_cast<typename addon_event_traits<ev>::decl>(event_list->callbacks[cb])(std::forward<Args>(args)...))
 				skip = true;
 		return skip;
 	}
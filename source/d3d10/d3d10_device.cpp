@@ -320,7 +320,7 @@ void    STDMETHODCALLTYPE D3D10Device::OMSetRenderTargets(UINT NumViews, ID3D10R
 	_orig->OMSetRenderTargets(NumViews, ppRenderTargetViews, pDepthStencilView);
 
 #if RESHADE_ADDON
-	if (!reshade::has_addon_event<reshade::addon_event::bind_render_targets_and_depth_stencil>())
+	if (!reshade::has_addon_event<reshade::addon_event::bind_render_targets_and_depth_stencil>() && !reshade::has_addon_event<reshade::addon_event::draw_batch>())
 		return;
 
 #ifndef _WIN64
@@ -413,7 +413,7 @@ void    STDMETHODCALLTYPE D3D10Device::RSSetViewports(UINT NumViewports, const D
 	_orig->RSSetViewports(NumViewports, pViewports);
 
 #if RESHADE_ADDON
-	if (!reshade::has_addon_event<reshade::addon_event::bind_viewports>())
+	if (!reshade::has_addon_event<reshade::addon_event::bind_viewports>() && !reshade::has_addon_event<reshade::addon_event::draw_batch>())
 		return;
 
 	temp_mem<reshade::api::viewport, D3D10_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE> viewport_data(NumViewports);
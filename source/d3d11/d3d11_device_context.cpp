@@ -426,7 +426,7 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::OMSetRenderTargets(UINT NumViews,
 	_orig->OMSetRenderTargets(NumViews, ppRenderTargetViews, pDepthStencilView);
 
 #if RESHADE_ADDON
-	if (!reshade::has_addon_event<reshade::addon_event::bind_render_targets_and_depth_stencil>())
+	if (!reshade::has_addon_event<reshade::addon_event::bind_render_targets_and_depth_stencil>() && !reshade::has_addon_event<reshade::addon_event::draw_batch>())
 		return;
 
 #ifndef _WIN64
@@ -448,7 +448,7 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::OMSetRenderTargetsAndUnorderedAcce
 
 #if RESHADE_ADDON
 	if (NumRTVs != D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL &&
-		reshade::has_addon_event<reshade::addon_event::bind_render_targets_and_depth_stencil>())
+		(reshade::has_addon_event<reshade::addon_event::bind_render_targets_and_depth_stencil>() || reshade::has_addon_event<reshade::addon_event::draw_batch>()))
 	{
 #ifndef _WIN64
 		temp_mem<reshade::api::resource_view, D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT> rtvs_mem(NumRTVs);
@@ -1160,7 +1160,7 @@ void STDMETHODCALLTYPE D3D12GraphicsCommandList::OMSetRenderTargets(UINT NumRend
         _current_depth_stencil = pDepthStencilDescriptor != nullptr ? *pDepthStencilDescriptor : D3D12_CPU_DESCRIPTOR_HANDLE {};
 
 #if RESHADE_ADDON
-        if (!reshade::has_addon_event<reshade::addon_event::bind_render_targets_and_depth_stencil>())
+        if (!reshade::has_addon_event<reshade::addon_event::bind_render_targets_and_depth_stencil>() && !reshade::has_addon_event<reshade::addon_event::draw_batch>())
                 return;
 
 	temp_mem<reshade::api::resource_view, D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT> rtvs(NumRenderTargetDescriptors);
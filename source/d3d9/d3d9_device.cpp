@@ -1189,7 +1189,8 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::SetRenderTarget(DWORD RenderTargetInd
 #if RESHADE_ADDON
 	if (SUCCEEDED(hr) && (
 		reshade::has_addon_event<reshade::addon_event::bind_render_targets_and_depth_stencil>() ||
-		reshade::has_addon_event<reshade::addon_event::bind_viewports>()))
+		reshade::has_addon_event<reshade::addon_event::bind_viewports>() ||
+		reshade::has_addon_event<reshade::addon_event::draw_batch>()))
 	{
 		DWORD count = 0;
 		com_ptr<IDirect3DSurface9> surface;
@@ -1253,7 +1254,7 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::SetDepthStencilSurface(IDirect3DSurfa
 	{
 		_current_depth_stencil = std::move(surface_proxy);
 
-		if (reshade::has_addon_event<reshade::addon_event::bind_render_targets_and_depth_stencil>())
+		if (reshade::has_addon_event<reshade::addon_event::bind_render_targets_and_depth_stencil>() || reshade::has_addon_event<reshade::addon_event::draw_batch>())
 		{
 			DWORD count = 0;
 			com_ptr<IDirect3DSurface9> surface;
@@ -4,6 +4,9 @@
  */
 
 #include "dll_log.hpp"
+#include <atomic>
+#include <cstring> // std::memcpy
+#include <intrin.h>
 #include <Windows.h>
 
 struct scoped_file_handle
@@ -27,43 +30,188 @@ private:
 };
 
 static scoped_file_handle s_file_handle;
+// Serializes all writes to and changes of the log file handle, since these happen on the background writer thread and on any thread that logs an error or flushes
+// This is a slim reader/writer lock rather than a 'std::mutex', since trying to acquire it again on the thread that already holds it is well-defined (and fails), which can happen in the exception handler
+static SRWLOCK s_file_lock = SRWLOCK_INIT;
 
-bool reshade::log::open_log_file(const std::filesystem::path &path, std::error_code &ec)
+// Bounded lock-free multi-producer multi-consumer queue of formatted lines that the background writer thread writes to the log file
+struct ring_slot
 {
-	// Close the previous file first
-	// Do this here, instead of in 'scoped_file_handle::operator=', so that the old handle is closed before the new handle is created
-	if (s_file_handle != INVALID_HANDLE_VALUE)
-		CloseHandle(s_file_handle);
+	std::atomic<size_t> sequence;
+	std::string line;
+};
 
-	// Open the log file for writing (and flush on each write) and clear previous contents
-	s_file_handle = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_WRITE_THROUGH, NULL);
+static ring_slot s_ring[1024];
+static std::atomic<size_t> s_ring_enqueue_position = 0;
+static std::atomic<size_t> s_ring_dequeue_position = 0;
 
-	if (s_file_handle != INVALID_HANDLE_VALUE)
+static std::atomic<bool> s_writer_running = false;
+static HANDLE s_writer_thread = nullptr;
+static HANDLE s_writer_wake_event = nullptr;
+
+static bool try_enqueue_line(std::string &line)
+{
+	for (size_t position = s_ring_enqueue_position.load(std::memory_order_relaxed);;)
 	{
-		// Last error may be ERROR_ALREADY_EXISTS if an existing file was overwritten, which can be ignored
-		ec.clear();
-		return true;
+		ring_slot &slot = s_ring[position % std::size(s_ring)];
+		const auto difference = static_cast<intptr_t>(slot.sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(position);
+
+		if (difference == 0)
+		{
+			if (s_ring_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				slot.line = std::move(line);
+				slot.sequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (difference < 0)
+		{
+			return false; // Queue is full
+		}
+		else
+		{
+			position = s_ring_enqueue_position.load(std::memory_order_relaxed);
+		}
 	}
+}
+static bool try_dequeue_line(std::string &line)
+{
+	for (size_t position = s_ring_dequeue_position.load(std::memory_order_relaxed);;)
+	{
+		ring_slot &slot = s_ring[position % std::size(s_ring)];
+		const auto difference = static_cast<intptr_t>(slot.sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(position + 1);
+
+		if (difference == 0)
+		{
+			if (s_ring_dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				line = std::move(slot.line);
+				slot.sequence.store(position + std::size(s_ring), std::memory_order_release);
+				return true;
+			}
+		}
+		else if (difference < 0)
+		{
+			return false; // Queue is empty
+		}
+		else
+		{
+			position = s_ring_dequeue_position.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+static void write_pending_lines(const std::string &additional_data = std::string(), bool wait_for_lock = true)
+{
+	// When not waiting, go ahead without the lock if it cannot be acquired right away, since it may be held by a thread that was terminated during process exit, or by the current thread if an exception occurred while it was writing
+	// The queue itself is safe to use without the lock and 'WriteFile' writes each call in one piece, the lock only keeps lines written by different threads in order
+	bool locked = true;
+	if (wait_for_lock)
+		AcquireSRWLockExclusive(&s_file_lock);
 	else
+		locked = TryAcquireSRWLockExclusive(&s_file_lock) != FALSE;
+
+	// Combine all pending lines into a single write
+	// Dequeue while holding the lock, so that lines dequeued by different threads cannot be written out of order
+	std::string pending_data;
+	for (std::string line; try_dequeue_line(line);)
+		pending_data += line;
+	pending_data += additional_data;
+
+	if (s_file_handle != INVALID_HANDLE_VALUE && !pending_data.empty())
 	{
-		ec.assign(GetLastError(), std::system_category());
-		return false;
+		DWORD written = 0;
+		WriteFile(s_file_handle, pending_data.data(), static_cast<DWORD>(pending_data.size()), &written, nullptr);
+		assert(written == pending_data.size());
 	}
+
+	if (locked)
+		ReleaseSRWLockExclusive(&s_file_lock);
 }
 
-void reshade::log::message(level level, const char *format, ...)
+static DWORD WINAPI background_writer_main(LPVOID)
 {
-	static constexpr char level_names[][6] = { "ERROR", "WARN ", "INFO ", "DEBUG" };
+	while (s_writer_running.load(std::memory_order_acquire))
+	{
+		// Write in batches every so often, or earlier when the queue fills up
+		WaitForSingleObject(s_writer_wake_event, 100);
 
-	if (static_cast<size_t>(level) == 0)
-		level = level::error;
-	if (static_cast<size_t>(level) > std::size(level_names))
-		level = level::debug;
+		write_pending_lines();
+	}
+
+	write_pending_lines();
+
+	return 0;
+}
+
+// Limit the number of identical messages written per second from the same call site, so that messages logged every frame do not flood the log
+struct rate_limit_site
+{
+	std::atomic<uint64_t> key;
+	std::atomic<DWORD> second;
+	std::atomic<uint32_t> count;
+	std::atomic<uint32_t> suppressed_count;
+	// Beginning of the message text, so that a summary of suppressed repetitions can still be written when the log is flushed (only accessed while holding 'content_lock')
+	std::atomic_flag content_lock;
+	char content[128];
+};
+
+static rate_limit_site s_rate_limit_sites[256];
+
+static bool check_rate_limit(const void *return_address, const char *content, size_t content_length, uint32_t &suppressed_count)
+{
+	// Identify a message by its call site and its formatted text (FNV-1a hash), so that different messages from the same call site (e.g. through a common helper function) are not suppressed
+	uint64_t key = 14695981039346656037ull ^ reinterpret_cast<uintptr_t>(return_address);
+	for (size_t i = 0; i < content_length; ++i)
+		key = (key ^ static_cast<uint8_t>(content[i])) * 1099511628211ull;
+
+	rate_limit_site &site = s_rate_limit_sites[(key ^ (key >> 32)) % std::size(s_rate_limit_sites)];
+
+	const DWORD current_second = GetTickCount() / 1000;
+
+	suppressed_count = 0;
+
+	// Counting is approximate when multiple threads log the same message at the same time, or messages share a table entry, which is fine for this purpose
+	if (site.key.load(std::memory_order_relaxed) != key)
+	{
+		site.key.store(key, std::memory_order_relaxed);
+		site.second.store(current_second, std::memory_order_relaxed);
+		site.count.store(1, std::memory_order_relaxed);
+		site.suppressed_count.store(0, std::memory_order_relaxed);
+
+		if (!site.content_lock.test_and_set(std::memory_order_acquire))
+		{
+			const size_t length = content_length < std::size(site.content) ? content_length : std::size(site.content) - 1;
+			std::memcpy(site.content, content, length);
+			site.content[length] = '\0';
+			site.content_lock.clear(std::memory_order_release);
+		}
+		return true;
+	}
+
+	if (site.second.exchange(current_second, std::memory_order_relaxed) != current_second)
+	{
+		site.count.store(1, std::memory_order_relaxed);
+		suppressed_count = site.suppressed_count.exchange(0, std::memory_order_relaxed);
+		return true;
+	}
+
+	if (site.count.fetch_add(1, std::memory_order_relaxed) < 50)
+		return true;
+
+	site.suppressed_count.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+static size_t vformat_line(std::string &line_string, reshade::log::level level, const char *format, va_list args)
+{
+	static constexpr char level_names[][6] = { "ERROR", "WARN ", "INFO ", "DEBUG" };
 
 	SYSTEMTIME time;
 	GetLocalTime(&time);
 
-	std::string line_string(256, '\0');
+	line_string.assign(256, '\0');
 
 	// Start a new line
 	const auto meta_length = std::snprintf(line_string.data(), line_string.size(),
@@ -76,37 +224,185 @@ void reshade::log::message(level level, const char *format, ...)
 #endif
 		time.wHour, time.wMinute, time.wSecond, time.wMilliseconds, GetCurrentThreadId(), level_names[static_cast<size_t>(level) - 1]);
 
-	va_list args;
-	va_start(args, format);
-	const auto content_length = std::vsnprintf(line_string.data() + meta_length, line_string.size() + 1 - meta_length, format, args);
-	va_end(args);
+	// Format into a copy of the argument list first, so that the original can be used again should the line not fit
+	va_list args_copy;
+	va_copy(args_copy, args);
+	const auto content_length = std::vsnprintf(line_string.data() + meta_length, line_string.size() + 1 - meta_length, format, args_copy);
+	va_end(args_copy);
 
 	const bool remaining_content = static_cast<size_t>(meta_length) + static_cast<size_t>(content_length) > line_string.size();
 	line_string.resize(static_cast<size_t>(meta_length) + static_cast<size_t>(content_length));
 
 	if (remaining_content)
-	{
-		va_start(args, format);
 		std::vsnprintf(line_string.data() + meta_length, line_string.size() + 1 - meta_length, format, args);
-		va_end(args);
-	}
 
+	return static_cast<size_t>(meta_length);
+}
+static size_t format_line(std::string &line_string, reshade::log::level level, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	const size_t meta_length = vformat_line(line_string, level, format, args);
+	va_end(args);
+
+	return meta_length;
+}
+
+static void terminate_line(std::string &line_string)
+{
 	line_string += '\n'; // Terminate line with line feed
 
 	// Replace all LF with CRLF
 	for (size_t offset = 0; (offset = line_string.find('\n', offset)) != std::string::npos; offset += 2)
 		line_string.replace(offset, 1, "\r\n", 2);
+}
 
-	// Write line to the log file
+bool reshade::log::open_log_file(const std::filesystem::path &path, std::error_code &ec)
+{
+	// Hold the lock while replacing the handle, so that the background writer thread (or any other thread writing a line) cannot use the handle in the meantime
+	AcquireSRWLockExclusive(&s_file_lock);
+
+	// Close the previous file first
+	// Do this here, instead of in 'scoped_file_handle::operator=', so that the old handle is closed before the new handle is created
 	if (s_file_handle != INVALID_HANDLE_VALUE)
+		CloseHandle(s_file_handle);
+
+	// Open the log file for writing (and flush on each write) and clear previous contents
+	s_file_handle = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_WRITE_THROUGH, NULL);
+	const DWORD error_code = GetLastError();
+	const bool success = s_file_handle != INVALID_HANDLE_VALUE;
+
+	ReleaseSRWLockExclusive(&s_file_lock);
+
+	if (success)
 	{
-		DWORD written = 0;
-		WriteFile(s_file_handle, line_string.data(), static_cast<DWORD>(line_string.size()), &written, nullptr);
-		assert(written == line_string.size());
+		// Last error may be ERROR_ALREADY_EXISTS if an existing file was overwritten, which can be ignored
+		ec.clear();
+		return true;
+	}
+	else
+	{
+		ec.assign(error_code, std::system_category());
+		return false;
+	}
+}
+
+void reshade::log::start_background_writer()
+{
+	if (s_writer_running || s_file_handle == INVALID_HANDLE_VALUE)
+		return;
+
+	// Queue is empty at this point, so can reset it
+	for (size_t i = 0; i < std::size(s_ring); ++i)
+		s_ring[i].sequence.store(i, std::memory_order_relaxed);
+	s_ring_enqueue_position.store(0, std::memory_order_relaxed);
+	s_ring_dequeue_position.store(0, std::memory_order_relaxed);
+
+	s_writer_wake_event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+	if (s_writer_wake_event == nullptr)
+	{
+		stop_background_writer();
+		return;
 	}
 
+	s_writer_running.store(true, std::memory_order_release);
+
+	s_writer_thread = CreateThread(nullptr, 0, &background_writer_main, nullptr, 0, nullptr);
+	if (s_writer_thread == nullptr)
+	{
+		s_writer_running.store(false, std::memory_order_release);
+		stop_background_writer();
+	}
+}
+void reshade::log::stop_background_writer()
+{
+	if (s_writer_running.exchange(false, std::memory_order_acq_rel) && s_writer_thread != nullptr)
+	{
+		SetEvent(s_writer_wake_event);
+
+		// Wait for the thread to exit, so that it cannot outlive this module
+		// This does not dead lock on the loader lock when called during 'DLL_PROCESS_DETACH', since the module is pinned after initialization, so detach only happens when the process is exiting, at which point all other threads were already terminated (the timeout is only a safeguard)
+		WaitForSingleObject(s_writer_thread, 1000);
+	}
+
+	if (s_writer_thread != nullptr)
+		CloseHandle(s_writer_thread);
+	s_writer_thread = nullptr;
+	if (s_writer_wake_event != nullptr)
+		CloseHandle(s_writer_wake_event);
+	s_writer_wake_event = nullptr;
+
+	// The writer thread may have been terminated while it was holding the lock, which 'flush' does not wait for
+	flush();
+}
+
+void reshade::log::flush()
+{
+	// Write summaries for messages that were suppressed since the last time they were logged, so that they are not lost
+	std::string summary_lines;
+	for (rate_limit_site &site : s_rate_limit_sites)
+	{
+		if (site.suppressed_count.load(std::memory_order_relaxed) == 0 || site.content_lock.test_and_set(std::memory_order_acquire))
+			continue;
+
+		if (const uint32_t suppressed_count = site.suppressed_count.exchange(0, std::memory_order_relaxed))
+		{
+			std::string line_string;
+			format_line(line_string, level::warning, "Suppressed %u more repetitions of \"%s\" in the last second.", suppressed_count, site.content);
+			terminate_line(line_string);
+
+			summary_lines += line_string;
+		}
+
+		site.content_lock.clear(std::memory_order_release);
+	}
+
+	// This is called from the exception handler, so do not wait for the lock, which may be held by the current thread
+	write_pending_lines(summary_lines, false);
+}
+
+void reshade::log::message(level level, const char *format, ...)
+{
+	if (static_cast<size_t>(level) == 0)
+		level = level::error;
+	if (static_cast<size_t>(level) > static_cast<size_t>(level::debug))
+		level = level::debug;
+
+	std::string line_string;
+
+	va_list args;
+	va_start(args, format);
+	const size_t meta_length = vformat_line(line_string, level, format, args);
+	va_end(args);
+
+	// Errors and warnings are never suppressed, so that no important information is lost
+	if (level != level::error && level != level::warning)
+	{
+		if (uint32_t suppressed_count; !check_rate_limit(_ReturnAddress(), line_string.data() + meta_length, line_string.size() - meta_length, suppressed_count))
+			return;
+		else if (suppressed_count != 0)
+			message(level::warning, "Suppressed %u more repetitions of \"%s\" in the last second.", suppressed_count, line_string.c_str() + meta_length);
+	}
+
+	terminate_line(line_string);
+
 #ifndef NDEBUG
 	// Write line to the debug output
 	OutputDebugStringA(line_string.c_str());
 #endif
+
+	// Write line to the log file
+	if (s_file_handle != INVALID_HANDLE_VALUE)
+	{
+		// Errors are written immediately, so that they are not lost if the application crashes afterwards
+		if (level != level::error && s_writer_running.load(std::memory_order_acquire) && try_enqueue_line(line_string))
+		{
+			if (s_ring_enqueue_position.load(std::memory_order_relaxed) - s_ring_dequeue_position.load(std::memory_order_relaxed) > std::size(s_ring) / 2)
+				SetEvent(s_writer_wake_event);
+			return;
+		}
+
+		// Write anything still pending first, to keep lines in order
+		write_pending_lines(line_string);
+	}
 }
@@ -42,6 +42,21 @@ namespace reshade::log
 	/// <param name="ec">Error code that is set on failure.</param>
 	bool open_log_file(const std::filesystem::path &path, std::error_code &ec);
 
+	/// <summary>
+	/// Starts writing log messages on a background thread, so that logging does not block the calling thread on disk I/O.
+	/// Errors are still written immediately.
+	/// </summary>
+	void start_background_writer();
+	/// <summary>
+	/// Stops the background thread and writes all pending log messages to the log file.
+	/// </summary>
+	void stop_background_writer();
+	/// <summary>
+	/// Writes all pending log messages and summaries of suppressed repetitions to the log file.
+	/// This does not wait for other threads currently writing to the log file, so it is safe to call from an exception handler.
+	/// </summary>
+	void flush();
+
 	/// <summary>
 	/// Constructs a single log message including current time and level and writes it to the open log file.
 	/// </summary>
@@ -236,6 +236,9 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 						((code ^ 0xE24C4A00) <= 0xFF) /* LuaJIT exception */)
 						goto continue_search;
 
+					// Make sure messages leading up to the exception are in the log file
+					reshade::log::flush();
+
 					// Create dump with exception information for the first 100 occurrences
 					if (static unsigned int dump_index = 0; dump_index < 100)
 					{
@@ -345,10 +348,16 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 					}
 
 			reshade::log::message(reshade::log::level::info, "Initialized.");
+
+			// Initialization succeeded, so no longer need to worry about this module being unloaded right away again, and can start writing the log in the background
+			reshade::log::start_background_writer();
 			break;
 		}
 		case DLL_PROCESS_DETACH:
 		{
+			// Write remaining messages and switch back to writing synchronously, since the background thread must not outlive this module
+			reshade::log::stop_background_writer();
+
 			reshade::log::message(reshade::log::level::info, "Exiting ...");
 
 #if RESHADE_ADDON
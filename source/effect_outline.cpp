@@ -0,0 +1,453 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "effect_outline.hpp"
+#include "effect_lexer.hpp"
+#include <cstdlib> // std::strtoull
+
+static bool is_type_token(reshadefx::tokenid id)
+{
+	return id == reshadefx::tokenid::identifier || id == reshadefx::tokenid::void_ || (id >= reshadefx::tokenid::bool_ && id <= reshadefx::tokenid::storage3d);
+}
+
+static reshadefx::type type_from_name(const std::string_view name)
+{
+	reshadefx::type type = {};
+	type.rows = 1;
+	type.cols = 1;
+
+	if (name.compare(0, 4, "bool") == 0)
+		type.base = reshadefx::type::t_bool;
+	else if (name.compare(0, 4, "uint") == 0 || name.compare(0, 5, "dword") == 0 || name.compare(0, 9, "min16uint") == 0)
+		type.base = reshadefx::type::t_uint;
+	else if (name.compare(0, 3, "int") == 0 || name.compare(0, 8, "min16int") == 0)
+		type.base = reshadefx::type::t_int;
+	else if (name.compare(0, 5, "float") == 0 || name.compare(0, 4, "half") == 0 || name.compare(0, 6, "double") == 0 || name.compare(0, 10, "min16float") == 0)
+		type.base = reshadefx::type::t_float;
+	else
+		type.base = reshadefx::type::t_string;
+
+	// Vector types have their dimension as the last character (matrix types are not supported in annotations)
+	if (type.base != reshadefx::type::t_string && !name.empty() && name.back() >= '1' && name.back() <= '4')
+		type.rows = name.back() - '0';
+
+	return type;
+}
+
+static void store_component(reshadefx::annotation &annotation, size_t index, double value)
+{
+	if (index >= 16)
+		return;
+
+	switch (annotation.type.base)
+	{
+	case reshadefx::type::t_bool:
+		annotation.value.as_uint[index] = value != 0.0 ? 1 : 0;
+		break;
+	case reshadefx::type::t_int:
+		annotation.value.as_int[index] = static_cast<int32_t>(value);
+		break;
+	case reshadefx::type::t_uint:
+		annotation.value.as_uint[index] = static_cast<uint32_t>(value);
+		break;
+	default:
+		annotation.value.as_float[index] = static_cast<float>(value);
+		break;
+	}
+}
+
+static bool literal_as_double(const reshadefx::token &tok, double &value)
+{
+	switch (tok.id)
+	{
+	case reshadefx::tokenid::true_literal:
+		value = 1.0;
+		return true;
+	case reshadefx::tokenid::false_literal:
+		value = 0.0;
+		return true;
+	case reshadefx::tokenid::int_literal:
+		value = tok.literal_as_int;
+		return true;
+	case reshadefx::tokenid::uint_literal:
+		value = tok.literal_as_uint;
+		return true;
+	case reshadefx::tokenid::float_literal:
+		value = tok.literal_as_float;
+		return true;
+	case reshadefx::tokenid::double_literal:
+		value = tok.literal_as_double;
+		return true;
+	default:
+		return false;
+	}
+}
+
+/// <summary>
+/// Parses an annotation list, starting after the opening '&lt;' and stopping after the closing '&gt;'.
+/// </summary>
+static reshadefx::token scan_annotations(reshadefx::lexer &lexer, std::vector<reshadefx::annotation> &annotations)
+{
+	reshadefx::token tok = lexer.lex();
+
+	while (tok.id != reshadefx::tokenid::greater && tok.id != reshadefx::tokenid::end_of_file)
+	{
+		// Each annotation has the form 'name = value;', optionally preceded by a type ('type name = value;')
+		if (!is_type_token(tok.id))
+		{
+			tok = lexer.lex();
+			continue;
+		}
+
+		reshadefx::annotation &annotation = annotations.emplace_back();
+
+		bool has_type = false;
+		const std::string_view first_name = std::string_view(lexer.input_string()).substr(tok.offset, tok.length);
+		if (tok = lexer.lex(); tok.id == reshadefx::tokenid::identifier)
+		{
+			has_type = true;
+			annotation.type = type_from_name(first_name);
+			annotation.name = std::move(tok.literal_as_string);
+			tok = lexer.lex();
+		}
+		else
+		{
+			annotation.name = first_name;
+		}
+
+		if (tok.id == reshadefx::tokenid::equal)
+			tok = lexer.lex();
+
+		if (tok.id == reshadefx::tokenid::string_literal)
+		{
+			annotation.type = type_from_name("string");
+			annotation.type.rows = 0;
+
+			// Adjacent string literals are concatenated
+			while (tok.id == reshadefx::tokenid::string_literal)
+			{
+				annotation.value.string_data += tok.literal_as_string;
+				tok = lexer.lex();
+			}
+		}
+		else
+		{
+			// Collect all literal components of either a single value, a vector constructor or an initializer list
+			std::vector<double> values;
+			bool negate = false;
+
+			// Without an explicit type, the type is that of the vector constructor or otherwise the first literal
+			if (!has_type && is_type_token(tok.id) && tok.id != reshadefx::tokenid::identifier)
+			{
+				has_type = true;
+				annotation.type = type_from_name(std::string_view(lexer.input_string()).substr(tok.offset, tok.length));
+			}
+
+			for (; tok.id != reshadefx::tokenid::semicolon && tok.id != reshadefx::tokenid::greater && tok.id != reshadefx::tokenid::end_of_file; tok = lexer.lex())
+			{
+				if (double value; literal_as_double(tok, value))
+				{
+					if (!has_type)
+					{
+						has_type = true;
+						annotation.type = type_from_name(
+							tok.id == reshadefx::tokenid::true_literal || tok.id == reshadefx::tokenid::false_literal ? "bool" :
+							tok.id == reshadefx::tokenid::int_literal ? "int" :
+							tok.id == reshadefx::tokenid::uint_literal ? "uint" : "float");
+					}
+
+					values.push_back(negate ? -value : value);
+					negate = false;
+				}
+				else
+				{
+					negate = tok.id == reshadefx::tokenid::minus;
+				}
+			}
+
+			for (size_t i = 0; i < values.size(); ++i)
+				store_component(annotation, i, values[i]);
+
+			// A single value initializes all components of a vector
+			if (values.size() == 1)
+				for (size_t i = 1; i < annotation.type.rows && i < 16; ++i)
+					annotation.value.as_uint[i] = annotation.value.as_uint[0];
+		}
+
+		if (annotation.name.empty())
+			annotations.pop_back();
+
+		while (tok.id != reshadefx::tokenid::semicolon && tok.id != reshadefx::tokenid::greater && tok.id != reshadefx::tokenid::end_of_file)
+			tok = lexer.lex();
+		if (tok.id == reshadefx::tokenid::semicolon)
+			tok = lexer.lex();
+	}
+
+	return lexer.lex();
+}
+
+reshadefx::effect_outline reshadefx::scan_effect_outline(const std::string &source)
+{
+	effect_outline outline;
+
+	lexer lexer(source, true, true, true, true);
+
+	// Declarations are only looked for while every open scope is a namespace
+	std::vector<bool> scopes;
+	size_t non_namespace_scopes = 0;
+	size_t parenthesis_depth = 0;
+	bool namespace_pending = false;
+
+	for (token tok = lexer.lex(); tok.id != tokenid::end_of_file;)
+	{
+		switch (tok.id)
+		{
+		case tokenid::namespace_:
+			namespace_pending = true;
+			break;
+		case tokenid::brace_open:
+			scopes.push_back(namespace_pending);
+			non_namespace_scopes += namespace_pending ? 0 : 1;
+			namespace_pending = false;
+			break;
+		case tokenid::brace_close:
+			if (!scopes.empty())
+			{
+				non_namespace_scopes -= scopes.back() ? 0 : 1;
+				scopes.pop_back();
+			}
+			break;
+		case tokenid::parenthesis_open:
+			parenthesis_depth++;
+			break;
+		case tokenid::parenthesis_close:
+			if (parenthesis_depth != 0)
+				parenthesis_depth--;
+			break;
+		case tokenid::semicolon:
+			namespace_pending = false;
+			break;
+		default:
+			break;
+		}
+
+		if (non_namespace_scopes != 0 || parenthesis_depth != 0)
+		{
+			tok = lexer.lex();
+			continue;
+		}
+
+		if (tok.id == tokenid::technique)
+		{
+			if (tok = lexer.lex(); tok.id != tokenid::identifier)
+				continue;
+
+			outline_entry &entry = outline.techniques.emplace_back();
+			entry.name = std::move(tok.literal_as_string);
+
+			if (tok = lexer.lex(); tok.id == tokenid::less)
+				tok = scan_annotations(lexer, entry.annotations);
+			continue;
+		}
+
+		if (tok.id == tokenid::uniform_)
+		{
+			// Skip any additional qualifiers (e.g. 'uniform const float')
+			do
+				tok = lexer.lex();
+			while (tok.id == tokenid::const_ || tok.id == tokenid::static_ || tok.id == tokenid::volatile_ || tok.id == tokenid::precise || tok.id == tokenid::extern_);
+
+			if (!is_type_token(tok.id))
+				continue;
+
+			outline_entry entry;
+			entry.type = source.substr(tok.offset, tok.length);
+
+			// Skip template arguments of 'vector<float, 3>' and 'matrix<float, 3, 3>'
+			if (tok = lexer.lex(); tok.id == tokenid::less)
+			{
+				while (tok.id != tokenid::greater && tok.id != tokenid::end_of_file)
+				{
+					entry.type.append(source, tok.offset, tok.length);
+					tok = lexer.lex();
+				}
+				entry.type += '>';
+				tok = lexer.lex();
+			}
+
+			if (tok.id != tokenid::identifier)
+				continue;
+
+			entry.name = std::move(tok.literal_as_string);
+
+			// Skip array dimensions and semantics
+			for (tok = lexer.lex(); tok.id == tokenid::bracket_open || tok.id == tokenid::colon; tok = lexer.lex())
+			{
+				if (tok.id == tokenid::bracket_open)
+					while (tok.id != tokenid::bracket_close && tok.id != tokenid::end_of_file)
+						tok = lexer.lex();
+				else
+					tok = lexer.lex();
+			}
+
+			if (tok.id == tokenid::less)
+				tok = scan_annotations(lexer, entry.annotations);
+
+			outline.uniforms.push_back(std::move(entry));
+			continue;
+		}
+
+		tok = lexer.lex();
+	}
+
+	return outline;
+}
+
+static void write_string(std::string &data, const std::string_view value)
+{
+	data += std::to_string(value.size());
+	data += ':';
+	data += value;
+}
+static bool read_string(const std::string &data, size_t &offset, std::string &value)
+{
+	const size_t separator = data.find(':', offset);
+	if (separator == std::string::npos)
+		return false;
+
+	// Length has to be a plain decimal number, so that corrupted data is not silently read as a zero length
+	if (separator == offset || separator - offset > 10 ||
+		std::find_if(data.begin() + offset, data.begin() + separator, [](char c) { return c < '0' || c > '9'; }) != data.begin() + separator)
+		return false;
+
+	const size_t length = std::strtoull(data.c_str() + offset, nullptr, 10);
+	if (length > data.size() - (separator + 1))
+		return false;
+
+	value.assign(data, separator + 1, length);
+	offset = separator + 1 + length;
+	return true;
+}
+static bool read_number(const std::string &data, size_t &offset, uint32_t &value)
+{
+	std::string text;
+	if (!read_string(data, offset, text))
+		return false;
+
+	value = static_cast<uint32_t>(std::strtoull(text.c_str(), nullptr, 10));
+	return true;
+}
+
+static void write_entries(std::string &data, const std::vector<reshadefx::outline_entry> &entries)
+{
+	write_string(data, std::to_string(entries.size()));
+
+	for (const reshadefx::outline_entry &entry : entries)
+	{
+		write_string(data, entry.name);
+		write_string(data, entry.type);
+		write_string(data, std::to_string(entry.annotations.size()));
+
+		for (const reshadefx::annotation &annotation : entry.annotations)
+		{
+			write_string(data, std::to_string(static_cast<uint32_t>(annotation.type.base)));
+			write_string(data, std::to_string(annotation.type.rows));
+			write_string(data, annotation.name);
+
+			if (annotation.type.base == reshadefx::type::t_string)
+			{
+				write_string(data, annotation.value.string_data);
+			}
+			else
+			{
+				// Store the raw bits of all components, so that floating-point values round-trip exactly
+				for (unsigned int i = 0; i < annotation.type.rows && i < 16; ++i)
+					write_string(data, std::to_string(annotation.value.as_uint[i]));
+			}
+		}
+	}
+}
+static bool read_entries(const std::string &data, size_t &offset, std::vector<reshadefx::outline_entry> &entries)
+{
+	uint32_t num_entries = 0;
+	if (!read_number(data, offset, num_entries))
+		return false;
+
+	// Each entry is at least three empty strings ("0:"), so reject counts that cannot fit in the remaining data before allocating memory for them
+	if (num_entries > (data.size() - offset) / 6)
+		return false;
+
+	entries.resize(num_entries);
+
+	for (reshadefx::outline_entry &entry : entries)
+	{
+		uint32_t num_annotations = 0;
+		if (!read_string(data, offset, entry.name) ||
+			!read_string(data, offset, entry.type) ||
+			!read_number(data, offset, num_annotations))
+			return false;
+
+		// Each annotation is at least three empty strings as well
+		if (num_annotations > (data.size() - offset) / 6)
+			return false;
+
+		entry.annotations.resize(num_annotations);
+
+		for (reshadefx::annotation &annotation : entry.annotations)
+		{
+			uint32_t base = 0;
+			uint32_t rows = 0;
+			if (!read_number(data, offset, base) ||
+				!read_number(data, offset, rows) ||
+				!read_string(data, offset, annotation.name))
+				return false;
+
+			// Annotations can only be scalars, vectors or strings
+			if (base > reshadefx::type::t_string || rows > 4)
+				return false;
+
+			annotation.type.base = static_cast<reshadefx::type::datatype>(base);
+			annotation.type.rows = rows;
+			annotation.type.cols = 1;
+
+			if (annotation.type.base == reshadefx::type::t_string)
+			{
+				if (!read_string(data, offset, annotation.value.string_data))
+					return false;
+			}
+			else
+			{
+				for (unsigned int i = 0; i < annotation.type.rows && i < 16; ++i)
+					if (!read_number(data, offset, annotation.value.as_uint[i]))
+						return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+std::string reshadefx::serialize_effect_outline(const effect_outline &outline)
+{
+	std::string data = "outline1;";
+	write_entries(data, outline.techniques);
+	write_entries(data, outline.uniforms);
+	return data;
+}
+
+bool reshadefx::deserialize_effect_outline(const std::string &data, effect_outline &outline)
+{
+	if (data.compare(0, 9, "outline1;") != 0)
+		return false;
+
+	// Only replace the outline once all of it was read successfully, and reject trailing data too
+	effect_outline result;
+	size_t offset = 9;
+	if (!read_entries(data, offset, result.techniques) || !read_entries(data, offset, result.uniforms) || offset != data.size())
+		return false;
+
+	outline = std::move(result);
+	return true;
+}
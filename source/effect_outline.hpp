@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+#include <algorithm> // std::find_if
+
+namespace reshadefx
+{
+	/// <summary>
+	/// A technique or uniform variable declared in an effect, as found by <see cref="scan_effect_outline"/>.
+	/// </summary>
+	struct outline_entry
+	{
+		std::string name;
+		/// <summary>
+		/// Type name as written in the source (only set for uniform variables).
+		/// </summary>
+		std::string type;
+		std::vector<annotation> annotations;
+
+		auto annotation_as_int(const std::string_view ann_name, size_t i = 0, int default_value = 0) const
+		{
+			const auto it = std::find_if(annotations.cbegin(), annotations.cend(),
+				[ann_name](const annotation &annotation) { return annotation.name == ann_name; });
+			return it != annotations.cend() && i < 16 ?
+				(it->type.is_integral() ? it->value.as_int[i] : static_cast<int>(it->value.as_float[i])) : default_value;
+		}
+		auto annotation_as_string(const std::string_view ann_name, const std::string_view default_value = std::string_view()) const
+		{
+			const auto it = std::find_if(annotations.cbegin(), annotations.cend(),
+				[ann_name](const annotation &annotation) { return annotation.name == ann_name; });
+			return it != annotations.cend() ? std::string_view(it->value.string_data) : default_value;
+		}
+	};
+
+	/// <summary>
+	/// Lists the techniques and uniform variables an effect declares, without having compiled it.
+	/// </summary>
+	struct effect_outline
+	{
+		std::vector<outline_entry> techniques;
+		std::vector<outline_entry> uniforms;
+	};
+
+	/// <summary>
+	/// Performs a shallow scan over the tokens of preprocessed effect source code to find the techniques and uniform variables declared at global or namespace scope, together with their annotations.
+	/// This is much cheaper than running the parser and code generation, but does not validate the source and only understands literal annotation values (and vector constructors of literals).
+	/// </summary>
+	/// <param name="source">Preprocessed effect source code.</param>
+	effect_outline scan_effect_outline(const std::string &source);
+
+	/// <summary>
+	/// Serializes an effect outline into a compact string that can be stored in the effect cache.
+	/// </summary>
+	std::string serialize_effect_outline(const effect_outline &outline);
+	/// <summary>
+	/// Reads back an effect outline that was previously serialized with <see cref="serialize_effect_outline"/>.
+	/// </summary>
+	/// <returns><see langword="true"/> if the data was valid, <see langword="false"/> otherwise.</returns>
+	bool deserialize_effect_outline(const std::string &data, effect_outline &outline);
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "effect_pass_planner.hpp"
+#include <algorithm> // std::any_of, std::equal, std::find, std::find_if, std::none_of
+
+static bool contains(const std::vector<std::string> &names, const std::string &name)
+{
+	return std::find(names.cbegin(), names.cend(), name) != names.cend();
+}
+
+std::vector<reshadefx::pass_plan> reshadefx::plan_technique_passes(const effect_module &module, const technique &tech)
+{
+	std::vector<pass_plan> plans(tech.passes.size() + 1);
+
+	// Textures not in this list are in the shader resource state
+	std::vector<std::pair<std::string, texture_state>> current_states;
+	// Textures that were written by a previous pass and still need to have their mipmaps generated
+	std::vector<std::string> pending_mipmaps;
+
+	for (size_t pass_index = 0; pass_index <= tech.passes.size(); ++pass_index)
+	{
+		pass_plan &plan = plans[pass_index];
+
+		// The final entry behaves like a pass that reads all textures, so that everything is in a consistent state for the next technique
+		const bool is_final = pass_index == tech.passes.size();
+
+		std::vector<std::string> read_textures;
+		std::vector<std::string> written_textures;
+		texture_state write_state = texture_state::shader_resource;
+		bool generate_mipmaps = false;
+
+		if (!is_final)
+		{
+			const pass &pass = tech.passes[pass_index];
+
+			for (const texture_binding &binding : pass.texture_bindings)
+				if (const std::string &texture_name = module.samplers[binding.index].texture_name; !contains(read_textures, texture_name))
+					read_textures.push_back(texture_name);
+
+			for (int i = 0; i < 8 && !pass.render_target_names[i].empty(); ++i)
+				if (!contains(written_textures, pass.render_target_names[i]))
+					written_textures.push_back(pass.render_target_names[i]);
+			for (const storage_binding &binding : pass.storage_bindings)
+				if (const std::string &texture_name = module.storages[binding.index].texture_name; !contains(written_textures, texture_name))
+					written_textures.push_back(texture_name);
+
+			write_state = pass.cs_entry_point.empty() ? texture_state::render_target : texture_state::unordered_access;
+			generate_mipmaps = pass.generate_mipmaps;
+		}
+
+		const auto current_state = [&current_states](const std::string &texture_name) {
+			const auto it = std::find_if(current_states.cbegin(), current_states.cend(),
+				[&texture_name](const std::pair<std::string, texture_state> &state) { return state.first == texture_name; });
+			return it != current_states.cend() ? it->second : texture_state::shader_resource;
+		};
+		const auto set_current_state = [&current_states](const std::string &texture_name, texture_state new_state) {
+			const auto it = std::find_if(current_states.begin(), current_states.end(),
+				[&texture_name](const std::pair<std::string, texture_state> &state) { return state.first == texture_name; });
+			if (it == current_states.end())
+				current_states.emplace_back(texture_name, new_state);
+			else if (new_state == texture_state::shader_resource)
+				current_states.erase(it);
+			else
+				it->second = new_state;
+		};
+
+		// Generate mipmaps for textures that are about to be sampled, or that are about to be overwritten by a pass that does not generate mipmaps itself (to preserve the content of the lower levels)
+		for (auto it = pending_mipmaps.begin(); it != pending_mipmaps.end();)
+		{
+			const std::string &texture_name = *it;
+
+			if (is_final || contains(read_textures, texture_name) || (!generate_mipmaps && contains(written_textures, texture_name)))
+			{
+				// Mipmap generation requires the texture to be in the shader resource state
+				if (const texture_state old_state = current_state(texture_name);
+					old_state != texture_state::shader_resource)
+				{
+					plan.transitions_before_mipmaps.push_back({ texture_name, old_state, texture_state::shader_resource });
+					set_current_state(texture_name, texture_state::shader_resource);
+				}
+
+				plan.generate_mipmaps.push_back(texture_name);
+				it = pending_mipmaps.erase(it);
+			}
+			else if (contains(written_textures, texture_name))
+			{
+				// Texture is overwritten before anything sampled it, so can skip generating mipmaps for the previous content
+				it = pending_mipmaps.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		// Transition textures that are no longer written back to the shader resource state (textures that continue to be written by this pass can stay in their current state)
+		for (auto it = current_states.begin(); it != current_states.end();)
+		{
+			if (!contains(written_textures, it->first))
+			{
+				plan.transitions.push_back({ it->first, it->second, texture_state::shader_resource });
+				it = current_states.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		for (const std::string &texture_name : written_textures)
+		{
+			if (const texture_state old_state = current_state(texture_name);
+				old_state != write_state)
+			{
+				plan.transitions.push_back({ texture_name, old_state, write_state });
+				set_current_state(texture_name, write_state);
+			}
+			else if (write_state == texture_state::unordered_access)
+			{
+				// Texture stays in the unordered access state because the previous pass was a compute pass writing to it as well, so have to wait for those writes to finish before this pass accesses it (UAV barrier)
+				plan.transitions.push_back({ texture_name, old_state, write_state });
+			}
+
+			if (generate_mipmaps && !contains(pending_mipmaps, texture_name))
+			{
+				const auto texture = std::find_if(module.textures.cbegin(), module.textures.cend(),
+					[&texture_name](const reshadefx::texture &item) { return item.unique_name == texture_name; });
+				if (texture != module.textures.cend() && texture->levels > 1)
+					pending_mipmaps.push_back(texture_name);
+			}
+		}
+
+		// Can combine all transitions into a single batch if there is no mipmap generation in between
+		if (plan.generate_mipmaps.empty())
+		{
+			plan.transitions.insert(plan.transitions.begin(), plan.transitions_before_mipmaps.begin(), plan.transitions_before_mipmaps.end());
+			plan.transitions_before_mipmaps.clear();
+		}
+
+		if (pass_index == 0 || is_final)
+			continue;
+
+		const pass &pass = tech.passes[pass_index];
+		const reshadefx::pass &prev_pass = tech.passes[pass_index - 1];
+
+		// Generating mipmaps invalidates bindings, as does switching between compute and graphics
+		plan.bind_shared_tables = !plan.generate_mipmaps.empty() || pass.cs_entry_point.empty() != prev_pass.cs_entry_point.empty();
+
+		// Passes writing to the exact same render targets, without anything happening in between, can share a single render pass
+		plan.continue_render_pass =
+			pass.cs_entry_point.empty() && prev_pass.cs_entry_point.empty() &&
+			!pass.render_target_names[0].empty() && // Passes writing to the back buffer require it to be copied in between
+			std::equal(std::begin(pass.render_target_names), std::end(pass.render_target_names), std::begin(prev_pass.render_target_names)) &&
+			pass.srgb_write_enable == prev_pass.srgb_write_enable &&
+			pass.stencil_enable == prev_pass.stencil_enable &&
+			pass.viewport_width == prev_pass.viewport_width &&
+			pass.viewport_height == prev_pass.viewport_height &&
+			!pass.clear_render_targets &&
+			pass.storage_bindings.empty() && prev_pass.storage_bindings.empty() &&
+			plan.transitions_before_mipmaps.empty() && plan.generate_mipmaps.empty() && plan.transitions.empty() &&
+			std::none_of(read_textures.cbegin(), read_textures.cend(),
+				[&written_textures](const std::string &texture_name) { return contains(written_textures, texture_name); });
+	}
+
+	return plans;
+}
+
+bool reshadefx::is_transient_texture(const effect_module &module, const std::string &texture_name)
+{
+	const auto texture = std::find_if(module.textures.cbegin(), module.textures.cend(),
+		[&texture_name](const reshadefx::texture &item) { return item.unique_name == texture_name; });
+	if (texture == module.textures.cend() ||
+		texture->type != texture_type::texture_2d || !texture->semantic.empty() || !texture->render_target || texture->storage_access ||
+		std::any_of(texture->annotations.cbegin(), texture->annotations.cend(),
+			[](const annotation &annotation) { return annotation.name == "source"; }))
+		return false;
+
+	bool is_used = false;
+
+	for (const technique &tech : module.techniques)
+	{
+		bool is_written = false;
+
+		for (const pass &pass : tech.passes)
+		{
+			// Storage writes may not cover the whole texture
+			if (std::any_of(pass.storage_bindings.cbegin(), pass.storage_bindings.cend(),
+					[&module, &texture_name](const storage_binding &binding) { return module.storages[binding.index].texture_name == texture_name; }))
+				return false;
+
+			// Sampling from the texture before it was written in this technique means the contents from a previous technique or frame are used
+			if (!is_written && std::any_of(pass.texture_bindings.cbegin(), pass.texture_bindings.cend(),
+					[&module, &texture_name](const texture_binding &binding) { return module.samplers[binding.index].texture_name == texture_name; }))
+				return false;
+
+			for (int i = 0; i < 8 && !pass.render_target_names[i].empty(); ++i)
+			{
+				if (is_written || pass.render_target_names[i] != texture_name)
+					continue;
+
+				// The first write has to overwrite the whole texture, without depending on its previous contents
+				// Whether a pass covers every pixel depends on the shader code too (which may discard pixels or output a partial primitive), so only passes that clear their render targets first are accepted, which also makes blending, write masks and stencil testing irrelevant
+				if (!pass.clear_render_targets)
+					return false;
+				// Lower mipmap levels keep their previous contents unless they are generated from the new contents
+				if (texture->levels > 1 && !pass.generate_mipmaps)
+					return false;
+
+				is_written = true;
+				is_used = true;
+			}
+		}
+	}
+
+	return is_used;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+
+namespace reshadefx
+{
+	/// <summary>
+	/// State a texture has to be in to be accessed by a pass.
+	/// </summary>
+	enum class texture_state
+	{
+		shader_resource,
+		render_target,
+		unordered_access
+	};
+
+	/// <summary>
+	/// Describes the state transition of a texture between passes.
+	/// A transition from <see cref="texture_state::unordered_access"/> to <see cref="texture_state::unordered_access"/> describes a barrier between unordered access writes and later accesses.
+	/// </summary>
+	struct texture_transition
+	{
+		std::string texture_name;
+		texture_state old_state = texture_state::shader_resource;
+		texture_state new_state = texture_state::shader_resource;
+	};
+
+	/// <summary>
+	/// Describes the work that has to be done before executing a pass of a technique.
+	/// </summary>
+	struct pass_plan
+	{
+		/// <summary>
+		/// Transitions that have to happen before mipmaps are generated (in a single batch).
+		/// </summary>
+		std::vector<texture_transition> transitions_before_mipmaps;
+		/// <summary>
+		/// Unique names of the textures that have to have their mipmaps generated.
+		/// This is deferred until right before a pass actually samples a texture, so that generation can be skipped if a texture is overwritten again in the meantime.
+		/// </summary>
+		std::vector<std::string> generate_mipmaps;
+		/// <summary>
+		/// Transitions that have to happen before the pass is executed (in a single batch).
+		/// </summary>
+		std::vector<texture_transition> transitions;
+		/// <summary>
+		/// Set to <see langword="true"/> when descriptor tables shared by all passes of a technique have to be bound again before the pass.
+		/// </summary>
+		bool bind_shared_tables = true;
+		/// <summary>
+		/// Set to <see langword="true"/> when the pass can continue the render pass of the previous pass, instead of ending it and beginning a new one.
+		/// </summary>
+		bool continue_render_pass = false;
+	};
+
+	/// <summary>
+	/// Analyzes which textures the passes of a technique read from and write to, to compute the minimal set of state transitions and mipmap generation required to execute them.
+	/// </summary>
+	/// <param name="module">Effect module the technique belongs to.</param>
+	/// <param name="tech">Technique to plan.</param>
+	/// <returns>List with one entry per pass, plus a final entry describing the work that has to be done after the last pass (which returns all textures to the shader resource state).</returns>
+	std::vector<pass_plan> plan_technique_passes(const effect_module &module, const technique &tech);
+
+	/// <summary>
+	/// Checks whether the contents of the specified texture only live within a single technique.
+	/// This is the case if every technique using the texture clears it in the first pass writing to it and does not sample from it before, so its contents never have to be preserved between techniques (or frames) and its memory can be shared with other textures.
+	/// </summary>
+	/// <param name="module">Effect module the texture belongs to.</param>
+	/// <param name="texture_name">Unique name of the texture to check.</param>
+	bool is_transient_texture(const effect_module &module, const std::string &texture_name);
+}
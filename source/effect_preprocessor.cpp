@@ -1217,6 +1217,8 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 		}
 	}
 
+	_expanded_macros.insert(macro_it->first);
+
 	expand_macro(macro_it->first, macro_it->second, arguments);
 
 	return true;
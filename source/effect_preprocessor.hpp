@@ -88,6 +88,11 @@ namespace reshadefx
 		/// Gets a list of all defines that were used in #ifdef and #ifndef lines.
 		/// </summary>
 		std::vector<std::pair<std::string, std::string>> used_macro_definitions() const;
+		/// <summary>
+		/// Checks whether the specified macro was expanded at least once, either in code or in a #if expression.
+		/// </summary>
+		/// <param name="name">Name of the macro to check.</param>
+		bool is_macro_expanded(const std::string &name) const { return _expanded_macros.find(name) != _expanded_macros.end(); }
 
 		/// <summary>
 		/// Gets a list of "#pragma reshade" directives that where used.
@@ -153,6 +158,7 @@ namespace reshadefx
 
 		unsigned short _recursion_count = 0;
 		std::unordered_set<std::string> _used_macros;
+		std::unordered_set<std::string> _expanded_macros;
 		std::unordered_map<std::string, macro> _macros;
 
 		std::vector<if_level> _if_stack;
@@ -4,15 +4,168 @@
  */
 
 #include "ini_file.hpp"
+#include <Windows.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
 #include <shared_mutex>
+#include <condition_variable>
 #include <cctype> // std::toupper
 #include <cassert>
-#include <algorithm> // std::min, std::sort, std::transform
+#include <algorithm> // std::count, std::find_if, std::min, std::sort, std::transform
 #include <utf8/core.h>
 
 static std::shared_mutex s_ini_cache_mutex;
 static std::unordered_map<std::wstring, std::unique_ptr<reshade::ini_file>> s_ini_cache;
 
+struct pending_save
+{
+	std::filesystem::path path;
+	std::string data;
+	std::filesystem::file_time_type modified_at;
+};
+
+// Queue of INI files to be written on a background thread, so that the thread saving them does not have to wait on file I/O
+static std::mutex s_save_queue_mutex;
+static std::condition_variable s_save_queue_idle;
+static std::deque<pending_save> s_save_queue;
+static std::vector<std::pair<std::filesystem::path, std::filesystem::file_time_type>> s_completed_saves;
+static std::vector<std::filesystem::path> s_failed_saves;
+static bool s_save_thread_running = false;
+static std::atomic<bool> s_save_failed = false;
+
+// Sharing and lock violations only last until whoever has the file open (e.g. a text editor or a virus scanner) closes it again, any other error is not going to go away by trying again
+static bool is_transient_error(unsigned long error)
+{
+	return error == ERROR_SHARING_VIOLATION || error == ERROR_LOCK_VIOLATION;
+}
+
+static bool write_ini_file_once(const std::filesystem::path &path, const std::string &data, unsigned long &error)
+{
+	// Write to a temporary file first and then replace the actual file with it, so that it is never left partially written (e.g. when the application crashes during the write)
+	std::filesystem::path temp_path = path;
+	temp_path += L".tmp";
+
+	FILE *const file = _wfsopen(temp_path.c_str(), L"wb", SH_DENYWR);
+	if (file == nullptr)
+	{
+		error = _doserrno;
+		return false;
+	}
+	const size_t file_size_written = fwrite(data.data(), 1, data.size(), file);
+	const bool file_flushed = fflush(file) == 0;
+	fclose(file);
+
+	std::error_code ec;
+	if (file_size_written != data.size() || !file_flushed)
+	{
+		error = ERROR_WRITE_FAULT;
+		std::filesystem::remove(temp_path, ec);
+		return false;
+	}
+
+	std::filesystem::rename(temp_path, path, ec);
+	if (ec)
+	{
+		error = static_cast<unsigned long>(ec.value());
+		std::filesystem::remove(temp_path, ec);
+		return false;
+	}
+
+	return true;
+}
+
+static bool write_ini_file(const std::filesystem::path &path, const std::string &data, std::filesystem::file_time_type &modified_at, bool &retry)
+{
+	retry = false;
+
+	std::error_code ec;
+	if (const std::filesystem::file_time_type file_modified_at = std::filesystem::last_write_time(path, ec);
+		!ec && (file_modified_at - modified_at) > std::chrono::seconds(2))
+		return false; // File exists and was modified on disk and therefore may have different data, so cannot save
+
+	// Back off exponentially while the file is locked, but give up after a few attempts so that the background thread does not stall the queue, in which case the changes stay in memory and are saved again on a later flush
+	constexpr unsigned int max_attempts = 5;
+	for (unsigned int attempt = 1; true; ++attempt)
+	{
+		unsigned long error = ERROR_SUCCESS;
+		if (write_ini_file_once(path, data, error))
+			break;
+
+		if (!is_transient_error(error))
+			return false;
+
+		if (attempt == max_attempts)
+		{
+			retry = true;
+			return false;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(10 << attempt));
+	}
+
+	modified_at = std::filesystem::last_write_time(path, ec);
+
+	assert(!ec && std::filesystem::file_size(path, ec) > 0);
+
+	return true;
+}
+
+static void queue_save(const std::filesystem::path &path, std::string &&data, std::filesystem::file_time_type modified_at)
+{
+	const std::unique_lock<std::mutex> lock(s_save_queue_mutex);
+
+	// Coalesce with a save of the same file that did not start yet
+	if (const auto it = std::find_if(s_save_queue.begin(), s_save_queue.end(), [&path](const pending_save &save) { return save.path == path; });
+		it != s_save_queue.end())
+	{
+		it->data = std::move(data);
+		it->modified_at = modified_at;
+		return;
+	}
+
+	s_save_queue.push_back({ path, std::move(data), modified_at });
+
+	if (s_save_thread_running)
+		return;
+
+	// Thread exits again once the queue is empty, so that it does not have to be managed across module unload (the queue is drained before the runtime shuts down via 'wait_for_pending_saves')
+	s_save_thread_running = true;
+	std::thread([]() {
+		std::unique_lock<std::mutex> lock(s_save_queue_mutex);
+
+		while (!s_save_queue.empty())
+		{
+			pending_save save = std::move(s_save_queue.front());
+			s_save_queue.pop_front();
+
+			lock.unlock();
+
+			bool retry = false;
+			const bool success = write_ini_file(save.path, save.data, save.modified_at, retry);
+
+			lock.lock();
+
+			if (success)
+			{
+				s_completed_saves.emplace_back(std::move(save.path), save.modified_at);
+			}
+			else
+			{
+				s_save_failed = true;
+
+				// Mark file as modified again in 'flush_cache', so that it is saved again later
+				if (retry)
+					s_failed_saves.push_back(std::move(save.path));
+			}
+		}
+
+		s_save_thread_running = false;
+		s_save_queue_idle.notify_all();
+	}).detach();
+}
+
 reshade::ini_file &reshade::global_config()
 {
 	return ini_file::load_cache(g_reshade_base_path / L"ReShade.ini");
@@ -32,31 +185,43 @@ bool reshade::ini_file::load()
 
 	// Clear when file does not exist too
 	_sections.clear();
+	_serialized_sections.clear();
 
-	FILE *const file = _wfsopen(_path.c_str(), L"r", SH_DENYWR);
+	FILE *const file = _wfsopen(_path.c_str(), L"rb", SH_DENYWR);
 	if (file == nullptr)
 		return false;
 
 	_modified = false;
 	_modified_at = modified_at;
 
-	// Remove BOM (0xefbbbf means 0xfeff)
-	if (fgetc(file) != utf8::bom[0] || fgetc(file) != utf8::bom[1] || fgetc(file) != utf8::bom[2])
-		fseek(file, 0, SEEK_SET);
-
-	std::string line_data, section;
-	line_data.resize(BUFSIZ);
-	while (fgets(line_data.data(), static_cast<int>(line_data.size() + 1), file))
+	// Read the entire file in one go and parse it in place, instead of copying it line by line
+	std::string data;
+	if (fseek(file, 0, SEEK_END) == 0)
 	{
-		size_t line_length;
-		while ((line_length = std::strlen(line_data.data())) == line_data.size() && line_data.back() != '\n')
+		if (const long file_size = ftell(file); file_size > 0 && fseek(file, 0, SEEK_SET) == 0)
 		{
-			line_data.resize(line_data.size() + BUFSIZ);
-			if (!fgets(line_data.data() + line_length, static_cast<int>(line_data.size() - line_length + 1), file))
-				break;
+			data.resize(static_cast<size_t>(file_size));
+			data.resize(fread(data.data(), 1, data.size(), file));
 		}
+	}
 
-		const std::string_view line = trim(std::string_view(line_data.data(), line_length), " \t\r\n");
+	fclose(file);
+
+	std::string_view remaining = data;
+
+	// Remove BOM (0xefbbbf means 0xfeff)
+	if (utf8::starts_with_bom(remaining.cbegin(), remaining.cend()))
+		remaining.remove_prefix(std::size(utf8::bom));
+
+	std::string_view section_name;
+	// Look up section only once for all its keys, and only create it once it has a key
+	section_type *section = nullptr;
+
+	while (!remaining.empty())
+	{
+		const size_t line_length = std::min<size_t>(remaining.find('\n'), remaining.size());
+		const std::string_view line = trim(remaining.substr(0, line_length), " \t\r\n");
+		remaining.remove_prefix(std::min<size_t>(line_length + 1, remaining.size()));
 
 		if (line.empty() || line[0] == ';' || line[0] == '/' || line[0] == '#')
 			continue;
@@ -64,10 +229,20 @@ bool reshade::ini_file::load()
 		// Read section name
 		if (line[0] == '[')
 		{
-			section = trim(line.substr(0, line.find(']')), " \t[]");
+			section_name = trim(line.substr(0, line.find(']')), " \t[]");
+			section = nullptr;
 			continue;
 		}
 
+		// Only allocate a string for the section name when it is seen for the first time
+		if (section == nullptr)
+		{
+			auto it = _sections.find(section_name);
+			if (it == _sections.end())
+				it = _sections.emplace(section_name, section_type()).first;
+			section = &it->second;
+		}
+
 		// Read section content
 		const size_t assign_index = line.find('=');
 		if (assign_index != std::string::npos)
@@ -75,63 +250,75 @@ bool reshade::ini_file::load()
 			const std::string_view key = trim(line.substr(0, assign_index));
 			const std::string_view value = trim(line.substr(assign_index + 1));
 
+			// Append to key if it already exists
+			auto it = section->find(key);
+			if (it == section->end())
+				it = section->emplace(key, value_type()).first;
+
 			if (value.empty())
-			{
-				_sections[section].insert({ std::string(key), {} });
 				continue;
-			}
 
-			// Append to key if it already exists
-			ini_file::value_type &elements = _sections[section][std::string(key)];
+			ini_file::value_type &elements = it->second;
+			// Reserve for the common case of no escaped commas, so that the element list is only allocated once
+			elements.reserve(elements.size() + std::count(value.begin(), value.end(), ',') + 1);
 			for (size_t offset = 0, base = 0, len = value.size(); offset <= len;)
 			{
 				// Treat ",," as an escaped comma and only split on single ","
-				const size_t found = std::min(value.find(',', offset), len);
+				const size_t found = std::min<size_t>(value.find(',', offset), len);
 				if (found + 1 < len && value[found + 1] == ',')
 				{
 					offset = found + 2;
 				}
 				else
 				{
-					std::string &element = elements.emplace_back();
-					element.reserve(found - base);
+					const std::string_view element = value.substr(base, found - base);
 
-					while (base < found)
+					// Most elements contain no escape sequences, so can be copied as a whole
+					if (element.find(",,") == std::string_view::npos)
+					{
+						elements.emplace_back(element);
+					}
+					else
 					{
-						const char c = value[base++];
-						element += c;
+						std::string &unescaped_element = elements.emplace_back();
+						unescaped_element.reserve(element.size());
+
+						for (size_t i = 0; i < element.size(); ++i)
+						{
+							unescaped_element += element[i];
 
-						if (c == ',' && base < found && value[base] == ',')
-							base++; // Skip second comma in a ",," escape sequence
+							if (element[i] == ',' && i + 1 < element.size() && element[i + 1] == ',')
+								i++; // Skip second comma in a ",," escape sequence
+						}
 					}
 
 					offset = base = found + 1;
 				}
 			}
 		}
-		else
+		else if (section->find(line) == section->end())
 		{
-			_sections[section].insert({ std::string(line), {} });
+			section->emplace(line, value_type());
 		}
 	}
 
-	fclose(file);
+	// Only change revision once the file was parsed, so that users of the cached values only update them after new values are available
+	_revision++;
 
 	return true;
 }
-bool reshade::ini_file::save()
+void reshade::ini_file::save()
 {
 	if (!_modified)
-		return true;
+		return;
 
-	// Reset state even on failure to avoid 'flush_cache' repeatedly trying and failing to save
 	_modified = false;
 
-	std::error_code ec;
-	const std::filesystem::file_time_type modified_at = std::filesystem::last_write_time(_path, ec);
-	if (!ec && (modified_at - _modified_at) > std::chrono::seconds(2))
-		return false; // File exists and was modified on disk and therefore may have different data, so cannot save
-
+	// Write on the background thread as well, which also ensures that this cannot race with a pending background save of this file, since the queue is processed in order
+	queue_save(_path, serialize(), _modified_at);
+}
+std::string reshade::ini_file::serialize()
+{
 	std::string data;
 	std::vector<std::string> section_names, key_names;
 
@@ -149,89 +336,111 @@ bool reshade::ini_file::save()
 
 	for (const std::string &section_name : section_names)
 	{
-		if (const section_type &keys = _sections.at(section_name); !keys.empty())
+		const section_type &keys = _sections.at(section_name);
+		if (keys.empty())
+			continue;
+
+		// Reuse text of sections that were not modified since the last save
+		if (const auto it = _serialized_sections.find(section_name); it != _serialized_sections.end())
 		{
-			key_names.clear();
-			key_names.reserve(keys.size());
-			for (const std::pair<const std::string, value_type> &key : keys)
-				key_names.push_back(key.first);
-
-			std::sort(key_names.begin(), key_names.end(),
-				[](std::string a, std::string b) {
-					std::transform(a.begin(), a.end(), a.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(std::toupper(c)); });
-					std::transform(b.begin(), b.end(), b.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(std::toupper(c)); });
-					return a < b;
-				});
-
-			// Empty section should have been sorted to the top, so do not need to append it before keys
-			if (!section_name.empty())
-				data += '[' + section_name + ']' + '\n';
-
-			for (const std::string &key_name : key_names)
-			{
-				data += key_name + '=';
+			data += it->second;
+			continue;
+		}
 
-				if (const ini_file::value_type &elements = keys.at(key_name); !elements.empty())
-				{
-					std::string value;
-					for (const std::string &element : elements)
-					{
-						// Empty elements mess with escaped commas, so simply skip them
-						if (element.empty())
-							continue;
-
-						value.reserve(value.size() + element.size() + 1);
-						for (const char c : element)
-							value.append(c == ',' ? 2 : 1, c);
-						value += ','; // Separate multiple values with a comma
-					}
+		std::string section_data;
 
-					// Remove the last comma
-					if (!value.empty())
-					{
-						assert(value.back() == ',');
-						value.pop_back();
-					}
+		key_names.clear();
+		key_names.reserve(keys.size());
+		for (const std::pair<const std::string, value_type> &key : keys)
+			key_names.push_back(key.first);
 
-					data += value;
+		std::sort(key_names.begin(), key_names.end(),
+			[](std::string a, std::string b) {
+				std::transform(a.begin(), a.end(), a.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(std::toupper(c)); });
+				std::transform(b.begin(), b.end(), b.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(std::toupper(c)); });
+				return a < b;
+			});
+
+		// Empty section should have been sorted to the top, so do not need to append it before keys
+		if (!section_name.empty())
+			section_data += '[' + section_name + ']' + '\n';
+
+		for (const std::string &key_name : key_names)
+		{
+			section_data += key_name + '=';
+
+			if (const ini_file::value_type &elements = keys.at(key_name); !elements.empty())
+			{
+				std::string value;
+				for (const std::string &element : elements)
+				{
+					// Empty elements mess with escaped commas, so simply skip them
+					if (element.empty())
+						continue;
+
+					value.reserve(value.size() + element.size() + 1);
+					for (const char c : element)
+						value.append(c == ',' ? 2 : 1, c);
+					value += ','; // Separate multiple values with a comma
+				}
+
+				// Remove the last comma
+				if (!value.empty())
+				{
+					assert(value.back() == ',');
+					value.pop_back();
 				}
 
-				data += '\n';
+				section_data += value;
 			}
 
-			data += '\n';
+			section_data += '\n';
 		}
-	}
 
-	FILE *const file = _wfsopen(_path.c_str(), L"w", SH_DENYWR);
-	if (file == nullptr)
-		return false;
-	const size_t file_size_written = fwrite(data.data(), 1, data.size(), file);
-	fclose(file);
-	if (file_size_written != data.size())
-		return false;
-
-	// Flush stream to disk before updating last write time
-	_modified_at = std::filesystem::last_write_time(_path, ec);
+		section_data += '\n';
 
-	assert(!ec && std::filesystem::file_size(_path, ec) > 0);
+		data += section_data;
+		_serialized_sections.emplace(section_name, std::move(section_data));
+	}
 
-	return true;
+	return data;
 }
 
 bool reshade::ini_file::flush_cache()
 {
-	bool success = true;
-
 	const std::shared_lock<std::shared_mutex> lock(s_ini_cache_mutex);
 
-	// Save all files that were modified in one second intervals
+	// Update last write time of files that finished saving in the background, so that they are not loaded again unnecessarily
+	std::vector<std::pair<std::filesystem::path, std::filesystem::file_time_type>> completed_saves;
+	std::vector<std::filesystem::path> failed_saves;
+	{
+		const std::unique_lock<std::mutex> save_queue_lock(s_save_queue_mutex);
+		completed_saves.swap(s_completed_saves);
+		failed_saves.swap(s_failed_saves);
+	}
+
+	for (const std::pair<std::filesystem::path, std::filesystem::file_time_type> &completed_save : completed_saves)
+		if (const auto it = s_ini_cache.find(completed_save.first); it != s_ini_cache.end() && !it->second->_modified)
+			it->second->_modified_at = completed_save.second;
+
+	// Files that failed to save still have their changes in memory, so mark them as modified again to try again later
+	for (const std::filesystem::path &failed_save : failed_saves)
+		if (const auto it = s_ini_cache.find(failed_save); it != s_ini_cache.end())
+			it->second->_modified = true;
+
+	// Save all files that were not modified for at least one second, so that repeated changes (e.g. while dragging a slider) are coalesced into a single save
 	for (auto &file : s_ini_cache)
+	{
 		// Check modified status before requesting file time, since the latter is costly and therefore should be avoided when not necessary
 		if (file.second->_modified && (std::filesystem::file_time_type::clock::now() - file.second->_modified_at) > std::chrono::seconds(1))
-			success &= file.second->save();
+		{
+			file.second->_modified = false;
 
-	return success;
+			queue_save(file.second->_path, file.second->serialize(), file.second->_modified_at);
+		}
+	}
+
+	return !s_save_failed.exchange(false);
 }
 bool reshade::ini_file::flush_cache(const std::filesystem::path &path)
 {
@@ -240,7 +449,17 @@ bool reshade::ini_file::flush_cache(const std::filesystem::path &path)
 	const std::shared_lock<std::shared_mutex> lock(s_ini_cache_mutex);
 
 	const auto it = s_ini_cache.find(path);
-	return it != s_ini_cache.end() && it->second->save();
+	if (it == s_ini_cache.end())
+		return false;
+
+	it->second->save();
+	return true;
+}
+
+void reshade::ini_file::wait_for_pending_saves()
+{
+	std::unique_lock<std::mutex> lock(s_save_queue_mutex);
+	s_save_queue_idle.wait(lock, []() { return !s_save_thread_running; });
 }
 
 void reshade::ini_file::clear_cache()
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <map>
 #include <string>
 #include <vector>
 #include <filesystem>
@@ -36,10 +37,15 @@ namespace reshade
 		/// </summary>
 		const std::filesystem::path &path() const { return _path; }
 
+		/// <summary>
+		/// Gets a number that changes whenever the data in this INI file changes (either by loading it again or modifying values).
+		/// </summary>
+		uint64_t revision() const { return _revision; }
+
 		/// <summary>
 		/// Checks whether the specified <paramref name="section"/> and <paramref name="key"/> currently exist in the INI.
 		/// </summary>
-		bool has(const std::string &section, const std::string &key) const
+		bool has(std::string_view section, std::string_view key) const
 		{
 			const auto it1 = _sections.find(section);
 			if (it1 == _sections.end())
@@ -56,7 +62,7 @@ namespace reshade
 		/// <param name="value">Reference filled with the data of this INI entry.</param>
 		/// <returns><see langword="true"/> if the key exists, <see langword="false"/> otherwise.</returns>
 		template <typename T>
-		bool get(const std::string &section, const std::string &key, T &value) const
+		bool get(std::string_view section, std::string_view key, T &value) const
 		{
 			const auto it1 = _sections.find(section);
 			if (it1 == _sections.end())
@@ -68,7 +74,7 @@ namespace reshade
 			return true;
 		}
 		template <typename T, size_t SIZE>
-		bool get(const std::string &section, const std::string &key, T(&values)[SIZE]) const
+		bool get(std::string_view section, std::string_view key, T(&values)[SIZE]) const
 		{
 			const auto it1 = _sections.find(section);
 			if (it1 == _sections.end())
@@ -81,7 +87,7 @@ namespace reshade
 			return true;
 		}
 		template <typename T>
-		bool get(const std::string &section, const std::string &key, std::vector<T> &values) const
+		bool get(std::string_view section, std::string_view key, std::vector<T> &values) const
 		{
 			const auto it1 = _sections.find(section);
 			if (it1 == _sections.end())
@@ -95,7 +101,7 @@ namespace reshade
 			return true;
 		}
 		template <>
-		bool get(const std::string &section, const std::string &key, std::vector<std::pair<std::string, std::string>> &values) const
+		bool get(std::string_view section, std::string_view key, std::vector<std::pair<std::string, std::string>> &values) const
 		{
 			const auto it1 = _sections.find(section);
 			if (it1 == _sections.end())
@@ -120,7 +126,7 @@ namespace reshade
 		/// Returns <see langword="true"/> only if the specified <paramref name="section"/> and <paramref name="key"/> exists and is not zero.
 		/// </summary>
 		/// <returns><see langword="true"/> if the key exists and is not zero, <see langword="false"/> otherwise.</returns>
-		bool get(const std::string &section, const std::string &key) const
+		bool get(std::string_view section, std::string_view key) const
 		{
 			bool value = false;
 			return get<bool>(section, key, value) && value;
@@ -143,18 +149,11 @@ namespace reshade
 		template <>
 		void set(const std::string &section, const std::string &key, const std::string &value)
 		{
-			auto &v = _sections[section][key];
-			v.assign(1, value);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			set_value(section, key, value_type(1, value));
 		}
 		void set(const std::string &section, const std::string &key, std::string &&value)
 		{
-			auto &v = _sections[section][key];
-			v.resize(1);
-			v[0] = std::forward<std::string>(value);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			set_value(section, key, value_type(1, std::forward<std::string>(value)));
 		}
 		template <>
 		void set(const std::string &section, const std::string &key, const std::filesystem::path &value)
@@ -164,43 +163,32 @@ namespace reshade
 		template <typename T, size_t SIZE>
 		void set(const std::string &section, const std::string &key, const T(&values)[SIZE], const size_t size = SIZE)
 		{
-			auto &v = _sections[section][key];
-			v.resize(size);
+			value_type v(size);
 			for (size_t i = 0; i < size; ++i)
 				v[i] = std::to_string(values[i]);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			set_value(section, key, std::move(v));
 		}
 		template <typename T>
 		void set(const std::string &section, const std::string &key, const std::vector<T> &values)
 		{
-			auto &v = _sections[section][key];
-			v.resize(values.size());
+			value_type v(values.size());
 			for (size_t i = 0; i < values.size(); ++i)
 				v[i] = std::to_string(values[i]);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			set_value(section, key, std::move(v));
 		}
 		template <>
 		void set(const std::string &section, const std::string &key, const std::vector<std::string> &values)
 		{
-			auto &v = _sections[section][key];
-			v = values;
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			set_value(section, key, value_type(values));
 		}
 		void set(const std::string &section, const std::string &key, std::vector<std::string> &&values)
 		{
-			auto &v = _sections[section][key];
-			v = std::forward<std::vector<std::string>>(values);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			set_value(section, key, std::forward<std::vector<std::string>>(values));
 		}
 		template <>
 		void set(const std::string &section, const std::string &key, const std::vector<std::pair<std::string, std::string>> &values)
 		{
-			auto &v = _sections[section][key];
-			v.resize(values.size());
+			value_type v(values.size());
 			for (size_t i = 0; i < values.size(); ++i)
 			{
 				const std::pair<std::string, std::string> &value = values[i];
@@ -208,18 +196,15 @@ namespace reshade
 				if (!value.second.empty())
 					v[i] += '=' + value.second;
 			}
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			set_value(section, key, std::move(v));
 		}
 		template <>
 		void set(const std::string &section, const std::string &key, const std::vector<std::filesystem::path> &values)
 		{
-			auto &v = _sections[section][key];
-			v.resize(values.size());
+			value_type v(values.size());
 			for (size_t i = 0; i < values.size(); ++i)
 				v[i] = values[i].u8string();
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			set_value(section, key, std::move(v));
 		}
 
 		/// <summary>
@@ -228,6 +213,8 @@ namespace reshade
 		void clear()
 		{
 			_sections.clear();
+			_serialized_sections.clear();
+			_revision++;
 			_modified = true;
 			_modified_at = std::filesystem::file_time_type::clock::now();
 		}
@@ -235,7 +222,7 @@ namespace reshade
 		/// <summary>
 		/// Removes the specified <paramref name="key"/> from the <paramref name="section"/>.
 		/// </summary>
-		void remove_key(const std::string &section, const std::string &key)
+		void remove_key(std::string_view section, std::string_view key)
 		{
 			const auto it1 = _sections.find(section);
 			if (it1 == _sections.end())
@@ -244,8 +231,7 @@ namespace reshade
 			if (it2 == it1->second.end())
 				return;
 			it1->second.erase(it2);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			mark_modified(section);
 		}
 
 		/// <summary>
@@ -254,14 +240,26 @@ namespace reshade
 		bool load();
 		/// <summary>
 		/// Saves all changes to this INI file to disk.
+		/// Only serializes the changes on the calling thread, the file is written on a background thread (see <see cref="wait_for_pending_saves"/>).
+		/// Whether that write succeeded is only known later, so failures are reported by <see cref="flush_cache"/> instead.
 		/// </summary>
-		bool save();
+		void save();
 
 		/// <summary>
-		/// Saves all changes to INI files that were loaded through <see cref="load_cache"/> to disk.
+		/// Saves all changes to INI files that were loaded through <see cref="load_cache"/> to disk, once they have not been modified for a second.
+		/// Only serializes the changes on the calling thread, the files are written on a background thread.
 		/// </summary>
+		/// <returns><see langword="false"/> if a previous background save failed, <see langword="true"/> otherwise.</returns>
 		static bool flush_cache();
+		/// <summary>
+		/// Saves all changes to the specified INI file that was loaded through <see cref="load_cache"/> to disk immediately, without waiting for them to be written.
+		/// </summary>
+		/// <returns><see langword="true"/> if the file was found in the cache, <see langword="false"/> otherwise.</returns>
 		static bool flush_cache(const std::filesystem::path &path);
+		/// <summary>
+		/// Waits for all INI files that are being saved on the background thread to be written to disk.
+		/// </summary>
+		static void wait_for_pending_saves();
 
 		/// <summary>
 		/// Removes all INI files from cache, without saving changes.
@@ -348,11 +346,36 @@ namespace reshade
 		using value_type = std::vector<std::string>;
 		/// <summary>
 		/// Describes a section of multiple key/value pairs in an INI file.
+		/// Uses a transparent comparator, so that lookups can be done with a string view and do not have to allocate a temporary string.
 		/// </summary>
-		using section_type = std::unordered_map<std::string, value_type>;
+		using section_type = std::map<std::string, value_type, std::less<>>;
+
+		void set_value(const std::string &section, const std::string &key, value_type &&value)
+		{
+			section_type &keys = _sections[section];
+			// Avoid saving the file again when nothing actually changed (e.g. when the same preset values are written repeatedly)
+			if (const auto it = keys.find(key); it != keys.end() && it->second == value)
+				return;
+			keys[key] = std::move(value);
+			mark_modified(section);
+		}
+
+		void mark_modified(std::string_view section)
+		{
+			if (const auto it = _serialized_sections.find(section); it != _serialized_sections.end())
+				_serialized_sections.erase(it);
+			_revision++;
+			_modified = true;
+			_modified_at = std::filesystem::file_time_type::clock::now();
+		}
+
+		std::string serialize();
 
 		const std::filesystem::path _path;
-		std::unordered_map<std::string, section_type> _sections;
+		std::map<std::string, section_type, std::less<>> _sections;
+		// Text of sections that were not modified since they were last saved, so that only modified sections have to be serialized again
+		std::map<std::string, std::string, std::less<>> _serialized_sections;
+		uint64_t _revision = 0;
 		bool _modified = false;
 		std::filesystem::file_time_type _modified_at;
 	};
@@ -350,7 +350,7 @@ static void update_framebuffer_object(GLenum target, GLuint framebuffer = 0)
 	const reshade::api::resource_view default_attachment = device->get_framebuffer_attachment(framebuffer, GL_COLOR, 0);
 	g_opengl_context->update_current_window_height(default_attachment);
 
-	if (!reshade::has_addon_event<reshade::addon_event::bind_render_targets_and_depth_stencil>())
+	if (!reshade::has_addon_event<reshade::addon_event::bind_render_targets_and_depth_stencil>() && !reshade::has_addon_event<reshade::addon_event::draw_batch>())
 		return;
 
 	uint32_t count = 0;
@@ -1202,7 +1202,7 @@ extern "C" void APIENTRY glViewport(GLint x, GLint y, GLsizei width, GLsizei hei
 
 #if RESHADE_ADDON
 	if (g_opengl_context &&
-		reshade::has_addon_event<reshade::addon_event::bind_viewports>())
+		(reshade::has_addon_event<reshade::addon_event::bind_viewports>() || reshade::has_addon_event<reshade::addon_event::draw_batch>()))
 	{
 		const reshade::api::viewport viewport_data = {
 			static_cast<float>(x),
@@ -3460,7 +3460,7 @@ void APIENTRY glViewportArrayv(GLuint first, GLsizei count, const GLfloat *v)
 
 #if RESHADE_ADDON
 	if (g_opengl_context &&
-		reshade::has_addon_event<reshade::addon_event::bind_viewports>())
+		(reshade::has_addon_event<reshade::addon_event::bind_viewports>() || reshade::has_addon_event<reshade::addon_event::draw_batch>()))
 	{
 		temp_mem<reshade::api::viewport> viewport_data(count);
 		for (GLsizei i = 0; i < count; ++i, v += 4)
@@ -3484,7 +3484,7 @@ void APIENTRY glViewportIndexedf(GLuint index, GLfloat x, GLfloat y, GLfloat w,
 
 #if RESHADE_ADDON
 	if (g_opengl_context &&
-		reshade::has_addon_event<reshade::addon_event::bind_viewports>())
+		(reshade::has_addon_event<reshade::addon_event::bind_viewports>() || reshade::has_addon_event<reshade::addon_event::draw_batch>()))
 	{
 		const reshade::api::viewport viewport_data = { x, y, w, h, 0.0f, 1.0f };
 
@@ -8,6 +8,7 @@
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
 #include "effect_preprocessor.hpp"
+#include "effect_pass_planner.hpp"
 #include "version.h"
 #include "dll_log.hpp"
 #include "dll_resources.hpp"
@@ -27,7 +28,7 @@
 #include <cstdlib> // std::malloc, std::rand, std::strtod, std::strtol
 #include <cstring> // std::memcpy, std::memset, std::strlen
 #include <charconv> // std::to_chars
-#include <algorithm> // std::all_of, std::copy_n, std::equal, std::fill_n, std::find, std::find_if, std::for_each, std::max, std::min, std::replace, std::remove, std::remove_if, std::reverse, std::search, std::set_symmetric_difference, std::sort, std::stable_sort, std::swap, std::transform
+#include <algorithm> // std::all_of, std::clamp, std::copy_n, std::equal, std::fill_n, std::find, std::find_if, std::for_each, std::lower_bound, std::max, std::min, std::replace, std::remove, std::remove_if, std::reverse, std::search, std::set_symmetric_difference, std::sort, std::stable_sort, std::swap, std::transform
 #include <fpng.h>
 #include <stb_image.h>
 #include <stb_image_dds.h>
@@ -173,6 +174,53 @@ static std::vector<std::filesystem::path> find_files(const std::vector<std::file
 	return files;
 }
 
+// Maximum number of screenshot jobs waiting for a worker, to bound the memory held by pending image data
+static constexpr size_t max_screenshot_jobs = 4;
+// Maximum size of decoded image data an effect holds on to between loading and creating it, anything beyond that is decoded again (or read from the effect cache) when the effect is created
+static constexpr size_t max_texture_source_data_size = 256 * 1024 * 1024;
+
+static bool is_used_by_same_effect(const reshade::texture &a, const reshade::texture &b)
+{
+	return std::any_of(a.shared.cbegin(), a.shared.cend(),
+		[&b](size_t effect_index) { return std::find(b.shared.cbegin(), b.shared.cend(), effect_index) != b.shared.cend(); });
+}
+static bool has_invalid_memory_sharing(const std::vector<reshade::texture> &textures, const reshade::texture &tex)
+{
+	// Sharing memory is only valid between transient textures that are never used by the same effect (which can change whenever another effect starts to share one of them)
+	bool shares_memory = false;
+	for (const reshade::texture &item : textures)
+	{
+		if (&item == &tex || item.resource != tex.resource)
+			continue;
+		if (!item.transient || is_used_by_same_effect(item, tex))
+			return true;
+		shares_memory = true;
+	}
+	return shares_memory && !tex.transient;
+}
+
+static void mark_uniform_data_dirty(reshade::effect &effect, uint32_t offset, uint32_t size)
+{
+	// Extend range to whole 16-byte constant registers, which also coalesces neighboring variables into a single range
+	uint32_t range_begin = offset & ~15u;
+	uint32_t range_end = (offset + size + 15) & ~15u;
+
+	std::vector<std::pair<uint32_t, uint32_t>> &ranges = effect.uniform_data_dirty_ranges;
+
+	// Merge with all existing ranges that overlap or touch the new one
+	auto it = std::lower_bound(ranges.begin(), ranges.end(), range_begin,
+		[](const std::pair<uint32_t, uint32_t> &range, uint32_t value) { return range.second < value; });
+	auto last = it;
+	for (; last != ranges.end() && last->first <= range_end; ++last)
+	{
+		range_begin = std::min(range_begin, last->first);
+		range_end = std::max(range_end, last->second);
+	}
+
+	it = ranges.erase(it, last);
+	ranges.insert(it, std::make_pair(range_begin, range_end));
+}
+
 reshade::runtime::runtime(api::swapchain *swapchain, api::command_queue *graphics_queue, const std::filesystem::path &config_path, bool is_vr) :
 	_swapchain(swapchain),
 	_device(swapchain->get_device()),
@@ -240,7 +288,7 @@ reshade::runtime::runtime(api::swapchain *swapchain, api::command_queue *graphic
 }
 reshade::runtime::~runtime()
 {
-	assert(_worker_threads.empty());
+	assert(_worker_threads.empty() && _screenshot_workers.empty());
 	assert(!_is_initialized && _techniques.empty() && _technique_sorting.empty());
 
 #if RESHADE_GUI
@@ -250,6 +298,9 @@ reshade::runtime::~runtime()
 
 	deinit_gui();
 #endif
+
+	// Make sure all changes are written to disk before shutting down
+	ini_file::wait_for_pending_saves();
 }
 
 bool reshade::runtime::on_init()
@@ -522,6 +573,10 @@ void reshade::runtime::on_reset()
 	else
 		return; // Nothing to do if the runtime was already destroyed or not successfully initialized in the first place
 
+	// Finish any readbacks still in flight (like screenshots) and wait for them to be written
+	process_texture_readbacks(true);
+	finish_screenshot_jobs();
+
 	// Already performs a wait for idle, so no need to do it again before destroying resources below
 	destroy_effects();
 
@@ -560,6 +615,8 @@ void reshade::runtime::on_reset()
 	destroy_state_block(_device, _app_state);
 	_app_state = {};
 
+	destroy_upload_ring();
+
 	_width = _height = 0;
 	_back_buffer_format = api::format::unknown;
 	_back_buffer_samples = 1;
@@ -585,6 +642,9 @@ void reshade::runtime::on_present()
 
 #if RESHADE_ADDON
 	_is_in_present_call = true;
+
+	// Delete add-on event callback lists that were replaced since the last present and are no longer iterated by any thread
+	reclaim_addon_event_lists();
 #endif
 
 	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
@@ -640,6 +700,14 @@ void reshade::runtime::on_present()
 	if (_should_save_screenshot)
 		save_screenshot(_screenshot_save_before ? "After" : nullptr);
 
+	process_texture_readbacks(false);
+
+	// Mark the end of the texture updates of this frame in the upload ring buffer, so that space can be reused once the GPU finished reading it
+	if (_upload_ring_fence != 0 &&
+		(_upload_ring_in_flight.empty() ? _upload_ring_tail : _upload_ring_in_flight.back().second) != _upload_ring_head &&
+		_graphics_queue->signal(_upload_ring_fence, _upload_ring_fence_value + 1))
+		_upload_ring_in_flight.emplace_back(++_upload_ring_fence_value, _upload_ring_head);
+
 	_frame_count++;
 	const auto current_time = std::chrono::high_resolution_clock::now();
 	_last_frame_duration = current_time - _last_present_time; _last_present_time = current_time;
@@ -1047,6 +1115,17 @@ void reshade::runtime::load_current_preset()
 
 	const ini_file &preset = ini_file::load_cache(_current_preset_path);
 
+	// Apply the snapshot of this preset if neither it nor the loaded effects changed since it was taken, instead of matching everything by name again
+	if (!_performance_mode && _reload_remaining_effects == std::numeric_limits<size_t>::max())
+	{
+		if (const auto it = _preset_snapshots.find(_current_preset_path.native());
+			it != _preset_snapshots.end() && it->second.preset_revision == preset.revision() && it->second.technique_enabled.size() == _techniques.size())
+		{
+			apply_preset_snapshot(it->second);
+			return;
+		}
+	}
+
 	std::vector<std::string> technique_list;
 	preset.get({}, "Techniques", technique_list);
 	std::vector<std::string> sorted_technique_list;
@@ -1226,6 +1305,128 @@ void reshade::runtime::load_current_preset()
 
 	// Reverse queue so that effects are enabled in the order they are defined in the preset (since the queue is worked from back to front)
 	std::reverse(_reload_create_queue.begin(), _reload_create_queue.end());
+
+	// Only take a snapshot once values reached their final state and all effects are loaded
+	if (!_performance_mode && !_is_in_preset_transition && _reload_remaining_effects == std::numeric_limits<size_t>::max())
+		take_preset_snapshot(preset.revision());
+}
+void reshade::runtime::take_preset_snapshot(uint64_t preset_revision)
+{
+	preset_snapshot &snapshot = _preset_snapshots[_current_preset_path.native()];
+	snapshot.preset_revision = preset_revision;
+	snapshot.preset_is_incomplete = _preset_is_incomplete;
+	snapshot.technique_sorting = _technique_sorting;
+
+	snapshot.uniforms.clear();
+	snapshot.uniform_data.clear();
+
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		const effect &effect = _effects[effect_index];
+
+		for (size_t uniform_index = 0; uniform_index < effect.uniforms.size(); ++uniform_index)
+		{
+			const uniform &variable = effect.uniforms[uniform_index];
+
+			// Skip the same variables as 'load_current_preset'
+			if (variable.special != special_uniform::none ||
+				variable.annotation_as_uint("nosave"))
+				continue;
+
+			preset_snapshot::uniform_value &value = snapshot.uniforms.emplace_back();
+			value.effect_index = effect_index;
+			value.uniform_index = uniform_index;
+			value.offset = variable.offset;
+			value.size = variable.size;
+			value.is_float = variable.type.base == reshadefx::type::t_float;
+			std::copy_n(variable.toggle_key_data, 4, value.toggle_key_data.begin());
+
+			const uint8_t *const data = effect.uniform_data_storage.data() + variable.offset;
+			snapshot.uniform_data.insert(snapshot.uniform_data.end(), data, data + variable.size);
+		}
+	}
+
+	snapshot.technique_enabled.resize(_techniques.size());
+	snapshot.technique_toggle_key_data.resize(_techniques.size());
+
+	for (size_t technique_index = 0; technique_index < _techniques.size(); ++technique_index)
+	{
+		const technique &tech = _techniques[technique_index];
+
+		snapshot.technique_enabled[technique_index] = tech.enabled;
+		std::copy_n(tech.toggle_key_data, 4, snapshot.technique_toggle_key_data[technique_index].begin());
+	}
+}
+void reshade::runtime::apply_preset_snapshot(const preset_snapshot &snapshot)
+{
+	_preset_is_incomplete = snapshot.preset_is_incomplete;
+	_technique_sorting = snapshot.technique_sorting;
+
+	// Compute times since the transition has started and how much is left till it should end
+	auto transition_time = std::chrono::duration_cast<std::chrono::microseconds>(_last_present_time - _last_preset_switching_time).count();
+	auto transition_ms_left = _preset_transition_duration - transition_time / 1000;
+	auto transition_ms_left_from_last_frame = transition_ms_left + std::chrono::duration_cast<std::chrono::microseconds>(_last_frame_duration).count() / 1000;
+
+	if (_is_in_preset_transition && transition_ms_left <= 0)
+		_is_in_preset_transition = false;
+
+	// Only touch values that actually differ from the current state
+	const uint8_t *snapshot_data = snapshot.uniform_data.data();
+
+	for (const preset_snapshot::uniform_value &value : snapshot.uniforms)
+	{
+		effect &effect = _effects[value.effect_index];
+		uniform &variable = effect.uniforms[value.uniform_index];
+
+		std::copy_n(value.toggle_key_data.begin(), 4, variable.toggle_key_data);
+
+		uint8_t *const data = effect.uniform_data_storage.data() + value.offset;
+
+		if (std::memcmp(data, snapshot_data, value.size) != 0)
+		{
+			if (_is_in_preset_transition && value.is_float)
+			{
+				// Perform smooth transition on floating point values
+				for (uint32_t i = 0; i + sizeof(float) <= value.size; i += sizeof(float))
+				{
+					float value_old, value_new;
+					std::memcpy(&value_old, data + i, sizeof(float));
+					std::memcpy(&value_new, snapshot_data + i, sizeof(float));
+
+					const float value_left = (value_new - value_old);
+					value_new -= (value_left / transition_ms_left_from_last_frame) * transition_ms_left;
+
+					std::memcpy(data + i, &value_new, sizeof(float));
+				}
+			}
+			else
+			{
+				std::memcpy(data, snapshot_data, value.size);
+			}
+
+			mark_uniform_data_dirty(effect, value.offset, value.size);
+		}
+
+		snapshot_data += value.size;
+	}
+
+	for (size_t technique_index = 0; technique_index < _techniques.size(); ++technique_index)
+	{
+		technique &tech = _techniques[technique_index];
+
+		std::copy_n(snapshot.technique_toggle_key_data[technique_index].begin(), 4, tech.toggle_key_data);
+
+		if (tech.enabled == snapshot.technique_enabled[technique_index])
+			continue;
+
+		if (snapshot.technique_enabled[technique_index])
+			enable_technique(tech);
+		else
+			disable_technique(tech);
+	}
+
+	// Reverse queue so that effects are enabled in the order they are defined in the preset (since the queue is worked from back to front)
+	std::reverse(_reload_create_queue.begin(), _reload_create_queue.end());
 }
 void reshade::runtime::save_current_preset(ini_file &preset) const
 {
@@ -1518,6 +1719,8 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		effect.permutations.resize(1);
 	}
 
+	effect.skipped = false;
+
 	if (_effect_load_skipping && !force_load)
 	{
 		if (std::vector<std::string> techniques;
@@ -1529,7 +1732,11 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 					return at_pos == 0 || technique.find(effect_name, at_pos) == at_pos;
 				}) == techniques.cend();
 
-			if (effect.skipped)
+			// Skipped effects are not compiled, but their techniques and uniforms are still listed in the overlay, using an outline that is cached alongside the preprocessed source
+			if (std::string outline_data;
+				effect.skipped &&
+				load_effect_cache(source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + std::to_string(source_hash), "outline", outline_data) &&
+				reshadefx::deserialize_effect_outline(outline_data, effect.outline))
 			{
 				if (_reload_remaining_effects != std::numeric_limits<size_t>::max())
 					_reload_remaining_effects--;
@@ -1549,8 +1756,37 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 	std::string source;
 	std::string errors;
 
+	// Permutations that only differ in properties the effect source does not depend on can reuse the code compiled for the default permutation, so that only pipelines have to be created for them
+	// This does not apply to D3D9, where the back buffer dimensions are additionally baked into the shader code (see 'COLOR_PIXEL_SIZE' below)
+	if (permutation_index != 0 && effect.compiled && effect.permutation_dependencies != permutation_dependency::all && _renderer_id != 0x9000)
+	{
+		const effect_permutation &default_permutation_info = _effect_permutations[0];
+		const effect_permutation &permutation_info = _effect_permutations[permutation_index];
+
+		if (((effect.permutation_dependencies & permutation_dependency::buffer_dimensions) == 0 ||
+				(permutation_info.width == default_permutation_info.width && permutation_info.height == default_permutation_info.height)) &&
+			((effect.permutation_dependencies & permutation_dependency::buffer_color) == 0 ||
+				(permutation_info.color_space == default_permutation_info.color_space && permutation_info.color_format == default_permutation_info.color_format)))
+		{
+			const effect::permutation &default_permutation = effect.permutations[0];
+			assert(!default_permutation.assembly.empty());
+
+			permutation.module = default_permutation.module;
+			permutation.generated_code = default_permutation.generated_code;
+			permutation.assembly = default_permutation.assembly;
+			permutation.assembly_text = default_permutation.assembly_text;
+
+			preprocessed = true;
+			compiled = true;
+
+			log::message(log::level::info, "Reusing compiled code of '%s' for permutation (width = %u, height = %u, format = %u).", source_file.u8string().c_str(), permutation_info.width, permutation_info.height, static_cast<uint32_t>(permutation_info.color_format));
+		}
+	}
+
 	if (!preprocessed && (preprocess_required || (source_cached = load_effect_cache(source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + std::to_string(source_hash), "i", source)) == false))
 	{
+		permutation_dependency permutation_dependencies = permutation_dependency::all;
+
 		reshadefx::preprocessor pp;
 		pp.add_macro_definition("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
 		pp.add_macro_definition("__RESHADE_PERMUTATION__", permutation_index != 0 ? "1" : "0");
@@ -1632,6 +1868,22 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 				source = "// " + definition.first + '=' + definition.second + '\n' + source;
 			}
 
+			// Keep track of the permutation-specific macros that were referenced, so that permutations which only differ in other aspects can share code
+			if (pp.is_macro_expanded("__RESHADE_PERMUTATION__"))
+			{
+				permutation_dependencies = permutation_dependency::all;
+			}
+			else
+			{
+				permutation_dependencies = permutation_dependency::none;
+				if (pp.is_macro_expanded("BUFFER_WIDTH") || pp.is_macro_expanded("BUFFER_HEIGHT") || pp.is_macro_expanded("BUFFER_RCP_WIDTH") || pp.is_macro_expanded("BUFFER_RCP_HEIGHT"))
+					permutation_dependencies |= permutation_dependency::buffer_dimensions;
+				if (pp.is_macro_expanded("BUFFER_COLOR_SPACE") || pp.is_macro_expanded("BUFFER_COLOR_FORMAT") || pp.is_macro_expanded("BUFFER_COLOR_BIT_DEPTH"))
+					permutation_dependencies |= permutation_dependency::buffer_color;
+			}
+
+			source = "// __RESHADE_PERMUTATION_DEPENDENCIES__=" + std::to_string(static_cast<uint32_t>(permutation_dependencies)) + '\n' + source;
+
 			std::sort(preprocessor_definitions.begin(), preprocessor_definitions.end());
 
 			// Do not cache if any special pragma directives were used, to ensure they are read again next time
@@ -1648,6 +1900,7 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 			std::sort(effect.included_files.begin(), effect.included_files.end()); // Sort file names alphabetically
 
 			effect.preprocessed = preprocessed;
+			effect.permutation_dependencies = permutation_dependencies;
 		}
 	}
 	else
@@ -1655,6 +1908,8 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		if (permutation_index == 0 && !source.empty())
 		{
 			effect.definitions.clear();
+			// Cache files written by older versions do not contain this information, so assume the worst
+			effect.permutation_dependencies = permutation_dependency::all;
 
 			// Read used preprocessor definitions and pragmas from the cached source
 			for (size_t offset = 0, next; source.compare(offset, 3, "// ") == 0; offset = next + 1)
@@ -1668,6 +1923,10 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 				{
 					code_preamble += source.substr(offset, (next + 1) - offset);
 				}
+				else if (source.compare(offset, 37, "__RESHADE_PERMUTATION_DEPENDENCIES__=") == 0)
+				{
+					effect.permutation_dependencies = static_cast<permutation_dependency>(std::strtoul(source.c_str() + offset + 37, nullptr, 10));
+				}
 				else if (const size_t equals_index = source.find('=', offset);
 					equals_index != std::string::npos)
 				{
@@ -1681,6 +1940,22 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		}
 	}
 
+	if (effect.skipped)
+	{
+		// Only do a shallow scan of the preprocessed source, instead of parsing and compiling it
+		effect.outline = reshadefx::scan_effect_outline(source);
+
+		if (!source.empty())
+			save_effect_cache(source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + std::to_string(source_hash), "outline", reshadefx::serialize_effect_outline(effect.outline));
+
+		// The preprocessed source is not kept, so it has to be preprocessed again when the effect is loaded for real later
+		effect.preprocessed = false;
+
+		if (_reload_remaining_effects != std::numeric_limits<size_t>::max())
+			_reload_remaining_effects--;
+		return false;
+	}
+
 	std::unique_ptr<reshadefx::codegen> codegen;
 	if (!compiled && !source.empty())
 	{
@@ -2137,6 +2412,7 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		for (texture new_texture : permutation.module.textures)
 		{
 			new_texture.effect_index = effect_index;
+			new_texture.transient = reshadefx::is_transient_texture(permutation.module, new_texture.unique_name);
 
 			if (!new_texture.semantic.empty() && (new_texture.render_target || new_texture.storage_access))
 			{
@@ -2201,6 +2477,8 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 				// Update render target and storage access flags of the existing shared texture, in case they are used as such in this effect
 				existing_texture->render_target |= new_texture.render_target;
 				existing_texture->storage_access |= new_texture.storage_access;
+				// Texture can only be transient if it is so in all effects using it
+				existing_texture->transient = existing_texture->transient && new_texture.transient;
 				continue;
 			}
 
@@ -2241,6 +2519,7 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 
 					existing_texture->render_target = true;
 					existing_texture->storage_access = true;
+					existing_texture->transient = existing_texture->transient && new_texture.transient;
 					continue;
 				}
 			}
@@ -2283,6 +2562,35 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		}
 	}
 
+	// Decode images attached to textures already here on the loading thread, so that creating the effect later only has to upload them
+	if (compiled && permutation_index == 0)
+	{
+		effect.texture_source_data.clear();
+
+		size_t total_data_size = 0;
+
+		for (const reshadefx::texture &texture_info : permutation.module.textures)
+		{
+			const texture tex(texture_info);
+			if (!tex.semantic.empty() || tex.annotation_as_string("source").empty())
+				continue;
+
+			effect::texture_source source;
+			source.desc = texture_info;
+			source.source = tex.annotation_as_string("source");
+
+			// Failure is remembered with empty data, so that the error is not reported twice
+			if (!load_texture_source(tex, source.pixels_data))
+				source.pixels_data.clear();
+			else if (total_data_size + source.pixels_data.size() > max_texture_source_data_size)
+				continue;
+
+			total_data_size += source.pixels_data.size();
+
+			effect.texture_source_data.emplace(tex.unique_name, std::move(source));
+		}
+	}
+
 	effect.compiled = compiled;
 
 	if (!errors.empty())
@@ -2336,7 +2644,9 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 		if (tex.resource != 0)
 		{
 			if (!(tex.render_target && tex.rtv[0] == 0) &&
-				!(tex.storage_access && tex.uav.empty()))
+				!(tex.storage_access && tex.uav.empty()) &&
+				// Texture may no longer be allowed to share memory since it was created (e.g. because another effect now shares it and depends on its contents, or uses it together with a texture it shares memory with)
+				!has_invalid_memory_sharing(_textures, tex))
 				continue;
 
 			// Update texture if usage has changed since it was last created (e.g. because a pooled texture is now used with storage access when it was not before)
@@ -2498,6 +2808,9 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 			}
 
 			_device->set_resource_name(effect.cb, "ReShade constant buffer");
+
+			// Contents of the new constant buffer are undefined, so have to upload everything the first time
+			effect.uniform_data_dirty_ranges.assign(1, std::make_pair(0u, static_cast<uint32_t>(effect.uniform_data_storage.size())));
 		}
 		else
 		{
@@ -2658,14 +2971,6 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 
 						const api::resource_desc res_desc = _device->get_resource_desc(render_target_texture->resource);
 						render_target_formats[render_target_count] = api::format_to_default_typed(res_desc.texture.format, pass.srgb_write_enable);
-
-						if (std::find(pass.modified_resources.cbegin(), pass.modified_resources.cend(), render_target_texture->resource) == pass.modified_resources.cend())
-						{
-							pass.modified_resources.push_back(render_target_texture->resource);
-
-							if (pass.generate_mipmaps && render_target_texture->levels > 1)
-								pass.generate_mipmap_views.push_back(render_target_texture->srv[0]);
-						}
 					}
 
 					subobjects.push_back({ api::pipeline_subobject_type::render_target_formats, static_cast<uint32_t>(render_target_count), render_target_formats });
@@ -2922,15 +3227,64 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 					write.type = api::descriptor_type::unordered_access_view;
 					write.descriptors = &uav;
 				}
+			}
+		}
 
-				if (std::find(pass.modified_resources.cbegin(), pass.modified_resources.cend(), storage_texture->resource) == pass.modified_resources.cend())
+		// Plan state transitions and mipmap generation between passes based on which textures they read from and write to
+		if (const auto module_tech = std::find_if(permutation.module.techniques.cbegin(), permutation.module.techniques.cend(),
+				[&tech](const reshadefx::technique &item) { return item.name == tech.name; });
+			module_tech != permutation.module.techniques.cend())
+		{
+			const auto to_resource_usage = [](reshadefx::texture_state state) {
+				switch (state)
 				{
-					pass.modified_resources.push_back(storage_texture->resource);
-
-					if (pass.generate_mipmaps && storage_texture->levels > 1)
-						pass.generate_mipmap_views.push_back(storage_texture->srv[0]);
+				default:
+				case reshadefx::texture_state::shader_resource:
+					return api::resource_usage::shader_resource;
+				case reshadefx::texture_state::render_target:
+					return api::resource_usage::render_target;
+				case reshadefx::texture_state::unordered_access:
+					return api::resource_usage::unordered_access;
+				}
+			};
+			const auto find_texture = [this](const std::string &unique_name) {
+				const auto texture = std::find_if(_textures.cbegin(), _textures.cend(),
+					[&unique_name](const reshade::texture &item) {
+						return item.unique_name == unique_name && item.resource != 0;
+					});
+				assert(texture != _textures.cend());
+				return texture;
+			};
+			const auto build_barrier_list = [&](const std::vector<reshadefx::texture_transition> &plan_transitions, technique::barrier_list &barriers) {
+				barriers = {};
+				for (const reshadefx::texture_transition &transition : plan_transitions)
+				{
+					barriers.resources.push_back(find_texture(transition.texture_name)->resource);
+					barriers.old_states.push_back(to_resource_usage(transition.old_state));
+					barriers.new_states.push_back(to_resource_usage(transition.new_state));
 				}
+			};
+			const auto build_transitions = [&](const reshadefx::pass_plan &plan, technique::transitions &transitions) {
+				build_barrier_list(plan.transitions_before_mipmaps, transitions.barriers_before_mipmaps);
+				transitions.generate_mipmap_views.clear();
+				for (const std::string &texture_name : plan.generate_mipmaps)
+					transitions.generate_mipmap_views.push_back(find_texture(texture_name)->srv[0]);
+				build_barrier_list(plan.transitions, transitions.barriers);
+			};
+
+			const std::vector<reshadefx::pass_plan> plans = reshadefx::plan_technique_passes(permutation.module, *module_tech);
+			assert(plans.size() == tech.permutations[permutation_index].passes.size() + 1);
+
+			for (size_t pass_index = 0; pass_index < tech.permutations[permutation_index].passes.size(); ++pass_index)
+			{
+				technique::pass &pass = tech.permutations[permutation_index].passes[pass_index];
+
+				build_transitions(plans[pass_index], pass.transitions_before);
+				pass.bind_shared_tables = plans[pass_index].bind_shared_tables;
+				pass.continue_render_pass = plans[pass_index].continue_render_pass;
 			}
+
+			build_transitions(plans.back(), tech.permutations[permutation_index].transitions_after);
 		}
 
 		tech.permutations[permutation_index].created = true;
@@ -2939,6 +3293,61 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 	if (!descriptor_writes.empty())
 		_device->update_descriptor_tables(static_cast<uint32_t>(descriptor_writes.size()), descriptor_writes.data());
 
+	// Build table of special uniform variables to update every frame (ignore other permutations, since they share the same uniform variables)
+	if (permutation_index == 0)
+	{
+		effect.special_uniform_updates.clear();
+
+		for (size_t uniform_index = 0; uniform_index < effect.uniforms.size(); ++uniform_index)
+		{
+			const uniform &variable = effect.uniforms[uniform_index];
+
+			special_uniform_update update;
+			update.special = variable.special;
+			update.uniform_index = static_cast<uint32_t>(uniform_index);
+
+			switch (variable.special)
+			{
+			case special_uniform::none:
+			case special_uniform::unknown:
+				continue;
+			case special_uniform::random:
+				update.int_range[0] = variable.annotation_as_int("min", 0, 0);
+				update.int_range[1] = variable.annotation_as_int("max", 0, RAND_MAX);
+				break;
+			case special_uniform::ping_pong:
+				update.float_range[0] = variable.annotation_as_float("min", 0, 0.0f);
+				update.float_range[1] = variable.annotation_as_float("max", 0, 1.0f);
+				update.step[0] = variable.annotation_as_float("step", 0);
+				update.step[1] = variable.annotation_as_float("step", 1);
+				update.smoothing = variable.annotation_as_float("smoothing");
+				break;
+			case special_uniform::key:
+			case special_uniform::mouse_button:
+				update.keycode = variable.annotation_as_int("keycode");
+				if (variable.special == special_uniform::key ? (update.keycode <= 7 || update.keycode >= 256) : (update.keycode < 0 || update.keycode >= 5))
+					continue; // Skip variables with an invalid key code, since they would never be updated anyway
+				if (const std::string_view mode = variable.annotation_as_string("mode");
+					mode == "toggle" || variable.annotation_as_int("toggle"))
+					update.mode = special_uniform_update::key_mode::toggle;
+				else if (mode == "press")
+					update.mode = special_uniform_update::key_mode::press;
+				else
+					update.mode = special_uniform_update::key_mode::down;
+				break;
+			case special_uniform::mouse_wheel:
+				update.float_range[0] = variable.annotation_as_float("min");
+				update.float_range[1] = variable.annotation_as_float("max");
+				update.step[0] = variable.annotation_as_float("step");
+				if (update.step[0] == 0.0f)
+					update.step[0] = 1.0f;
+				break;
+			}
+
+			effect.special_uniform_updates.push_back(update);
+		}
+	}
+
 	effect.created = true;
 
 	load_textures(effect_index);
@@ -2949,6 +3358,9 @@ void reshade::runtime::destroy_effect(size_t effect_index, bool unload)
 {
 	assert(effect_index < _effects.size());
 
+	// Snapshots reference uniforms and techniques by index, so are no longer valid after effects changed
+	_preset_snapshots.clear();
+
 	for (technique &tech : _techniques)
 	{
 		if (tech.effect_index != effect_index)
@@ -2967,10 +3379,10 @@ void reshade::runtime::destroy_effect(size_t effect_index, bool unload)
 				pass.storage_table = {};
 
 				std::fill_n(pass.render_target_views, 8, api::resource_view {});
-				pass.modified_resources.clear();
-				pass.generate_mipmap_views.clear();
+				pass.transitions_before = {};
 			}
 
+			permutation.transitions_after = {};
 			permutation.created = false;
 		}
 	}
@@ -2980,6 +3392,8 @@ void reshade::runtime::destroy_effect(size_t effect_index, bool unload)
 		_device->destroy_resource(effect.cb);
 		effect.cb = {};
 
+		effect.special_uniform_updates.clear();
+
 		_device->destroy_query_heap(effect.query_heap);
 		effect.query_heap = {};
 
@@ -3008,20 +3422,21 @@ void reshade::runtime::destroy_effect(size_t effect_index, bool unload)
 	// No techniques from this effect are rendering anymore
 	effect.rendering = 0;
 
-	// Destroy textures belonging to this effect
+	// Destroy textures belonging to this effect (before removing them from the list, since destroying a texture may hand over its resource to another texture sharing its memory)
+	for (texture &tex : _textures)
+	{
+		tex.shared.erase(std::remove(tex.shared.begin(), tex.shared.end(), effect_index), tex.shared.end());
+		if (tex.shared.empty())
+		{
+			destroy_texture(tex);
+			continue;
+		}
+		// If this texture is still used by another effect, move ownership to that other effect
+		if (effect_index == tex.effect_index)
+			tex.effect_index = tex.shared.front();
+	}
 	_textures.erase(std::remove_if(_textures.begin(), _textures.end(),
-		[this, effect_index](texture &tex) {
-			tex.shared.erase(std::remove(tex.shared.begin(), tex.shared.end(), effect_index), tex.shared.end());
-			if (tex.shared.empty())
-			{
-				destroy_texture(tex);
-				return true;
-			}
-			// If this texture is still used by another effect, move ownership to that other effect
-			if (effect_index == tex.effect_index)
-				tex.effect_index = tex.shared.front();
-			return false;
-		}), _textures.end());
+		[](const texture &tex) { return tex.shared.empty(); }), _textures.end());
 	// Clean up techniques belonging to this effect
 	for (auto it = _techniques.begin(); it != _techniques.end();)
 	{
@@ -3046,187 +3461,404 @@ void reshade::runtime::destroy_effect(size_t effect_index, bool unload)
 	// Do not clear effect here, since it is common to be reused immediately
 }
 
-void reshade::runtime::load_textures(size_t effect_index)
+static bool get_texture_upload_format(reshadefx::texture_format format, uint32_t &pixel_size, stbir_datatype &data_type, stbir_pixel_layout &pixel_layout)
 {
-	for (texture &tex : _textures)
+	switch (format)
 	{
-		if (tex.resource == 0 || !tex.semantic.empty())
-			continue; // Ignore textures that are not created yet and those that are handled in the runtime implementation
-		if (std::find(tex.shared.begin(), tex.shared.end(), effect_index) == tex.shared.end())
-			continue; // Ignore textures not being used with this effect
+	case reshadefx::texture_format::r8:
+		pixel_size = 1 * 1;
+		data_type = STBIR_TYPE_UINT8;
+		pixel_layout = STBIR_1CHANNEL;
+		return true;
+	case reshadefx::texture_format::r32f:
+		pixel_size = 4 * 1;
+		data_type = STBIR_TYPE_FLOAT;
+		pixel_layout = STBIR_1CHANNEL;
+		return true;
+	case reshadefx::texture_format::rg8:
+		pixel_size = 1 * 2;
+		data_type = STBIR_TYPE_UINT8;
+		pixel_layout = STBIR_2CHANNEL;
+		return true;
+	case reshadefx::texture_format::rg16:
+		pixel_size = 2 * 2;
+		data_type = STBIR_TYPE_UINT16;
+		pixel_layout = STBIR_2CHANNEL;
+		return true;
+	case reshadefx::texture_format::rg16f:
+		pixel_size = 2 * 2;
+		data_type = STBIR_TYPE_HALF_FLOAT;
+		pixel_layout = STBIR_2CHANNEL;
+		return true;
+	case reshadefx::texture_format::rg32f:
+		pixel_size = 4 * 2;
+		data_type = STBIR_TYPE_FLOAT;
+		pixel_layout = STBIR_2CHANNEL;
+		return true;
+	case reshadefx::texture_format::rgba8:
+	case reshadefx::texture_format::rgb10a2:
+		pixel_size = 1 * 4;
+		data_type = STBIR_TYPE_UINT8;
+		pixel_layout = STBIR_4CHANNEL;
+		return true;
+	case reshadefx::texture_format::rgba16:
+		pixel_size = 2 * 4;
+		data_type = STBIR_TYPE_UINT16;
+		pixel_layout = STBIR_4CHANNEL;
+		return true;
+	case reshadefx::texture_format::rgba16f:
+		pixel_size = 2 * 4;
+		data_type = STBIR_TYPE_HALF_FLOAT;
+		pixel_layout = STBIR_4CHANNEL;
+		return true;
+	case reshadefx::texture_format::rgba32f:
+		pixel_size = 4 * 4;
+		data_type = STBIR_TYPE_FLOAT;
+		pixel_layout = STBIR_4CHANNEL;
+		return true;
+	default:
+		return false;
+	}
+}
 
-		std::filesystem::path source_path = std::filesystem::u8path(tex.annotation_as_string("source"));
-		// Ignore textures that have no image file attached to them (e.g. plain render targets)
-		if (source_path.empty())
-			continue;
+static uint16_t get_texture_source_levels(const reshade::texture &tex, reshade::api::device_api api)
+{
+	// Mipmaps of 3D textures are still generated on the GPU
+	// The same goes for D3D9, where textures with mipmaps use automatic mipmap generation, which only makes the base level accessible
+	return tex.depth == 1 && api != reshade::api::device_api::d3d9 ? tex.levels : 1;
+}
+static size_t get_texture_source_data_size(const reshade::texture &tex, reshade::api::device_api api, uint32_t pixel_size)
+{
+	size_t size = 0;
+	for (uint32_t level = 0, mip_width = tex.width, mip_height = tex.height; level < get_texture_source_levels(tex, api); ++level, mip_width = std::max(1u, mip_width / 2), mip_height = std::max(1u, mip_height / 2))
+		size += static_cast<size_t>(mip_width) * static_cast<size_t>(mip_height) * static_cast<size_t>(tex.depth) * pixel_size;
+	return size;
+}
 
-		// Search for image file using the provided search paths unless the path provided is already absolute
-		if (!find_file(_texture_search_paths, source_path))
-		{
-			log::message(log::level::error, "Source '%s' for texture '%s' was not found in any of the texture search paths!", source_path.u8string().c_str(), tex.unique_name.c_str());
-			_last_reload_successful = false;
-			continue;
+bool reshade::runtime::load_texture_source(const texture &tex, std::string &pixels_data) const
+{
+	std::filesystem::path source_path = std::filesystem::u8path(tex.annotation_as_string("source"));
+	assert(!source_path.empty());
+
+	// Search for image file using the provided search paths unless the path provided is already absolute
+	if (!find_file(_texture_search_paths, source_path))
+	{
+		log::message(log::level::error, "Source '%s' for texture '%s' was not found in any of the texture search paths!", source_path.u8string().c_str(), tex.unique_name.c_str());
+		return false;
+	}
+
+	uint32_t pixel_size = 0;
+	stbir_datatype data_type = STBIR_TYPE_UINT8;
+	stbir_pixel_layout pixel_layout = STBIR_4CHANNEL;
+	if (!get_texture_upload_format(tex.format, pixel_size, data_type, pixel_layout))
+	{
+		log::message(log::level::error, "Texture upload is not supported for format %d of texture '%s'!", static_cast<int>(tex.format), tex.unique_name.c_str());
+		return false;
+	}
+
+	const size_t texture_data_size = get_texture_source_data_size(tex, _device->get_api(), pixel_size);
+
+	// Read file data into memory in one go since that is faster than reading chunk by chunk
+	std::vector<stbi_uc> file_data;
+	if (FILE *const file = _wfsopen(source_path.c_str(), L"rb", SH_DENYNO))
+	{
+		fseek(file, 0, SEEK_END);
+		const size_t file_size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+
+		file_data.resize(file_size);
+		const size_t file_size_read = fread(file_data.data(), 1, file_size, file);
+		fclose(file);
+
+		if (file_size_read != file_size)
+			file_data.clear();
+	}
+
+	if (file_data.empty())
+	{
+		log::message(log::level::error, "Failed to load '%s' for texture '%s'!", source_path.u8string().c_str(), tex.unique_name.c_str());
+		return false;
+	}
+
+	// Decoded and resized image data only depends on the file contents and the texture description, so can be cached
+	const std::string cache_id =
+		source_path.stem().u8string() + '-' +
+		std::to_string(std::hash<std::string_view>()(std::string_view(reinterpret_cast<const char *>(file_data.data()), file_data.size()))) + '-' +
+		std::to_string(tex.width) + 'x' + std::to_string(tex.height) + 'x' + std::to_string(tex.depth) + '-' +
+		std::to_string(get_texture_source_levels(tex, _device->get_api())) + '-' +
+		std::to_string(static_cast<int>(tex.format));
+
+	if (load_effect_cache(cache_id, "tex", pixels_data) && pixels_data.size() == texture_data_size)
+		return true;
+
+	void *pixels = nullptr;
+	int width = 0, height = 1, depth = 1, channels = 0;
+	const bool is_floating_point_format =
+		tex.format == reshadefx::texture_format::r32f ||
+		tex.format == reshadefx::texture_format::rg32f ||
+		tex.format == reshadefx::texture_format::rgba32f;
+
+	if (source_path.extension() == L".cube")
+	{
+		if (!is_floating_point_format)
+		{
+			log::message(log::level::error, "Source '%s' for texture '%s' is a Cube LUT file, which can only be loaded into textures with a floating-point format!", source_path.u8string().c_str(), tex.unique_name.c_str());
+			return false;
 		}
 
-		void *pixels = nullptr;
-		int width = 0, height = 1, depth = 1, channels = 0;
-		const bool is_floating_point_format =
-			tex.format == reshadefx::texture_format::r32f ||
-			tex.format == reshadefx::texture_format::rg32f ||
-			tex.format == reshadefx::texture_format::rgba32f;
+		float domain_min[3] = { 0.0f, 0.0f, 0.0f };
+		float domain_max[3] = { 1.0f, 1.0f, 1.0f };
+
+		char line_data[1024];
+		size_t file_offset = 0;
+		size_t line_offset = 0;
+		const auto read_line = [&]() {
+			if (file_offset >= file_data.size())
+				return false;
+			line_offset = file_offset;
+			size_t line_length = 0;
+			while (file_offset < file_data.size() && file_data[file_offset] != '\n')
+				if (line_length < sizeof(line_data) - 1)
+					line_data[line_length++] = static_cast<char>(file_data[file_offset++]);
+				else
+					file_offset++;
+			if (file_offset < file_data.size())
+				file_offset++; // Skip new line character
+			line_data[line_length] = '\0';
+			return true;
+		};
 
-		if (FILE *const file = _wfsopen(source_path.c_str(), L"rb", SH_DENYNO))
+		// Read header information
+		while (read_line())
 		{
-			fseek(file, 0, SEEK_END);
-			const size_t file_size = ftell(file);
-			fseek(file, 0, SEEK_SET);
+			const std::string_view line = trim(line_data, "\r\n");
+
+			if (line.empty() || line[0] == '#')
+				continue; // Skip lines with comments
+
+			char *p = line_data;
+
+			if (line.rfind("TITLE", 0) == 0)
+				continue; // Skip optional line with title
 
-			if (source_path.extension() == L".cube")
+			if (line.rfind("DOMAIN_MIN", 0) == 0)
 			{
-				if (!is_floating_point_format)
-				{
-					log::message(log::level::error, "Source '%s' for texture '%s' is a Cube LUT file, which can only be loaded into textures with a floating-point format!", source_path.u8string().c_str(), tex.unique_name.c_str());
-					_last_reload_successful = false;
-					continue;
-				}
+				p += 10;
+				domain_min[0] = static_cast<float>(std::strtod(p, &p));
+				domain_min[1] = static_cast<float>(std::strtod(p, &p));
+				domain_min[2] = static_cast<float>(std::strtod(p, &p));
+				continue;
+			}
+			if (line.rfind("DOMAIN_MAX", 0) == 0)
+			{
+				p += 10;
+				domain_max[0] = static_cast<float>(std::strtod(p, &p));
+				domain_max[1] = static_cast<float>(std::strtod(p, &p));
+				domain_max[2] = static_cast<float>(std::strtod(p, &p));
+				continue;
+			}
 
-				float domain_min[3] = { 0.0f, 0.0f, 0.0f };
-				float domain_max[3] = { 1.0f, 1.0f, 1.0f };
+			if (line.rfind("LUT_1D_SIZE", 0) == 0)
+			{
+				if (pixels != nullptr)
+					break;
+				width = std::strtol(p + 11, nullptr, 10);
+				pixels = std::malloc(static_cast<size_t>(width) * 4 * sizeof(float));
+				continue;
+			}
+			if (line.rfind("LUT_3D_SIZE", 0) == 0)
+			{
+				if (pixels != nullptr)
+					break;
+				width = height = depth = std::strtol(p + 11, nullptr, 10);
+				pixels = std::malloc(static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4 * sizeof(float));
+				continue;
+			}
 
-				// Read header information
-				char line_data[1024];
-				while (fgets(line_data, sizeof(line_data), file))
-				{
-					const std::string_view line = trim(line_data, "\r\n");
+			// Line has no known keyword, so assume this is where the table data starts and roll back a line to continue reading that below
+			file_offset = line_offset;
+			break;
+		}
 
-					if (line.empty() || line[0] == '#')
-						continue; // Skip lines with comments
+		// Read table data
+		if (pixels != nullptr)
+		{
+			size_t index = 0;
 
-					char *p = line_data;
+			while (read_line() && (index + 4) <= (static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4))
+			{
+				const std::string_view line = trim(line_data, "\r\n");
 
-					if (line.rfind("TITLE", 0) == 0)
-						continue; // Skip optional line with title
+				if (line.empty() || line[0] == '#')
+					continue; // Skip lines with comments
 
-					if (line.rfind("DOMAIN_MIN", 0) == 0)
-					{
-						p += 10;
-						domain_min[0] = static_cast<float>(std::strtod(p, &p));
-						domain_min[1] = static_cast<float>(std::strtod(p, &p));
-						domain_min[2] = static_cast<float>(std::strtod(p, &p));
-						continue;
-					}
-					if (line.rfind("DOMAIN_MAX", 0) == 0)
-					{
-						p += 10;
-						domain_max[0] = static_cast<float>(std::strtod(p, &p));
-						domain_max[1] = static_cast<float>(std::strtod(p, &p));
-						domain_max[2] = static_cast<float>(std::strtod(p, &p));
-						continue;
-					}
+				char *p = line_data;
 
-					if (line.rfind("LUT_1D_SIZE", 0) == 0)
-					{
-						if (pixels != nullptr)
-							break;
-						width = std::strtol(p + 11, nullptr, 10);
-						pixels = std::malloc(static_cast<size_t>(width) * 4 * sizeof(float));
-						continue;
-					}
-					if (line.rfind("LUT_3D_SIZE", 0) == 0)
-					{
-						if (pixels != nullptr)
-							break;
-						width = height = depth = std::strtol(p + 11, nullptr, 10);
-						pixels = std::malloc(static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4 * sizeof(float));
-						continue;
-					}
+				static_cast<float *>(pixels)[index++] = static_cast<float>(std::strtod(p, &p)) * (domain_max[0] - domain_min[0]) + domain_min[0];
+				static_cast<float *>(pixels)[index++] = static_cast<float>(std::strtod(p, &p)) * (domain_max[1] - domain_min[1]) + domain_min[1];
+				static_cast<float *>(pixels)[index++] = static_cast<float>(std::strtod(p, &p)) * (domain_max[2] - domain_min[2]) + domain_min[2];
+				static_cast<float *>(pixels)[index++] = 1.0f;
+			}
+		}
+	}
+	else
+	{
+		if (is_floating_point_format)
+			pixels = stbi_loadf_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &channels, STBI_rgb_alpha);
+		else if (stbi_dds_test_memory(file_data.data(), static_cast<int>(file_data.size())))
+			pixels = stbi_dds_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &depth, &channels, STBI_rgb_alpha);
+		else
+			pixels = stbi_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &channels, STBI_rgb_alpha);
+	}
 
-					// Line has no known keyword, so assume this is where the table data starts and roll back a line to continue reading that below
-					fseek(file, -static_cast<long>(std::strlen(line_data)), SEEK_CUR);
-					break;
-				}
+	if (pixels == nullptr)
+	{
+		log::message(log::level::error, "Failed to load '%s' for texture '%s'!", source_path.u8string().c_str(), tex.unique_name.c_str());
+		return false;
+	}
 
-				// Read table data
-				if (pixels != nullptr)
-				{
-					size_t index = 0;
+	// Collapse data to the correct number of components per pixel based on the texture format
+	switch (tex.format)
+	{
+	case reshadefx::texture_format::r8:
+		for (size_t i = 4, k = 1; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 1)
+			static_cast<stbi_uc *>(pixels)[k] = static_cast<stbi_uc *>(pixels)[i];
+		break;
+	case reshadefx::texture_format::r32f:
+		for (size_t i = 4, k = 1; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 1)
+			static_cast<float *>(pixels)[k] = static_cast<float *>(pixels)[i];
+		break;
+	case reshadefx::texture_format::rg8:
+		for (size_t i = 4, k = 2; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 2)
+			static_cast<stbi_uc *>(pixels)[k + 0] = static_cast<stbi_uc *>(pixels)[i + 0],
+			static_cast<stbi_uc *>(pixels)[k + 1] = static_cast<stbi_uc *>(pixels)[i + 1];
+		break;
+	case reshadefx::texture_format::rg32f:
+		for (size_t i = 4, k = 2; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 2)
+			static_cast<float *>(pixels)[k + 0] = static_cast<float *>(pixels)[i + 0],
+			static_cast<float *>(pixels)[k + 1] = static_cast<float *>(pixels)[i + 1];
+		break;
+	case reshadefx::texture_format::rgba8:
+	case reshadefx::texture_format::rgba32f:
+		break;
+	default:
+		log::message(log::level::error, "Texture upload is not supported for format %d of texture '%s'!", static_cast<int>(tex.format), tex.unique_name.c_str());
+		stbi_image_free(pixels);
+		return false;
+	}
 
-					while (fgets(line_data, sizeof(line_data), file) && (index + 4) <= (static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4))
-					{
-						const std::string_view line = trim(line_data, "\r\n");
+	if (static_cast<uint32_t>(depth) != tex.depth || (tex.depth != 1 && (static_cast<uint32_t>(width) != tex.width || static_cast<uint32_t>(height) != tex.height)))
+	{
+		log::message(log::level::error, "Resizing image data is not supported for 3D textures like '%s'.", tex.unique_name.c_str());
+		stbi_image_free(pixels);
+		return false;
+	}
 
-						if (line.empty() || line[0] == '#')
-							continue; // Skip lines with comments
+	pixels_data.resize(texture_data_size);
+
+	// Need to potentially resize image data to the texture dimensions
+	if (static_cast<uint32_t>(width) != tex.width || static_cast<uint32_t>(height) != tex.height)
+	{
+		log::message(log::level::info, "Resizing image data for texture '%s' from %ux%u to %ux%u.", tex.unique_name.c_str(), width, height, tex.width, tex.height);
 
-						char *p = line_data;
+		stbir_resize(pixels, width, height, 0, pixels_data.data(), tex.width, tex.height, 0, pixel_layout, data_type, STBIR_EDGE_CLAMP, STBIR_FILTER_DEFAULT);
+	}
+	else
+	{
+		std::memcpy(pixels_data.data(), pixels, static_cast<size_t>(tex.width) * static_cast<size_t>(tex.height) * static_cast<size_t>(tex.depth) * pixel_size);
+	}
 
-						static_cast<float *>(pixels)[index++] = static_cast<float>(std::strtod(p, &p)) * (domain_max[0] - domain_min[0]) + domain_min[0];
-						static_cast<float *>(pixels)[index++] = static_cast<float>(std::strtod(p, &p)) * (domain_max[1] - domain_min[1]) + domain_min[1];
-						static_cast<float *>(pixels)[index++] = static_cast<float>(std::strtod(p, &p)) * (domain_max[2] - domain_min[2]) + domain_min[2];
-						static_cast<float *>(pixels)[index++] = 1.0f;
-					}
-				}
-			}
-			else
-			{
-				// Read texture data into memory in one go since that is faster than reading chunk by chunk
-				std::vector<stbi_uc> file_data(file_size);
-				const size_t file_size_read = fread(file_data.data(), 1, file_size, file);
-				fclose(file);
+	stbi_image_free(pixels);
 
-				if (file_size_read == file_size)
-				{
-					if (is_floating_point_format)
-						pixels = stbi_loadf_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &channels, STBI_rgb_alpha);
-					else if (stbi_dds_test_memory(file_data.data(), static_cast<int>(file_data.size())))
-						pixels = stbi_dds_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &depth, &channels, STBI_rgb_alpha);
-					else
-						pixels = stbi_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &channels, STBI_rgb_alpha);
-				}
+	// Generate mipmaps on the CPU with a box filter (matching what the GPU does), so they can be cached and uploaded together with the base level
+	size_t offset = 0;
+	for (uint32_t level = 1, mip_width = tex.width, mip_height = tex.height; level < get_texture_source_levels(tex, _device->get_api()); ++level)
+	{
+		const uint32_t level_width = std::max(1u, mip_width / 2);
+		const uint32_t level_height = std::max(1u, mip_height / 2);
+		const size_t level_offset = offset + static_cast<size_t>(mip_width) * static_cast<size_t>(mip_height) * pixel_size;
+
+		stbir_resize(pixels_data.data() + offset, mip_width, mip_height, 0, pixels_data.data() + level_offset, level_width, level_height, 0, pixel_layout, data_type, STBIR_EDGE_CLAMP, STBIR_FILTER_BOX);
+
+		mip_width = level_width;
+		mip_height = level_height;
+		offset = level_offset;
+	}
+
+	save_effect_cache(cache_id, "tex", pixels_data);
+
+	return true;
+}
+
+void reshade::runtime::load_textures(size_t effect_index)
+{
+	effect &effect = _effects[effect_index];
+
+	for (texture &tex : _textures)
+	{
+		if (tex.resource == 0 || !tex.semantic.empty())
+			continue; // Ignore textures that are not created yet and those that are handled in the runtime implementation
+		if (std::find(tex.shared.begin(), tex.shared.end(), effect_index) == tex.shared.end())
+			continue; // Ignore textures not being used with this effect
+
+		// Ignore textures that have no image file attached to them (e.g. plain render targets)
+		if (tex.annotation_as_string("source").empty())
+			continue;
+
+		// Image data was usually already decoded while loading the effect, so only have to upload it here
+		// But the texture may have been created from the description in another effect, in which case the image data has to be decoded again to match it
+		std::string pixels_data;
+		bool has_pixels_data = false;
+		if (const auto it = effect.texture_source_data.find(tex.unique_name);
+			it != effect.texture_source_data.end())
+		{
+			if (const reshadefx::texture_desc &desc = it->second.desc;
+				desc.type == tex.type && desc.width == tex.width && desc.height == tex.height && desc.depth == tex.depth && desc.levels == tex.levels && desc.format == tex.format &&
+				it->second.source == tex.annotation_as_string("source"))
+			{
+				pixels_data = std::move(it->second.pixels_data);
+				has_pixels_data = true;
 			}
+
+			effect.texture_source_data.erase(it);
+		}
+
+		if (!has_pixels_data && !load_texture_source(tex, pixels_data))
+		{
+			pixels_data.clear(); // May contain partial data from a failed cache load
 		}
 
-		if (pixels == nullptr)
+		if (pixels_data.empty())
 		{
-			log::message(log::level::error, "Failed to load '%s' for texture '%s'!", source_path.u8string().c_str(), tex.unique_name.c_str());
 			_last_reload_successful = false;
 			continue;
 		}
 
-		// Collapse data to the correct number of components per pixel based on the texture format
-		switch (tex.format)
+		uint32_t pixel_size;
+		stbir_datatype data_type;
+		stbir_pixel_layout pixel_layout;
+		if (!get_texture_upload_format(tex.format, pixel_size, data_type, pixel_layout) ||
+			pixels_data.size() != get_texture_source_data_size(tex, _device->get_api(), pixel_size))
 		{
-		case reshadefx::texture_format::r8:
-			for (size_t i = 4, k = 1; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 1)
-				static_cast<stbi_uc *>(pixels)[k] = static_cast<stbi_uc *>(pixels)[i];
-			break;
-		case reshadefx::texture_format::r32f:
-			for (size_t i = 4, k = 1; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 1)
-				static_cast<float *>(pixels)[k] = static_cast<float *>(pixels)[i];
-			break;
-		case reshadefx::texture_format::rg8:
-			for (size_t i = 4, k = 2; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 2)
-				static_cast<stbi_uc *>(pixels)[k + 0] = static_cast<stbi_uc *>(pixels)[i + 0],
-				static_cast<stbi_uc *>(pixels)[k + 1] = static_cast<stbi_uc *>(pixels)[i + 1];
-			break;
-		case reshadefx::texture_format::rg32f:
-			for (size_t i = 4, k = 2; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 2)
-				static_cast<float *>(pixels)[k + 0] = static_cast<float *>(pixels)[i + 0],
-				static_cast<float *>(pixels)[k + 1] = static_cast<float *>(pixels)[i + 1];
-			break;
-		case reshadefx::texture_format::rgba8:
-		case reshadefx::texture_format::rgba32f:
-			break;
-		default:
-			log::message(log::level::error, "Texture upload is not supported for format %d of texture '%s'!", static_cast<int>(tex.format), tex.unique_name.c_str());
 			_last_reload_successful = false;
-			stbi_image_free(pixels);
 			continue;
 		}
 
-		update_texture(tex, width, height, depth, pixels);
+		// Upload all subresources at once, including the mipmaps that were already generated on the CPU
+		api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
+		cmd_list->barrier(tex.resource, api::resource_usage::shader_resource, api::resource_usage::copy_dest);
+		const uint16_t levels = get_texture_source_levels(tex, _device->get_api());
+		size_t offset = 0;
+		for (uint32_t level = 0, mip_width = tex.width, mip_height = tex.height; level < levels; ++level, mip_width = std::max(1u, mip_width / 2), mip_height = std::max(1u, mip_height / 2))
+		{
+			_device->update_texture_region({ pixels_data.data() + offset, mip_width * pixel_size, mip_width * mip_height * pixel_size }, tex.resource, level);
+			offset += static_cast<size_t>(mip_width) * static_cast<size_t>(mip_height) * static_cast<size_t>(tex.depth) * pixel_size;
+		}
+		cmd_list->barrier(tex.resource, api::resource_usage::copy_dest, api::resource_usage::shader_resource);
 
-		stbi_image_free(pixels);
+		// Fall back to generating mipmaps on the GPU for textures where that was not done on the CPU
+		if (levels < tex.levels)
+			cmd_list->generate_mipmaps(tex.srv[0]);
 
 		tex.loaded = true;
 	}
@@ -3237,6 +3869,28 @@ bool reshade::runtime::create_texture(texture &tex)
 	if (!tex.semantic.empty())
 		return true;
 
+	// Transient textures can share memory with other transient textures of the same description, as long as no effect uses both (since techniques of different effects never overlap)
+	if (tex.transient)
+	{
+		for (const texture &host : _textures)
+		{
+			if (&host == &tex || host.resource == 0 || host.aliased || !host.transient ||
+				!host.matches_description(tex) || host.render_target != tex.render_target || host.storage_access != tex.storage_access)
+				continue;
+
+			if (std::any_of(_textures.cbegin(), _textures.cend(),
+					[&tex, &host](const texture &item) { return item.resource == host.resource && is_used_by_same_effect(item, tex); }))
+				continue;
+
+			tex.resource = host.resource;
+			std::copy_n(host.srv, 2, tex.srv);
+			std::copy_n(host.rtv, 2, tex.rtv);
+			tex.uav = host.uav;
+			tex.aliased = true;
+			return true;
+		}
+	}
+
 	api::resource_type type = api::resource_type::unknown;
 	api::resource_view_type view_type = api::resource_view_type::unknown;
 
@@ -3428,6 +4082,29 @@ void reshade::runtime::destroy_texture(texture &tex)
 		_preview_texture.handle = 0;
 #endif
 
+	if (tex.aliased)
+	{
+		// Resource and views are owned by another texture, so simply forget about them
+		tex.resource = {};
+		std::fill_n(tex.srv, 2, api::resource_view {});
+		std::fill_n(tex.rtv, 2, api::resource_view {});
+		tex.uav.clear();
+		tex.aliased = false;
+		return;
+	}
+
+	// Hand over ownership of the resource and views to a texture sharing them, instead of destroying them while they are still in use
+	if (const auto alias = std::find_if(_textures.begin(), _textures.end(),
+			[&tex](const texture &item) { return item.aliased && item.resource == tex.resource; });
+		tex.resource != 0 && alias != _textures.end())
+	{
+		alias->aliased = false;
+
+		tex.aliased = true;
+		destroy_texture(tex);
+		return;
+	}
+
 	_device->destroy_resource(tex.resource);
 	tex.resource = {};
 
@@ -3705,13 +4382,27 @@ bool reshade::runtime::save_effect_cache(const std::string &id, const std::strin
 	std::filesystem::path path = g_reshade_base_path / _effect_cache_path;
 	path /= std::filesystem::u8path("reshade-" + id + '.' + type);
 
-	FILE *const file = _wfsopen(path.c_str(), L"wb", SH_DENYNO);
+	// Effects are loaded on multiple threads and can write the same cache file (e.g. when they use the same source image), so write to a file unique to this thread and then replace the cache file with it
+	std::filesystem::path temp_path = path;
+	temp_path += L'.' + std::to_wstring(GetCurrentThreadId()) + L".tmp";
+
+	FILE *const file = _wfsopen(temp_path.c_str(), L"wb", SH_DENYWR);
 	if (file == nullptr)
 		return false;
 
 	const size_t file_size_written = fwrite(data.data(), 1, data.size(), file);
 	fclose(file);
-	return file_size_written == data.size();
+
+	std::error_code ec;
+	if (file_size_written == data.size())
+		std::filesystem::rename(temp_path, path, ec);
+	if (file_size_written != data.size() || ec)
+	{
+		std::filesystem::remove(temp_path, ec);
+		return false;
+	}
+
+	return true;
 }
 void reshade::runtime::clear_effect_cache()
 {
@@ -3725,7 +4416,7 @@ void reshade::runtime::clear_effect_cache()
 
 		const std::filesystem::path filename = entry.path().filename();
 		const std::filesystem::path extension = entry.path().extension();
-		if (filename.native().compare(0, 8, L"reshade-") != 0 || (extension != L".i" && extension != L".cso" && extension != L".asm"))
+		if (filename.native().compare(0, 8, L"reshade-") != 0 || (extension != L".i" && extension != L".cso" && extension != L".asm" && extension != L".tex" && extension != L".outline"))
 			continue;
 
 		std::filesystem::remove(entry, ec);
@@ -3977,9 +4668,11 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 		if (!effect.rendering || (!_effects_enabled && !effect.addon))
 			continue;
 
-		for (uniform &variable : effect.uniforms)
+		for (const special_uniform_update &update : effect.special_uniform_updates)
 		{
-			switch (variable.special)
+			uniform &variable = effect.uniforms[update.uniform_index];
+
+			switch (update.special)
 			{
 				case special_uniform::frame_time:
 				{
@@ -3996,19 +4689,19 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 				}
 				case special_uniform::random:
 				{
-					const int min = variable.annotation_as_int("min", 0, 0);
-					const int max = variable.annotation_as_int("max", 0, RAND_MAX);
+					const int min = update.int_range[0];
+					const int max = update.int_range[1];
 					set_uniform_value(variable, min + (std::rand() % (std::abs(max - min) + 1)));
 					break;
 				}
 				case special_uniform::ping_pong:
 				{
-					const float min = variable.annotation_as_float("min", 0, 0.0f);
-					const float max = variable.annotation_as_float("max", 0, 1.0f);
-					const float step_min = variable.annotation_as_float("step", 0);
-					const float step_max = variable.annotation_as_float("step", 1);
+					const float min = update.float_range[0];
+					const float max = update.float_range[1];
+					const float step_min = update.step[0];
+					const float step_max = update.step[1];
 					float increment = step_max == 0 ? step_min : (step_min + std::fmod(static_cast<float>(std::rand()), step_max - step_min + 1));
-					const float smoothing = variable.annotation_as_float("smoothing");
+					const float smoothing = update.smoothing;
 
 					float value[2] = { 0, 0 };
 					get_uniform_value(variable, value, 2);
@@ -4056,21 +4749,22 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 					if (_input == nullptr)
 						break;
 
-					if (const int keycode = variable.annotation_as_int("keycode");
-						keycode > 7 && keycode < 256)
+					switch (update.mode)
 					{
-						if (const std::string_view mode = variable.annotation_as_string("mode");
-							mode == "toggle" || variable.annotation_as_int("toggle"))
+					case special_uniform_update::key_mode::toggle:
+						if (_input->is_key_pressed(update.keycode))
 						{
 							bool current_value = false;
 							get_uniform_value(variable, &current_value);
-							if (_input->is_key_pressed(keycode))
-								set_uniform_value(variable, !current_value);
+							set_uniform_value(variable, !current_value);
 						}
-						else if (mode == "press")
-							set_uniform_value(variable, _input->is_key_pressed(keycode));
-						else
-							set_uniform_value(variable, _input->is_key_down(keycode));
+						break;
+					case special_uniform_update::key_mode::press:
+						set_uniform_value(variable, _input->is_key_pressed(update.keycode));
+						break;
+					case special_uniform_update::key_mode::down:
+						set_uniform_value(variable, _input->is_key_down(update.keycode));
+						break;
 					}
 					break;
 				}
@@ -4095,21 +4789,22 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 					if (_input == nullptr)
 						break;
 
-					if (const int keycode = variable.annotation_as_int("keycode");
-						keycode >= 0 && keycode < 5)
+					switch (update.mode)
 					{
-						if (const std::string_view mode = variable.annotation_as_string("mode");
-							mode == "toggle" || variable.annotation_as_int("toggle"))
+					case special_uniform_update::key_mode::toggle:
+						if (_input->is_mouse_button_pressed(update.keycode))
 						{
 							bool current_value = false;
 							get_uniform_value(variable, &current_value);
-							if (_input->is_mouse_button_pressed(keycode))
-								set_uniform_value(variable, !current_value);
+							set_uniform_value(variable, !current_value);
 						}
-						else if (mode == "press")
-							set_uniform_value(variable, _input->is_mouse_button_pressed(keycode));
-						else
-							set_uniform_value(variable, _input->is_mouse_button_down(keycode));
+						break;
+					case special_uniform_update::key_mode::press:
+						set_uniform_value(variable, _input->is_mouse_button_pressed(update.keycode));
+						break;
+					case special_uniform_update::key_mode::down:
+						set_uniform_value(variable, _input->is_mouse_button_down(update.keycode));
+						break;
 					}
 					break;
 				}
@@ -4118,11 +4813,9 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 					if (_input == nullptr)
 						break;
 
-					const float min = variable.annotation_as_float("min");
-					const float max = variable.annotation_as_float("max");
-					float step = variable.annotation_as_float("step");
-					if (step == 0.0f)
-						step  = 1.0f;
+					const float min = update.float_range[0];
+					const float max = update.float_range[1];
+					const float step = update.step[0];
 
 					float value[2] = { 0, 0 };
 					get_uniform_value(variable, value, 2);
@@ -4198,6 +4891,9 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 	cmd_list->begin_debug_event("ReShade effects");
 #endif
 
+	// The application may have changed constant registers since effects were last rendered
+	_uniform_push_constants_effect_index = std::numeric_limits<size_t>::max();
+
 	// Render all enabled techniques
 	for (size_t technique_index : _technique_sorting)
 	{
@@ -4239,7 +4935,7 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 }
 void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_list, api::resource back_buffer_resource, api::resource_view back_buffer_rtv, api::resource_view back_buffer_rtv_srgb, size_t permutation_index)
 {
-	const effect &effect = _effects[tech.effect_index];
+	effect &effect = _effects[tech.effect_index];
 	const effect::permutation &permutation = effect.permutations[permutation_index];
 
 #ifndef NDEBUG
@@ -4275,24 +4971,85 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 	const std::chrono::high_resolution_clock::time_point time_technique_started = std::chrono::high_resolution_clock::now();
 #endif
 
-	// Update shader constants
-	if (void *mapped_uniform_data;
-		effect.cb != 0 && _device->map_buffer_region(effect.cb, 0, effect.uniform_data_storage.size(), api::map_access::write_discard, &mapped_uniform_data))
+	// Update shader constants (only those that were modified since they were last uploaded)
+	if (effect.cb != 0)
 	{
-		std::memcpy(mapped_uniform_data, effect.uniform_data_storage.data(), effect.uniform_data_storage.size());
-		_device->unmap_buffer_region(effect.cb);
+		if (!effect.uniform_data_dirty_ranges.empty())
+		{
+			const api::device_api api = _device->get_api();
+
+			// Not done in OpenGL, since mapping a range without invalidating it synchronizes with the GPU if it is still reading from the buffer, which would cost more than uploading everything with 'write_discard' (which orphans the buffer instead)
+			if (api == api::device_api::d3d12 || api == api::device_api::vulkan)
+			{
+				// Can write to parts of the constant buffer without discarding the rest of its contents in these APIs, so only map the range that changed
+				const uint32_t dirty_begin = effect.uniform_data_dirty_ranges.front().first;
+				const uint32_t dirty_end = effect.uniform_data_dirty_ranges.back().second;
+
+				if (void *mapped_uniform_data;
+					_device->map_buffer_region(effect.cb, dirty_begin, dirty_end - dirty_begin, api::map_access::write_only, &mapped_uniform_data))
+				{
+					for (const auto &[range_begin, range_end] : effect.uniform_data_dirty_ranges)
+						std::memcpy(static_cast<uint8_t *>(mapped_uniform_data) + (range_begin - dirty_begin), effect.uniform_data_storage.data() + range_begin, range_end - range_begin);
+					_device->unmap_buffer_region(effect.cb);
+
+					effect.uniform_data_dirty_ranges.clear();
+				}
+			}
+			else if (void *mapped_uniform_data;
+				_device->map_buffer_region(effect.cb, 0, effect.uniform_data_storage.size(), api::map_access::write_discard, &mapped_uniform_data))
+			{
+				std::memcpy(mapped_uniform_data, effect.uniform_data_storage.data(), effect.uniform_data_storage.size());
+				_device->unmap_buffer_region(effect.cb);
+
+				effect.uniform_data_dirty_ranges.clear();
+			}
+		}
 	}
 	else if (_device->get_api() == api::device_api::d3d9)
 	{
-		cmd_list->push_constants(api::shader_stage::all, permutation.layout, 0, 0, static_cast<uint32_t>(effect.uniform_data_storage.size() / 4), effect.uniform_data_storage.data());
+		// Constant registers are shared between all effects, so can only push modified ranges if this effect was the last one to push its data
+		if (_uniform_push_constants_effect_index != tech.effect_index)
+		{
+			cmd_list->push_constants(api::shader_stage::all, permutation.layout, 0, 0, static_cast<uint32_t>(effect.uniform_data_storage.size() / 4), effect.uniform_data_storage.data());
+		}
+		else
+		{
+			for (const auto &[range_begin, range_end] : effect.uniform_data_dirty_ranges)
+				cmd_list->push_constants(api::shader_stage::all, permutation.layout, 0, range_begin / 4, (range_end - range_begin) / 4, effect.uniform_data_storage.data() + range_begin);
+		}
+
+		effect.uniform_data_dirty_ranges.clear();
+
+		_uniform_push_constants_effect_index = tech.effect_index;
 	}
 
 	const bool sampler_with_resource_view = _device->check_capability(api::device_caps::sampler_with_resource_view);
 
+	const auto apply_transitions = [cmd_list](const technique::transitions &transitions) {
+		if (!transitions.barriers_before_mipmaps.resources.empty())
+			cmd_list->barrier(static_cast<uint32_t>(transitions.barriers_before_mipmaps.resources.size()), transitions.barriers_before_mipmaps.resources.data(), transitions.barriers_before_mipmaps.old_states.data(), transitions.barriers_before_mipmaps.new_states.data());
+
+		// Generate mipmaps for resources modified by previous passes
+		for (const api::resource_view modified_texture : transitions.generate_mipmap_views)
+			cmd_list->generate_mipmaps(modified_texture);
+
+		if (!transitions.barriers.resources.empty())
+			cmd_list->barrier(static_cast<uint32_t>(transitions.barriers.resources.size()), transitions.barriers.resources.data(), transitions.barriers.old_states.data(), transitions.barriers.new_states.data());
+	};
+
 	bool is_effect_stencil_cleared = false;
 	bool needs_implicit_back_buffer_copy = true; // First pass always needs the back buffer updated
 
-	for (size_t pass_index = 0; pass_index < tech.permutations[permutation_index].passes.size(); ++pass_index)
+	const std::vector<technique::pass> &passes = tech.permutations[permutation_index].passes;
+
+	// Timestamp queries must not be issued inside a render pass, so every pass begins and ends its own render pass while gathering statistics
+	bool allow_continue_render_pass = true;
+#if RESHADE_GUI
+	if (gather_gpu_statistics)
+		allow_continue_render_pass = false;
+#endif
+
+	for (size_t pass_index = 0; pass_index < passes.size(); ++pass_index)
 	{
 		if (needs_implicit_back_buffer_copy)
 		{
@@ -4306,7 +5063,10 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 			cmd_list->barrier(2, resources, state_new, state_old);
 		}
 
-		const technique::pass &pass = tech.permutations[permutation_index].passes[pass_index];
+		const technique::pass &pass = passes[pass_index];
+
+		// Transition resources for this pass and generate mipmaps for resources previous passes modified (batched and only where necessary)
+		apply_transitions(pass.transitions_before);
 
 #ifndef NDEBUG
 		cmd_list->begin_debug_event((pass.name.empty() ? "Pass " + std::to_string(pass_index) : pass.name).c_str());
@@ -4317,8 +5077,6 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 			cmd_list->end_query(effect.query_heap, api::query_type::timestamp, query_base_index + static_cast<uint32_t>((1 + pass_index) * 2));
 #endif
 
-		const uint32_t num_barriers = static_cast<uint32_t>(pass.modified_resources.size());
-
 		if (!pass.cs_entry_point.empty())
 		{
 			// Compute shaders do not write to the back buffer, so no update necessary
@@ -4326,36 +5084,26 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 
 			cmd_list->bind_pipeline(api::pipeline_stage::all_compute, pass.pipeline);
 
-			temp_mem<api::resource_usage> state_old, state_new;
-			std::fill_n(state_old.p, num_barriers, api::resource_usage::shader_resource);
-			std::fill_n(state_new.p, num_barriers, api::resource_usage::unordered_access);
-			cmd_list->barrier(num_barriers, pass.modified_resources.data(), state_old.p, state_new.p);
-
-			// Reset bindings on every pass (since they get invalidated by the call to 'generate_mipmaps' below)
-			if (effect.cb != 0)
-				cmd_list->bind_descriptor_table(api::shader_stage::all_compute, permutation.layout, 0, permutation.cb_table);
-			if (permutation.sampler_table != 0)
-				assert(!sampler_with_resource_view),
-				cmd_list->bind_descriptor_table(api::shader_stage::all_compute, permutation.layout, 1, permutation.sampler_table);
+			// Reset shared bindings only when necessary (they get invalidated by calls to 'generate_mipmaps' and when switching between compute and graphics)
+			if (pass.bind_shared_tables)
+			{
+				if (effect.cb != 0)
+					cmd_list->bind_descriptor_table(api::shader_stage::all_compute, permutation.layout, 0, permutation.cb_table);
+				if (permutation.sampler_table != 0)
+					assert(!sampler_with_resource_view),
+					cmd_list->bind_descriptor_table(api::shader_stage::all_compute, permutation.layout, 1, permutation.sampler_table);
+			}
 			if (!pass.texture_bindings.empty())
 				cmd_list->bind_descriptor_table(api::shader_stage::all_compute, permutation.layout, sampler_with_resource_view ? 1 : 2, pass.texture_table);
 			if (!pass.storage_bindings.empty())
 				cmd_list->bind_descriptor_table(api::shader_stage::all_compute, permutation.layout, sampler_with_resource_view ? 2 : 3, pass.storage_table);
 
 			cmd_list->dispatch(pass.viewport_width, pass.viewport_height, pass.viewport_dispatch_z);
-
-			cmd_list->barrier(num_barriers, pass.modified_resources.data(), state_new.p, state_old.p);
 		}
 		else
 		{
 			cmd_list->bind_pipeline(api::pipeline_stage::all_graphics, pass.pipeline);
 
-			// Transition resource state for render targets
-			temp_mem<api::resource_usage> state_old, state_new;
-			std::fill_n(state_old.p, num_barriers, api::resource_usage::shader_resource);
-			std::fill_n(state_new.p, num_barriers, api::resource_usage::render_target);
-			cmd_list->barrier(num_barriers, pass.modified_resources.data(), state_old.p, state_new.p);
-
 			// Setup render targets
 			uint32_t render_target_count = 0;
 			api::render_pass_depth_stencil_desc depth_stencil = {};
@@ -4393,14 +5141,19 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 					depth_stencil.stencil_load_op = api::render_pass_load_op::clear, is_effect_stencil_cleared = true;
 			}
 
-			cmd_list->begin_render_pass(render_target_count, render_target, depth_stencil.view != 0 ? &depth_stencil : nullptr);
+			// Passes writing to the same render targets as the previous pass can continue its render pass
+			if (!pass.continue_render_pass || !allow_continue_render_pass)
+				cmd_list->begin_render_pass(render_target_count, render_target, depth_stencil.view != 0 ? &depth_stencil : nullptr);
 
-			// Reset bindings on every pass (since they get invalidated by the call to 'generate_mipmaps' below)
-			if (effect.cb != 0)
-				cmd_list->bind_descriptor_table(api::shader_stage::all_graphics, permutation.layout, 0, permutation.cb_table);
-			if (permutation.sampler_table != 0)
-				assert(!sampler_with_resource_view),
-				cmd_list->bind_descriptor_table(api::shader_stage::all_graphics, permutation.layout, 1, permutation.sampler_table);
+			// Reset shared bindings only when necessary (they get invalidated by calls to 'generate_mipmaps' and when switching between compute and graphics)
+			if (pass.bind_shared_tables)
+			{
+				if (effect.cb != 0)
+					cmd_list->bind_descriptor_table(api::shader_stage::all_graphics, permutation.layout, 0, permutation.cb_table);
+				if (permutation.sampler_table != 0)
+					assert(!sampler_with_resource_view),
+					cmd_list->bind_descriptor_table(api::shader_stage::all_graphics, permutation.layout, 1, permutation.sampler_table);
+			}
 			// Setup shader resources after binding render targets, to ensure any OM bindings by the application are unset at this point (e.g. a depth buffer that was bound to the OM and is now bound as shader resource)
 			if (!pass.texture_bindings.empty())
 				cmd_list->bind_descriptor_table(api::shader_stage::all_graphics, permutation.layout, sampler_with_resource_view ? 1 : 2, pass.texture_table);
@@ -4456,10 +5209,8 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 			// Draw primitives
 			cmd_list->draw(pass.num_vertices, 1, 0, 0);
 
-			cmd_list->end_render_pass();
-
-			// Transition resource state back to shader access
-			cmd_list->barrier(num_barriers, pass.modified_resources.data(), state_new.p, state_old.p);
+			if (pass_index + 1 >= passes.size() || !passes[pass_index + 1].continue_render_pass || !allow_continue_render_pass)
+				cmd_list->end_render_pass();
 		}
 
 #if RESHADE_GUI
@@ -4467,15 +5218,14 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 			cmd_list->end_query(effect.query_heap, api::query_type::timestamp, query_base_index + static_cast<uint32_t>((1 + pass_index) * 2) + 1);
 #endif
 
-		// Generate mipmaps for modified resources
-		for (const api::resource_view modified_texture : pass.generate_mipmap_views)
-			cmd_list->generate_mipmaps(modified_texture);
-
 #ifndef NDEBUG
 		cmd_list->end_debug_event();
 #endif
 	}
 
+	// Transition all resources back to shader access and generate any outstanding mipmaps, so that other techniques can access them
+	apply_transitions(tech.permutations[permutation_index].transitions_after);
+
 #if RESHADE_GUI
 	const std::chrono::high_resolution_clock::time_point time_technique_finished = std::chrono::high_resolution_clock::now();
 
@@ -4490,7 +5240,13 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 #endif
 
 #if RESHADE_ADDON
-	invoke_addon_event<addon_event::reshade_render_technique>(const_cast<runtime *>(this), api::effect_technique { reinterpret_cast<uintptr_t>(&tech) }, cmd_list, back_buffer_rtv, back_buffer_rtv_srgb);
+	if (has_addon_event<addon_event::reshade_render_technique>())
+	{
+		invoke_addon_event<addon_event::reshade_render_technique>(const_cast<runtime *>(this), api::effect_technique { reinterpret_cast<uintptr_t>(&tech) }, cmd_list, back_buffer_rtv, back_buffer_rtv_srgb);
+
+		// Add-ons may have modified constant registers
+		_uniform_push_constants_effect_index = std::numeric_limits<size_t>::max();
+	}
 #endif
 }
 
@@ -4512,7 +5268,7 @@ void reshade::runtime::save_texture(const texture &tex)
 	if (std::vector<uint8_t> pixels(static_cast<size_t>(tex.width) * static_cast<size_t>(tex.height) * 4);
 		get_texture_data(tex.resource, api::resource_usage::shader_resource, pixels.data()))
 	{
-		_worker_threads.emplace_back([this, screenshot_path, pixels = std::move(pixels), width = tex.width, height = tex.height]() mutable {
+		queue_screenshot_job([this, screenshot_path, pixels = std::move(pixels), width = tex.width, height = tex.height]() mutable {
 			// Default to a save failure unless it is reported to succeed below
 			bool save_success = false;
 
@@ -4567,90 +5323,139 @@ void reshade::runtime::update_texture(texture &tex, uint32_t width, uint32_t hei
 	uint32_t pixel_size;
 	stbir_datatype data_type;
 	stbir_pixel_layout pixel_layout;
-	switch (tex.format)
-	{
-	case reshadefx::texture_format::r8:
-		pixel_size = 1 * 1;
-		data_type = STBIR_TYPE_UINT8;
-		pixel_layout = STBIR_1CHANNEL;
-		break;
-	case reshadefx::texture_format::r32f:
-		pixel_size = 4 * 1;
-		data_type = STBIR_TYPE_FLOAT;
-		pixel_layout = STBIR_1CHANNEL;
-		break;
-	case reshadefx::texture_format::rg8:
-		pixel_size = 1 * 2;
-		data_type = STBIR_TYPE_UINT8;
-		pixel_layout = STBIR_2CHANNEL;
-		break;
-	case reshadefx::texture_format::rg16:
-		pixel_size = 2 * 2;
-		data_type = STBIR_TYPE_UINT16;
-		pixel_layout = STBIR_2CHANNEL;
-		break;
-	case reshadefx::texture_format::rg16f:
-		pixel_size = 2 * 2;
-		data_type = STBIR_TYPE_HALF_FLOAT;
-		pixel_layout = STBIR_2CHANNEL;
-		break;
-	case reshadefx::texture_format::rg32f:
-		pixel_size = 4 * 2;
-		data_type = STBIR_TYPE_FLOAT;
-		pixel_layout = STBIR_2CHANNEL;
-		break;
-	case reshadefx::texture_format::rgba8:
-	case reshadefx::texture_format::rgb10a2:
-		pixel_size = 1 * 4;
-		data_type = STBIR_TYPE_UINT8;
-		pixel_layout = STBIR_RGBA;
-		break;
-	case reshadefx::texture_format::rgba16:
-		pixel_size = 2 * 4;
-		data_type = STBIR_TYPE_UINT16;
-		pixel_layout = STBIR_RGBA;
-		break;
-	case reshadefx::texture_format::rgba16f:
-		pixel_size = 2 * 4;
-		data_type = STBIR_TYPE_HALF_FLOAT;
-		pixel_layout = STBIR_RGBA;
-		break;
-	case reshadefx::texture_format::rgba32f:
-		pixel_size = 4 * 4;
-		data_type = STBIR_TYPE_FLOAT;
-		pixel_layout = STBIR_RGBA;
-		break;
-	default:
+	if (!get_texture_upload_format(tex.format, pixel_size, data_type, pixel_layout))
 		return;
-	}
-
-	void *upload_data = const_cast<void *>(pixels);
 
-	// Need to potentially resize image data to the texture dimensions
-	std::vector<uint8_t> resized;
 	if (tex.width != width || tex.height != height)
-	{
 		log::message(log::level::info, "Resizing image data for texture '%s' from %ux%u to %ux%u.", tex.unique_name.c_str(), width, height, tex.width, tex.height);
 
-		resized.resize(static_cast<size_t>(tex.width) * static_cast<size_t>(tex.height) * static_cast<size_t>(tex.depth) * static_cast<size_t>(pixel_size));
+	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
+
+	// Rows in the upload buffer have to be aligned to 256 bytes in D3D12 (which all pixel sizes evenly divide)
+	const uint32_t row_pitch = (tex.width * pixel_size + 255) & ~255u;
+
+	if (uint64_t upload_offset; tex.depth == 1 && allocate_upload_ring_space(static_cast<uint64_t>(row_pitch) * tex.height, upload_offset))
+	{
+		uint8_t *const upload_data = _upload_ring_data + upload_offset;
+
+		// Resize or copy image data straight into the mapped upload buffer, so that no intermediate memory is needed
+		if (tex.width != width || tex.height != height)
+			stbir_resize(pixels, width, height, 0, upload_data, tex.width, tex.height, row_pitch, pixel_layout, data_type, STBIR_EDGE_CLAMP, STBIR_FILTER_DEFAULT);
+		else
+			for (size_t y = 0; y < tex.height; ++y)
+				std::memcpy(upload_data + y * row_pitch, static_cast<const uint8_t *>(pixels) + y * tex.width * pixel_size, tex.width * pixel_size);
 
-		upload_data = stbir_resize(pixels, width, height, 0, resized.data(), tex.width, tex.height, 0, pixel_layout, data_type, STBIR_EDGE_CLAMP, STBIR_FILTER_DEFAULT);
+		cmd_list->barrier(tex.resource, api::resource_usage::shader_resource, api::resource_usage::copy_dest);
+		cmd_list->copy_buffer_to_texture(_upload_ring_buffer, upload_offset, row_pitch / pixel_size, tex.height, tex.resource, 0);
+		cmd_list->barrier(tex.resource, api::resource_usage::copy_dest, api::resource_usage::shader_resource);
 	}
+	else
+	{
+		void *upload_data = const_cast<void *>(pixels);
 
-	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
-	cmd_list->barrier(tex.resource, api::resource_usage::shader_resource, api::resource_usage::copy_dest);
-	_device->update_texture_region({ upload_data, tex.width * pixel_size, tex.width * tex.height * pixel_size }, tex.resource, 0);
-	cmd_list->barrier(tex.resource, api::resource_usage::copy_dest, api::resource_usage::shader_resource);
+		// Need to potentially resize image data to the texture dimensions
+		std::vector<uint8_t> resized;
+		if (tex.width != width || tex.height != height)
+		{
+			resized.resize(static_cast<size_t>(tex.width) * static_cast<size_t>(tex.height) * static_cast<size_t>(tex.depth) * static_cast<size_t>(pixel_size));
+
+			upload_data = stbir_resize(pixels, width, height, 0, resized.data(), tex.width, tex.height, 0, pixel_layout, data_type, STBIR_EDGE_CLAMP, STBIR_FILTER_DEFAULT);
+		}
+
+		cmd_list->barrier(tex.resource, api::resource_usage::shader_resource, api::resource_usage::copy_dest);
+		_device->update_texture_region({ upload_data, tex.width * pixel_size, tex.width * tex.height * pixel_size }, tex.resource, 0);
+		cmd_list->barrier(tex.resource, api::resource_usage::copy_dest, api::resource_usage::shader_resource);
+	}
 
 	if (tex.levels > 1)
 		cmd_list->generate_mipmaps(tex.srv[0]);
 }
 
+bool reshade::runtime::allocate_upload_ring_space(uint64_t size, uint64_t &offset)
+{
+	if (_upload_ring_buffer == 0)
+	{
+		if (_upload_ring_unsupported)
+			return false;
+
+		// Only D3D12 and Vulkan allow buffers to stay mapped while the GPU reads from them, the drivers of the other APIs already manage staging memory for texture updates themselves
+		if ((_device->get_api() != api::device_api::d3d12 && _device->get_api() != api::device_api::vulkan) ||
+			!_device->check_capability(api::device_caps::copy_buffer_to_texture))
+		{
+			_upload_ring_unsupported = true;
+			return false;
+		}
+
+		// Add-ons typically stream the same texture every frame, so make room for a few frames worth of it
+		_upload_ring_size = std::max<uint64_t>(32 * 1024 * 1024, ((size + 511) & ~511ull) * 3);
+
+		if (!_device->create_resource(
+				api::resource_desc(_upload_ring_size, api::memory_heap::cpu_to_gpu, api::resource_usage::copy_source),
+				nullptr, api::resource_usage::cpu_access, &_upload_ring_buffer) ||
+			!_device->create_fence(0, api::fence_flags::none, &_upload_ring_fence) ||
+			!_device->map_buffer_region(_upload_ring_buffer, 0, UINT64_MAX, api::map_access::write_only, reinterpret_cast<void **>(&_upload_ring_data)))
+		{
+			log::message(log::level::error, "Failed to create texture upload ring buffer!");
+
+			destroy_upload_ring();
+			_upload_ring_unsupported = true;
+			return false;
+		}
+
+		_device->set_resource_name(_upload_ring_buffer, "ReShade texture upload ring buffer");
+	}
+
+	// Texture data placement has to be aligned to 512 bytes in D3D12
+	size = (size + 511) & ~511ull;
+	if (size > _upload_ring_size)
+		return false;
+
+	// Release space the GPU is done reading from
+	const uint64_t completed_fence_value = _device->get_completed_fence_value(_upload_ring_fence);
+	while (!_upload_ring_in_flight.empty() && _upload_ring_in_flight.front().first <= completed_fence_value)
+	{
+		_upload_ring_tail = _upload_ring_in_flight.front().second;
+		_upload_ring_in_flight.erase(_upload_ring_in_flight.begin());
+	}
+
+	// Allocations cannot wrap around the end of the buffer, so skip the remaining space in that case
+	uint64_t begin = _upload_ring_head;
+	if ((begin % _upload_ring_size) + size > _upload_ring_size)
+		begin += _upload_ring_size - (begin % _upload_ring_size);
+
+	// Fall back to a regular update instead of stalling when the GPU has not caught up yet
+	if (begin + size - _upload_ring_tail > _upload_ring_size)
+		return false;
+
+	offset = begin % _upload_ring_size;
+	_upload_ring_head = begin + size;
+	return true;
+}
+
+void reshade::runtime::destroy_upload_ring()
+{
+	if (_upload_ring_data != nullptr)
+		_device->unmap_buffer_region(_upload_ring_buffer);
+	_upload_ring_data = nullptr;
+
+	_device->destroy_resource(_upload_ring_buffer);
+	_upload_ring_buffer = {};
+	_device->destroy_fence(_upload_ring_fence);
+	_upload_ring_fence = {};
+
+	_upload_ring_size = 0;
+	_upload_ring_head = 0;
+	_upload_ring_tail = 0;
+	_upload_ring_fence_value = 0;
+	_upload_ring_in_flight.clear();
+}
+
 void reshade::runtime::reset_uniform_value(uniform &variable)
 {
 	if (variable.special != reshade::special_uniform::none)
 	{
 		std::memset(_effects[variable.effect_index].uniform_data_storage.data() + variable.offset, 0, variable.size);
+		mark_uniform_data_dirty(_effects[variable.effect_index], variable.offset, variable.size);
 		return;
 	}
 
@@ -4786,20 +5591,31 @@ void reshade::runtime::set_uniform_value_data(uniform &variable, const uint8_t *
 	size = std::min(size, static_cast<size_t>(variable.size));
 	assert(data != nullptr && (size % 4) == 0);
 
-	std::vector<uint8_t> &data_storage = _effects[variable.effect_index].uniform_data_storage;
+	effect &effect = _effects[variable.effect_index];
+	std::vector<uint8_t> &data_storage = effect.uniform_data_storage;
 	assert(variable.offset + size <= data_storage.size());
 
 	const size_t array_length = (variable.type.is_array() ? variable.type.array_length : 1u);
 	if (assert(base_index < array_length); base_index >= array_length)
 		return;
 
+	// Only copy data that actually changed, so that the variable is only marked for upload when necessary
+	bool modified = false;
+	const auto copy_if_modified = [&modified](uint8_t *dst, const uint8_t *src, size_t src_size) {
+		if (std::memcmp(dst, src, src_size) != 0)
+		{
+			std::memcpy(dst, src, src_size);
+			modified = true;
+		}
+	};
+
 	if (variable.type.is_matrix())
 	{
 		for (size_t a = base_index, i = 0; a < array_length; ++a)
 			// Each row of a matrix is 16-byte aligned, so needs special handling
 			for (size_t row = 0; row < variable.type.rows; ++row)
 				for (size_t col = 0; i < (size / 4) && col < variable.type.cols; ++col, ++i)
-					std::memcpy(
+					copy_if_modified(
 						data_storage.data() + variable.offset + (a * variable.type.rows * 4 + (row * 4 + col)) * 4,
 						data + ((a - base_index) * variable.type.components() + (row * variable.type.cols + col)) * 4, 4);
 	}
@@ -4808,14 +5624,17 @@ void reshade::runtime::set_uniform_value_data(uniform &variable, const uint8_t *
 		for (size_t a = base_index, i = 0; a < array_length; ++a)
 			// Each element in the array is 16-byte aligned, so needs special handling
 			for (size_t row = 0; i < (size / 4) && row < variable.type.rows; ++row, ++i)
-				std::memcpy(
+				copy_if_modified(
 					data_storage.data() + variable.offset + (a * 4 + row) * 4,
 					data + ((a - base_index) * variable.type.components() + row) * 4, 4);
 	}
 	else
 	{
-		std::memcpy(data_storage.data() + variable.offset, data, size);
+		copy_if_modified(data_storage.data() + variable.offset, data, size);
 	}
+
+	if (modified)
+		mark_uniform_data_dirty(effect, variable.offset, variable.size);
 }
 
 template <> void reshade::runtime::set_uniform_value<bool>(uniform &variable, const bool *values, size_t count, size_t array_index)
@@ -5023,105 +5842,198 @@ void reshade::runtime::save_screenshot(const char *postfix_in)
 
 	_last_screenshot_save_successful = true;
 
-	if (std::vector<uint8_t> pixels(static_cast<size_t>(_width) * static_cast<size_t>(_height) * (_back_buffer_format == api::format::r16g16b16a16_float ? 8 : 4));
-		capture_screenshot(pixels.data()))
-	{
-		const bool include_preset =
-			_screenshot_include_preset &&
-			postfix != "Before" && postfix != "Overlay" &&
-			ini_file::flush_cache(_current_preset_path);
+	const bool include_preset =
+		_screenshot_include_preset &&
+		postfix != "Before" && postfix != "Overlay" &&
+		ini_file::flush_cache(_current_preset_path);
 
-		// Play screenshot sound
-		if (!_screenshot_sound_path.empty())
-			utils::play_sound_async(g_reshade_base_path / _screenshot_sound_path);
+	// Encoding and writing the image happens on a screenshot worker thread once the image data is available
+	auto save_image = [this, screenshot_count, screenshot_format, screenshot_path, postfix, include_preset, back_buffer_format = _back_buffer_format](std::vector<uint8_t> &&pixels, uint32_t width, uint32_t height) {
+		// Remove alpha channel
+		int comp = 4;
+		if (_screenshot_clear_alpha && screenshot_format != 3)
+		{
+			comp = 3;
+			for (size_t i = 0; i < static_cast<size_t>(width) * static_cast<size_t>(height); ++i)
+				*reinterpret_cast<uint32_t *>(pixels.data() + 3 * i) = *reinterpret_cast<const uint32_t *>(pixels.data() + 4 * i);
+		}
 
-		_worker_threads.emplace_back([this, screenshot_count, screenshot_format, screenshot_path, postfix, pixels = std::move(pixels), include_preset]() mutable {
-			// Remove alpha channel
-			int comp = 4;
-			if (_screenshot_clear_alpha && screenshot_format != 3)
-			{
-				comp = 3;
-				for (size_t i = 0; i < static_cast<size_t>(_width) * static_cast<size_t>(_height); ++i)
-					*reinterpret_cast<uint32_t *>(pixels.data() + 3 * i) = *reinterpret_cast<const uint32_t *>(pixels.data() + 4 * i);
-			}
+		// Create screenshot directory if it does not exist
+		std::error_code ec;
+		_screenshot_directory_creation_successful = true;
+		if (!std::filesystem::exists(screenshot_path.parent_path(), ec))
+			if (!(_screenshot_directory_creation_successful = std::filesystem::create_directories(screenshot_path.parent_path(), ec)))
+				log::message(log::level::error, "Failed to create screenshot directory '%s' with error code %d!", screenshot_path.parent_path().u8string().c_str(), ec.value());
 
-			// Create screenshot directory if it does not exist
-			std::error_code ec;
-			_screenshot_directory_creation_successful = true;
-			if (!std::filesystem::exists(screenshot_path.parent_path(), ec))
-				if (!(_screenshot_directory_creation_successful = std::filesystem::create_directories(screenshot_path.parent_path(), ec)))
-					log::message(log::level::error, "Failed to create screenshot directory '%s' with error code %d!", screenshot_path.parent_path().u8string().c_str(), ec.value());
+		// Default to a save failure unless it is reported to succeed below
+		bool save_success = false;
 
-			// Default to a save failure unless it is reported to succeed below
-			bool save_success = false;
+		if (FILE *const file = _wfsopen(screenshot_path.c_str(), L"wb", SH_DENYNO))
+		{
+			const auto write_callback = [](void *context, void *data, int size) {
+				fwrite(data, 1, size, static_cast<FILE *>(context));
+			};
 
-			if (FILE *const file = _wfsopen(screenshot_path.c_str(), L"wb", SH_DENYNO))
+			switch (screenshot_format)
 			{
-				const auto write_callback = [](void *context, void *data, int size) {
-					fwrite(data, 1, size, static_cast<FILE *>(context));
-				};
-
-				switch (screenshot_format)
-				{
-				case 0:
-					save_success = stbi_write_bmp_to_func(write_callback, file, _width, _height, comp, pixels.data()) != 0;
-					break;
-				case 1:
+			case 0:
+				save_success = stbi_write_bmp_to_func(write_callback, file, width, height, comp, pixels.data()) != 0;
+				break;
+			case 1:
 #if 1
-					if (std::vector<uint8_t> encoded_data;
-						fpng::fpng_encode_image_to_memory(pixels.data(), _width, _height, comp, encoded_data))
-						save_success = fwrite(encoded_data.data(), 1, encoded_data.size(), file) == encoded_data.size();
+				if (std::vector<uint8_t> encoded_data;
+					fpng::fpng_encode_image_to_memory(pixels.data(), width, height, comp, encoded_data))
+					save_success = fwrite(encoded_data.data(), 1, encoded_data.size(), file) == encoded_data.size();
 #else
-					save_success = stbi_write_png_to_func(write_callback, file, _width, _height, comp, pixels.data(), 0) != 0;
+				save_success = stbi_write_png_to_func(write_callback, file, width, height, comp, pixels.data(), 0) != 0;
 #endif
-					break;
-				case 2:
-					save_success = stbi_write_jpg_to_func(write_callback, file, _width, _height, comp, pixels.data(), _screenshot_jpeg_quality) != 0;
-					break;
-				// Implicit HDR PNG when running in HDR
-				case 3:
-					save_success = sk_hdr_png::write_image_to_disk(screenshot_path.c_str(), _width, _height, pixels.data(), _screenshot_hdr_bits, _back_buffer_format);
-					break;
-				}
+				break;
+			case 2:
+				save_success = stbi_write_jpg_to_func(write_callback, file, width, height, comp, pixels.data(), _screenshot_jpeg_quality) != 0;
+				break;
+			// Implicit HDR PNG when running in HDR
+			case 3:
+				save_success = sk_hdr_png::write_image_to_disk(screenshot_path.c_str(), width, height, pixels.data(), _screenshot_hdr_bits, back_buffer_format);
+				break;
+			}
 
-				if (ferror(file))
-					save_success = false;
+			if (ferror(file))
+				save_success = false;
 
-				fclose(file);
-			}
+			fclose(file);
+		}
 
-			if (save_success)
+		if (save_success)
+		{
+			execute_screenshot_post_save_command(screenshot_path, screenshot_count, postfix);
+
+			if (include_preset)
 			{
-				execute_screenshot_post_save_command(screenshot_path, screenshot_count, postfix);
+				std::filesystem::path screenshot_preset_path = screenshot_path;
+				screenshot_preset_path.replace_extension(L".ini");
 
-				if (include_preset)
-				{
-					std::filesystem::path screenshot_preset_path = screenshot_path;
-					screenshot_preset_path.replace_extension(L".ini");
+				// Preset was flushed, so can just copy it over to the new location once the background save finished writing it to disk
+				ini_file::wait_for_pending_saves();
 
-					// Preset was flushed to disk, so can just copy it over to the new location
-					if (!std::filesystem::copy_file(_current_preset_path, screenshot_preset_path, std::filesystem::copy_options::overwrite_existing, ec))
-						log::message(log::level::error, "Failed to copy preset file for screenshot to '%s' with error code %d!", screenshot_preset_path.u8string().c_str(), ec.value());
-				}
+				if (!std::filesystem::copy_file(_current_preset_path, screenshot_preset_path, std::filesystem::copy_options::overwrite_existing, ec))
+					log::message(log::level::error, "Failed to copy preset file for screenshot to '%s' with error code %d!", screenshot_preset_path.u8string().c_str(), ec.value());
+			}
 
 #if RESHADE_ADDON
-				invoke_addon_event<addon_event::reshade_screenshot>(this, screenshot_path.u8string().c_str());
+			invoke_addon_event<addon_event::reshade_screenshot>(this, screenshot_path.u8string().c_str());
 #endif
-			}
-			else
-			{
-				log::message(log::level::error, "Failed to write screenshot to '%s'!", screenshot_path.u8string().c_str());
-			}
+		}
+		else
+		{
+			log::message(log::level::error, "Failed to write screenshot to '%s'!", screenshot_path.u8string().c_str());
+		}
 
-			if (_last_screenshot_save_successful)
-			{
-				_last_screenshot_time = std::chrono::high_resolution_clock::now();
-				_last_screenshot_file = screenshot_path;
-				_last_screenshot_save_successful = save_success;
-			}
+		if (_last_screenshot_save_successful)
+		{
+			_last_screenshot_time = std::chrono::high_resolution_clock::now();
+			_last_screenshot_file = screenshot_path;
+			_last_screenshot_save_successful = save_success;
+		}
+	};
+
+	// Read back image data a few frames later to avoid stalling the GPU, or fall back to waiting for it in case that is not possible right now
+	if (queue_texture_readback(
+			_back_buffer_resolved != 0 ? _back_buffer_resolved : _swapchain->get_current_back_buffer(),
+			_back_buffer_resolved != 0 ? api::resource_usage::render_target : api::resource_usage::present,
+			save_image))
+	{
+		// Play screenshot sound
+		if (!_screenshot_sound_path.empty())
+			utils::play_sound_async(g_reshade_base_path / _screenshot_sound_path);
+	}
+	else if (std::vector<uint8_t> pixels(static_cast<size_t>(_width) * static_cast<size_t>(_height) * (_back_buffer_format == api::format::r16g16b16a16_float ? 8 : 4));
+		capture_screenshot(pixels.data()))
+	{
+		// Play screenshot sound
+		if (!_screenshot_sound_path.empty())
+			utils::play_sound_async(g_reshade_base_path / _screenshot_sound_path);
+
+		queue_screenshot_job([save_image = std::move(save_image), pixels = std::move(pixels), width = _width, height = _height]() mutable {
+			save_image(std::move(pixels), width, height);
 		});
 	}
 }
+bool reshade::runtime::is_screenshot_job_queue_full()
+{
+	const std::unique_lock<std::mutex> lock(_screenshot_job_mutex);
+	return _screenshot_jobs.size() >= max_screenshot_jobs;
+}
+void reshade::runtime::queue_screenshot_job(std::function<void()> &&job)
+{
+	std::unique_lock<std::mutex> lock(_screenshot_job_mutex);
+
+	if (_screenshot_workers.empty())
+	{
+		_screenshot_workers_exit = false;
+
+		// Leave enough cores to the application, encoding happens in the background anyway
+		const unsigned int num_workers = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+		for (unsigned int i = 0; i < num_workers; ++i)
+		{
+			_screenshot_workers.emplace_back([this]() {
+				std::unique_lock<std::mutex> worker_lock(_screenshot_job_mutex);
+
+				while (true)
+				{
+					_screenshot_job_available.wait(worker_lock, [this]() { return _screenshot_workers_exit || !_screenshot_jobs.empty(); });
+
+					// Drain the queue before exiting, so that no screenshot is lost
+					if (_screenshot_jobs.empty())
+						break;
+
+					const std::function<void()> current_job = std::move(_screenshot_jobs.front());
+					_screenshot_jobs.pop_front();
+
+					worker_lock.unlock();
+					_screenshot_job_space_available.notify_one();
+
+					current_job();
+
+					worker_lock.lock();
+				}
+			});
+		}
+	}
+
+	// Block when encoding cannot keep up (e.g. during burst capture), to bound the memory held by pending image data
+	_screenshot_job_space_available.wait(lock, [this]() { return _screenshot_jobs.size() < max_screenshot_jobs; });
+
+	_screenshot_jobs.push_back(std::move(job));
+
+	lock.unlock();
+	_screenshot_job_available.notify_one();
+}
+void reshade::runtime::finish_screenshot_jobs()
+{
+	{
+		const std::unique_lock<std::mutex> lock(_screenshot_job_mutex);
+		_screenshot_workers_exit = true;
+	}
+
+	_screenshot_job_available.notify_all();
+
+	for (std::thread &thread : _screenshot_workers)
+		if (thread.joinable())
+			thread.join();
+	_screenshot_workers.clear();
+}
+bool reshade::runtime::capture_screenshot_async(void(*callback)(api::effect_runtime *runtime, const void *pixels, uint32_t width, uint32_t height, void *user_data), void *user_data)
+{
+	if (callback == nullptr)
+		return false;
+
+	return queue_texture_readback(
+		_back_buffer_resolved != 0 ? _back_buffer_resolved : _swapchain->get_current_back_buffer(),
+		_back_buffer_resolved != 0 ? api::resource_usage::render_target : api::resource_usage::present,
+		[this, callback, user_data](std::vector<uint8_t> &&pixels, uint32_t width, uint32_t height) {
+			callback(this, pixels.data(), width, height, user_data);
+		});
+}
 bool reshade::runtime::execute_screenshot_post_save_command(const std::filesystem::path &screenshot_path, unsigned int screenshot_count, std::string_view postfix)
 {
 	if (_screenshot_post_save_command.empty())
@@ -5168,20 +6080,105 @@ bool reshade::runtime::execute_screenshot_post_save_command(const std::filesyste
 	return true;
 }
 
+static bool is_texture_readback_format_supported(reshade::api::format view_format)
+{
+	return
+		view_format == reshade::api::format::r8_unorm ||
+		view_format == reshade::api::format::r8g8_unorm ||
+		view_format == reshade::api::format::r8g8b8a8_unorm ||
+		view_format == reshade::api::format::b8g8r8a8_unorm ||
+		view_format == reshade::api::format::r8g8b8x8_unorm ||
+		view_format == reshade::api::format::b8g8r8x8_unorm ||
+		view_format == reshade::api::format::r10g10b10a2_unorm ||
+		view_format == reshade::api::format::b10g10r10a2_unorm ||
+		view_format == reshade::api::format::r16g16b16a16_float;
+}
+static size_t get_texture_readback_pixel_size(reshade::api::format view_format)
+{
+	// Everything but FP16 is converted to 32-bit pixels
+	return view_format == reshade::api::format::r16g16b16a16_float ? 8 : 4;
+}
+static void convert_texture_readback_data(reshade::api::format view_format, reshade::api::color_space color_space, uint32_t width, uint32_t height, const uint8_t *mapped_pixels, uint32_t mapped_row_pitch, uint8_t *pixels)
+{
+	const size_t pixels_row_pitch = width * get_texture_readback_pixel_size(view_format);
+
+	for (size_t y = 0; y < height; ++y, pixels += pixels_row_pitch, mapped_pixels += mapped_row_pitch)
+	{
+		switch (view_format)
+		{
+		case reshade::api::format::r8_unorm:
+			for (size_t x = 0; x < width; ++x)
+			{
+				pixels[x * 4 + 0] = mapped_pixels[x];
+				pixels[x * 4 + 1] = 0;
+				pixels[x * 4 + 2] = 0;
+				pixels[x * 4 + 3] = 0xFF;
+			}
+			break;
+		case reshade::api::format::r8g8_unorm:
+			for (size_t x = 0; x < width; ++x)
+			{
+				pixels[x * 4 + 0] = mapped_pixels[x * 2 + 0];
+				pixels[x * 4 + 1] = mapped_pixels[x * 2 + 1];
+				pixels[x * 4 + 2] = 0;
+				pixels[x * 4 + 3] = 0xFF;
+			}
+			break;
+		case reshade::api::format::r8g8b8a8_unorm:
+		case reshade::api::format::r8g8b8x8_unorm:
+			std::memcpy(pixels, mapped_pixels, pixels_row_pitch);
+			if (view_format == reshade::api::format::r8g8b8x8_unorm)
+				for (size_t x = 0; x < pixels_row_pitch; x += 4)
+					pixels[x + 3] = 0xFF;
+			break;
+		case reshade::api::format::b8g8r8a8_unorm:
+		case reshade::api::format::b8g8r8x8_unorm:
+			std::memcpy(pixels, mapped_pixels, pixels_row_pitch);
+			// Format is BGRA, but output should be RGBA, so flip channels
+			for (size_t x = 0; x < pixels_row_pitch; x += 4)
+				std::swap(pixels[x + 0], pixels[x + 2]);
+			if (view_format == reshade::api::format::b8g8r8x8_unorm)
+				for (size_t x = 0; x < pixels_row_pitch; x += 4)
+					pixels[x + 3] = 0xFF;
+			break;
+		case reshade::api::format::r10g10b10a2_unorm:
+		case reshade::api::format::b10g10r10a2_unorm:
+			// SDR: Quantize the image down to 8-bpc for compatibility with standard screenshot formats
+			if (color_space != reshade::api::color_space::hdr10_st2084)
+			{
+				for (size_t x = 0; x < pixels_row_pitch; x += 4)
+				{
+					const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_pixels + x);
+					// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
+					pixels[x + 0] = (( rgba & 0x000003FF)        /  4) & 0xFF;
+					pixels[x + 1] = (((rgba & 0x000FFC00) >> 10) /  4) & 0xFF;
+					pixels[x + 2] = (((rgba & 0x3FF00000) >> 20) /  4) & 0xFF;
+					pixels[x + 3] = (((rgba & 0xC0000000) >> 30) * 85) & 0xFF;
+					if (view_format == reshade::api::format::b10g10r10a2_unorm)
+						std::swap(pixels[x + 0], pixels[x + 2]);
+				}
+			}
+			// HDR10: Keep the original data, do not convert to 8-bpc
+			else
+			{
+				std::memcpy(pixels, mapped_pixels, pixels_row_pitch);
+			}
+			break;
+		case reshade::api::format::r16g16b16a16_float:
+			// FP16 is implicitly always scRGB
+			assert(color_space == reshade::api::color_space::extended_srgb_linear);
+			std::memcpy(pixels, mapped_pixels, pixels_row_pitch);
+			break;
+		}
+	}
+}
+
 bool reshade::runtime::get_texture_data(api::resource resource, api::resource_usage state, uint8_t *pixels)
 {
 	const api::resource_desc desc = _device->get_resource_desc(resource);
 
 	const api::format view_format = api::format_to_default_typed(desc.texture.format, 0);
-	if (view_format != api::format::r8_unorm &&
-		view_format != api::format::r8g8_unorm &&
-		view_format != api::format::r8g8b8a8_unorm &&
-		view_format != api::format::b8g8r8a8_unorm &&
-		view_format != api::format::r8g8b8x8_unorm &&
-		view_format != api::format::b8g8r8x8_unorm &&
-		view_format != api::format::r10g10b10a2_unorm &&
-		view_format != api::format::b10g10r10a2_unorm &&
-		view_format != api::format::r16g16b16a16_float)
+	if (!is_texture_readback_format_supported(view_format))
 	{
 		log::message(log::level::error, "Screenshots are not supported for format %u!", static_cast<uint32_t>(desc.texture.format));
 		return false;
@@ -5211,78 +6208,7 @@ bool reshade::runtime::get_texture_data(api::resource resource, api::resource_us
 	api::subresource_data mapped_data = {};
 	if (_device->map_texture_region(intermediate, 0, nullptr, api::map_access::read_only, &mapped_data))
 	{
-		auto mapped_pixels = static_cast<const uint8_t *>(mapped_data.data);
-		const uint32_t pixels_row_pitch = api::format_row_pitch(view_format, desc.texture.width);
-
-		for (size_t y = 0; y < desc.texture.height; ++y, pixels += pixels_row_pitch, mapped_pixels += mapped_data.row_pitch)
-		{
-			switch (view_format)
-			{
-			case api::format::r8_unorm:
-				for (size_t x = 0; x < desc.texture.width; ++x)
-				{
-					pixels[x * 4 + 0] = mapped_pixels[x];
-					pixels[x * 4 + 1] = 0;
-					pixels[x * 4 + 2] = 0;
-					pixels[x * 4 + 3] = 0xFF;
-				}
-				break;
-			case api::format::r8g8_unorm:
-				for (size_t x = 0; x < desc.texture.width; ++x)
-				{
-					pixels[x * 4 + 0] = mapped_pixels[x * 2 + 0];
-					pixels[x * 4 + 1] = mapped_pixels[x * 2 + 1];
-					pixels[x * 4 + 2] = 0;
-					pixels[x * 4 + 3] = 0xFF;
-				}
-				break;
-			case api::format::r8g8b8a8_unorm:
-			case api::format::r8g8b8x8_unorm:
-				std::memcpy(pixels, mapped_pixels, pixels_row_pitch);
-				if (view_format == api::format::r8g8b8x8_unorm)
-					for (size_t x = 0; x < pixels_row_pitch; x += 4)
-						pixels[x + 3] = 0xFF;
-				break;
-			case api::format::b8g8r8a8_unorm:
-			case api::format::b8g8r8x8_unorm:
-				std::memcpy(pixels, mapped_pixels, pixels_row_pitch);
-				// Format is BGRA, but output should be RGBA, so flip channels
-				for (size_t x = 0; x < pixels_row_pitch; x += 4)
-					std::swap(pixels[x + 0], pixels[x + 2]);
-				if (view_format == api::format::b8g8r8x8_unorm)
-					for (size_t x = 0; x < pixels_row_pitch; x += 4)
-						pixels[x + 3] = 0xFF;
-				break;
-			case api::format::r10g10b10a2_unorm:
-			case api::format::b10g10r10a2_unorm:
-				// SDR: Quantize the image down to 8-bpc for compatibility with standard screenshot formats
-				if (_back_buffer_color_space != api::color_space::hdr10_st2084)
-				{
-					for (size_t x = 0; x < pixels_row_pitch; x += 4)
-					{
-						const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_pixels + x);
-						// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-						pixels[x + 0] = (( rgba & 0x000003FF)        /  4) & 0xFF;
-						pixels[x + 1] = (((rgba & 0x000FFC00) >> 10) /  4) & 0xFF;
-						pixels[x + 2] = (((rgba & 0x3FF00000) >> 20) /  4) & 0xFF;
-						pixels[x + 3] = (((rgba & 0xC0000000) >> 30) * 85) & 0xFF;
-						if (view_format == api::format::b10g10r10a2_unorm)
-							std::swap(pixels[x + 0], pixels[x + 2]);
-					}
-				}
-				// HDR10: Keep the original data, do not convert to 8-bpc
-				else
-				{
-					std::memcpy(pixels, mapped_pixels, pixels_row_pitch);
-				}
-				break;
-			case api::format::r16g16b16a16_float:
-				// FP16 is implicitly always scRGB
-				assert(_back_buffer_color_space == api::color_space::extended_srgb_linear);
-				std::memcpy(pixels, mapped_pixels, pixels_row_pitch);
-				break;
-			}
-		}
+		convert_texture_readback_data(view_format, _back_buffer_color_space, desc.texture.width, desc.texture.height, static_cast<const uint8_t *>(mapped_data.data), mapped_data.row_pitch, pixels);
 
 		_device->unmap_texture_region(intermediate, 0);
 	}
@@ -5291,3 +6217,125 @@ bool reshade::runtime::get_texture_data(api::resource resource, api::resource_us
 
 	return mapped_data.data != nullptr;
 }
+
+bool reshade::runtime::queue_texture_readback(api::resource resource, api::resource_usage state, std::function<void(std::vector<uint8_t> &&pixels, uint32_t width, uint32_t height)> &&callback)
+{
+	const api::resource_desc desc = _device->get_resource_desc(resource);
+
+	const api::format view_format = api::format_to_default_typed(desc.texture.format, 0);
+	if (!is_texture_readback_format_supported(view_format))
+	{
+		log::message(log::level::error, "Screenshots are not supported for format %u!", static_cast<uint32_t>(desc.texture.format));
+		return false;
+	}
+
+	if (_texture_readback_fence == 0 && !_device->create_fence(0, api::fence_flags::none, &_texture_readback_fence))
+		return false;
+
+	// Prefer an idle readback with a matching intermediate texture, so that nothing has to be created at steady state
+	const auto is_idle = [](const texture_readback &readback) { return readback.fence_value == 0; };
+	auto readback_it = std::find_if(_texture_readbacks.begin(), _texture_readbacks.end(),
+		[&](const texture_readback &readback) { return is_idle(readback) && readback.format == view_format && readback.width == desc.texture.width && readback.height == desc.texture.height; });
+	if (readback_it == _texture_readbacks.end())
+	{
+		readback_it = std::find_if(_texture_readbacks.begin(), _texture_readbacks.end(), is_idle);
+		if (readback_it == _texture_readbacks.end())
+		{
+			// Limit the number of readbacks in flight (D3D9 fences only track a limited number of pending values)
+			if (_texture_readbacks.size() >= 4)
+				return false;
+
+			readback_it = _texture_readbacks.emplace(_texture_readbacks.end());
+		}
+
+		_device->destroy_resource(readback_it->intermediate);
+		*readback_it = {};
+
+		if (!_device->create_resource(api::resource_desc(desc.texture.width, desc.texture.height, 1, 1, view_format, 1, api::memory_heap::gpu_to_cpu, api::resource_usage::copy_dest), nullptr, api::resource_usage::copy_dest, &readback_it->intermediate))
+		{
+			log::message(log::level::error, "Failed to create system memory texture for screenshot capture!");
+			return false;
+		}
+
+		_device->set_resource_name(readback_it->intermediate, "ReShade screenshot texture");
+
+		readback_it->format = view_format;
+		readback_it->width = desc.texture.width;
+		readback_it->height = desc.texture.height;
+	}
+
+	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
+	cmd_list->barrier(resource, state, api::resource_usage::copy_source);
+	cmd_list->copy_texture_region(resource, 0, nullptr, readback_it->intermediate, 0, nullptr);
+	cmd_list->barrier(resource, api::resource_usage::copy_source, state);
+
+	if (!_graphics_queue->signal(_texture_readback_fence, _texture_readback_fence_value + 1))
+		return false;
+
+	readback_it->fence_value = ++_texture_readback_fence_value;
+	readback_it->callback = std::move(callback);
+
+	return true;
+}
+
+void reshade::runtime::process_texture_readbacks(bool wait_for_all)
+{
+	if (_texture_readback_fence == 0)
+		return;
+
+	const uint64_t completed_fence_value = _device->get_completed_fence_value(_texture_readback_fence);
+
+	for (texture_readback &readback : _texture_readbacks)
+	{
+		if (readback.fence_value == 0)
+			continue;
+
+		// Retry next frame instead of blocking present until encoding caught up
+		if (!wait_for_all && is_screenshot_job_queue_full())
+			continue;
+
+		if (readback.fence_value > completed_fence_value)
+		{
+			// Never block present on a readback, even if it fell behind by several frames, just check again next frame (while all readbacks are in flight, new requests fall back to a synchronous capture instead)
+			if (!wait_for_all)
+				continue;
+
+			if (!_device->wait(_texture_readback_fence, readback.fence_value))
+				_graphics_queue->wait_idle();
+		}
+
+		readback.fence_value = 0;
+
+		// Only copy the mapped data here, conversion happens on the worker thread together with the callback
+		api::subresource_data mapped_data = {};
+		if (!_device->map_texture_region(readback.intermediate, 0, nullptr, api::map_access::read_only, &mapped_data))
+		{
+			readback.callback = nullptr;
+			continue;
+		}
+
+		std::vector<uint8_t> mapped_pixels(static_cast<size_t>(mapped_data.row_pitch) * readback.height);
+		std::memcpy(mapped_pixels.data(), mapped_data.data, mapped_pixels.size());
+
+		_device->unmap_texture_region(readback.intermediate, 0);
+
+		queue_screenshot_job([callback = std::move(readback.callback), mapped_pixels = std::move(mapped_pixels), mapped_row_pitch = mapped_data.row_pitch, format = readback.format, color_space = _back_buffer_color_space, width = readback.width, height = readback.height]() {
+			std::vector<uint8_t> pixels(static_cast<size_t>(width) * static_cast<size_t>(height) * get_texture_readback_pixel_size(format));
+			convert_texture_readback_data(format, color_space, width, height, mapped_pixels.data(), mapped_row_pitch, pixels.data());
+
+			callback(std::move(pixels), width, height);
+		});
+		readback.callback = nullptr;
+	}
+
+	if (wait_for_all)
+	{
+		for (const texture_readback &readback : _texture_readbacks)
+			_device->destroy_resource(readback.intermediate);
+		_texture_readbacks.clear();
+
+		_device->destroy_fence(_texture_readback_fence);
+		_texture_readback_fence = {};
+		_texture_readback_fence_value = 0;
+	}
+}
@@ -11,8 +11,12 @@
 #include <chrono>
 #include <memory>
 #include <filesystem>
+#include <array>
 #include <atomic>
+#include <deque>
+#include <functional>
 #include <shared_mutex>
+#include <condition_variable>
 
 namespace reshade
 {
@@ -69,6 +73,7 @@ namespace reshade
 		/// </summary>
 		void save_screenshot(const char *postfix) final;
 		bool capture_screenshot(void *pixels) final { return get_texture_data(_back_buffer_resolved != 0 ? _back_buffer_resolved : _swapchain->get_current_back_buffer(), _back_buffer_resolved != 0 ? api::resource_usage::render_target : api::resource_usage::present, static_cast<uint8_t *>(pixels)); }
+		bool capture_screenshot_async(void(*callback)(api::effect_runtime *runtime, const void *pixels, uint32_t width, uint32_t height, void *user_data), void *user_data) final;
 
 		void get_screenshot_width_and_height(uint32_t *out_width, uint32_t *out_height) const final { *out_width = _width; *out_height = _height; }
 
@@ -177,6 +182,8 @@ namespace reshade
 		void save_config() const;
 
 		void load_current_preset();
+		void take_preset_snapshot(uint64_t preset_revision);
+		void apply_preset_snapshot(const preset_snapshot &snapshot);
 		void save_current_preset(class ini_file &preset) const;
 
 		bool switch_to_next_preset(std::filesystem::path filter_path, bool reversed = false);
@@ -186,6 +193,7 @@ namespace reshade
 		void destroy_effect(size_t effect_index, bool unload = true);
 
 		void load_textures(size_t effect_index);
+		bool load_texture_source(const texture &texture, std::string &pixels_data) const;
 		bool create_texture(texture &texture);
 		void destroy_texture(texture &texture);
 
@@ -233,6 +241,15 @@ namespace reshade
 		bool get_preprocessor_definition(const std::string &effect_name, const std::string &name, int scope_mask, std::vector<std::pair<std::string, std::string>> *&scope, std::vector<std::pair<std::string, std::string>>::iterator &value) const;
 
 		bool get_texture_data(api::resource resource, api::resource_usage state, uint8_t *pixels);
+		bool queue_texture_readback(api::resource resource, api::resource_usage state, std::function<void(std::vector<uint8_t> &&pixels, uint32_t width, uint32_t height)> &&callback);
+		void process_texture_readbacks(bool wait_for_all);
+
+		bool is_screenshot_job_queue_full();
+		void queue_screenshot_job(std::function<void()> &&job);
+		void finish_screenshot_jobs();
+
+		bool allocate_upload_ring_space(uint64_t size, uint64_t &offset);
+		void destroy_upload_ring();
 
 		bool execute_screenshot_post_save_command(const std::filesystem::path &screenshot_path, unsigned int screenshot_count, std::string_view postfix);
 
@@ -337,11 +354,27 @@ namespace reshade
 		api::pipeline_layout _copy_pipeline_layout = {};
 		api::sampler  _copy_sampler_state = {};
 
+		// Index of the effect whose uniform data was last pushed to the constant registers in D3D9 (those persist across techniques)
+		size_t _uniform_push_constants_effect_index = std::numeric_limits<size_t>::max();
+
 		api::resource _back_buffer_resolved = {};
 		api::resource_view _back_buffer_resolved_srv = {};
 		std::vector<api::resource_view> _back_buffer_targets;
 
 		api::state_block _app_state = {};
+
+		// Persistently mapped buffer that texture updates are streamed through, with the GPU consuming it in frame order
+		api::resource _upload_ring_buffer = {};
+		uint8_t *_upload_ring_data = nullptr;
+		uint64_t _upload_ring_size = 0;
+		uint64_t _upload_ring_head = 0;
+		uint64_t _upload_ring_tail = 0;
+		api::fence _upload_ring_fence = {};
+		uint64_t _upload_ring_fence_value = 0;
+		// Pairs of fence value and ring position, which the GPU is done reading up to once that fence value completed
+		std::vector<std::pair<uint64_t, uint64_t>> _upload_ring_in_flight;
+		// Set once the device turned out to not support the upload ring, which does not change when the runtime is reset (so is not cleared in 'destroy_upload_ring')
+		bool _upload_ring_unsupported = false;
 		#pragma endregion
 
 		#pragma region Screenshot
@@ -369,6 +402,28 @@ namespace reshade
 		bool _screenshot_directory_creation_successful = true;
 		std::filesystem::path _last_screenshot_file;
 		std::chrono::high_resolution_clock::time_point _last_screenshot_time;
+
+		// Persistent system memory textures that are copied into on one frame and read from a few frames later, to avoid stalling the GPU
+		struct texture_readback
+		{
+			api::resource intermediate = {};
+			api::format format = api::format::unknown;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint64_t fence_value = 0; // Zero when this readback is not in flight
+			std::function<void(std::vector<uint8_t> &&pixels, uint32_t width, uint32_t height)> callback;
+		};
+		std::vector<texture_readback> _texture_readbacks;
+		api::fence _texture_readback_fence = {};
+		uint64_t _texture_readback_fence_value = 0;
+
+		// Fixed pool of threads encoding and writing screenshots, fed by a bounded queue
+		std::vector<std::thread> _screenshot_workers;
+		std::deque<std::function<void()>> _screenshot_jobs;
+		std::mutex _screenshot_job_mutex;
+		std::condition_variable _screenshot_job_available;
+		std::condition_variable _screenshot_job_space_available;
+		bool _screenshot_workers_exit = false;
 		#pragma endregion
 
 		#pragma region Preset Switching
@@ -387,6 +442,30 @@ namespace reshade
 			unsigned int key_data[4] = {};
 		};
 		std::vector<preset_shortcut> _preset_shortcuts;
+
+		// Result of loading a preset with all names resolved, so that switching back to it only has to copy the values that changed
+		struct preset_snapshot
+		{
+			uint64_t preset_revision = 0;
+			bool preset_is_incomplete = false;
+			std::vector<size_t> technique_sorting;
+			std::vector<bool> technique_enabled;
+			std::vector<std::array<unsigned int, 4>> technique_toggle_key_data;
+
+			struct uniform_value
+			{
+				size_t effect_index;
+				size_t uniform_index;
+				uint32_t offset;
+				uint32_t size;
+				bool is_float;
+				std::array<unsigned int, 4> toggle_key_data;
+			};
+			std::vector<uniform_value> uniforms;
+			// Packed uniform data in the order of the list above
+			std::vector<uint8_t> uniform_data;
+		};
+		std::unordered_map<std::wstring, preset_snapshot> _preset_snapshots;
 		#pragma endregion
 
 #if RESHADE_GUI
@@ -1303,6 +1303,9 @@ void reshade::runtime::render_technique(api::effect_technique handle, api::comma
 	invoke_addon_event<addon_event::reshade_begin_effects>(this, cmd_list, rtv, rtv_srgb);
 #endif
 
+	// The application may have changed constant registers since effects were last rendered
+	_uniform_push_constants_effect_index = std::numeric_limits<size_t>::max();
+
 	render_technique(*tech, cmd_list, back_buffer_resource, rtv, rtv_srgb, permutation_index);
 
 #if RESHADE_ADDON
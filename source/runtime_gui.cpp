@@ -2790,6 +2790,7 @@ void reshade::runtime::draw_gui_statistics()
 		// Variables used to calculate memory size of textures
 		lldiv_t memory_view;
 		int64_t post_processing_memory_size = 0;
+		int64_t shared_memory_size = 0;
 		const char *memory_size_unit;
 
 		for (const texture &tex : _textures)
@@ -2806,7 +2807,11 @@ void reshade::runtime::draw_gui_statistics()
 			for (uint32_t level = 0, width = tex.width, height = tex.height, depth = tex.depth; level < tex.levels; ++level, width /= 2, height /= 2, depth /= 2)
 				memory_size += static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * texture_format_info(tex.format).bytes_per_pixel;
 
-			post_processing_memory_size += memory_size;
+			// Textures sharing memory with another texture do not take up additional memory
+			if (!tex.aliased)
+				post_processing_memory_size += memory_size;
+			else
+				shared_memory_size += memory_size;
 
 			if (memory_size >= 1024 * 1024)
 			{
@@ -2820,7 +2825,7 @@ void reshade::runtime::draw_gui_statistics()
 				memory_size_unit = "KiB";
 			}
 
-			ImGui::TextColored(ImVec4(1, 1, 1, 1), "%s%s", tex.unique_name.c_str(), tex.shared.size() > 1 ? " (pooled)" : "");
+			ImGui::TextColored(ImVec4(1, 1, 1, 1), "%s%s", tex.unique_name.c_str(), tex.aliased ? " (aliased)" : tex.shared.size() > 1 ? " (pooled)" : "");
 			switch (tex.type)
 			{
 			case reshadefx::texture_type::texture_1d:
@@ -2952,6 +2957,9 @@ void reshade::runtime::draw_gui_statistics()
 
 			if (tex.type == reshadefx::texture_type::texture_2d)
 			{
+				if (tex.aliased || std::any_of(_textures.cbegin(), _textures.cend(), [&tex](const texture &item) { return item.aliased && item.resource == tex.resource; }))
+					ImGui::TextDisabled(_("Shares memory with textures of other effects, so the preview shows whichever rendered last."));
+
 				if (bool check = _preview_texture == tex.srv[0] && _preview_size[0] == 0; ImGui::RadioButton(_("Preview scaled"), check))
 				{
 					_preview_size[0] = 0;
@@ -3022,6 +3030,23 @@ void reshade::runtime::draw_gui_statistics()
 		}
 
 		ImGui::Text(_("Total memory usage: %lld.%03lld %s"), memory_view.quot, memory_view.rem, memory_size_unit);
+
+		if (shared_memory_size != 0)
+		{
+			if (shared_memory_size >= 1024 * 1024)
+			{
+				memory_view = std::lldiv(shared_memory_size, 1024 * 1024);
+				memory_view.rem /= 1000;
+				memory_size_unit = "MiB";
+			}
+			else
+			{
+				memory_view = std::lldiv(shared_memory_size, 1024);
+				memory_size_unit = "KiB";
+			}
+
+			ImGui::Text(_("Memory saved by aliasing transient textures: %lld.%03lld %s"), memory_view.quot, memory_view.rem, memory_size_unit);
+		}
 	}
 }
 void reshade::runtime::draw_gui_log()
@@ -3234,6 +3259,15 @@ void reshade::runtime::draw_gui_addons()
 
 	ImGui::Spacing();
 
+	if (bool profile_event_callbacks = addon_event_profiling.load(std::memory_order_relaxed);
+		ImGui::Checkbox(_("Measure time spent in event callbacks"), &profile_event_callbacks))
+	{
+		addon_event_profiling.store(profile_event_callbacks, std::memory_order_relaxed);
+		config.set("ADDON", "ProfileEventCallbacks", profile_event_callbacks);
+	}
+
+	ImGui::Spacing();
+
 	if (!addon_all_loaded)
 	{
 		ImGui::PushTextWrapPos();
@@ -3258,6 +3292,10 @@ void reshade::runtime::draw_gui_addons()
 
 		const float child_window_width = ImGui::GetContentRegionAvail().x;
 
+		std::vector<addon_event_cost> event_costs;
+		if (addon_event_profiling.load(std::memory_order_relaxed))
+			event_costs = get_addon_event_costs();
+
 		for (addon_info &info : addon_loaded_info)
 		{
 			if (!string_contains(info.name, _addons_filter))
@@ -3361,6 +3399,24 @@ void reshade::runtime::draw_gui_addons()
 
 				ImGui::EndGroup();
 
+				if (std::any_of(event_costs.cbegin(), event_costs.cend(),
+						[&info](const addon_event_cost &cost) { return cost.addon_name == info.name; }))
+				{
+					ImGui::Spacing();
+					ImGui::Separator();
+					ImGui::Spacing();
+
+					for (const addon_event_cost &cost : event_costs)
+					{
+						if (cost.addon_name != info.name)
+							continue;
+
+						ImGui::Text("%s", addon_event_to_string(cost.ev));
+						ImGui::SameLine(ImGui::GetWindowWidth() * 0.25f);
+						ImGui::Text(_("%llu calls, %.3f ms total, %.3f us average, %.3f us max"), cost.count, cost.total_ns / 1000000.0, cost.total_ns / 1000.0 / cost.count, cost.max_ns / 1000.0);
+					}
+				}
+
 				if (info.settings_overlay_callback != nullptr)
 				{
 					ImGui::Spacing();
@@ -4450,6 +4506,91 @@ void reshade::runtime::draw_technique_editor()
 		}
 	}
 
+	// List techniques of effects that were skipped during loading at the bottom, so that they can be enabled without having to force load all effects first
+	for (size_t effect_index = 0; effect_index < _effects.size() && !is_loading(); ++effect_index)
+	{
+		if (!_effects[effect_index].skipped)
+			continue;
+
+		for (size_t outline_index = 0; outline_index < _effects[effect_index].outline.techniques.size(); ++outline_index)
+		{
+			const reshadefx::outline_entry &outline_tech = _effects[effect_index].outline.techniques[outline_index];
+
+			if (outline_tech.annotation_as_int("hidden"))
+				continue;
+
+			ImGui::PushID(_effects[effect_index].source_file.u8string().c_str());
+			ImGui::PushID(static_cast<int>(outline_index));
+
+			ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetStyleColorVec4(ImGuiCol_TextDisabled));
+
+			std::string label(get_localized_annotation(outline_tech, "ui_label", _current_language));
+			if (label.empty())
+				label = outline_tech.name;
+			label += " [" + _effects[effect_index].source_file.filename().u8string() + ']';
+
+			bool status = false;
+			if (ImGui::Checkbox(label.c_str(), &status))
+			{
+				const std::string technique_name = outline_tech.name;
+
+				// Compile the effect now, then enable the technique that was just selected
+				if (reload_effect(effect_index))
+				{
+					if (const auto it = std::find_if(_techniques.begin(), _techniques.end(),
+							[effect_index, &technique_name](const technique &tech) { return tech.effect_index == effect_index && tech.name == technique_name; });
+						it != _techniques.end())
+						enable_technique(*it);
+
+					if (_auto_save_preset)
+						save_current_preset();
+					else
+						_preset_is_modified = true;
+				}
+
+				ImGui::PopStyleColor();
+				ImGui::PopID();
+				ImGui::PopID();
+				break; // The outline of this effect is no longer valid after it was loaded
+			}
+
+			ImGui::PopStyleColor();
+
+			if (const std::string_view tooltip = get_localized_annotation(outline_tech, "ui_tooltip", _current_language);
+				ImGui::IsItemHovered(ImGuiHoveredFlags_ForTooltip))
+			{
+				if (ImGui::BeginTooltip())
+				{
+					if (!tooltip.empty())
+					{
+						ImGui::TextUnformatted(tooltip.data(), tooltip.data() + tooltip.size());
+						ImGui::Separator();
+					}
+
+					ImGui::TextUnformatted(_("This effect was not loaded, since none of its techniques are enabled. Enabling this technique loads it."));
+
+					// Give an idea of what can be configured in this effect before it is loaded
+					for (const reshadefx::outline_entry &outline_uniform : _effects[effect_index].outline.uniforms)
+					{
+						if (outline_uniform.annotation_as_int("hidden") || !outline_uniform.annotation_as_string("source").empty())
+							continue;
+
+						std::string_view uniform_label = get_localized_annotation(outline_uniform, "ui_label", _current_language);
+						if (uniform_label.empty())
+							uniform_label = outline_uniform.name;
+
+						ImGui::BulletText("%.*s", static_cast<int>(uniform_label.size()), uniform_label.data());
+					}
+
+					ImGui::EndTooltip();
+				}
+			}
+
+			ImGui::PopID();
+			ImGui::PopID();
+		}
+	}
+
 	ImGui::EndDisabled();
 
 	// Move the selected technique to the position of the mouse in the list
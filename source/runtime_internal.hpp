@@ -6,6 +6,7 @@
 #pragma once
 
 #include "effect_module.hpp"
+#include "effect_outline.hpp"
 #include "moving_average.hpp"
 
 namespace reshade
@@ -72,6 +73,10 @@ namespace reshade
 
 		std::vector<size_t> shared;
 		bool loaded = false;
+		// Contents only live within a single technique, so memory can be shared with other transient textures (see 'reshadefx::is_transient_texture')
+		bool transient = false;
+		// Resource and views are borrowed from another transient texture and are not owned by this one
+		bool aliased = false;
 
 		api::resource resource = {};
 		api::resource_view srv[2] = {};
@@ -185,6 +190,20 @@ namespace reshade
 		moving_average<uint64_t, 60> average_cpu_duration;
 		moving_average<uint64_t, 60> average_gpu_duration;
 
+		struct barrier_list
+		{
+			std::vector<api::resource> resources;
+			std::vector<api::resource_usage> old_states;
+			std::vector<api::resource_usage> new_states;
+		};
+
+		struct transitions
+		{
+			barrier_list barriers_before_mipmaps;
+			std::vector<api::resource_view> generate_mipmap_views;
+			barrier_list barriers;
+		};
+
 		struct pass : reshadefx::pass
 		{
 			pass(const reshadefx::pass &init) : reshadefx::pass(init) {}
@@ -193,8 +212,11 @@ namespace reshade
 			api::pipeline pipeline = {};
 			api::descriptor_table texture_table = {};
 			api::descriptor_table storage_table = {};
-			std::vector<api::resource> modified_resources;
-			std::vector<api::resource_view> generate_mipmap_views;
+
+			// Work to do before this pass, as computed by 'reshadefx::plan_technique_passes'
+			transitions transitions_before;
+			bool bind_shared_tables = true;
+			bool continue_render_pass = false;
 
 			moving_average<uint64_t, 60> average_gpu_duration;
 		};
@@ -202,12 +224,44 @@ namespace reshade
 		struct permutation
 		{
 			std::vector<pass> passes;
+			// Work to do after the last pass, to return all resources to shader resource state
+			transitions transitions_after;
 			bool created = false;
 		};
 
 		std::vector<permutation> permutations;
 	};
 
+	struct special_uniform_update
+	{
+		enum class key_mode : uint8_t
+		{
+			down,
+			press,
+			toggle
+		};
+
+		special_uniform special = special_uniform::none;
+		key_mode mode = key_mode::down;
+		uint32_t uniform_index = 0;
+
+		// Annotation values, resolved once when the effect is created, so that they do not have to be looked up every frame
+		int keycode = 0;
+		int int_range[2] = {};
+		float float_range[2] = {};
+		float step[2] = {};
+		float smoothing = 0.0f;
+	};
+
+	enum class permutation_dependency : uint32_t
+	{
+		none = 0,
+		buffer_dimensions = 1 << 0, // BUFFER_WIDTH, BUFFER_HEIGHT, BUFFER_RCP_WIDTH, BUFFER_RCP_HEIGHT
+		buffer_color = 1 << 1, // BUFFER_COLOR_SPACE, BUFFER_COLOR_FORMAT, BUFFER_COLOR_BIT_DEPTH
+		all = 0xFFFFFFFF
+	};
+	RESHADE_DEFINE_ENUM_FLAG_OPERATORS(permutation_dependency);
+
 	struct effect
 	{
 		std::filesystem::path source_file;
@@ -223,10 +277,28 @@ namespace reshade
 
 		std::vector<std::filesystem::path> included_files;
 		std::vector<std::pair<std::string, std::string>> definitions;
+		// Permutation-specific macros the source of this effect referenced while it was preprocessed
+		permutation_dependency permutation_dependencies = permutation_dependency::all;
+		// Techniques and uniform variables found by a shallow scan of the source while the effect was skipped (so they can still be listed in the overlay)
+		reshadefx::effect_outline outline;
 
 		std::vector<uniform> uniforms;
 		std::vector<uint8_t> uniform_data_storage;
+		// Sorted list of non-overlapping byte ranges in the uniform storage that were modified since they were last uploaded
+		std::vector<std::pair<uint32_t, uint32_t>> uniform_data_dirty_ranges;
 		api::resource cb = {};
+		// List of special uniform variables to update every frame, in the order they appear in the uniform list
+		std::vector<special_uniform_update> special_uniform_updates;
+		struct texture_source
+		{
+			// Description and source of the texture the image data was decoded for, since the texture with this name may end up being created by another effect with a different description
+			reshadefx::texture_desc desc;
+			std::string source;
+			std::string pixels_data;
+		};
+
+		// Decoded image data of textures with a source image, keyed by unique texture name (filled while loading and consumed while creating the effect)
+		std::unordered_map<std::string, texture_source> texture_source_data;
 
 		struct binding
 		{
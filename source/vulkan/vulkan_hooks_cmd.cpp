@@ -49,7 +49,7 @@ static void invoke_begin_render_pass_event(const reshade::vulkan::device_impl *d
 		cmd_impl->current_depth_stencil_attachment = (a != VK_ATTACHMENT_UNUSED) ? attachments[a] : VK_NULL_HANDLE;
 	}
 
-	if (!reshade::has_addon_event<reshade::addon_event::begin_render_pass>())
+	if (!reshade::has_addon_event<reshade::addon_event::begin_render_pass>() && !reshade::has_addon_event<reshade::addon_event::draw_batch>())
 		return;
 
 	uint32_t num_transitions = 0;
@@ -171,7 +171,7 @@ static void invoke_begin_render_pass_event(reshade::vulkan::object_data<VK_OBJEC
 	else if (rendering_info->pStencilAttachment != nullptr)
 		cmd_impl->current_depth_stencil_attachment = rendering_info->pStencilAttachment->imageView;
 
-	if (!reshade::has_addon_event<reshade::addon_event::begin_render_pass>())
+	if (!reshade::has_addon_event<reshade::addon_event::begin_render_pass>() && !reshade::has_addon_event<reshade::addon_event::draw_batch>())
 		return;
 
 	temp_mem<reshade::api::render_pass_render_target_desc, 8> rts(rendering_info->colorAttachmentCount);
@@ -340,7 +340,7 @@ void VKAPI_CALL vkCmdSetViewport(VkCommandBuffer commandBuffer, uint32_t firstVi
 	trampoline(commandBuffer, firstViewport, viewportCount, pViewports);
 
 #if RESHADE_ADDON
-	if (!reshade::has_addon_event<reshade::addon_event::bind_viewports>())
+	if (!reshade::has_addon_event<reshade::addon_event::bind_viewports>() && !reshade::has_addon_event<reshade::addon_event::draw_batch>())
 		return;
 
 	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
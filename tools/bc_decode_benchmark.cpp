@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2024 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+// Throughput benchmark for the block-compressed texture decoders in 'examples/utils/bc_decode.hpp'
+// This does not depend on any Windows headers, so can be built and run on any platform, e.g.:
+//   g++ -std=c++17 -O2 -I examples/utils tools/bc_decode_benchmark.cpp -o bc_decode_benchmark && ./bc_decode_benchmark [size] [iterations]
+
+#include "bc_decode.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+int main(int argc, char *argv[])
+{
+	const uint32_t size = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) & ~3u : 2048;
+	const uint32_t iterations = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 10;
+	if (size == 0 || iterations == 0)
+	{
+		std::printf("usage: %s [size] [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	std::printf("Decoding %ux%u images %u times using %s code path\n", size, size, iterations, bc_decode::detail::has_simd() ? "SIMD" : "scalar");
+
+	static const char *const format_names[] = { "BC1", "BC2", "BC3", "BC4", "BC5", "BC6H_UF16", "BC6H_SF16", "BC7" };
+
+	// Random data exercises all modes of BC6H and BC7 (and both color modes of BC1), which is closer to the worst case than real textures
+	std::mt19937 rng(49);
+	std::vector<uint8_t> blocks(static_cast<size_t>(size / 4) * (size / 4) * 16);
+	for (uint8_t &value : blocks)
+		value = static_cast<uint8_t>(rng());
+
+	std::vector<uint8_t> pixels(static_cast<size_t>(size) * size * 4);
+
+	for (size_t format_index = 0; format_index < std::size(format_names); ++format_index)
+	{
+		const auto format = static_cast<bc_decode::block_format>(format_index);
+		const uint32_t src_row_pitch = (size / 4) * bc_decode::block_size(format);
+
+		// Warm up caches before measuring
+		bc_decode::decode_image(format, size, size, blocks.data(), src_row_pitch, pixels.data(), size * 4);
+
+		double best_ms = 0.0, total_ms = 0.0;
+		for (uint32_t i = 0; i < iterations; ++i)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			bc_decode::decode_image(format, size, size, blocks.data(), src_row_pitch, pixels.data(), size * 4);
+			const auto end = std::chrono::steady_clock::now();
+
+			const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+			total_ms += ms;
+			if (i == 0 || ms < best_ms)
+				best_ms = ms;
+		}
+
+		// Print a value derived from the decoded pixels, so that the compiler cannot optimize the decoding away
+		uint32_t checksum = 0;
+		for (size_t i = 0; i < pixels.size(); i += 61)
+			checksum = checksum * 31 + pixels[i];
+
+		std::printf("%-10s best %8.3f ms, average %8.3f ms, %8.1f MPixel/s (checksum %08x)\n",
+			format_names[format_index], best_ms, total_ms / iterations, (static_cast<double>(size) * size / 1e6) / (best_ms / 1e3), checksum);
+	}
+
+	return 0;
+}
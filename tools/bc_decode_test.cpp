@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2024 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+// Standalone correctness test for the block-compressed texture decoders in 'examples/utils/bc_decode.hpp'
+// This does not depend on any Windows headers, so can be built and run on any platform, e.g.:
+//   g++ -std=c++17 -O2 -I examples/utils tools/bc_decode_test.cpp -o bc_decode_test && ./bc_decode_test
+
+#include "bc_decode.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+struct reference_block
+{
+	bc_decode::block_format format;
+	const char *block;
+	// Expected 4x4 RGBA8 result, as decoded by the BCn decoder in Pillow (an independent implementation)
+	const char *expected;
+};
+
+// Covers both color modes of BC1, both alpha modes of BC3 and BC4, every BC6H mode (unsigned, and the untransformed mode for signed) and every BC7 mode
+static const reference_block s_reference_blocks[] = {
+	{ bc_decode::block_format::bc1,
+		"1ff8e0071c52c08d82ce0cae0bc2bc46",
+		"ff00ffff55aa55ff00ff00ffff00ffffaa55aaffff00ffff00ff00ff00ff00ffff00ffffff00ffffff00ffff55aa55ff00ff00ff55aa55ffff00ffffaa55aaff" },
+	{ bc_decode::block_format::bc1,
+		"0010ffffa18b8138dbe49a49925f6607",
+		"ffffffff100000ff877f7fff877f7fff00000000877f7fff100000ff877f7fffffffffff100000ff100000ff877f7fff100000ff877f7fff00000000100000ff" },
+	{ bc_decode::block_format::bc2,
+		"3fb923186cba6053c55b44a766f6f29d",
+		"739f26ffa5eb2133739f2699a5eb21bb739f2633a5eb21228cc523888cc52311739f26cc5a7929668cc523aa8cc523bba5eb21008cc52366a5eb2133739f2655" },
+	{ bc_decode::block_format::bc3,
+		"9e0da969b08be89d34a6c5e81090418a",
+		"a5c7a50da5c7a54bef182936a5c7a55fa5c7a536a5c7a59eef18295fbd8c7b4bef182974a5c7a50da5c7a589ef18295fbd8c7b36bd8c7b74a5c7a521bd8c7b5f" },
+	{ bc_decode::block_format::bc3,
+		"20e051227cf0385341956ff59c7db1b3",
+		"94aa08e0d6ac5446f7ae7be0b5ab2ee0f7ae7b46d6ac5420d6ac54fff7ae7b6cf7ae7b2094aa0800d6ac546cb5ab2e93d6ac546c94aa0800d6ac5493b5ab2e46" },
+	{ bc_decode::block_format::bc4,
+		"c0106144f7ebc6b08c058ae9260233ec",
+		"101010ff747474ff101010ffa6a6a6ff747474ff424242ff5b5b5bff292929ff8d8d8dff5b5b5bff8d8d8dff8d8d8dff747474ff101010ff747474ff5b5b5bff" },
+	{ bc_decode::block_format::bc4,
+		"10c0f1f1d44d100db1b35fb1a90e6fda",
+		"c0c0c0ff000000ffffffffff101010ffffffffffc0c0c0ff9c9c9cff000000ff9c9c9cffc0c0c0ffc0c0c0ff101010ffc0c0c0ff333333ff565656ff101010ff" },
+	{ bc_decode::block_format::bc5,
+		"53d7127931c26d4cb77b28427057f71a",
+		"6db700ff6d9400ffa2b700ffa27b00ffff9d00ff6db700ffa29d00ffd7a500ff6d8300ff53ae00ffff9400ff00a500ff008300ff539400ff878c00ff6db700ff" },
+	{ bc_decode::block_format::bc6h_uf16,
+		"18b7687eda74a617f3ac9a12a5ed3b3e",
+		"520007ff530006ff4e0007ff4f0007ff470005ff4e0007ff4f0007ff4c0008ff470005ff470005ff4b0008ff4e0007ff470005ff470005ff470005ff530006ff" },
+	{ bc_decode::block_format::bc6h_uf16,
+		"69568690df02ab2d5f5ce11a9dd9b91d",
+		"2e00ffffff02ffffff01ffffff02ffff2e00ffffff01ffffff00ffff0901ffffff00ffff0700ffff0500ffff0901ffff0700ffff0700ffff0500ffff0200ffff" },
+	{ bc_decode::block_format::bc6h_uf16,
+		"229743c198fc6d1441c7eb5cf6b5adac",
+		"000700ff000600ff000700ff000600ff000700ff000700ff000700ff000600ff000700ff000700ff000700ff000700ff000700ff000700ff000700ff000700ff" },
+	{ bc_decode::block_format::bc6h_uf16,
+		"e684b82274aa1fc49076e8da9221bda9",
+		"00ff01ff00ff01ff00ff01ff00ff01ff00ff01ff00ff01ff00ff02ff00ff01ff00ff02ff00ff01ff00ff02ff00ff01ff00ff01ff00ff02ff00ff01ff00ff02ff" },
+	{ bc_decode::block_format::bc6h_uf16,
+		"6a9c0641821c57999050f96cf3f1eab9",
+		"ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff" },
+	{ bc_decode::block_format::bc6h_uf16,
+		"ae8486db89baeb3c02390852137c7342",
+		"00ffa0ff00ffafff00ff90ff00ffdfff00ffa0ff00ff99ff00ffa0ff00ffb7ff00ff81ff00ff7cff00ff81ff00ffdfff00ff99ff00ffa0ff00ffafff00ffc1ff" },
+	{ bc_decode::block_format::bc6h_uf16,
+		"f2cfe6cf8f07f369b9b0d18442e21d70",
+		"ffffffff90ffffffffffffffffffffffb1fffffff5ffffffffffffffffffffffffffffff35ffffffffffffff1affffffffffffffffffffff35ffffffffffffff" },
+	{ bc_decode::block_format::bc6h_uf16,
+		"36d9db07e17a97f52742662b45ef9539",
+		"ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff" },
+	{ bc_decode::block_format::bc6h_uf16,
+		"da2adb389aec4fff5bed360b1d6d0ab3",
+		"09ff00ff11ff00ff08ff00ff16ff00ff0bff00ff05ff00ff11ff00ff0dff00ff04ff00ff04ff00ff0dff00ff16ff00ff0bff00ff07ff00ff04ff00ff16ff00ff" },
+	{ bc_decode::block_format::bc6h_uf16,
+		"1e16ea16816df73382b047ef46307870",
+		"ff3201ffffff59ffffffffffffff14ffff0100ff850301ff00ffffff00ffedff00ffffff850301ff00ffffff061e0cffffffffffff0700ffffff59ffffff14ff" },
+	{ bc_decode::block_format::bc6h_uf16,
+		"a3e74b50b9df034daca933d420a5d3b7",
+		"ff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ff" },
+	{ bc_decode::block_format::bc6h_uf16,
+		"c7543a1d0918baf7ea56189ef36ac5a1",
+		"ff0500ffff0300ffff0400ffff0500ffff0400ffff0500ffff0300ffff0400ffff0500ffff0300ffff0400ffff0400ffff0500ffff0300ffff0500ffff0400ff" },
+	{ bc_decode::block_format::bc6h_uf16,
+		"2be90cdbb33a5b864615f9c721ad56da",
+		"ff1cffffff1bffffff1bffffff1cffffff1affffff18ffffff1affffff19ffffff1cffffff1cffffff18ffffff19ffffff1bffffff1bffffff19ffffff18ffff" },
+	{ bc_decode::block_format::bc6h_uf16,
+		"8f1af0381018117815b43e3d557f7750",
+		"0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff" },
+	{ bc_decode::block_format::bc6h_sf16,
+		"43b4324f8e0e2d7c4a7116cb10b5743f",
+		"ff0000ffff0000ffff0000ffff0000ffff0000ffff0000ffff0501ffff2a05ffff0000ffff0000ffff0000ffff0501ffff0000ffff0000ffffffffffff0000ff" },
+	{ bc_decode::block_format::bc6h_sf16,
+		"63fba4b7eabebec42204b7fda008c580",
+		"0000ffff0000ffff0000ffff0000ffff0002ffff00ffffff00ffffff00ffffff0000ffff00ffffff000fffff0000ffff0000ffff00ffffff0000ffff000fffff" },
+	{ bc_decode::block_format::bc7,
+		"03bf48b6ec28e6611f942ff62cdd5435",
+		"9454d4ff9454d4ffe76123ff566dd0fff76300ffc65c68ff4f58ecff515fe3ff532136ff67264eff5366d9ff566dd0ff93307fff532136ff93307fff5874c6ff" },
+	{ bc_decode::block_format::bc7,
+		"ee015f557c0be8e0c9453a9da3654d0b",
+		"47e089ff68d88dff47e089ff56eb46ff568959ff68d88dff8dce91ffd0bd99ff564466ff56ca4cff564466ff68d88dff47e089ff56645fff56236cff560272ff" },
+	{ bc_decode::block_format::bc7,
+		"349c7899e5047b2ae44c7e711a78f78e",
+		"535d59ff535d59ff6329c6ff6329c6ff734a39ff10849cffce214affab2473ffce4abdffb380cbffce4abdff96b9d9ffce4abdff96b9d9ff7befe7ff96b9d9ff" },
+	{ bc_decode::block_format::bc7,
+		"0831e7636a1ecc0ffb9f2e25f1ba0589",
+		"98f2fcffccd0bdffe6c09effb2e2ddffbde76fffe6c09effb2e2ddffe6c09effb2d482ffc7f95dffc7f95dffccd0bdffc7f95dffbde76fffc7f95dffbde76fff" },
+	{ bc_decode::block_format::bc7,
+		"102a124f55ef850e36afb99983a37fe7",
+		"65678af75221a5795221a58b65678aae8cf752e565678a795221a5f75221a5ae8cf752c279b16dae65678a8b79b16d798cf7527965678a8b65678ae58cf75279" },
+	{ bc_decode::block_format::bc7,
+		"207c1747b4e9d18af82e7e640bfc79a1",
+		"f93836845c447a525c447ab4c53c4cb45c447ab4c53c4c22c53c4c22f93836225c447a845c447a525c447a22f938368490406484f93836b45c447a5290406452" },
+	{ bc_decode::block_format::bc7,
+		"407884fb855a5df0403e8bc1383a4314",
+		"e1b9a15daebaa4802ebeabd8babaa37855bda9bd7cbca7a3d5b9a26549bdaac57cbca7a3babaa37861bca8b5babaa378babaa378aebaa480aebaa480d5b9a265" },
+	{ bc_decode::block_format::bc7,
+		"80eeb1da9867903a03bf83ae8803b8c8",
+		"383051799e365069d3301841b67d3c3c61494a65d3301841d330184138305179d3301841b67d3c3c61494a659e365069d330184161494a658d6443509e365069" },
+	// Reserved BC7 mode (no mode bit set) decodes to transparent black
+	{ bc_decode::block_format::bc7,
+		"00000000000000000000000000000000",
+		"00000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000" },
+};
+
+static const char *const s_format_names[] = { "BC1", "BC2", "BC3", "BC4", "BC5", "BC6H_UF16", "BC6H_SF16", "BC7" };
+
+static std::vector<uint8_t> parse_hex(const char *text)
+{
+	std::vector<uint8_t> bytes;
+	for (; text[0] != '\0' && text[1] != '\0'; text += 2)
+	{
+		const char digits[3] = { text[0], text[1], '\0' };
+		bytes.push_back(static_cast<uint8_t>(std::strtoul(digits, nullptr, 16)));
+	}
+	return bytes;
+}
+
+static bool test_reference_blocks()
+{
+	bool success = true;
+
+	for (const reference_block &reference : s_reference_blocks)
+	{
+		const std::vector<uint8_t> block = parse_hex(reference.block);
+		const std::vector<uint8_t> expected = parse_hex(reference.expected);
+
+		uint8_t result[4 * 4 * 4];
+		bc_decode::decode_image(reference.format, 4, 4, block.data(), static_cast<uint32_t>(block.size()), result, 4 * 4);
+
+		// Pillow expands 5:6:5 endpoints through bit replication and converts BC6H half-floats to 8-bit with slightly different rounding, so allow an error of one for those color channels
+		const bool inexact_color =
+			reference.format == bc_decode::block_format::bc1 ||
+			reference.format == bc_decode::block_format::bc2 ||
+			reference.format == bc_decode::block_format::bc3 ||
+			reference.format == bc_decode::block_format::bc6h_uf16 ||
+			reference.format == bc_decode::block_format::bc6h_sf16;
+
+		for (size_t i = 0; i < std::size(result); ++i)
+		{
+			const int tolerance = inexact_color && (i % 4) != 3 ? 1 : 0;
+
+			if (std::abs(static_cast<int>(result[i]) - static_cast<int>(expected[i])) > tolerance)
+			{
+				std::printf("FAILED: %s block %s, pixel %zu channel %zu is %u, expected %u\n",
+					s_format_names[static_cast<size_t>(reference.format)], reference.block, i / 4, i % 4, result[i], expected[i]);
+				success = false;
+				break;
+			}
+		}
+	}
+
+	return success;
+}
+
+static bool test_partial_blocks()
+{
+	bool success = true;
+
+	// Blocks that are partially outside the image must be clipped, without writing past the end of a row or the image
+	const uint32_t width = 7, height = 5;
+	const uint32_t blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+
+	for (size_t format_index = 0; format_index < std::size(s_format_names); ++format_index)
+	{
+		const auto format = static_cast<bc_decode::block_format>(format_index);
+		const uint32_t block_size = bc_decode::block_size(format);
+
+		std::vector<uint8_t> blocks(blocks_x * blocks_y * block_size);
+		for (size_t i = 0; i < blocks.size(); ++i)
+			blocks[i] = static_cast<uint8_t>(i * 97 + 13);
+
+		// Decode the full blocks as reference
+		std::vector<uint8_t> full(blocks_x * 4 * blocks_y * 4 * 4);
+		bc_decode::decode_image(format, blocks_x * 4, blocks_y * 4, blocks.data(), blocks_x * block_size, full.data(), blocks_x * 4 * 4);
+
+		// Decode into an image with an extra guard pixel at the end of every row
+		const uint32_t row_pitch = (width + 1) * 4;
+		std::vector<uint8_t> clipped(row_pitch * height + 4, 0xCD);
+		bc_decode::decode_image(format, width, height, blocks.data(), blocks_x * block_size, clipped.data(), row_pitch);
+
+		for (uint32_t y = 0; y < height && success; ++y)
+		{
+			for (uint32_t x = 0; x < width + 1; ++x)
+			{
+				const uint8_t *const actual = clipped.data() + y * row_pitch + x * 4;
+				const uint8_t *const expected = full.data() + (y * blocks_x * 4 + x) * 4;
+
+				if (x < width ? std::memcmp(actual, expected, 4) != 0 : (actual[0] != 0xCD || actual[1] != 0xCD || actual[2] != 0xCD || actual[3] != 0xCD))
+				{
+					std::printf("FAILED: %s partial block, pixel %u,%u was %s\n", s_format_names[format_index], x, y, x < width ? "decoded incorrectly" : "overwritten");
+					success = false;
+					break;
+				}
+			}
+		}
+
+		if (clipped.back() != 0xCD)
+		{
+			std::printf("FAILED: %s partial block, wrote past the end of the image\n", s_format_names[format_index]);
+			success = false;
+		}
+	}
+
+	return success;
+}
+
+int main()
+{
+	std::printf("Using %s code path\n", bc_decode::detail::has_simd() ? "SIMD" : "scalar");
+
+	bool success = true;
+	success &= test_reference_blocks();
+	success &= test_partial_blocks();
+
+	std::printf(success ? "All tests passed.\n" : "Some tests failed!\n");
+
+	return success ? 0 : 1;
+}
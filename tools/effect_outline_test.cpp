@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2024 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+// Standalone unit test for the effect outline scanner and its cache serialization in 'source/effect_outline.cpp'
+// This does not depend on any Windows headers, so can be built and run on any platform, e.g.:
+//   g++ -std=c++17 -O2 -I source tools/effect_outline_test.cpp source/effect_outline.cpp source/effect_lexer.cpp -o effect_outline_test && ./effect_outline_test
+
+#include "effect_outline.hpp"
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+using namespace reshadefx;
+
+static bool s_success = true;
+
+static void check(bool condition, const char *test_name, const char *description)
+{
+	if (condition)
+		return;
+
+	std::printf("FAILED: %s, %s\n", test_name, description);
+	s_success = false;
+}
+
+static const char s_source[] = R"(
+uniform float Strength < ui_type = "slider"; ui_min = 0.0; ui_max = 2.5; ui_label = "Effect " "strength"; > = 1.0;
+uniform float3 Color < ui_type = "color"; ui_min = float3(0.0, 0.5, -1.0); > = float3(1.0, 1.0, 1.0);
+uniform int Mode < ui_type = "combo"; ui_items = "A\0B\0C\0"; ui_min = -3; > = 0;
+uniform bool Toggle < hidden = true; >;
+uniform uint FrameCount < source = "framecount"; >;
+
+namespace Inner
+{
+	uniform vector<float, 2> Offset < ui_step = 0.25; >;
+}
+
+float3 helper(float3 c)
+{
+	uniform float NotAUniform;
+	return c;
+}
+
+technique First < ui_label = "First technique"; enabled = true; timeout = 1000; >
+{
+	pass { }
+}
+technique Second
+{
+	pass { }
+}
+)";
+
+static bool annotations_equal(const std::vector<annotation> &lhs, const std::vector<annotation> &rhs)
+{
+	if (lhs.size() != rhs.size())
+		return false;
+
+	for (size_t i = 0; i < lhs.size(); ++i)
+	{
+		if (lhs[i].name != rhs[i].name || lhs[i].type.base != rhs[i].type.base || lhs[i].type.rows != rhs[i].type.rows)
+			return false;
+
+		if (lhs[i].type.base == type::t_string)
+		{
+			if (lhs[i].value.string_data != rhs[i].value.string_data)
+				return false;
+		}
+		else
+		{
+			if (std::memcmp(lhs[i].value.as_uint, rhs[i].value.as_uint, lhs[i].type.rows * sizeof(uint32_t)) != 0)
+				return false;
+		}
+	}
+
+	return true;
+}
+static bool entries_equal(const std::vector<outline_entry> &lhs, const std::vector<outline_entry> &rhs)
+{
+	if (lhs.size() != rhs.size())
+		return false;
+
+	for (size_t i = 0; i < lhs.size(); ++i)
+		if (lhs[i].name != rhs[i].name || lhs[i].type != rhs[i].type || !annotations_equal(lhs[i].annotations, rhs[i].annotations))
+			return false;
+
+	return true;
+}
+
+static void test_scan()
+{
+	const char *const test_name = "scan";
+
+	const effect_outline outline = scan_effect_outline(s_source);
+
+	check(outline.techniques.size() == 2, test_name, "expected two techniques");
+	check(outline.uniforms.size() == 6, test_name, "expected six uniforms at global or namespace scope");
+	if (outline.techniques.size() != 2 || outline.uniforms.size() != 6)
+		return;
+
+	check(outline.techniques[0].name == "First" && outline.techniques[1].name == "Second", test_name, "technique names");
+	check(outline.techniques[0].annotation_as_string("ui_label") == "First technique", test_name, "technique string annotation");
+	check(outline.techniques[0].annotation_as_int("timeout") == 1000, test_name, "technique integer annotation");
+	check(outline.techniques[1].annotations.empty(), test_name, "technique without annotations");
+
+	const outline_entry &strength = outline.uniforms[0];
+	check(strength.name == "Strength" && strength.type == "float", test_name, "uniform name and type");
+	check(strength.annotation_as_string("ui_label") == "Effect strength", test_name, "adjacent string literals are concatenated");
+	check(strength.annotations.size() == 4 && strength.annotations[2].value.as_float[0] == 2.5f, test_name, "float annotation");
+
+	const outline_entry &color = outline.uniforms[1];
+	check(color.annotations.size() == 2 && color.annotations[1].type.rows == 3 &&
+		color.annotations[1].value.as_float[1] == 0.5f && color.annotations[1].value.as_float[2] == -1.0f, test_name, "vector constructor annotation");
+
+	check(outline.uniforms[2].annotation_as_int("ui_min") == -3, test_name, "negative integer annotation");
+	check(outline.uniforms[2].annotation_as_string("ui_items") == std::string_view("A\0B\0C\0", 6), test_name, "string annotation with embedded null characters");
+	check(outline.uniforms[3].annotation_as_int("hidden") == 1, test_name, "boolean annotation");
+	check(outline.uniforms[5].name == "Offset" && outline.uniforms[5].type == "vector<float,2>", test_name, "uniform in namespace with template type");
+}
+
+static void test_round_trip()
+{
+	const char *const test_name = "round trip";
+
+	const effect_outline outline = scan_effect_outline(s_source);
+	const std::string data = serialize_effect_outline(outline);
+
+	effect_outline result;
+	check(deserialize_effect_outline(data, result), test_name, "serialized data has to be read back");
+	check(entries_equal(outline.techniques, result.techniques), test_name, "techniques have to match");
+	check(entries_equal(outline.uniforms, result.uniforms), test_name, "uniforms have to match");
+	check(serialize_effect_outline(result) == data, test_name, "serializing again has to give the same data");
+
+	// Floating-point values are stored as raw bits, so have to round-trip exactly
+	effect_outline special;
+	annotation &annotation = special.uniforms.emplace_back().annotations.emplace_back();
+	annotation.name = "value";
+	annotation.type.base = type::t_float;
+	annotation.type.rows = 4;
+	annotation.value.as_float[0] = 0.1f;
+	annotation.value.as_float[1] = -0.0f;
+	annotation.value.as_float[2] = 1e-40f;
+	annotation.value.as_float[3] = 3.4e38f;
+	check(deserialize_effect_outline(serialize_effect_outline(special), result) && entries_equal(special.uniforms, result.uniforms), test_name, "floating-point values have to round-trip exactly");
+
+	check(deserialize_effect_outline(serialize_effect_outline({}), result) && result.techniques.empty() && result.uniforms.empty(), test_name, "empty outline");
+}
+
+static void test_truncated()
+{
+	const char *const test_name = "truncated";
+
+	const std::string data = serialize_effect_outline(scan_effect_outline(s_source));
+
+	bool all_rejected = true;
+	for (size_t size = 0; size < data.size(); ++size)
+	{
+		effect_outline result;
+		result.techniques.emplace_back().name = "Unchanged";
+		if (deserialize_effect_outline(data.substr(0, size), result) || result.techniques.size() != 1 || result.techniques[0].name != "Unchanged")
+			all_rejected = false;
+	}
+
+	check(all_rejected, test_name, "every truncated prefix has to be rejected without changing the outline");
+}
+
+static void test_corrupt()
+{
+	const char *const test_name = "corrupt";
+
+	const std::string data = serialize_effect_outline(scan_effect_outline(s_source));
+
+	effect_outline result;
+	check(!deserialize_effect_outline("outline0;" + data.substr(9), result), test_name, "different version has to be rejected");
+	check(!deserialize_effect_outline(data + "1:0", result), test_name, "trailing data has to be rejected");
+	check(!deserialize_effect_outline("outline1;x:0:", result), test_name, "length that is not a number has to be rejected");
+	check(!deserialize_effect_outline("outline1;10:4294967295", result), test_name, "entry count larger than the data has to be rejected");
+	check(!deserialize_effect_outline("outline1;99999999999999999999:", result), test_name, "overlong length has to be rejected");
+
+	// No techniques and a single uniform 'A' with a float annotation 'x', then the same with an unsupported type and with too many components
+	check(deserialize_effect_outline("outline1;1:01:11:A0:1:11:71:11:x1:0", result) && result.uniforms.size() == 1 && result.uniforms[0].annotations.size() == 1, test_name, "hand-written data has to be read");
+	check(!deserialize_effect_outline("outline1;1:01:11:A0:1:11:91:11:x1:0", result), test_name, "annotation of an unsupported type has to be rejected");
+	check(!deserialize_effect_outline("outline1;1:01:11:A0:1:11:71:51:x1:01:01:01:01:0", result), test_name, "annotation with too many components has to be rejected");
+
+	// Replace every byte with characters that are significant to the format, which must never crash and has to either be rejected or give a valid outline
+	static const char replacements[] = { ':', ';', '0', '9', 'x', '\0' };
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		for (const char c : replacements)
+		{
+			std::string corrupted = data;
+			corrupted[i] = c;
+			if (deserialize_effect_outline(corrupted, result))
+				check(deserialize_effect_outline(serialize_effect_outline(result), result), test_name, "accepted corrupted data has to give an outline that can be serialized again");
+		}
+	}
+
+	// Random data after the header
+	std::mt19937 rng(40);
+	for (int i = 0; i < 10000; ++i)
+	{
+		std::string random_data = "outline1;";
+		const size_t length = rng() % 64;
+		for (size_t k = 0; k < length; ++k)
+			random_data += "0123456789:;x"[rng() % 13];
+		deserialize_effect_outline(random_data, result);
+	}
+}
+
+int main()
+{
+	test_scan();
+	test_round_trip();
+	test_truncated();
+	test_corrupt();
+
+	std::printf(s_success ? "All tests passed.\n" : "Some tests failed!\n");
+
+	return s_success ? 0 : 1;
+}
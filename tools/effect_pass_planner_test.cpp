@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2024 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+// Standalone unit test for the technique pass planner in 'source/effect_pass_planner.cpp'
+// This does not depend on any Windows headers, so can be built and run on any platform, e.g.:
+//   g++ -std=c++17 -O2 -I source tools/effect_pass_planner_test.cpp source/effect_pass_planner.cpp -o effect_pass_planner_test && ./effect_pass_planner_test
+
+#include "effect_pass_planner.hpp"
+#include <algorithm>
+#include <cstdio>
+
+using namespace reshadefx;
+
+static bool s_success = true;
+
+static void check(bool condition, const char *test_name, const char *description)
+{
+	if (condition)
+		return;
+
+	std::printf("FAILED: %s, %s\n", test_name, description);
+	s_success = false;
+}
+
+static bool has_transition(const std::vector<texture_transition> &transitions, const char *texture_name, texture_state old_state, texture_state new_state)
+{
+	return std::any_of(transitions.cbegin(), transitions.cend(),
+		[&](const texture_transition &transition) { return transition.texture_name == texture_name && transition.old_state == old_state && transition.new_state == new_state; });
+}
+static bool has_transition(const std::vector<texture_transition> &transitions, const char *texture_name)
+{
+	return std::any_of(transitions.cbegin(), transitions.cend(),
+		[&](const texture_transition &transition) { return transition.texture_name == texture_name; });
+}
+
+static void add_texture(effect_module &module, const char *name, uint32_t width = 256, uint32_t height = 256, uint16_t levels = 1)
+{
+	texture &tex = module.textures.emplace_back();
+	tex.unique_name = name;
+	tex.type = texture_type::texture_2d;
+	tex.width = width;
+	tex.height = height;
+	tex.levels = levels;
+	tex.render_target = true;
+
+	sampler &sampler = module.samplers.emplace_back();
+	sampler.unique_name = std::string("sampler_") + name;
+	sampler.texture_name = name;
+
+	storage &storage = module.storages.emplace_back();
+	storage.unique_name = std::string("storage_") + name;
+	storage.texture_name = name;
+}
+
+// Samplers and storages are added in the same order as textures, so they share the index
+static size_t index_of(const effect_module &module, const char *texture_name)
+{
+	return std::find_if(module.textures.cbegin(), module.textures.cend(),
+		[texture_name](const texture &tex) { return tex.unique_name == texture_name; }) - module.textures.cbegin();
+}
+
+static pass &add_compute_pass(effect_module &module, technique &tech, std::initializer_list<const char *> reads, std::initializer_list<const char *> writes)
+{
+	pass &pass = tech.passes.emplace_back();
+	pass.cs_entry_point = "main";
+	for (const char *const texture_name : reads)
+		pass.texture_bindings.push_back({ index_of(module, texture_name) });
+	for (const char *const texture_name : writes)
+		pass.storage_bindings.push_back({ index_of(module, texture_name) });
+	return pass;
+}
+static pass &add_graphics_pass(effect_module &module, technique &tech, std::initializer_list<const char *> reads, std::initializer_list<const char *> render_targets)
+{
+	pass &pass = tech.passes.emplace_back();
+	pass.vs_entry_point = "vs";
+	pass.ps_entry_point = "ps";
+	pass.viewport_width = 256;
+	pass.viewport_height = 256;
+	for (const char *const texture_name : reads)
+		pass.texture_bindings.push_back({ index_of(module, texture_name) });
+	int i = 0;
+	for (const char *const texture_name : render_targets)
+		pass.render_target_names[i++] = texture_name;
+	return pass;
+}
+
+static void test_consecutive_compute_writes()
+{
+	const char *const test_name = "consecutive compute writes";
+
+	effect_module module;
+	add_texture(module, "A");
+	add_texture(module, "B");
+	technique tech;
+	add_compute_pass(module, tech, {}, { "A" });
+	add_compute_pass(module, tech, {}, { "A" });
+	add_compute_pass(module, tech, {}, { "A", "B" });
+
+	const std::vector<pass_plan> plans = plan_technique_passes(module, tech);
+
+	check(plans.size() == 4, test_name, "expected one plan per pass plus a final one");
+	check(has_transition(plans[0].transitions, "A", texture_state::shader_resource, texture_state::unordered_access), test_name, "first pass has to transition to unordered access");
+	check(has_transition(plans[1].transitions, "A", texture_state::unordered_access, texture_state::unordered_access), test_name, "second pass writing the same texture needs a UAV barrier");
+	check(has_transition(plans[2].transitions, "A", texture_state::unordered_access, texture_state::unordered_access), test_name, "third pass writing the same texture needs a UAV barrier");
+	check(has_transition(plans[2].transitions, "B", texture_state::shader_resource, texture_state::unordered_access), test_name, "third pass has to transition the new texture to unordered access");
+	check(!has_transition(plans[2].transitions, "B", texture_state::unordered_access, texture_state::unordered_access), test_name, "third pass does not need a UAV barrier for a texture that was not written before");
+	check(has_transition(plans[3].transitions, "A", texture_state::unordered_access, texture_state::shader_resource), test_name, "final plan has to return textures to the shader resource state");
+	check(has_transition(plans[3].transitions, "B", texture_state::unordered_access, texture_state::shader_resource), test_name, "final plan has to return textures to the shader resource state");
+}
+
+static void test_compute_write_then_read()
+{
+	const char *const test_name = "compute write then read";
+
+	effect_module module;
+	add_texture(module, "A");
+	add_texture(module, "B");
+	technique tech;
+	add_compute_pass(module, tech, {}, { "A" });
+	add_compute_pass(module, tech, { "A" }, { "B" });
+	add_compute_pass(module, tech, { "A" }, { "A" });
+
+	const std::vector<pass_plan> plans = plan_technique_passes(module, tech);
+
+	check(has_transition(plans[1].transitions, "A", texture_state::unordered_access, texture_state::shader_resource), test_name, "pass sampling the texture has to transition it to the shader resource state");
+	check(!has_transition(plans[1].transitions, "A", texture_state::unordered_access, texture_state::unordered_access), test_name, "pass sampling the texture must not keep it in unordered access");
+	check(has_transition(plans[2].transitions, "A", texture_state::shader_resource, texture_state::unordered_access), test_name, "pass writing the texture again has to transition it back to unordered access");
+	check(has_transition(plans[2].transitions, "B", texture_state::unordered_access, texture_state::shader_resource), test_name, "texture that is no longer written has to be returned to the shader resource state");
+	check(!has_transition(plans[3].transitions, "B"), test_name, "texture that is no longer written is only returned to the shader resource state once");
+}
+
+static void test_graphics_passes()
+{
+	const char *const test_name = "graphics passes";
+
+	effect_module module;
+	add_texture(module, "A");
+	add_texture(module, "B");
+	technique tech;
+	add_graphics_pass(module, tech, {}, { "A" });
+	add_graphics_pass(module, tech, {}, { "A" });
+	add_graphics_pass(module, tech, { "A" }, { "B" });
+
+	const std::vector<pass_plan> plans = plan_technique_passes(module, tech);
+
+	check(has_transition(plans[0].transitions, "A", texture_state::shader_resource, texture_state::render_target), test_name, "first pass has to transition to render target");
+	check(plans[1].transitions.empty(), test_name, "render target writes do not need a barrier between passes");
+	check(plans[1].continue_render_pass, test_name, "passes writing the same render target can share a render pass");
+	check(!plans[2].continue_render_pass, test_name, "pass writing a different render target cannot share a render pass");
+	check(has_transition(plans[2].transitions, "A", texture_state::render_target, texture_state::shader_resource), test_name, "pass sampling the texture has to transition it to the shader resource state");
+}
+
+static void test_compute_after_graphics()
+{
+	const char *const test_name = "compute after graphics";
+
+	effect_module module;
+	add_texture(module, "A");
+	technique tech;
+	add_graphics_pass(module, tech, {}, { "A" });
+	add_compute_pass(module, tech, {}, { "A" });
+
+	const std::vector<pass_plan> plans = plan_technique_passes(module, tech);
+
+	check(has_transition(plans[1].transitions, "A", texture_state::render_target, texture_state::unordered_access), test_name, "compute pass has to transition the render target to unordered access");
+	check(plans[1].bind_shared_tables, test_name, "switching between graphics and compute has to bind descriptor tables again");
+}
+
+static void test_mipmap_generation()
+{
+	const char *const test_name = "mipmap generation";
+
+	effect_module module;
+	add_texture(module, "A", 256, 256, 4);
+	add_texture(module, "B");
+	technique tech;
+	add_graphics_pass(module, tech, {}, { "A" });
+	add_graphics_pass(module, tech, {}, { "B" });
+	add_graphics_pass(module, tech, { "A" }, { "B" });
+
+	const std::vector<pass_plan> plans = plan_technique_passes(module, tech);
+
+	check(plans[1].generate_mipmaps.empty(), test_name, "mipmap generation has to be deferred until the texture is sampled");
+	check(plans[2].generate_mipmaps.size() == 1 && plans[2].generate_mipmaps[0] == "A", test_name, "mipmaps have to be generated before the texture is sampled");
+	check(plans[3].generate_mipmaps.empty(), test_name, "mipmaps must only be generated once");
+
+	// Overwriting a texture before it is sampled makes generating mipmaps for the earlier content unnecessary
+	technique tech_overwrite;
+	add_graphics_pass(module, tech_overwrite, {}, { "A" });
+	tech_overwrite.passes.back().generate_mipmaps = true;
+	add_graphics_pass(module, tech_overwrite, {}, { "A" });
+	tech_overwrite.passes.back().clear_render_targets = true;
+
+	const std::vector<pass_plan> plans_overwrite = plan_technique_passes(module, tech_overwrite);
+
+	check(plans_overwrite[1].generate_mipmaps.empty(), test_name, "mipmaps of overwritten content must not be generated");
+	check(plans_overwrite[2].generate_mipmaps.size() == 1, test_name, "mipmaps have to be generated at the end of the technique");
+}
+
+static void test_transient_textures()
+{
+	const char *const test_name = "transient textures";
+
+	const auto make_module = [](bool clear, bool blend, bool sample_first) {
+		effect_module module;
+		add_texture(module, "A");
+		add_texture(module, "B");
+		technique &tech = module.techniques.emplace_back();
+		if (sample_first)
+			add_graphics_pass(module, tech, { "A" }, { "B" });
+		pass &pass = add_graphics_pass(module, tech, {}, { "A" });
+		pass.clear_render_targets = clear;
+		pass.blend_enable[0] = blend;
+		add_graphics_pass(module, tech, { "A" }, { "B" });
+		return module;
+	};
+
+	check(is_transient_texture(make_module(true, false, false), "A"), test_name, "texture cleared by its first write has to be transient");
+	check(is_transient_texture(make_module(true, true, false), "A"), test_name, "blending after a clear does not depend on previous contents");
+	check(!is_transient_texture(make_module(false, false, false), "A"), test_name, "texture not cleared by its first write may keep pixels the shader discards");
+	check(!is_transient_texture(make_module(false, true, false), "A"), test_name, "texture blended into by its first write depends on previous contents");
+	check(!is_transient_texture(make_module(true, false, true), "A"), test_name, "texture sampled before it is written depends on previous contents");
+	check(!is_transient_texture(make_module(true, false, false), "B"), test_name, "texture never cleared must not be transient");
+
+	effect_module module = make_module(true, false, false);
+	module.textures[0].annotations.push_back({ {}, "source", {} });
+	check(!is_transient_texture(module, "A"), test_name, "texture loaded from an image must not be transient");
+
+	module = make_module(true, false, false);
+	module.textures[0].levels = 4;
+	module.techniques[0].passes[0].generate_mipmaps = false;
+	check(!is_transient_texture(module, "A"), test_name, "lower mipmap levels keep their contents when they are not generated");
+
+	// Every technique using the texture has to clear it first
+	module = make_module(true, false, false);
+	technique &tech = module.techniques.emplace_back();
+	add_graphics_pass(module, tech, {}, { "A" });
+	check(!is_transient_texture(module, "A"), test_name, "texture not cleared by every technique must not be transient");
+}
+
+int main()
+{
+	test_consecutive_compute_writes();
+	test_compute_write_then_read();
+	test_graphics_passes();
+	test_compute_after_graphics();
+	test_mipmap_generation();
+	test_transient_textures();
+
+	std::printf(s_success ? "All tests passed.\n" : "Some tests failed!\n");
+
+	return s_success ? 0 : 1;
+}
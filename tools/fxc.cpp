@@ -6,7 +6,9 @@
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
 #include "effect_preprocessor.hpp"
+#include "effect_pass_planner.hpp"
 #include "version.h"
+#include <algorithm> // std::max
 #include <cstring>
 #include <fstream>
 #include <iostream>
@@ -28,6 +30,7 @@ Options:
 
   --glsl                    Print GLSL code for the previously specified entry point.
   --hlsl                    Print HLSL code for the previously specified entry point.
+  --memory                  Print an estimate of the memory used by textures and which of them are transient (can share memory with textures of other effects).
   --shader-model <value>    HLSL shader model version. Can be 30, 40, 41, 50, ...
 
   --width <value>           Value of the 'BUFFER_WIDTH' preprocessor macro.
@@ -40,6 +43,67 @@ Options:
 	)", path);
 }
 
+static void print_texture_memory(const reshadefx::effect_module &module)
+{
+	unsigned long long total_size = 0;
+	unsigned long long transient_size = 0;
+
+	for (const reshadefx::texture &tex : module.textures)
+	{
+		// Textures with a semantic are provided by the application
+		if (!tex.semantic.empty())
+			continue;
+
+		unsigned int bytes_per_pixel = 0;
+		switch (tex.format)
+		{
+		case reshadefx::texture_format::r8:
+			bytes_per_pixel = 1;
+			break;
+		case reshadefx::texture_format::r16f:
+		case reshadefx::texture_format::r16:
+		case reshadefx::texture_format::rg8:
+			bytes_per_pixel = 2;
+			break;
+		case reshadefx::texture_format::r32f:
+		case reshadefx::texture_format::r32u:
+		case reshadefx::texture_format::r32i:
+		case reshadefx::texture_format::rg16f:
+		case reshadefx::texture_format::rg16:
+		case reshadefx::texture_format::rgba8:
+		case reshadefx::texture_format::rgb10a2:
+		case reshadefx::texture_format::rg11b10f:
+			bytes_per_pixel = 4;
+			break;
+		case reshadefx::texture_format::rg32f:
+		case reshadefx::texture_format::rgba16f:
+		case reshadefx::texture_format::rgba16:
+			bytes_per_pixel = 8;
+			break;
+		case reshadefx::texture_format::rgba32f:
+		case reshadefx::texture_format::rgba32u:
+		case reshadefx::texture_format::rgba32i:
+			bytes_per_pixel = 16;
+			break;
+		}
+
+		// This ignores any alignment or padding the driver may add
+		unsigned long long size = 0;
+		for (unsigned int level = 0; level < tex.levels; ++level)
+			size += static_cast<unsigned long long>(std::max(tex.width >> level, 1u)) * std::max(tex.height >> level, 1u) * std::max(static_cast<unsigned int>(tex.depth) >> level, 1u) * bytes_per_pixel;
+
+		const bool transient = reshadefx::is_transient_texture(module, tex.unique_name);
+
+		printf("%-40s %5ux%-5u %2u levels %12llu bytes%s\n", tex.unique_name.c_str(), tex.width, tex.height, static_cast<unsigned int>(tex.levels), size, transient ? " (transient)" : "");
+
+		total_size += size;
+		if (transient)
+			transient_size += size;
+	}
+
+	printf("Total texture memory: %llu bytes, of which %llu bytes are transient\n", total_size, transient_size);
+}
+
 int main(int argc, char *argv[])
 {
 	const char *source_file = nullptr;
@@ -50,6 +114,7 @@ int main(int argc, char *argv[])
 	const char *buffer_height = "600";
 	bool print_glsl = false;
 	bool print_hlsl = false;
+	bool print_memory = false;
 	bool debug_info = false;
 	bool invert_y_axis = false;
 	bool spec_constants = false;
@@ -97,6 +162,8 @@ int main(int argc, char *argv[])
 				print_glsl = true;
 			else if (0 == std::strcmp(arg, "--hlsl"))
 				print_hlsl = true;
+			else if (0 == std::strcmp(arg, "--memory"))
+				print_memory = true;
 			else if (0 == std::strcmp(arg, "--invert-y"))
 				invert_y_axis = true;
 			else if (0 == std::strcmp(arg, "--spec-constants"))
@@ -178,6 +245,12 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
+	if (print_memory)
+	{
+		print_texture_memory(backend->module());
+		return 0;
+	}
+
 	std::basic_string<char> code = backend->finalize_code();
 
 	if (print_glsl || print_hlsl)
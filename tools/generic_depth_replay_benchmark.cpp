@@ -0,0 +1,391 @@
+/*
+ * Copyright (C) 2024 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+// Benchmark that replays synthetic draw streams through the depth-stencil statistics tracking of 'examples/09-depth/generic_depth_addon.cpp', comparing the previous global lock with the current per-command list accumulation
+// The tracking is replicated here without the ReShade API, so this does not depend on any Windows headers and can be built and run on any platform, e.g.:
+//   g++ -std=c++17 -O2 tools/generic_depth_replay_benchmark.cpp -pthread -o generic_depth_replay_benchmark && ./generic_depth_replay_benchmark [threads] [draws per command list] [frames]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct viewport
+{
+	float x, y, width, height, min_depth, max_depth;
+};
+
+// Same counters as in 'generic_depth_addon.cpp'
+struct draw_stats
+{
+	uint32_t vertices = 0;
+	uint32_t drawcalls = 0;
+	uint32_t drawcalls_indirect = 0;
+	viewport last_viewport = {};
+};
+struct depth_stencil_frame_stats
+{
+	draw_stats total_stats;
+	draw_stats current_stats;
+	bool reversed_clear_value = false;
+};
+
+using counters_map = std::unordered_map<uint64_t, depth_stencil_frame_stats>;
+
+static void merge_counters(counters_map &target, const counters_map &source)
+{
+	target.reserve(source.size());
+	for (const auto &[depth_stencil, source_counters] : source)
+	{
+		depth_stencil_frame_stats &counters = target[depth_stencil];
+		counters.total_stats.vertices += source_counters.total_stats.vertices;
+		counters.total_stats.drawcalls += source_counters.total_stats.drawcalls;
+		counters.total_stats.drawcalls_indirect += source_counters.total_stats.drawcalls_indirect;
+		counters.current_stats.vertices += source_counters.current_stats.vertices;
+		counters.current_stats.drawcalls += source_counters.current_stats.drawcalls;
+		counters.current_stats.drawcalls_indirect += source_counters.current_stats.drawcalls_indirect;
+		counters.reversed_clear_value = source_counters.reversed_clear_value;
+	}
+}
+
+// Recorded command, as seen by the add-on event callbacks
+struct command
+{
+	enum type : uint8_t
+	{
+		bind_depth_stencil,
+		bind_viewport,
+		clear_depth,
+		draw,
+		draw_indirect,
+	} type;
+	uint64_t depth_stencil;
+	uint32_t count;
+	uint32_t instances;
+};
+
+// A frame similar to that of a typical deferred renderer: a couple of shadow maps, a depth pre-pass and geometry pass into the main depth-stencil and post processing without a depth-stencil
+static std::vector<command> record_stream(std::mt19937 &rng, uint32_t num_draws)
+{
+	std::vector<command> stream;
+	stream.reserve(num_draws + 64);
+
+	const uint64_t main_depth_stencil = 0x1000, shadow_depth_stencils[] = { 0x2000, 0x3000, 0x4000 };
+
+	const auto add_draws = [&](uint32_t count) {
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (rng() % 32 == 0)
+				stream.push_back({ command::draw_indirect, 0, static_cast<uint32_t>(1 + rng() % 4), 0 });
+			else
+				stream.push_back({ command::draw, 0, static_cast<uint32_t>(3 * (1 + rng() % 2000)), static_cast<uint32_t>(1 + (rng() % 8 == 0 ? rng() % 16 : 0)) });
+		}
+	};
+
+	for (const uint64_t shadow_depth_stencil : shadow_depth_stencils)
+	{
+		stream.push_back({ command::bind_depth_stencil, shadow_depth_stencil, 0, 0 });
+		stream.push_back({ command::bind_viewport, 0, 2048, 2048 });
+		stream.push_back({ command::clear_depth, shadow_depth_stencil, 1, 0 });
+		add_draws(num_draws / 8);
+	}
+
+	stream.push_back({ command::bind_depth_stencil, main_depth_stencil, 0, 0 });
+	stream.push_back({ command::bind_viewport, 0, 3840, 2160 });
+	stream.push_back({ command::clear_depth, main_depth_stencil, 0, 0 });
+	add_draws(num_draws - 4 * (num_draws / 8));
+
+	stream.push_back({ command::bind_depth_stencil, 0, 0, 0 });
+	add_draws(num_draws / 8);
+
+	return stream;
+}
+
+// Tracking before the restructure: every draw looks up the counters in the hash map, and execute merges into the queue while holding a global lock
+struct global_lock_tracking
+{
+	struct state
+	{
+		viewport current_viewport = {};
+		uint64_t current_depth_stencil = 0;
+		counters_map counters_per_used_depth_stencil;
+	};
+
+	std::shared_mutex global_mutex;
+	state queue_state;
+
+	void replay(state &state, const std::vector<command> &stream, bool is_queue)
+	{
+		for (const command &cmd : stream)
+		{
+			switch (cmd.type)
+			{
+			case command::bind_depth_stencil:
+				state.current_depth_stencil = cmd.depth_stencil;
+				break;
+			case command::bind_viewport:
+				state.current_viewport = { 0, 0, static_cast<float>(cmd.count), static_cast<float>(cmd.instances), 0, 1 };
+				break;
+			case command::clear_depth:
+				if (cmd.count != 1)
+				{
+					std::shared_lock<std::shared_mutex> lock(global_mutex, std::defer_lock);
+					if (is_queue)
+						lock.lock();
+					state.counters_per_used_depth_stencil[cmd.depth_stencil].reversed_clear_value = true;
+				}
+				break;
+			case command::draw:
+				if (state.current_depth_stencil != 0)
+				{
+					std::shared_lock<std::shared_mutex> lock(global_mutex, std::defer_lock);
+					if (is_queue)
+						lock.lock();
+					depth_stencil_frame_stats &counters = state.counters_per_used_depth_stencil[state.current_depth_stencil];
+					counters.total_stats.vertices += cmd.count * cmd.instances;
+					counters.total_stats.drawcalls += 1;
+					counters.current_stats.vertices += cmd.count * cmd.instances;
+					counters.current_stats.drawcalls += 1;
+					counters.current_stats.last_viewport = state.current_viewport;
+				}
+				break;
+			case command::draw_indirect:
+				if (state.current_depth_stencil != 0)
+				{
+					std::shared_lock<std::shared_mutex> lock(global_mutex, std::defer_lock);
+					if (is_queue)
+						lock.lock();
+					depth_stencil_frame_stats &counters = state.counters_per_used_depth_stencil[state.current_depth_stencil];
+					counters.total_stats.drawcalls += cmd.count;
+					counters.total_stats.drawcalls_indirect += cmd.count;
+					counters.current_stats.drawcalls += cmd.count;
+					counters.current_stats.drawcalls_indirect += cmd.count;
+					counters.current_stats.last_viewport = state.current_viewport;
+				}
+				break;
+			}
+		}
+	}
+
+	void execute(const state &source)
+	{
+		const std::unique_lock<std::shared_mutex> lock(global_mutex);
+		queue_state.current_depth_stencil = source.current_depth_stencil;
+		merge_counters(queue_state.counters_per_used_depth_stencil, source.counters_per_used_depth_stencil);
+	}
+
+	// Present merged and then cleared the queue state under the global lock, and effect runtimes copied the resulting map
+	counters_map present()
+	{
+		const std::unique_lock<std::shared_mutex> lock(global_mutex);
+		counters_map frame_counters;
+		merge_counters(frame_counters, queue_state.counters_per_used_depth_stencil);
+		queue_state.counters_per_used_depth_stencil.clear();
+		return frame_counters;
+	}
+};
+
+// Current tracking: command list state is only touched by the recording thread and caches the counters of the bound depth-stencil, while queue state has its own lock that present only holds to swap the counters out
+struct command_list_local_tracking
+{
+	struct state
+	{
+		std::mutex queue_mutex;
+		viewport current_viewport = {};
+		uint64_t current_depth_stencil = 0;
+		counters_map counters_per_used_depth_stencil;
+		uint64_t cached_counters_resource = 0;
+		depth_stencil_frame_stats *cached_counters = nullptr;
+
+		depth_stencil_frame_stats &counters_for(uint64_t depth_stencil)
+		{
+			if (cached_counters == nullptr || cached_counters_resource != depth_stencil)
+			{
+				cached_counters = &counters_per_used_depth_stencil[depth_stencil];
+				cached_counters_resource = depth_stencil;
+			}
+			return *cached_counters;
+		}
+	};
+
+	state queue_state;
+	counters_map queue_counters;
+
+	void replay(state &state, const std::vector<command> &stream, bool is_queue)
+	{
+		for (const command &cmd : stream)
+		{
+			switch (cmd.type)
+			{
+			case command::bind_depth_stencil:
+				state.current_depth_stencil = cmd.depth_stencil;
+				break;
+			case command::bind_viewport:
+				state.current_viewport = { 0, 0, static_cast<float>(cmd.count), static_cast<float>(cmd.instances), 0, 1 };
+				break;
+			case command::clear_depth:
+				if (cmd.count != 1)
+				{
+					std::unique_lock<std::mutex> lock(state.queue_mutex, std::defer_lock);
+					if (is_queue)
+						lock.lock();
+					state.counters_for(cmd.depth_stencil).reversed_clear_value = true;
+				}
+				break;
+			case command::draw:
+				if (state.current_depth_stencil != 0)
+				{
+					std::unique_lock<std::mutex> lock(state.queue_mutex, std::defer_lock);
+					if (is_queue)
+						lock.lock();
+					depth_stencil_frame_stats &counters = state.counters_for(state.current_depth_stencil);
+					counters.total_stats.vertices += cmd.count * cmd.instances;
+					counters.total_stats.drawcalls += 1;
+					counters.current_stats.vertices += cmd.count * cmd.instances;
+					counters.current_stats.drawcalls += 1;
+					counters.current_stats.last_viewport = state.current_viewport;
+				}
+				break;
+			case command::draw_indirect:
+				if (state.current_depth_stencil != 0)
+				{
+					std::unique_lock<std::mutex> lock(state.queue_mutex, std::defer_lock);
+					if (is_queue)
+						lock.lock();
+					depth_stencil_frame_stats &counters = state.counters_for(state.current_depth_stencil);
+					counters.total_stats.drawcalls += cmd.count;
+					counters.total_stats.drawcalls_indirect += cmd.count;
+					counters.current_stats.drawcalls += cmd.count;
+					counters.current_stats.drawcalls_indirect += cmd.count;
+					counters.current_stats.last_viewport = state.current_viewport;
+				}
+				break;
+			}
+		}
+	}
+
+	void execute(const state &source)
+	{
+		const std::unique_lock<std::mutex> lock(queue_state.queue_mutex);
+		queue_state.current_depth_stencil = source.current_depth_stencil;
+		// Merge through the cached counters like 'state_tracking::merge_counters' does
+		for (const auto &[depth_stencil, source_counters] : source.counters_per_used_depth_stencil)
+		{
+			depth_stencil_frame_stats &counters = queue_state.counters_for(depth_stencil);
+			counters.total_stats.vertices += source_counters.total_stats.vertices;
+			counters.total_stats.drawcalls += source_counters.total_stats.drawcalls;
+			counters.total_stats.drawcalls_indirect += source_counters.total_stats.drawcalls_indirect;
+			counters.current_stats.vertices += source_counters.current_stats.vertices;
+			counters.current_stats.drawcalls += source_counters.current_stats.drawcalls;
+			counters.current_stats.drawcalls_indirect += source_counters.current_stats.drawcalls_indirect;
+			counters.reversed_clear_value = source_counters.reversed_clear_value;
+		}
+	}
+
+	counters_map present()
+	{
+		{
+			const std::unique_lock<std::mutex> lock(queue_state.queue_mutex);
+			queue_state.counters_per_used_depth_stencil.swap(queue_counters);
+			queue_state.cached_counters = nullptr;
+		}
+
+		counters_map frame_counters;
+		merge_counters(frame_counters, queue_counters);
+		queue_counters.clear();
+		return frame_counters;
+	}
+};
+
+// Print a value derived from the results, so that the compiler cannot optimize the tracking away (and both implementations can be checked to give the same result)
+static uint64_t checksum(const counters_map &frame_counters)
+{
+	uint64_t value = 0;
+	for (const auto &[depth_stencil, counters] : frame_counters)
+		value += depth_stencil * (counters.total_stats.vertices + 31ull * counters.total_stats.drawcalls + 17ull * counters.total_stats.drawcalls_indirect + counters.reversed_clear_value);
+	return value;
+}
+
+template <typename tracking_type>
+static double replay_frames(const std::vector<std::vector<command>> &streams, uint32_t num_frames, bool immediate, uint64_t &result)
+{
+	tracking_type tracking;
+	result = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (uint32_t frame = 0; frame < num_frames; ++frame)
+	{
+		if (immediate)
+		{
+			// Like D3D11 immediate context rendering, where all draws go to the queue state on the application thread
+			for (const std::vector<command> &stream : streams)
+				tracking.replay(tracking.queue_state, stream, true);
+		}
+		else
+		{
+			// Like D3D12 or Vulkan, where command lists are recorded in parallel and each thread executes its command list when done
+			std::vector<std::thread> threads;
+			for (const std::vector<command> &stream : streams)
+			{
+				threads.emplace_back([&tracking, &stream]() {
+					typename tracking_type::state state;
+					tracking.replay(state, stream, false);
+					tracking.execute(state);
+				});
+			}
+			for (std::thread &thread : threads)
+				thread.join();
+		}
+
+		result += checksum(tracking.present());
+	}
+
+	const auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::milli>(end - start).count() / num_frames;
+}
+
+int main(int argc, char *argv[])
+{
+	const uint32_t num_threads = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+	const uint32_t num_draws = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 20000;
+	const uint32_t num_frames = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 50;
+	if (num_threads == 0 || num_draws < 8 || num_frames == 0)
+	{
+		std::printf("usage: %s [threads] [draws per command list] [frames]\n", argv[0]);
+		return 1;
+	}
+
+	std::mt19937 rng(44);
+	std::vector<std::vector<command>> streams;
+	size_t num_commands = 0;
+	for (uint32_t i = 0; i < num_threads; ++i)
+		num_commands += streams.emplace_back(record_stream(rng, num_draws)).size();
+
+	std::printf("Replaying %u command lists with %zu commands in total for %u frames\n", num_threads, num_commands, num_frames);
+
+	for (const bool immediate : { true, false })
+	{
+		uint64_t global_lock_result = 0, command_list_local_result = 0;
+		const double global_lock_ms = replay_frames<global_lock_tracking>(streams, num_frames, immediate, global_lock_result);
+		const double command_list_local_ms = replay_frames<command_list_local_tracking>(streams, num_frames, immediate, command_list_local_result);
+
+		std::printf("%-23s global lock %8.3f ms per frame (%6.2f ns per command), command list local %8.3f ms per frame (%6.2f ns per command), %s (checksum %016llx)\n",
+			immediate ? "immediate context:" : "parallel command lists:",
+			global_lock_ms, global_lock_ms * 1e6 / num_commands,
+			command_list_local_ms, command_list_local_ms * 1e6 / num_commands,
+			global_lock_result == command_list_local_result ? "results match" : "results DIFFER",
+			static_cast<unsigned long long>(command_list_local_result));
+	}
+
+	return 0;
+}
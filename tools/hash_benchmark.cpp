@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2024 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+// Throughput benchmark for the texture hash functions selectable with 'RESHADE_ADDON_TEXTURE_HASH_ALGORITHM' in 'examples/utils/config.hpp'
+// This does not depend on any Windows headers, so can be built and run on any platform, e.g.:
+//   g++ -std=c++17 -O2 -I examples/utils tools/hash_benchmark.cpp -o hash_benchmark && ./hash_benchmark [size in KiB] [iterations]
+
+#include "crc32_hash.hpp"
+#include "xxh3_hash.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// Byte-wise table lookup, like 'compute_crc32' was before it was changed to slicing-by-16
+static uint32_t compute_crc32_bytewise(const uint8_t *data, size_t size)
+{
+	static constexpr crc32_slicing_tables<0xEDB88320> tables;
+
+	uint32_t crc = 0xFFFFFFFF;
+	for (; size != 0; --size, ++data)
+		crc = (crc >> 8) ^ tables.table[0][(crc ^ (*data)) & 0xFF];
+	return ~crc;
+}
+
+static uint64_t compute_crc32c_table(const uint8_t *data, size_t size)
+{
+	return compute_crc32_slicing_by_16<0x82F63B78>(data, size);
+}
+
+int main(int argc, char *argv[])
+{
+	// Default is the size of the top level of a 4096x4096 BC7 texture
+	const size_t size = (argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16384) * 1024;
+	const uint32_t iterations = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 10;
+	if (size == 0 || iterations == 0)
+	{
+		std::printf("usage: %s [size in KiB] [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	std::mt19937 rng(46);
+	std::vector<uint8_t> data(size);
+	for (uint8_t &value : data)
+		value = static_cast<uint8_t>(rng());
+
+	std::printf("Hashing %zu KiB %u times\n", size / 1024, iterations);
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	std::printf("Using %s code path for CRC32C\n", has_crc32c_sse42() ? "SSE4.2" : "table");
+#endif
+
+	static const struct { const char *name; uint64_t(*function)(const uint8_t *, size_t); } hash_functions[] = {
+		{ "CRC32 (byte-wise)", [](const uint8_t *data, size_t size) -> uint64_t { return compute_crc32_bytewise(data, size); } },
+		{ "CRC32 (slicing-by-16)", [](const uint8_t *data, size_t size) -> uint64_t { return compute_crc32(data, size); } },
+		{ "CRC32C (slicing-by-16)", compute_crc32c_table },
+		{ "CRC32C (hardware)", [](const uint8_t *data, size_t size) -> uint64_t { return compute_crc32c(data, size); } },
+		{ "XXH3", compute_xxh3_64 },
+	};
+
+	for (const auto &hash_function : hash_functions)
+	{
+		// Warm up caches before measuring
+		uint64_t hash = hash_function.function(data.data(), data.size());
+
+		double best_ms = 0.0, total_ms = 0.0;
+		for (uint32_t i = 0; i < iterations; ++i)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			hash += hash_function.function(data.data(), data.size());
+			const auto end = std::chrono::steady_clock::now();
+
+			const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+			total_ms += ms;
+			if (i == 0 || ms < best_ms)
+				best_ms = ms;
+		}
+
+		// Print a value derived from the hashes, so that the compiler cannot optimize the hashing away
+		std::printf("%-23s best %8.3f ms, average %8.3f ms, %8.1f MiB/s (checksum %016llx)\n",
+			hash_function.name, best_ms, total_ms / iterations, (size / (1024.0 * 1024.0)) / (best_ms / 1e3), static_cast<unsigned long long>(hash));
+	}
+
+	return 0;
+}
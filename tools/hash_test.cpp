@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2024 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+// Standalone known-answer test for the texture hash functions in 'examples/utils/crc32_hash.hpp' and 'examples/utils/xxh3_hash.hpp'
+// This does not depend on any Windows headers, so can be built and run on any platform, e.g.:
+//   g++ -std=c++17 -O2 -I examples/utils tools/hash_test.cpp -o hash_test && ./hash_test
+
+#include "crc32_hash.hpp"
+#include "xxh3_hash.hpp"
+#include <cstdio>
+#include <vector>
+
+static bool s_success = true;
+
+static void check(bool condition, const char *test_name, const char *description)
+{
+	if (condition)
+		return;
+
+	std::printf("FAILED: %s, %s\n", test_name, description);
+	s_success = false;
+}
+
+// Same input as the sanity tests of the xxHash reference implementation ('fillTestBuffer' in 'tests/sanity_test_vectors.h')
+static std::vector<uint8_t> create_sanity_buffer(size_t size)
+{
+	std::vector<uint8_t> buffer(size);
+	uint64_t byte_gen = 2654435761U;
+	for (uint8_t &value : buffer)
+	{
+		value = static_cast<uint8_t>(byte_gen >> 56);
+		byte_gen *= 11400714785074694797ULL;
+	}
+	return buffer;
+}
+
+// Byte-wise reference implementation, which every optimized variant has to match
+static uint32_t compute_crc32_bytewise(const uint8_t *data, size_t size, uint32_t polynomial)
+{
+	uint32_t crc = 0xFFFFFFFF;
+	for (size_t i = 0; i < size; ++i)
+	{
+		crc ^= data[i];
+		for (int k = 0; k < 8; ++k)
+			crc = (crc >> 1) ^ (polynomial & (0u - (crc & 1)));
+	}
+	return ~crc;
+}
+
+static void test_crc32()
+{
+	const char *const test_name = "CRC32";
+
+	const auto check_value = reinterpret_cast<const uint8_t *>("123456789");
+
+	check(compute_crc32(check_value, 9) == 0xCBF43926, test_name, "check value of \"123456789\" has to be 0xCBF43926");
+	check(compute_crc32(check_value, 0) == 0, test_name, "empty input has to give zero");
+
+	// Lengths around the 16 byte step of the sliced loop, at every alignment
+	const std::vector<uint8_t> buffer = create_sanity_buffer(4096 + 16);
+	bool all_match = true;
+	for (size_t offset = 0; offset < 16; ++offset)
+		for (size_t size = 0; size < 300; ++size)
+			all_match &= compute_crc32(buffer.data() + offset, size) == compute_crc32_bytewise(buffer.data() + offset, size, 0xEDB88320);
+	all_match &= compute_crc32(buffer.data(), 4096) == compute_crc32_bytewise(buffer.data(), 4096, 0xEDB88320);
+	check(all_match, test_name, "slicing-by-16 has to match the byte-wise implementation");
+}
+
+static void test_crc32c()
+{
+	const char *const test_name = "CRC32C";
+
+	const auto check_value = reinterpret_cast<const uint8_t *>("123456789");
+
+	check(compute_crc32c(check_value, 9) == 0xE3069283, test_name, "check value of \"123456789\" has to be 0xE3069283");
+	check(compute_crc32_slicing_by_16<0x82F63B78>(check_value, 9) == 0xE3069283, test_name, "check value of the table fallback has to be 0xE3069283");
+
+	const std::vector<uint8_t> buffer = create_sanity_buffer(4096 + 16);
+	bool all_match = true;
+	for (size_t offset = 0; offset < 16; ++offset)
+	{
+		for (size_t size = 0; size < 300; ++size)
+		{
+			const uint32_t expected = compute_crc32_bytewise(buffer.data() + offset, size, 0x82F63B78);
+			all_match &= compute_crc32c(buffer.data() + offset, size) == expected;
+			all_match &= compute_crc32_slicing_by_16<0x82F63B78>(buffer.data() + offset, size) == expected;
+		}
+	}
+	check(all_match, test_name, "hardware and table implementations have to match the byte-wise implementation");
+}
+
+static void test_xxh3()
+{
+	const char *const test_name = "XXH3";
+
+	// Test vectors of 'XXH3_64bits' with a seed of zero from the xxHash reference implementation, which cover every length class (0-16, 17-128, 129-240 and long input with one or multiple blocks)
+	static const struct { size_t size; uint64_t hash; } test_vectors[] = {
+		{    0, 0x2D06800538D394C2ULL },
+		{    1, 0xC44BDFF4074EECDBULL },
+		{    6, 0x27B56A84CD2D7325ULL },
+		{   12, 0xA713DAF0DFBB77E7ULL },
+		{   24, 0xA3FE70BF9D3510EBULL },
+		{   48, 0x397DA259ECBA1F11ULL },
+		{   80, 0xBCDEFBBB2C47C90AULL },
+		{  195, 0xCD94217EE362EC3AULL },
+		{  403, 0xCDEB804D65C6DEA4ULL },
+		{  512, 0x617E49599013CB6BULL },
+		{ 2048, 0xDD59E2C3A5F038E0ULL },
+		{ 2240, 0x6E73A90539CF2948ULL },
+		{ 2367, 0xCB37AEB9E5D361EDULL },
+	};
+
+	const std::vector<uint8_t> buffer = create_sanity_buffer(4096);
+
+	for (const auto &test_vector : test_vectors)
+	{
+		if (compute_xxh3_64(buffer.data(), test_vector.size) != test_vector.hash)
+		{
+			std::printf("FAILED: %s, hash of %zu bytes is %016llx instead of %016llx\n", test_name, test_vector.size,
+				static_cast<unsigned long long>(compute_xxh3_64(buffer.data(), test_vector.size)), static_cast<unsigned long long>(test_vector.hash));
+			s_success = false;
+		}
+	}
+}
+
+int main()
+{
+	test_crc32();
+	test_crc32c();
+	test_xxh3();
+
+	std::printf(s_success ? "All tests passed.\n" : "Some tests failed!\n");
+
+	return s_success ? 0 : 1;
+}
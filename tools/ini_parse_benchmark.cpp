@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2024 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+// Benchmark for loading and querying INI files with 'source/ini_file.cpp', using a generated file shaped like a large preset
+// The INI file code uses the Windows API, so this has to be built on Windows, e.g. from a developer command prompt:
+//   cl /std:c++17 /O2 /EHsc /I source /I deps\utfcpp\source tools\ini_parse_benchmark.cpp source\ini_file.cpp && ini_parse_benchmark.exe [sections] [keys per section] [iterations]
+
+#include "ini_file.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+std::filesystem::path g_reshade_dll_path;
+std::filesystem::path g_reshade_base_path;
+std::filesystem::path g_target_executable_path;
+
+// Mix of the value shapes found in presets and 'ReShade.ini': single numbers, vectors, comma separated lists with escaped commas and empty values
+static std::string create_ini(unsigned int num_sections, unsigned int num_keys)
+{
+	std::string data;
+	data += "Techniques=";
+	for (unsigned int i = 0; i < num_sections; ++i)
+		data += "Technique" + std::to_string(i) + "@Effect" + std::to_string(i) + ".fx,";
+	data += "\n\n";
+
+	for (unsigned int section_index = 0; section_index < num_sections; ++section_index)
+	{
+		data += "[Effect" + std::to_string(section_index) + ".fx]\n";
+		for (unsigned int key_index = 0; key_index < num_keys; ++key_index)
+		{
+			data += "Uniform" + std::to_string(key_index) + '=';
+			switch (key_index % 4)
+			{
+			case 0:
+				data += std::to_string(key_index * 0.125);
+				break;
+			case 1:
+				data += "0.250000,0.500000,0.750000,1.000000";
+				break;
+			case 2:
+				data += "Some text,,with an escaped comma,and a second element";
+				break;
+			case 3:
+				break;
+			}
+			data += '\n';
+		}
+		data += '\n';
+	}
+
+	return data;
+}
+
+int main(int argc, char *argv[])
+{
+	const unsigned int num_sections = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100;
+	const unsigned int num_keys = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 50;
+	const unsigned int iterations = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 20;
+	if (num_sections == 0 || num_keys == 0 || iterations == 0)
+	{
+		std::printf("usage: %s [sections] [keys per section] [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / L"ini_parse_benchmark.ini";
+	const std::string data = create_ini(num_sections, num_keys);
+	if (FILE *const file = _wfopen(path.c_str(), L"wb"))
+	{
+		fwrite(data.data(), 1, data.size(), file);
+		fclose(file);
+	}
+	else
+	{
+		std::printf("Failed to write '%s'!\n", path.u8string().c_str());
+		return 1;
+	}
+
+	std::printf("Loading a %.1f KiB INI file with %u sections of %u keys %u times\n", data.size() / 1024.0, num_sections, num_keys, iterations);
+
+	// Constructing a new instance every iteration, since 'load' skips files that were not modified since they were last loaded
+	double best_load_ms = 0.0, total_load_ms = 0.0;
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		const reshade::ini_file ini(path);
+		const auto end = std::chrono::steady_clock::now();
+
+		const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+		total_load_ms += ms;
+		if (i == 0 || ms < best_load_ms)
+			best_load_ms = ms;
+	}
+
+	// Query every key through string views, like the runtime does when it loads a preset
+	const reshade::ini_file ini(path);
+	std::vector<std::string> section_names(num_sections), key_names(num_keys);
+	for (unsigned int i = 0; i < num_sections; ++i)
+		section_names[i] = "Effect" + std::to_string(i) + ".fx";
+	for (unsigned int i = 0; i < num_keys; ++i)
+		key_names[i] = "Uniform" + std::to_string(i);
+
+	double checksum = 0.0;
+	double best_get_ms = 0.0, total_get_ms = 0.0;
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		for (const std::string &section_name : section_names)
+		{
+			for (const std::string &key_name : key_names)
+			{
+				float values[4] = {};
+				ini.get(section_name, key_name, values);
+				checksum += values[0] + values[3];
+			}
+		}
+		const auto end = std::chrono::steady_clock::now();
+
+		const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+		total_get_ms += ms;
+		if (i == 0 || ms < best_get_ms)
+			best_get_ms = ms;
+	}
+
+	std::filesystem::remove(path);
+
+	const double num_lookups = static_cast<double>(num_sections) * num_keys;
+
+	std::printf("load best %8.3f ms, average %8.3f ms, %8.1f MiB/s\n",
+		best_load_ms, total_load_ms / iterations, (data.size() / (1024.0 * 1024.0)) / (best_load_ms / 1e3));
+	// Print a value derived from the queried values, so that the compiler cannot optimize the lookups away
+	std::printf("get  best %8.3f ms, average %8.3f ms, %8.1f ns per key (checksum %.3f)\n",
+		best_get_ms, total_get_ms / iterations, best_get_ms * 1e6 / num_lookups, checksum);
+
+	return 0;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2024 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+// Benchmark for the cost of logging a message on the calling thread in 'source/dll_log.cpp', with and without the background writer
+// The logger uses the Windows API, so this has to be built on Windows, e.g. from a developer command prompt:
+//   cl /std:c++17 /O2 /EHsc /I source tools\log_benchmark.cpp source\dll_log.cpp && log_benchmark.exe [threads] [messages per thread]
+
+#include "dll_log.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+static double log_messages(unsigned int num_threads, unsigned int num_messages, bool repeated)
+{
+	std::vector<std::thread> threads;
+
+	const auto start = std::chrono::steady_clock::now();
+	for (unsigned int thread_index = 0; thread_index < num_threads; ++thread_index)
+	{
+		threads.emplace_back([thread_index, num_messages, repeated]() {
+			for (unsigned int i = 0; i < num_messages; ++i)
+			{
+				// Repeated messages exercise the rate limiter, which suppresses most of them, while unique messages are all written
+				if (repeated)
+					reshade::log::message(reshade::log::level::info, "Repeated message from thread %u.", thread_index);
+				else
+					reshade::log::message(reshade::log::level::info, "Message %u from thread %u with some additional text to make it about as long as a typical log line.", i, thread_index);
+			}
+		});
+	}
+	for (std::thread &thread : threads)
+		thread.join();
+	const auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / (static_cast<double>(num_threads) * num_messages);
+}
+
+int main(int argc, char *argv[])
+{
+	const unsigned int num_threads = argc > 1 ? static_cast<unsigned int>(std::strtoul(argv[1], nullptr, 10)) : 4;
+	const unsigned int num_messages = argc > 2 ? static_cast<unsigned int>(std::strtoul(argv[2], nullptr, 10)) : 20000;
+	if (num_threads == 0 || num_messages == 0)
+	{
+		std::printf("usage: %s [threads] [messages per thread]\n", argv[0]);
+		return 1;
+	}
+
+	std::error_code ec;
+	const std::filesystem::path log_path = std::filesystem::temp_directory_path(ec) / L"reshade_log_benchmark.log";
+	if (!reshade::log::open_log_file(log_path, ec))
+	{
+		std::printf("Failed to open log file '%s'!\n", log_path.u8string().c_str());
+		return 1;
+	}
+
+	std::printf("Logging %u messages on each of %u threads to '%s'\n", num_messages, num_threads, log_path.u8string().c_str());
+
+	// Wall time divided by the number of messages, which includes the time threads spend waiting on each other
+	std::printf("Synchronous writes, unique messages:   %8.1f ns per message\n", log_messages(num_threads, num_messages, false));
+	std::printf("Synchronous writes, repeated messages: %8.1f ns per message\n", log_messages(num_threads, num_messages, true));
+
+	reshade::log::start_background_writer();
+	std::printf("Background writer, unique messages:    %8.1f ns per message\n", log_messages(num_threads, num_messages, false));
+	std::printf("Background writer, repeated messages:  %8.1f ns per message\n", log_messages(num_threads, num_messages, true));
+
+	const auto start = std::chrono::steady_clock::now();
+	reshade::log::stop_background_writer();
+	const auto end = std::chrono::steady_clock::now();
+	std::printf("Stopping the background writer took %.3f ms\n", std::chrono::duration<double, std::milli>(end - start).count());
+
+	return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2024 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+// Throughput benchmark for the screenshot encoders at 4K and 8K, both for a single image and for a burst of images encoded on a worker pool sized like the one in 'reshade::runtime::queue_screenshot_job'
+// This only depends on the fpng and stb submodules, so can be built and run on any platform, e.g.:
+//   g++ -std=c++17 -O2 -msse4.1 -mpclmul -I deps/fpng/src -I deps/stb tools/screenshot_encode_benchmark.cpp deps/fpng/src/fpng.cpp -pthread -o screenshot_encode_benchmark && ./screenshot_encode_benchmark [burst] [jpeg quality]
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <fpng.h>
+#include <stb_image_write.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+enum class encoder
+{
+	fpng,
+	png,
+	jpeg,
+};
+
+static const char *const s_encoder_names[] = { "PNG (fpng)", "PNG (stb)", "JPEG (stb)" };
+
+static void write_callback(void *context, void *data, int size)
+{
+	// Only count the bytes, to not measure disk throughput
+	*static_cast<size_t *>(context) += size;
+	(void)data;
+}
+
+static size_t encode(encoder type, const std::vector<uint8_t> &pixels, uint32_t width, uint32_t height, int jpeg_quality)
+{
+	size_t encoded_size = 0;
+
+	switch (type)
+	{
+	case encoder::fpng:
+		if (std::vector<uint8_t> encoded_data;
+			fpng::fpng_encode_image_to_memory(pixels.data(), width, height, 4, encoded_data))
+			encoded_size = encoded_data.size();
+		break;
+	case encoder::png:
+		stbi_write_png_to_func(write_callback, &encoded_size, width, height, 4, pixels.data(), 0);
+		break;
+	case encoder::jpeg:
+		stbi_write_jpg_to_func(write_callback, &encoded_size, width, height, 4, pixels.data(), jpeg_quality);
+		break;
+	}
+
+	return encoded_size;
+}
+
+// Something between a flat color and pure noise, which compresses about as well as a typical game frame
+static std::vector<uint8_t> create_image(uint32_t width, uint32_t height)
+{
+	std::mt19937 rng(35);
+	std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			uint8_t *const pixel = pixels.data() + (static_cast<size_t>(y) * width + x) * 4;
+			const uint32_t noise = rng() & 0x0F0F0F;
+
+			pixel[0] = static_cast<uint8_t>((x * 255) / width + (noise & 0xF));
+			pixel[1] = static_cast<uint8_t>((y * 255) / height + ((noise >> 8) & 0xF));
+			pixel[2] = static_cast<uint8_t>(((x ^ y) >> 4) + ((noise >> 16) & 0xF));
+			pixel[3] = 0xFF;
+		}
+	}
+
+	return pixels;
+}
+
+int main(int argc, char *argv[])
+{
+	const uint32_t burst = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 8;
+	const int jpeg_quality = argc > 2 ? std::atoi(argv[2]) : 90;
+	if (burst == 0 || jpeg_quality < 1 || jpeg_quality > 100)
+	{
+		std::printf("usage: %s [burst] [jpeg quality]\n", argv[0]);
+		return 1;
+	}
+
+	fpng::fpng_init();
+
+	// Same pool size as the screenshot workers in the runtime
+	const unsigned int num_workers = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+
+	std::printf("Encoding single images and bursts of %u images on %u worker threads\n", burst, num_workers);
+
+	static const uint32_t sizes[][2] = { { 3840, 2160 }, { 7680, 4320 } };
+
+	for (const auto &size : sizes)
+	{
+		const uint32_t width = size[0], height = size[1];
+		const std::vector<uint8_t> pixels = create_image(width, height);
+		const double megapixels = static_cast<double>(width) * height / 1e6;
+
+		for (size_t encoder_index = 0; encoder_index < std::size(s_encoder_names); ++encoder_index)
+		{
+			const auto type = static_cast<encoder>(encoder_index);
+
+			// Single image, which is the latency of a single screenshot
+			const auto single_start = std::chrono::steady_clock::now();
+			const size_t encoded_size = encode(type, pixels, width, height, jpeg_quality);
+			const auto single_end = std::chrono::steady_clock::now();
+			const double single_ms = std::chrono::duration<double, std::milli>(single_end - single_start).count();
+
+			// Burst of images pulled from a shared counter by the worker pool, which is the throughput during burst capture
+			std::atomic<uint32_t> next_image = 0;
+			std::vector<std::thread> workers;
+			const auto burst_start = std::chrono::steady_clock::now();
+			for (unsigned int i = 0; i < num_workers; ++i)
+			{
+				workers.emplace_back([&]() {
+					while (next_image.fetch_add(1) < burst)
+						encode(type, pixels, width, height, jpeg_quality);
+				});
+			}
+			for (std::thread &thread : workers)
+				thread.join();
+			const auto burst_end = std::chrono::steady_clock::now();
+			const double burst_ms = std::chrono::duration<double, std::milli>(burst_end - burst_start).count();
+
+			std::printf("%ux%u %-10s single %9.1f ms (%6.1f MPixel/s, %5.1f MiB), burst %6.2f images/s (%6.1f MPixel/s)\n",
+				width, height, s_encoder_names[encoder_index],
+				single_ms, megapixels / (single_ms / 1e3), encoded_size / (1024.0 * 1024.0),
+				burst / (burst_ms / 1e3), burst * megapixels / (burst_ms / 1e3));
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,448 @@
+/*
+ * Copyright (C) 2024 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+// Micro-benchmark comparing the per-frame special uniform update in 'reshade::runtime::render_effects' before and after annotation values were resolved once in 'create_effect'
+// This only depends on the effect module header, so can be built and run on any platform, e.g.:
+//   g++ -std=c++17 -O2 -I source tools/special_uniform_benchmark.cpp -o special_uniform_benchmark && ./special_uniform_benchmark [uniforms] [frames]
+
+#include "effect_module.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+// Subset of 'reshade::special_uniform' which reads annotations every frame
+enum class special_uniform
+{
+	none,
+	random,
+	ping_pong,
+	key,
+	mouse_wheel,
+};
+
+// Same linear annotation search as 'reshade::uniform' in 'source/runtime_internal.hpp'
+struct uniform : reshadefx::uniform
+{
+	auto annotation_as_int(const std::string_view ann_name, size_t i = 0, int default_value = 0) const
+	{
+		const auto it = std::find_if(annotations.cbegin(), annotations.cend(),
+			[ann_name](const reshadefx::annotation &annotation) { return annotation.name == ann_name; });
+		return it != annotations.cend() && i < 16 ?
+			(it->type.is_integral() ? it->value.as_int[i] : static_cast<int>(it->value.as_float[i])) : default_value;
+	}
+	auto annotation_as_float(const std::string_view ann_name, size_t i = 0, float default_value = 0.0f) const
+	{
+		const auto it = std::find_if(annotations.cbegin(), annotations.cend(),
+			[ann_name](const reshadefx::annotation &annotation) { return annotation.name == ann_name; });
+		return it != annotations.cend() && i < 16 ?
+			(it->type.is_floating_point() ? it->value.as_float[i] : static_cast<float>(it->value.as_int[i])) : default_value;
+	}
+	auto annotation_as_string(const std::string_view ann_name, const std::string_view default_value = std::string_view()) const
+	{
+		const auto it = std::find_if(annotations.cbegin(), annotations.cend(),
+			[ann_name](const reshadefx::annotation &annotation) { return annotation.name == ann_name; });
+		return it != annotations.cend() ?
+			std::string_view(it->value.string_data) : default_value;
+	}
+
+	special_uniform special = special_uniform::none;
+};
+
+// Same layout as 'reshade::special_uniform_update' in 'source/runtime_internal.hpp'
+struct special_uniform_update
+{
+	enum class key_mode : uint8_t
+	{
+		down,
+		press,
+		toggle
+	};
+
+	special_uniform special = special_uniform::none;
+	key_mode mode = key_mode::down;
+	uint32_t uniform_index = 0;
+
+	int keycode = 0;
+	int int_range[2] = {};
+	float float_range[2] = {};
+	float step[2] = {};
+	float smoothing = 0.0f;
+};
+
+static std::vector<uint8_t> s_uniform_data;
+static bool s_key_state[256] = {};
+
+static void get_uniform_value(const uniform &variable, float *values, size_t count)
+{
+	std::memcpy(values, s_uniform_data.data() + variable.offset, std::min<size_t>(count * sizeof(float), variable.size));
+}
+static void set_uniform_value(const uniform &variable, const float *values, size_t count)
+{
+	std::memcpy(s_uniform_data.data() + variable.offset, values, std::min<size_t>(count * sizeof(float), variable.size));
+}
+static void set_uniform_value(const uniform &variable, int value)
+{
+	std::memcpy(s_uniform_data.data() + variable.offset, &value, sizeof(value));
+}
+
+static void add_annotation(uniform &variable, const char *name, reshadefx::type::datatype base, float value)
+{
+	reshadefx::annotation &annotation = variable.annotations.emplace_back();
+	annotation.name = name;
+	annotation.type.base = base;
+	annotation.type.rows = 1;
+	annotation.type.cols = 1;
+	if (base == reshadefx::type::t_float)
+		annotation.value.as_float[0] = value;
+	else
+		annotation.value.as_int[0] = static_cast<int>(value);
+}
+static void add_annotation(uniform &variable, const char *name, const char *value)
+{
+	reshadefx::annotation &annotation = variable.annotations.emplace_back();
+	annotation.name = name;
+	annotation.type.base = reshadefx::type::t_string;
+	annotation.value.string_data = value;
+}
+
+static std::vector<uniform> create_uniforms(uint32_t count)
+{
+	std::vector<uniform> uniforms(count);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uniform &variable = uniforms[i];
+		variable.size = 2 * sizeof(float);
+		variable.offset = i * 16;
+
+		// Add a few UI annotations in front, like most effects do, so that lookups have to skip over them
+		add_annotation(variable, "ui_type", "slider");
+		add_annotation(variable, "ui_label", "Label");
+		add_annotation(variable, "ui_tooltip", "Tooltip");
+
+		switch (i % 4)
+		{
+		case 0:
+			variable.special = special_uniform::random;
+			add_annotation(variable, "source", "random");
+			add_annotation(variable, "min", reshadefx::type::t_int, 0);
+			add_annotation(variable, "max", reshadefx::type::t_int, 100);
+			break;
+		case 1:
+			variable.special = special_uniform::ping_pong;
+			add_annotation(variable, "source", "pingpong");
+			add_annotation(variable, "min", reshadefx::type::t_float, 0.0f);
+			add_annotation(variable, "max", reshadefx::type::t_float, 10.0f);
+			add_annotation(variable, "step", reshadefx::type::t_float, 2.0f);
+			add_annotation(variable, "smoothing", reshadefx::type::t_float, 0.0f);
+			break;
+		case 2:
+			variable.special = special_uniform::key;
+			add_annotation(variable, "source", "key");
+			add_annotation(variable, "keycode", reshadefx::type::t_int, static_cast<float>(0x41 + i % 26));
+			add_annotation(variable, "mode", i % 3 == 0 ? "toggle" : "press");
+			break;
+		case 3:
+			variable.special = special_uniform::mouse_wheel;
+			add_annotation(variable, "source", "mousewheel");
+			add_annotation(variable, "min", reshadefx::type::t_float, -10.0f);
+			add_annotation(variable, "max", reshadefx::type::t_float, 10.0f);
+			break;
+		}
+	}
+
+	s_uniform_data.assign(static_cast<size_t>(count) * 16, 0);
+
+	return uniforms;
+}
+
+// Per-frame update before the change, which looked up every annotation each time
+static void update_with_annotation_lookups(std::vector<uniform> &uniforms, float frame_time, float wheel_delta)
+{
+	for (uniform &variable : uniforms)
+	{
+		switch (variable.special)
+		{
+		case special_uniform::random:
+		{
+			const int min = variable.annotation_as_int("min", 0, 0);
+			const int max = variable.annotation_as_int("max", 0, RAND_MAX);
+			set_uniform_value(variable, min + (std::rand() % (std::abs(max - min) + 1)));
+			break;
+		}
+		case special_uniform::ping_pong:
+		{
+			const float min = variable.annotation_as_float("min", 0, 0.0f);
+			const float max = variable.annotation_as_float("max", 0, 1.0f);
+			const float step_min = variable.annotation_as_float("step", 0);
+			const float step_max = variable.annotation_as_float("step", 1);
+			float increment = step_max == 0 ? step_min : (step_min + std::fmod(static_cast<float>(std::rand()), step_max - step_min + 1));
+			const float smoothing = variable.annotation_as_float("smoothing");
+
+			float value[2] = { 0, 0 };
+			get_uniform_value(variable, value, 2);
+			if (value[1] >= 0)
+			{
+				if (smoothing > 0)
+					increment *= std::max(1.0f - std::exp(-smoothing * (max - value[0])), 0.05f);
+				if ((value[0] += increment * frame_time) >= max)
+					value[0] = max, value[1] = -1;
+			}
+			else
+			{
+				if ((value[0] -= increment * frame_time) <= min)
+					value[0] = min, value[1] = +1;
+			}
+			set_uniform_value(variable, value, 2);
+			break;
+		}
+		case special_uniform::key:
+		{
+			if (const int keycode = variable.annotation_as_int("keycode");
+				keycode > 7 && keycode < 256)
+			{
+				if (const std::string_view mode = variable.annotation_as_string("mode");
+					mode == "toggle" || variable.annotation_as_int("toggle"))
+				{
+					float current_value = 0;
+					get_uniform_value(variable, &current_value, 1);
+					if (s_key_state[keycode])
+						set_uniform_value(variable, current_value == 0);
+				}
+				else if (mode == "press")
+					set_uniform_value(variable, s_key_state[keycode]);
+				else
+					set_uniform_value(variable, s_key_state[keycode]);
+			}
+			break;
+		}
+		case special_uniform::mouse_wheel:
+		{
+			const float min = variable.annotation_as_float("min");
+			const float max = variable.annotation_as_float("max");
+			float step = variable.annotation_as_float("step");
+			if (step == 0.0f)
+				step  = 1.0f;
+
+			float value[2] = { 0, 0 };
+			get_uniform_value(variable, value, 2);
+			value[1] = wheel_delta;
+			value[0] = value[0] + wheel_delta * step;
+			if (min != max)
+				value[0] = std::max(min, std::min(value[0], max));
+			set_uniform_value(variable, value, 2);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+// Table creation done once in 'create_effect'
+static std::vector<special_uniform_update> create_update_table(const std::vector<uniform> &uniforms)
+{
+	std::vector<special_uniform_update> updates;
+
+	for (size_t uniform_index = 0; uniform_index < uniforms.size(); ++uniform_index)
+	{
+		const uniform &variable = uniforms[uniform_index];
+
+		special_uniform_update update;
+		update.special = variable.special;
+		update.uniform_index = static_cast<uint32_t>(uniform_index);
+
+		switch (variable.special)
+		{
+		case special_uniform::none:
+			continue;
+		case special_uniform::random:
+			update.int_range[0] = variable.annotation_as_int("min", 0, 0);
+			update.int_range[1] = variable.annotation_as_int("max", 0, RAND_MAX);
+			break;
+		case special_uniform::ping_pong:
+			update.float_range[0] = variable.annotation_as_float("min", 0, 0.0f);
+			update.float_range[1] = variable.annotation_as_float("max", 0, 1.0f);
+			update.step[0] = variable.annotation_as_float("step", 0);
+			update.step[1] = variable.annotation_as_float("step", 1);
+			update.smoothing = variable.annotation_as_float("smoothing");
+			break;
+		case special_uniform::key:
+			update.keycode = variable.annotation_as_int("keycode");
+			if (update.keycode <= 7 || update.keycode >= 256)
+				continue;
+			if (const std::string_view mode = variable.annotation_as_string("mode");
+				mode == "toggle" || variable.annotation_as_int("toggle"))
+				update.mode = special_uniform_update::key_mode::toggle;
+			else if (mode == "press")
+				update.mode = special_uniform_update::key_mode::press;
+			else
+				update.mode = special_uniform_update::key_mode::down;
+			break;
+		case special_uniform::mouse_wheel:
+			update.float_range[0] = variable.annotation_as_float("min");
+			update.float_range[1] = variable.annotation_as_float("max");
+			update.step[0] = variable.annotation_as_float("step");
+			if (update.step[0] == 0.0f)
+				update.step[0] = 1.0f;
+			break;
+		}
+
+		updates.push_back(update);
+	}
+
+	return updates;
+}
+
+// Per-frame update after the change, which only walks the precompiled table
+static void update_with_table(std::vector<uniform> &uniforms, const std::vector<special_uniform_update> &updates, float frame_time, float wheel_delta)
+{
+	for (const special_uniform_update &update : updates)
+	{
+		uniform &variable = uniforms[update.uniform_index];
+
+		switch (update.special)
+		{
+		case special_uniform::random:
+		{
+			const int min = update.int_range[0];
+			const int max = update.int_range[1];
+			set_uniform_value(variable, min + (std::rand() % (std::abs(max - min) + 1)));
+			break;
+		}
+		case special_uniform::ping_pong:
+		{
+			const float min = update.float_range[0];
+			const float max = update.float_range[1];
+			const float step_min = update.step[0];
+			const float step_max = update.step[1];
+			float increment = step_max == 0 ? step_min : (step_min + std::fmod(static_cast<float>(std::rand()), step_max - step_min + 1));
+			const float smoothing = update.smoothing;
+
+			float value[2] = { 0, 0 };
+			get_uniform_value(variable, value, 2);
+			if (value[1] >= 0)
+			{
+				if (smoothing > 0)
+					increment *= std::max(1.0f - std::exp(-smoothing * (max - value[0])), 0.05f);
+				if ((value[0] += increment * frame_time) >= max)
+					value[0] = max, value[1] = -1;
+			}
+			else
+			{
+				if ((value[0] -= increment * frame_time) <= min)
+					value[0] = min, value[1] = +1;
+			}
+			set_uniform_value(variable, value, 2);
+			break;
+		}
+		case special_uniform::key:
+		{
+			switch (update.mode)
+			{
+			case special_uniform_update::key_mode::toggle:
+				if (s_key_state[update.keycode])
+				{
+					float current_value = 0;
+					get_uniform_value(variable, &current_value, 1);
+					set_uniform_value(variable, current_value == 0);
+				}
+				break;
+			case special_uniform_update::key_mode::press:
+			case special_uniform_update::key_mode::down:
+				set_uniform_value(variable, s_key_state[update.keycode]);
+				break;
+			}
+			break;
+		}
+		case special_uniform::mouse_wheel:
+		{
+			const float min = update.float_range[0];
+			const float max = update.float_range[1];
+			const float step = update.step[0];
+
+			float value[2] = { 0, 0 };
+			get_uniform_value(variable, value, 2);
+			value[1] = wheel_delta;
+			value[0] = value[0] + wheel_delta * step;
+			if (min != max)
+				value[0] = std::max(min, std::min(value[0], max));
+			set_uniform_value(variable, value, 2);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+template <typename F>
+static void measure(const char *name, uint32_t frames, uint32_t uniform_count, F &&update)
+{
+	// Warm up caches before measuring
+	update(0);
+
+	double best_ms = 0.0, total_ms = 0.0;
+	for (uint32_t i = 0; i < frames; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		update(i);
+		const auto end = std::chrono::steady_clock::now();
+
+		const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+		total_ms += ms;
+		if (i == 0 || ms < best_ms)
+			best_ms = ms;
+	}
+
+	// Print a value derived from the uniform storage, so that the compiler cannot optimize the updates away
+	uint32_t checksum = 0;
+	for (size_t i = 0; i < s_uniform_data.size(); i += 7)
+		checksum = checksum * 31 + s_uniform_data[i];
+
+	std::printf("%-20s best %8.3f ms, average %8.3f ms per frame, %8.1f ns per uniform (checksum %08x)\n",
+		name, best_ms, total_ms / frames, (best_ms * 1e6) / uniform_count, checksum);
+}
+
+int main(int argc, char *argv[])
+{
+	const uint32_t uniform_count = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 4096;
+	const uint32_t frames = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 1000;
+	if (uniform_count == 0 || frames == 0)
+	{
+		std::printf("usage: %s [uniforms] [frames]\n", argv[0]);
+		return 1;
+	}
+
+	std::printf("Updating %u special uniforms for %u frames\n", uniform_count, frames);
+
+	std::vector<uniform> uniforms = create_uniforms(uniform_count);
+
+	std::srand(28);
+	measure("annotation lookups", frames, uniform_count, [&](uint32_t frame) {
+		s_key_state[0x41 + frame % 26] = (frame % 2) != 0;
+		update_with_annotation_lookups(uniforms, 16.0f, (frame % 3) - 1.0f);
+	});
+
+	s_uniform_data.assign(s_uniform_data.size(), 0);
+	std::fill_n(s_key_state, 256, false);
+
+	const auto start = std::chrono::steady_clock::now();
+	const std::vector<special_uniform_update> updates = create_update_table(uniforms);
+	const auto end = std::chrono::steady_clock::now();
+	std::printf("Creating the update table took %.3f ms\n", std::chrono::duration<double, std::milli>(end - start).count());
+
+	std::srand(28);
+	measure("precompiled table", frames, uniform_count, [&](uint32_t frame) {
+		s_key_state[0x41 + frame % 26] = (frame % 2) != 0;
+		update_with_table(uniforms, updates, 16.0f, (frame % 3) - 1.0f);
+	});
+
+	return 0;
+}